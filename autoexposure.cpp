@@ -0,0 +1,110 @@
+#include "autoexposure.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+// a level this close to full scale is clipped: the real one is unknown
+constexpr double ClipLevel = 0.99;
+// clipped highlights step down at least this much
+constexpr double ClippedHighlightStep = 0.5;
+
+}  // namespace
+
+
+AutoExposure::AutoExposure()
+    : mtx()
+    , config()
+    , status()
+    , nSkip(0)
+    , lastChange()
+{}
+
+void AutoExposure::SetConfig(const AutoExposureConfig &config) {
+    std::lock_guard<std::mutex> lock(mtx);
+    this->config = config;
+    this->config.nMinExposure = std::max<long>(1, config.nMinExposure);
+    this->config.nMaxExposure = std::max(this->config.nMinExposure, config.nMaxExposure);
+    this->config.nMaxGain = std::max(config.nMinGain, config.nMaxGain);
+    this->config.dMaxStep = std::max(1.0, config.dMaxStep);
+}
+AutoExposureConfig AutoExposure::GetConfig() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return config;
+}
+
+void AutoExposure::Reset() {
+    std::lock_guard<std::mutex> lock(mtx);
+    status = AutoExposureStatus();
+    nSkip = 0;
+    lastChange = clock::time_point();
+}
+
+double AutoExposure::GainFactor(long nGain) const {
+    return config.dGainDbPerUnit > 0 ? std::pow(10.0, nGain * config.dGainDbPerUnit / 20) : 1.0;
+}
+
+std::optional<AutoExposureSettings> AutoExposure::Update(const FrameStats &stats, long nExposure, long nGain, clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if ( stats.nCount == 0 || stats.histogram.size() < 2 || nExposure <= 0 ) {
+        return std::nullopt;
+    }
+    if ( nSkip > 0 ) {
+        // exposed while the last change landed
+        --nSkip;
+        return std::nullopt;
+    }
+    const double dFull = stats.nSaturation > 0 ? stats.nSaturation : stats.histogram.size() - 1;
+    const double dFloor = 1 / dFull;
+    const auto dBrightness = std::min(1.0, stats.GetPercentile(config.dPercentile) / dFull);
+    const auto dHighlight = std::min(1.0, stats.GetPercentile(config.dHighlightPercentile) / dFull);
+    ++status.nFrames;
+    status.dBrightness = dBrightness;
+    status.dHighlight = dHighlight;
+
+    // signal scale to the target, held back by the highlights
+    double dFactor = 1 / config.dMaxStep;
+    if ( dBrightness < ClipLevel ) {
+        dFactor = std::max(config.dTarget - config.dBlackLevel, dFloor) / std::max(dBrightness - config.dBlackLevel, dFloor);
+        if ( dHighlight >= ClipLevel ) {
+            dFactor = std::min(dFactor, ClippedHighlightStep);
+        } else {
+            dFactor = std::min(dFactor, std::max(config.dHighlightLimit - config.dBlackLevel, dFloor) / std::max(dHighlight - config.dBlackLevel, dFloor));
+        }
+    }
+    status.bConverged = std::abs(dFactor - 1) <= config.dTolerance;
+    if ( status.bConverged ) {
+        status.bLimited = false;
+        return std::nullopt;
+    }
+    if ( lastChange != clock::time_point() && now - lastChange < config.minInterval ) {
+        return std::nullopt;
+    }
+    dFactor = std::clamp(dFactor, 1 / config.dMaxStep, config.dMaxStep);
+
+    // exposure first, the gain makes up the rest
+    const auto dSignal = nExposure * GainFactor(nGain) * dFactor;
+    AutoExposureSettings next;
+    next.nExposure = std::clamp(std::lround(dSignal / GainFactor(config.nMinGain)), config.nMinExposure, config.nMaxExposure);
+    next.nGain = nGain;
+    if ( config.dGainDbPerUnit > 0 ) {
+        const auto dGain = 20 * std::log10(dSignal / next.nExposure) / config.dGainDbPerUnit;
+        next.nGain = std::clamp(std::lround(dGain), config.nMinGain, config.nMaxGain);
+    }
+    const auto dReached = next.nExposure * GainFactor(next.nGain) / dSignal;
+    status.bLimited = std::abs(dReached - 1) > config.dTolerance;
+    if ( next.nExposure == nExposure && next.nGain == nGain ) {
+        return std::nullopt;
+    }
+    ++status.nAdjustments;
+    nSkip = config.nSettleFrames;
+    lastChange = now;
+    return next;
+}
+
+AutoExposureStatus AutoExposure::GetStatus() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return status;
+}
@@ -0,0 +1,84 @@
+#ifndef AUTOEXPOSURE_H
+#define AUTOEXPOSURE_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+#include "framestats.h"
+
+
+struct AutoExposureConfig {
+    // levels as a fraction of full scale (FrameStats::nSaturation)
+    double dTarget = 0.25;                  // for the dPercentile sample
+    double dPercentile = 50;
+    double dHighlightLimit = 0.9;           // the dHighlightPercentile sample stays below
+    double dHighlightPercentile = 99.5;
+    double dTolerance = 0.1;                // relative error left alone
+    double dBlackLevel = 0;                 // pedestal (offset) subtracted before scaling
+    // exposure (us) first, gain only beyond nMaxExposure; clamped to the
+    // camera ranges
+    long nMinExposure = 0;
+    long nMaxExposure = 1000000;
+    long nMinGain = 0;
+    long nMaxGain = 0x7fffffff;
+    double dGainDbPerUnit = 0.1;            // POA_GAIN step
+    // rate limit: a change at most every minInterval, nSettleFrames more are
+    // skipped after it (CcdPlayerOne already drops the frames that started
+    // before it landed), one step scales the signal by at most dMaxStep
+    std::chrono::milliseconds minInterval = std::chrono::milliseconds(100);
+    int nSettleFrames = 1;
+    double dMaxStep = 16;
+};
+
+struct AutoExposureSettings {
+    long nExposure = 0;     // us
+    long nGain = 0;
+};
+
+struct AutoExposureStatus {
+    double dBrightness = 0;         // last dPercentile sample / full scale
+    double dHighlight = 0;
+    bool bConverged = false;        // within dTolerance
+    bool bLimited = false;          // wants more (or less) than the limits allow
+    std::uint64_t nAdjustments = 0;
+    std::uint64_t nFrames = 0;      // frames measured
+};
+
+//
+// predictive auto exposure from the frame histogram
+// the signal is taken as linear in exposure times gain (dGainDbPerUnit), so
+// one measured frame gives the factor to the target directly; the first
+// step lands within the sensor's nonlinearity and the pedestal error, the
+// next one or two finish it. a clipped frame is stepped down by dMaxStep
+// since its level says nothing. the settings are split exposure first, so
+// a darker scene lowers the gain before the exposure.
+//
+class AutoExposure {
+public:
+    using clock = std::chrono::steady_clock;
+
+    AutoExposure();
+
+    void SetConfig(const AutoExposureConfig &config);
+    AutoExposureConfig GetConfig() const;
+    // a new stream: no settle frames, no rate limit
+    void Reset();
+
+    // stats of a frame taken with nExposure/nGain; the next settings if
+    // they should change
+    std::optional<AutoExposureSettings> Update(const FrameStats &stats, long nExposure, long nGain, clock::time_point now = clock::now());
+    AutoExposureStatus GetStatus() const;
+
+private:
+    double GainFactor(long nGain) const;
+
+    mutable std::mutex mtx;
+    AutoExposureConfig config;
+    AutoExposureStatus status;
+    int nSkip;
+    clock::time_point lastChange;
+};
+
+#endif // AUTOEXPOSURE_H
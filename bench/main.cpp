@@ -0,0 +1,491 @@
+//
+// capture throughput benchmark
+//
+// drives CcdPlayerOne / PlayerOneCamera over ROI x bin x format x mode and
+// writes one JSON object per case (JSON lines).
+// --memory first compares the download buffer memory options on full frames:
+// a copy into the buffer as the SDK does, the frame statistics as processing.
+// run against real hardware or the simulated SDK (sim/).
+//
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#include "ccdplayerone.h"
+#include "framebuffer.h"
+#include "framepool.h"
+#include "framestats.h"
+#include "playeronecamera.hpp"
+
+
+//
+// allocation counter
+//
+static std::atomic<std::uint64_t> g_nAllocCount(0);
+static std::atomic<std::uint64_t> g_nAllocBytes(0);
+
+void *operator new(std::size_t nSize) {
+    ++g_nAllocCount;
+    g_nAllocBytes += nSize;
+    if ( void *p = std::malloc(nSize ? nSize : 1) ) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+
+namespace {
+
+// process CPU time (all threads)
+double CpuSeconds() {
+#ifdef Q_OS_UNIX
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#else
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+// minor page faults of the process
+long MinorFaults() {
+#ifdef Q_OS_UNIX
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt;
+#else
+    return 0;
+#endif
+}
+
+const char *FormatName(POAImgFormat fmt) {
+    switch (fmt) {
+    case POAImgFormat::POA_RAW8:
+        return "RAW8";
+    case POAImgFormat::POA_RAW16:
+        return "RAW16";
+    case POAImgFormat::POA_RGB24:
+        return "RGB24";
+    case POAImgFormat::POA_MONO8:
+        return "MONO8";
+    case POAImgFormat::POA_END:
+        break;
+    }
+    return "END";
+}
+
+class FrameCounter {
+public:
+    void Reset() {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_nFrames = 0;
+        m_bAborted = false;
+    }
+    void Frame() {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        ++m_nFrames;
+        m_cv.notify_all();
+    }
+    void Abort() {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_bAborted = true;
+        m_cv.notify_all();
+    }
+    // false: aborted or timeout
+    bool WaitFor(int nFrames, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(m_mtx);
+        return m_cv.wait_for(lock, timeout, [&]() {
+            return m_bAborted || m_nFrames >= nFrames;
+        }) && ! m_bAborted;
+    }
+    int GetFrames() {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        return m_nFrames;
+    }
+
+private:
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    int m_nFrames = 0;
+    bool m_bAborted = false;
+};
+
+struct BenchRoi {
+    const char *szName;
+    int nDivisor;       // 0: fixed 256x256
+};
+
+struct BenchMemory {
+    QString name;
+    bool bPooled;       // false: a new heap buffer per frame, the path before the pool
+    FrameMemory memory;
+};
+
+// vector, pool, page, thp or hugetlb, each with an optional "-prefault"
+std::optional<BenchMemory> ParseBenchMemory(const QString &name) {
+    BenchMemory bench{name, true, FrameMemory()};
+    auto base = name;
+    if ( base.endsWith("-prefault") ) {
+        base.chop(9);
+        bench.memory.bPrefault = true;
+    }
+    if ( base == "vector" ) {
+        bench.bPooled = false;
+        bench.memory.nAlignment = alignof(std::max_align_t);
+    } else if ( base == "page" ) {
+        bench.memory.nAlignment = 4096;
+    } else if ( base == "thp" ) {
+        bench.memory.hugePages = HugePages::Transparent;
+    } else if ( base == "hugetlb" ) {
+        bench.memory.hugePages = HugePages::Explicit;
+    } else if ( base != "pool" ) {
+        return std::nullopt;
+    }
+    return bench;
+}
+
+struct DurationSummary {
+    double dMean = 0;   // us
+    double dP50 = 0;
+    double dMax = 0;
+};
+
+DurationSummary Summarize(std::vector<double> durations) {
+    DurationSummary summary;
+    if ( durations.empty() ) {
+        return summary;
+    }
+    std::sort(durations.begin(), durations.end());
+    for (const auto d : durations) {
+        summary.dMean += d;
+    }
+    summary.dMean /= durations.size();
+    summary.dP50 = durations[durations.size() / 2];
+    summary.dMax = durations.back();
+    return summary;
+}
+
+QJsonObject ToJson(const DurationSummary &summary) {
+    QJsonObject result;
+    result["mean_us"] = summary.dMean;
+    result["p50_us"] = summary.dP50;
+    result["max_us"] = summary.dMax;
+    return result;
+}
+
+// nFrames downloads and statistics of one full frame with the given memory
+QJsonObject RunMemoryCase(const BenchMemory &bench, int nWidth, int nHeight, int nBytepp, int nFrames) {
+    const auto nSize = static_cast<std::size_t>(nWidth) * nHeight * nBytepp;
+    FrameBuffer source(nSize);
+    std::uint32_t nSeed = 1;
+    for (auto &value : source) {
+        nSeed = nSeed * 1664525 + 1013904223;
+        value = static_cast<unsigned char>(nSeed >> 24);
+    }
+
+    FrameBufferPool pool;
+    pool.SetMemory(bench.memory);
+    const auto nFallbacks = GetHugePageFallbackCount();
+    const auto nFaults = MinorFaults();
+    const auto allocStart = std::chrono::steady_clock::now();
+    if ( bench.bPooled ) {
+        // what CcdPlayerOne reserves before a live view
+        pool.Reserve(4, nSize);
+    }
+    const auto dAlloc = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - allocStart).count();
+
+    FrameStatsEngine engine;
+    FrameStats stats;
+    std::vector<double> downloads;
+    std::vector<double> processing;
+    const auto nFrameFaults = MinorFaults();
+    for (int i = 0; i < nFrames; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<FrameBuffer> pBuffer;
+        if ( bench.bPooled ) {
+            pBuffer = pool.Acquire(nSize);
+        } else {
+            // value initialized, as std::vector<unsigned char>(nSize) was
+            pBuffer = std::make_shared<FrameBuffer>(nSize, 0, FrameAllocator<unsigned char>(bench.memory));
+        }
+        std::copy(source.begin(), source.end(), pBuffer->begin());
+        const auto downloaded = std::chrono::steady_clock::now();
+        engine.Compute(nWidth, nHeight, nBytepp, *pBuffer, stats);
+        const auto processed = std::chrono::steady_clock::now();
+        downloads.push_back(std::chrono::duration<double, std::micro>(downloaded - start).count());
+        processing.push_back(std::chrono::duration<double, std::micro>(processed - downloaded).count());
+    }
+
+    QJsonObject result;
+    result["memory"] = bench.name;
+    result["width"] = nWidth;
+    result["height"] = nHeight;
+    result["bytepp"] = nBytepp;
+    result["frames"] = nFrames;
+    result["reserve_us"] = dAlloc;
+    result["download"] = ToJson(Summarize(downloads));
+    result["processing"] = ToJson(Summarize(processing));
+    result["minor_faults"] = static_cast<double>(nFrameFaults - nFaults);
+    result["minor_faults_per_frame"] = static_cast<double>(MinorFaults() - nFrameFaults) / nFrames;
+    result["huge_page_fallbacks"] = static_cast<double>(GetHugePageFallbackCount() - nFallbacks);
+    return result;
+}
+
+struct BenchOptions {
+    int nFrames;
+    long nExposure;     // us
+    QStringList modes;
+    QStringList formats;
+    QList<int> bins;
+    std::vector<BenchMemory> memories;
+};
+
+}  // namespace
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("PlayerOne capture throughput benchmark");
+    parser.addHelpOption();
+    parser.addOptions({
+        { "camera", "camera index", "index", "0" },
+        { "frames", "frames per case", "count", "20" },
+        { "exposure", "exposure time (us)", "us", "1000" },
+        { "modes", "single,live", "modes", "single,live" },
+        { "formats", "RAW8,RAW16,RGB24,MONO8", "formats", "RAW8,RAW16,RGB24,MONO8" },
+        { "bins", "bins to test (default: all supported)", "bins" },
+        { "output", "write JSON lines to file (default: stdout)", "file" },
+        { "memory", "compare buffer memory first: vector,pool,page,thp,hugetlb[-prefault]", "memories" },
+    });
+    parser.process(app);
+
+    BenchOptions options;
+    options.nFrames = std::max(1, parser.value("frames").toInt());
+    options.nExposure = parser.value("exposure").toLong();
+    options.modes = parser.value("modes").split(',', Qt::SkipEmptyParts);
+    options.formats = parser.value("formats").split(',', Qt::SkipEmptyParts);
+    for (const auto &bin : parser.value("bins").split(',', Qt::SkipEmptyParts)) {
+        options.bins.append(bin.toInt());
+    }
+    for (const auto &name : parser.value("memory").split(',', Qt::SkipEmptyParts)) {
+        const auto memory = ParseBenchMemory(name);
+        if ( ! memory ) {
+            std::cerr << "unknown memory " << name.toStdString() << std::endl;
+            return 1;
+        }
+        options.memories.push_back(*memory);
+    }
+
+    QFile outputFile;
+    if ( parser.isSet("output") ) {
+        outputFile.setFileName(parser.value("output"));
+        if ( ! outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+            std::cerr << "cannot open " << parser.value("output").toStdString() << std::endl;
+            return 1;
+        }
+    } else {
+        outputFile.open(stdout, QIODevice::WriteOnly);
+    }
+
+    CcdPlayerOne camera;
+    if ( ! camera.Open(parser.value("camera").toInt()) ) {
+        std::cerr << "open failed" << std::endl;
+        return 1;
+    }
+    const auto pDevice = camera.GetCamera();
+    const auto pExecutor = camera.GetExecutor();
+    const auto &prop = pDevice->m_CamProp;
+
+    for (const auto fmt : prop.imgFormats) {
+        if ( options.memories.empty() || fmt == POAImgFormat::POA_END ) {
+            break;
+        }
+        if ( ! options.formats.contains(FormatName(fmt)) ) {
+            continue;
+        }
+        const int nBytepp = fmt == POAImgFormat::POA_RAW16 ? 2 : (fmt == POAImgFormat::POA_RGB24 ? 3 : 1);
+        for (const auto &memory : options.memories) {
+            auto result = RunMemoryCase(memory, prop.maxWidth, prop.maxHeight, nBytepp, options.nFrames);
+            result["camera"] = prop.cameraModelName;
+            result["format"] = FormatName(fmt);
+            outputFile.write(QJsonDocument(result).toJson(QJsonDocument::Compact));
+            outputFile.write("\n");
+            outputFile.flush();
+
+            std::cerr << "memory " << memory.name.toStdString() << " " << FormatName(fmt) << ": download "
+                      << result["download"].toObject()["p50_us"].toDouble() << " us, processing "
+                      << result["processing"].toObject()["p50_us"].toDouble() << " us" << std::endl;
+        }
+    }
+
+    FrameCounter counter;
+    QObject::connect(&camera, &CcdPlayerOne::imageReady, [&](int, int, const FrameBuffer &, const FrameTimestamps &) {
+        counter.Frame();
+    });
+    QObject::connect(&camera, &CcdPlayerOne::aborted, [&]() {
+        counter.Abort();
+    });
+
+    if ( ! camera.SetExposure(options.nExposure) ) {
+        std::cerr << "SetExposure failed" << std::endl;
+        return 1;
+    }
+
+    const BenchRoi aRois[] = {
+        { "full", 1 },
+        { "half", 2 },
+        { "quarter", 4 },
+        { "256", 0 },
+    };
+    const auto waitTimeout = std::chrono::milliseconds(options.nExposure / 1000 * 2 + 5000);
+
+    for (const auto bin : prop.bins) {
+        if ( bin == 0 ) {
+            break;
+        }
+        if ( ! options.bins.isEmpty() && ! options.bins.contains(bin) ) {
+            continue;
+        }
+        for (const auto fmt : prop.imgFormats) {
+            if ( fmt == POAImgFormat::POA_END ) {
+                break;
+            }
+            if ( ! options.formats.contains(FormatName(fmt)) ) {
+                continue;
+            }
+            for (const auto &roi : aRois) {
+                for (const auto &mode : options.modes) {
+                    const bool bLive = mode == "live";
+
+                    // configure (SDK requires a stopped camera)
+                    camera.StopLiveView();
+                    camera.AbortExposure();
+                    if ( ! pExecutor->Call(&PlayerOneCamera::SetImageFormat, fmt) || ! pExecutor->Call(&PlayerOneCamera::SetImageBin, bin) ) {
+                        continue;
+                    }
+                    const auto nMaxWidth = prop.maxWidth / bin;
+                    const auto nMaxHeight = prop.maxHeight / bin;
+                    const auto nWidth = roi.nDivisor == 0 ? std::min(256, nMaxWidth) : nMaxWidth / roi.nDivisor;
+                    const auto nHeight = roi.nDivisor == 0 ? std::min(256, nMaxHeight) : nMaxHeight / roi.nDivisor;
+                    if ( ! pExecutor->Call(&PlayerOneCamera::SetImageSize, nWidth, nHeight)
+                         || ! pExecutor->Call(&PlayerOneCamera::SetImageStartPos, (nMaxWidth - nWidth) / 2, (nMaxHeight - nHeight) / 2) ) {
+                        continue;
+                    }
+                    const auto actualSize = pExecutor->Call(&PlayerOneCamera::GetImageSize);
+                    if ( ! actualSize ) {
+                        continue;
+                    }
+                    // what the readout model expects from the cases so far
+                    CaptureGeometry geometry;
+                    geometry.nFormat = fmt;
+                    geometry.nBin = bin;
+                    std::tie(geometry.nWidth, geometry.nHeight) = *actualSize;
+                    const auto predictedFps = camera.PredictFps(geometry, options.nExposure, bLive);
+
+                    counter.Reset();
+                    camera.ResetLatencyStats();
+                    const auto nAllocCount = g_nAllocCount.load();
+                    const auto nAllocBytes = g_nAllocBytes.load();
+                    const auto dCpuStart = CpuSeconds();
+                    const auto start = std::chrono::steady_clock::now();
+
+                    bool bOk = true;
+                    std::optional<int> dropped;
+                    if ( bLive ) {
+                        bOk = camera.StartLiveView() && counter.WaitFor(options.nFrames, waitTimeout * options.nFrames);
+                        dropped = pExecutor->Call(&PlayerOneCamera::GetDroppedImagesCount);
+                    } else {
+                        for (int i = 0; bOk && i < options.nFrames; ++i) {
+                            bOk = camera.StartExposure() && counter.WaitFor(i + 1, waitTimeout);
+                        }
+                    }
+
+                    const auto dWall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    const auto dCpu = CpuSeconds() - dCpuStart;
+                    const auto nFrames = counter.GetFrames();
+                    const auto nFrameAllocs = g_nAllocCount.load() - nAllocCount;
+                    const auto nFrameAllocBytes = g_nAllocBytes.load() - nAllocBytes;
+                    camera.StopLiveView();
+                    camera.EndExposure();
+
+                    const auto dInterval = nFrames > 0 ? dWall / nFrames : 0.0;
+                    QJsonObject result;
+                    result["camera"] = prop.cameraModelName;
+                    result["mode"] = mode;
+                    result["format"] = FormatName(fmt);
+                    result["bin"] = bin;
+                    result["roi"] = roi.szName;
+                    result["width"] = std::get<0>(*actualSize);
+                    result["height"] = std::get<1>(*actualSize);
+                    result["exposure_us"] = static_cast<double>(options.nExposure);
+                    result["ok"] = bOk;
+                    result["frames"] = nFrames;
+                    result["fps"] = dWall > 0 ? nFrames / dWall : 0.0;
+                    result["interval_ms"] = dInterval * 1000;
+                    result["overhead_ms"] = nFrames > 0 ? (dInterval - options.nExposure / 1e6) * 1000 : 0.0;
+                    result["cpu_percent"] = dWall > 0 ? dCpu / dWall * 100 : 0.0;
+                    result["allocs_per_frame"] = nFrames > 0 ? static_cast<double>(nFrameAllocs) / nFrames : 0.0;
+                    result["alloc_bytes_per_frame"] = nFrames > 0 ? static_cast<double>(nFrameAllocBytes) / nFrames : 0.0;
+                    if ( dropped ) {
+                        result["dropped"] = *dropped;
+                    }
+                    if ( predictedFps ) {
+                        result["predicted_fps"] = *predictedFps;
+                    }
+                    QJsonObject latency;
+                    for (const auto &summary : camera.GetLatencySummary()) {
+                        if ( summary.nCount == 0 ) {
+                            continue;
+                        }
+                        QJsonObject stage;
+                        stage["p50_us"] = static_cast<double>(summary.nP50);
+                        stage["p99_us"] = static_cast<double>(summary.nP99);
+                        stage["max_us"] = static_cast<double>(summary.nMax);
+                        latency[LatencyStageName(summary.stage)] = stage;
+                    }
+                    result["latency"] = latency;
+
+                    outputFile.write(QJsonDocument(result).toJson(QJsonDocument::Compact));
+                    outputFile.write("\n");
+                    outputFile.flush();
+
+                    std::cerr << mode.toStdString() << " " << FormatName(fmt) << " bin" << bin << " " << roi.szName
+                              << ": " << result["fps"].toDouble() << " fps" << std::endl;
+                }
+            }
+        }
+    }
+
+    std::cerr << camera.GetReadoutReport();
+    camera.Close();
+    return 0;
+}
@@ -0,0 +1,12 @@
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = playerone_bench
+
+SOURCES += \
+    main.cpp
+
+include(../playerone.pri)
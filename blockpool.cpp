@@ -0,0 +1,46 @@
+#include "blockpool.h"
+
+#include <new>
+
+
+BlockPool::~BlockPool() {
+    for (void *p : freeBlocks) {
+        ::operator delete(p);
+    }
+}
+
+void *BlockPool::Allocate(std::size_t nSize) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if ( nBlockSize == 0 ) {
+            nBlockSize = nSize;
+        }
+        if ( nSize == nBlockSize && ! freeBlocks.empty() ) {
+            void *p = freeBlocks.back();
+            freeBlocks.pop_back();
+            return p;
+        }
+        ++nAllocations;
+        if ( nSize == nBlockSize ) {
+            // room to take the block back without allocating
+            freeBlocks.reserve(nAllocations);
+        }
+    }
+    return ::operator new(nSize);
+}
+
+void BlockPool::Deallocate(void *p, std::size_t nSize) noexcept {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if ( nSize == nBlockSize && freeBlocks.size() < freeBlocks.capacity() ) {
+            freeBlocks.push_back(p);
+            return;
+        }
+    }
+    ::operator delete(p);
+}
+
+std::size_t BlockPool::GetAllocationCount() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return nAllocations;
+}
@@ -0,0 +1,77 @@
+#ifndef BLOCKPOOL_H
+#define BLOCKPOOL_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+//
+// recycled storage for shared_ptr control blocks
+// the frame pools hand out their records as shared_ptr<T>(p, deleter, alloc);
+// with a BlockAllocator the control block comes from here instead of the
+// heap, so once the pool has seen as many records in flight as the pipeline
+// holds, handing out a record allocates nothing.
+// a pool keeps blocks of the size it was first asked for (one shared_ptr
+// type per pool), other sizes go to the heap. the pool lives as long as the
+// last allocator, so records can outlive their frame pool.
+//
+class BlockPool {
+public:
+    BlockPool() = default;
+    ~BlockPool();
+    BlockPool(const BlockPool &) = delete;
+    BlockPool &operator=(const BlockPool &) = delete;
+
+    void *Allocate(std::size_t nSize);
+    void Deallocate(void *p, std::size_t nSize) noexcept;
+
+    // blocks taken from the heap since construction
+    std::size_t GetAllocationCount() const;
+
+private:
+    mutable std::mutex mtx;
+    std::size_t nBlockSize = 0;
+    std::vector<void *> freeBlocks;
+    std::size_t nAllocations = 0;
+};
+
+template <typename T>
+class BlockAllocator {
+public:
+    using value_type = T;
+
+    explicit BlockAllocator(std::shared_ptr<BlockPool> pPool) noexcept
+        : pPool(std::move(pPool))
+    {}
+    template <typename U>
+    BlockAllocator(const BlockAllocator<U> &other) noexcept
+        : pPool(other.GetPool())
+    {}
+
+    T *allocate(std::size_t nCount) {
+        return static_cast<T *>(pPool->Allocate(nCount * sizeof(T)));
+    }
+    void deallocate(T *p, std::size_t nCount) noexcept {
+        pPool->Deallocate(p, nCount * sizeof(T));
+    }
+
+    const std::shared_ptr<BlockPool> &GetPool() const noexcept {
+        return pPool;
+    }
+
+private:
+    std::shared_ptr<BlockPool> pPool;
+};
+
+template <typename T, typename U>
+bool operator==(const BlockAllocator<T> &a, const BlockAllocator<U> &b) noexcept {
+    return a.GetPool() == b.GetPool();
+}
+template <typename T, typename U>
+bool operator!=(const BlockAllocator<T> &a, const BlockAllocator<U> &b) noexcept {
+    return ! (a == b);
+}
+
+#endif // BLOCKPOOL_H
@@ -0,0 +1,563 @@
+#include "calibration.h"
+
+#include <QDir>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+
+namespace {
+
+const char MasterMagic[8] = { 'P', 'O', 'A', 'M', 'S', 'T', 'R', '1' };
+constexpr qint64 MasterHeaderSize = 128;
+
+struct MasterFileHeader {
+    char magic[8];
+    std::int32_t nType;
+    std::int32_t nFrames;
+    std::int64_t nExposure;
+    std::int64_t nGain;
+    std::int64_t nOffset;
+    std::int32_t nBin;
+    std::int32_t nStartX;
+    std::int32_t nStartY;
+    std::int32_t nWidth;
+    std::int32_t nHeight;
+    std::int32_t nBytepp;
+    std::int32_t bHasTemperature;
+    std::int32_t nReserved;
+    double dTemperature;
+};
+static_assert(sizeof(MasterFileHeader) <= MasterHeaderSize, "master header too large");
+
+std::size_t PixelCount(const CalibrationKey &key) {
+    return static_cast<std::size_t>(key.nWidth) * key.nHeight;
+}
+
+// frame ROI inside the master ROI
+bool Contains(const CalibrationKey &master, int nStartX, int nStartY, int nWidth, int nHeight) {
+    return nStartX >= master.nStartX && nStartY >= master.nStartY
+        && nStartX + nWidth <= master.nStartX + master.nWidth
+        && nStartY + nHeight <= master.nStartY + master.nHeight;
+}
+
+template <typename T>
+inline T ClampSample(float v) {
+    const float maxValue = static_cast<float>(std::numeric_limits<T>::max());
+    return static_cast<T>(std::min(maxValue, std::max(0.0f, v + 0.5f)));
+}
+
+// the fused per row kernel, specialized so the inner loop stays branch free
+template <typename T, bool bSubtract, bool bMultiply>
+void CalibrateRow(T *p, const float *pDark, const float *pGain, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        float v = static_cast<float>(p[i]);
+        if ( bSubtract ) {
+            v -= pDark[i];
+        }
+        if ( bMultiply ) {
+            v *= pGain[i];
+        }
+        p[i] = ClampSample<T>(v);
+    }
+}
+
+template <typename T>
+void CalibrateRows(T *pFrame, std::size_t nWidth, std::size_t nHeight, const float *pDark, std::size_t nDarkStride,
+                   const float *pGain, std::size_t nGainStride, ThreadPool &pool) {
+    pool.ParallelFor(nHeight, [=](std::size_t nBegin, std::size_t nEnd) {
+        for (auto y = nBegin; y < nEnd; ++y) {
+            T *p = pFrame + y * nWidth;
+            const float *d = pDark ? pDark + y * nDarkStride : nullptr;
+            const float *g = pGain ? pGain + y * nGainStride : nullptr;
+            if ( d && g ) {
+                CalibrateRow<T, true, true>(p, d, g, nWidth);
+            } else if ( d ) {
+                CalibrateRow<T, true, false>(p, d, g, nWidth);
+            } else if ( g ) {
+                CalibrateRow<T, false, true>(p, d, g, nWidth);
+            }
+        }
+    }, std::max<std::size_t>(1, 65536 / std::max<std::size_t>(1, nWidth)));
+}
+
+float CombineMedian(float *p, std::size_t n) {
+    const auto mid = p + n / 2;
+    std::nth_element(p, mid, p + n);
+    if ( n % 2 ) {
+        return *mid;
+    }
+    return (*mid + *std::max_element(p, mid)) * 0.5f;
+}
+
+float CombineSigmaClip(const float *p, std::size_t n) {
+    double dMean = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        dMean += p[i];
+    }
+    dMean /= n;
+    double dLimit = std::numeric_limits<double>::max();
+    for (int nPass = 0; nPass < 2; ++nPass) {
+        double dSum = 0;
+        double dSumSq = 0;
+        std::size_t nKept = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            if ( std::abs(p[i] - dMean) <= dLimit ) {
+                dSum += p[i];
+                dSumSq += static_cast<double>(p[i]) * p[i];
+                ++nKept;
+            }
+        }
+        if ( nKept == 0 ) {
+            break;
+        }
+        dMean = dSum / nKept;
+        const auto dVar = std::max(0.0, dSumSq / nKept - dMean * dMean);
+        dLimit = std::max(0.5, 3.0 * std::sqrt(dVar));
+    }
+    double dSum = 0;
+    std::size_t nKept = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        if ( std::abs(p[i] - dMean) <= dLimit ) {
+            dSum += p[i];
+            ++nKept;
+        }
+    }
+    return static_cast<float>(nKept > 0 ? dSum / nKept : dMean);
+}
+
+}  // namespace
+
+
+const char *MasterTypeName(MasterType type) {
+    switch (type) {
+    case MasterType::Bias:
+        return "bias";
+    case MasterType::Dark:
+        return "dark";
+    case MasterType::Flat:
+        return "flat";
+    }
+    return "";
+}
+
+
+MasterFrame::MasterFrame()
+    : file()
+    , pData(nullptr)
+    , type(MasterType::Bias)
+    , key()
+    , nFrames(0)
+{}
+
+MasterFrame::~MasterFrame() {
+    if ( pData ) {
+        file.unmap(reinterpret_cast<uchar *>(const_cast<float *>(pData)) - MasterHeaderSize);
+    }
+}
+
+std::shared_ptr<MasterFrame> MasterFrame::Open(const std::string &path) {
+    std::shared_ptr<MasterFrame> pMaster(new MasterFrame());
+    pMaster->file.setFileName(QString::fromStdString(path));
+    if ( ! pMaster->file.open(QIODevice::ReadOnly) ) {
+        return nullptr;
+    }
+    MasterFileHeader header;
+    if ( pMaster->file.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header) ) {
+        return nullptr;
+    }
+    if ( std::memcmp(header.magic, MasterMagic, sizeof(MasterMagic)) != 0 || header.nType < 0 || header.nType > 2 ) {
+        return nullptr;
+    }
+    auto &key = pMaster->key;
+    key.nExposure = static_cast<long>(header.nExposure);
+    key.nGain = static_cast<long>(header.nGain);
+    key.nOffset = static_cast<long>(header.nOffset);
+    key.nBin = header.nBin;
+    key.nStartX = header.nStartX;
+    key.nStartY = header.nStartY;
+    key.nWidth = header.nWidth;
+    key.nHeight = header.nHeight;
+    key.nBytepp = header.nBytepp;
+    if ( header.bHasTemperature ) {
+        key.temperature = header.dTemperature;
+    }
+    pMaster->type = static_cast<MasterType>(header.nType);
+    pMaster->nFrames = header.nFrames;
+
+    const auto nDataSize = static_cast<qint64>(PixelCount(key) * sizeof(float));
+    if ( key.nWidth <= 0 || key.nHeight <= 0 || pMaster->file.size() < MasterHeaderSize + nDataSize ) {
+        return nullptr;
+    }
+    // map header and data together, the header keeps the samples aligned
+    const auto pMap = pMaster->file.map(0, MasterHeaderSize + nDataSize);
+    if ( ! pMap ) {
+        return nullptr;
+    }
+    pMaster->pData = reinterpret_cast<const float *>(pMap + MasterHeaderSize);
+    return pMaster;
+}
+
+MasterType MasterFrame::GetType() const {
+    return type;
+}
+const CalibrationKey &MasterFrame::GetKey() const {
+    return key;
+}
+int MasterFrame::GetFrameCount() const {
+    return nFrames;
+}
+std::string MasterFrame::GetPath() const {
+    return file.fileName().toStdString();
+}
+const float *MasterFrame::GetData() const {
+    return pData;
+}
+
+
+MasterBuilder::MasterBuilder(MasterType type, const CalibrationKey &key, const std::string &spoolPath)
+    : type(type)
+    , key(key)
+    , spoolPath(spoolPath)
+    , spool(spoolPath, std::ios::binary | std::ios::trunc)
+    , nFrames(0)
+{}
+
+MasterBuilder::~MasterBuilder() {
+    spool.close();
+    std::remove(spoolPath.c_str());
+}
+
+MasterType MasterBuilder::GetType() const {
+    return type;
+}
+const CalibrationKey &MasterBuilder::GetKey() const {
+    return key;
+}
+
+bool MasterBuilder::Add(const FrameBuffer &buffer) {
+    const auto nSize = PixelCount(key) * key.nBytepp;
+    if ( buffer.size() < nSize || ! spool ) {
+        return false;
+    }
+    spool.write(reinterpret_cast<const char *>(buffer.data()), nSize);
+    if ( ! spool ) {
+        return false;
+    }
+    ++nFrames;
+    return true;
+}
+
+int MasterBuilder::GetFrameCount() const {
+    return nFrames;
+}
+
+std::shared_ptr<MasterFrame> MasterBuilder::Build(const std::string &path, CombineMethod method, const MasterFrame *pBias,
+                                                  ThreadPool &pool, std::size_t nMemoryLimit) {
+    if ( nFrames == 0 || (key.nBytepp != 1 && key.nBytepp != 2) ) {
+        return nullptr;
+    }
+    spool.flush();
+    QFile input(QString::fromStdString(spoolPath));
+    if ( ! input.open(QIODevice::ReadOnly) ) {
+        return nullptr;
+    }
+    const auto nPixels = PixelCount(key);
+    const auto nFrameSize = nPixels * key.nBytepp;
+    const auto pInput = input.map(0, static_cast<qint64>(nFrameSize) * nFrames);
+    if ( ! pInput ) {
+        return nullptr;
+    }
+
+    // written to a temporary name, renamed when complete
+    const auto tempPath = QString::fromStdString(path + ".part");
+    QFile output(tempPath);
+    if ( ! output.open(QIODevice::ReadWrite | QIODevice::Truncate) ) {
+        return nullptr;
+    }
+    const auto nDataSize = static_cast<qint64>(nPixels * sizeof(float));
+    if ( ! output.resize(MasterHeaderSize + nDataSize) ) {
+        return nullptr;
+    }
+    const auto pOutput = output.map(0, MasterHeaderSize + nDataSize);
+    if ( ! pOutput ) {
+        return nullptr;
+    }
+    float *pData = reinterpret_cast<float *>(pOutput + MasterHeaderSize);
+
+    // rows per tile: one tile of every frame per thread fits the limit
+    const auto nWidth = static_cast<std::size_t>(key.nWidth);
+    const auto nThreads = static_cast<std::size_t>(pool.GetThreadCount() + 1);
+    const auto nTileRows = std::max<std::size_t>(1, nMemoryLimit / nThreads / (nWidth * nFrames * sizeof(float)));
+    const auto nTiles = (static_cast<std::size_t>(key.nHeight) + nTileRows - 1) / nTileRows;
+    const auto nCount = static_cast<std::size_t>(nFrames);
+    const auto nBytepp = key.nBytepp;
+    const auto nHeight = static_cast<std::size_t>(key.nHeight);
+    pool.ParallelFor(nTiles, [&](std::size_t nBegin, std::size_t nEnd) {
+        std::vector<float> tile(nTileRows * nWidth * nCount);
+        std::vector<float> samples(nCount);
+        for (auto t = nBegin; t < nEnd; ++t) {
+            const auto y0 = t * nTileRows;
+            const auto nRows = std::min(nTileRows, nHeight - y0);
+            const auto nTileSamples = nRows * nWidth;
+            // frame major copy keeps the spool reads sequential
+            for (std::size_t f = 0; f < nCount; ++f) {
+                const auto pSrc = pInput + f * nFrameSize + y0 * nWidth * nBytepp;
+                float *pDst = tile.data() + f * nTileSamples;
+                if ( nBytepp == 2 ) {
+                    for (std::size_t i = 0; i < nTileSamples; ++i) {
+                        std::uint16_t v;
+                        std::memcpy(&v, pSrc + i * 2, 2);
+                        pDst[i] = v;
+                    }
+                } else {
+                    for (std::size_t i = 0; i < nTileSamples; ++i) {
+                        pDst[i] = pSrc[i];
+                    }
+                }
+            }
+            float *pOut = pData + y0 * nWidth;
+            for (std::size_t i = 0; i < nTileSamples; ++i) {
+                for (std::size_t f = 0; f < nCount; ++f) {
+                    samples[f] = tile[f * nTileSamples + i];
+                }
+                pOut[i] = method == CombineMethod::Median ? CombineMedian(samples.data(), nCount) : CombineSigmaClip(samples.data(), nCount);
+            }
+        }
+    });
+    input.unmap(pInput);
+    input.close();
+
+    if ( type == MasterType::Flat ) {
+        // bias subtract, then store mean / flat
+        const float *pBiasData = nullptr;
+        std::size_t nBiasStride = 0;
+        if ( pBias && Contains(pBias->GetKey(), key.nStartX, key.nStartY, key.nWidth, key.nHeight) ) {
+            const auto &biasKey = pBias->GetKey();
+            nBiasStride = biasKey.nWidth;
+            pBiasData = pBias->GetData() + (key.nStartY - biasKey.nStartY) * nBiasStride + (key.nStartX - biasKey.nStartX);
+        }
+        std::mutex mtxSum;
+        double dSum = 0;
+        pool.ParallelFor(nHeight, [&](std::size_t nBegin, std::size_t nEnd) {
+            double dPartial = 0;
+            for (auto y = nBegin; y < nEnd; ++y) {
+                float *p = pData + y * nWidth;
+                if ( pBiasData ) {
+                    const float *b = pBiasData + y * nBiasStride;
+                    for (std::size_t x = 0; x < nWidth; ++x) {
+                        p[x] -= b[x];
+                    }
+                }
+                for (std::size_t x = 0; x < nWidth; ++x) {
+                    dPartial += p[x];
+                }
+            }
+            std::lock_guard<std::mutex> lock(mtxSum);
+            dSum += dPartial;
+        });
+        const auto fMean = static_cast<float>(dSum / nPixels);
+        // dead or unlit pixels are left as they are
+        const auto fMin = std::max(1e-3f, fMean * 1e-3f);
+        pool.ParallelFor(nHeight, [&](std::size_t nBegin, std::size_t nEnd) {
+            for (auto y = nBegin; y < nEnd; ++y) {
+                float *p = pData + y * nWidth;
+                for (std::size_t x = 0; x < nWidth; ++x) {
+                    p[x] = p[x] > fMin ? fMean / p[x] : 1.0f;
+                }
+            }
+        });
+    }
+
+    MasterFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MasterMagic, sizeof(MasterMagic));
+    header.nType = static_cast<std::int32_t>(type);
+    header.nFrames = nFrames;
+    header.nExposure = key.nExposure;
+    header.nGain = key.nGain;
+    header.nOffset = key.nOffset;
+    header.nBin = key.nBin;
+    header.nStartX = key.nStartX;
+    header.nStartY = key.nStartY;
+    header.nWidth = key.nWidth;
+    header.nHeight = key.nHeight;
+    header.nBytepp = key.nBytepp;
+    header.bHasTemperature = key.temperature ? 1 : 0;
+    header.dTemperature = key.temperature.value_or(0.0);
+    std::memcpy(pOutput, &header, sizeof(header));
+    output.unmap(pOutput);
+    output.close();
+
+    QFile::remove(QString::fromStdString(path));
+    if ( ! QFile::rename(tempPath, QString::fromStdString(path)) ) {
+        return nullptr;
+    }
+    return MasterFrame::Open(path);
+}
+
+
+Calibrator::Calibrator(std::shared_ptr<MasterFrame> pDark, std::shared_ptr<MasterFrame> pFlat)
+    : pDark(std::move(pDark))
+    , pFlat(std::move(pFlat))
+{}
+
+std::shared_ptr<MasterFrame> Calibrator::GetDark() const {
+    return pDark;
+}
+std::shared_ptr<MasterFrame> Calibrator::GetFlat() const {
+    return pFlat;
+}
+
+bool Calibrator::Apply(int nStartX, int nStartY, int nWidth, int nHeight, int nBytepp, FrameBuffer &buffer,
+                       ThreadPool &pool) const {
+    if ( nBytepp != 1 && nBytepp != 2 ) {
+        return false;
+    }
+    if ( buffer.size() < static_cast<std::size_t>(nWidth) * nHeight * nBytepp ) {
+        return false;
+    }
+    // top left sample of the ROI in a master
+    auto origin = [=](const std::shared_ptr<MasterFrame> &pMaster) -> const float * {
+        if ( ! pMaster ) {
+            return nullptr;
+        }
+        const auto &key = pMaster->GetKey();
+        if ( key.nBytepp != nBytepp || ! Contains(key, nStartX, nStartY, nWidth, nHeight) ) {
+            return nullptr;
+        }
+        return pMaster->GetData() + static_cast<std::size_t>(nStartY - key.nStartY) * key.nWidth + (nStartX - key.nStartX);
+    };
+    const auto pDarkData = origin(pDark);
+    const auto pGainData = origin(pFlat);
+    if ( (pDark && ! pDarkData) || (pFlat && ! pGainData) || (! pDarkData && ! pGainData) ) {
+        return false;
+    }
+    const std::size_t nDarkStride = pDark ? pDark->GetKey().nWidth : 0;
+    const std::size_t nGainStride = pFlat ? pFlat->GetKey().nWidth : 0;
+    if ( nBytepp == 2 ) {
+        CalibrateRows(reinterpret_cast<std::uint16_t *>(buffer.data()), nWidth, nHeight, pDarkData, nDarkStride, pGainData, nGainStride, pool);
+    } else {
+        CalibrateRows(buffer.data(), nWidth, nHeight, pDarkData, nDarkStride, pGainData, nGainStride, pool);
+    }
+    return true;
+}
+
+
+CalibrationLibrary::CalibrationLibrary(const std::string &directory)
+    : mtx()
+    , directory(directory)
+    , masters()
+{}
+
+std::string CalibrationLibrary::GetDirectory() const {
+    return directory;
+}
+
+bool CalibrationLibrary::Scan() {
+    QDir dir(QString::fromStdString(directory));
+    if ( ! dir.exists() && ! dir.mkpath(".") ) {
+        return false;
+    }
+    std::vector<std::shared_ptr<MasterFrame>> found;
+    for (const auto &name : dir.entryList({ "*.master" }, QDir::Files)) {
+        if ( auto pMaster = MasterFrame::Open(dir.filePath(name).toStdString()) ) {
+            found.push_back(std::move(pMaster));
+        }
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    masters.swap(found);
+    return true;
+}
+
+std::unique_ptr<MasterBuilder> CalibrationLibrary::CreateBuilder(MasterType type, const CalibrationKey &key) const {
+    return std::make_unique<MasterBuilder>(type, key, MasterPath(type, key) + ".spool");
+}
+
+std::shared_ptr<MasterFrame> CalibrationLibrary::Build(MasterBuilder &builder, CombineMethod method) {
+    std::shared_ptr<MasterFrame> pBias;
+    if ( builder.GetType() == MasterType::Flat ) {
+        pBias = Find(MasterType::Bias, builder.GetKey());
+    }
+    const auto path = MasterPath(builder.GetType(), builder.GetKey());
+    std::lock_guard<std::mutex> lock(mtx);
+    // drop a master of the same name, its file gets replaced
+    masters.erase(std::remove_if(masters.begin(), masters.end(), [&](const std::shared_ptr<MasterFrame> &p) {
+        return p->GetPath() == path;
+    }), masters.end());
+    auto pMaster = builder.Build(path, method, pBias.get());
+    if ( pMaster ) {
+        masters.push_back(pMaster);
+    }
+    return pMaster;
+}
+
+std::shared_ptr<MasterFrame> CalibrationLibrary::Find(MasterType type, const CalibrationKey &key) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::shared_ptr<MasterFrame> best;
+    double dBestScore = std::numeric_limits<double>::max();
+    for (const auto &pMaster : masters) {
+        const auto &m = pMaster->GetKey();
+        if ( pMaster->GetType() != type || m.nBytepp != key.nBytepp || m.nBin != key.nBin
+             || ! Contains(m, key.nStartX, key.nStartY, key.nWidth, key.nHeight) ) {
+            continue;
+        }
+        double dScore = 0;
+        if ( type != MasterType::Flat ) {
+            if ( m.nGain != key.nGain || m.nOffset != key.nOffset ) {
+                continue;
+            }
+            if ( type == MasterType::Dark && std::abs(m.nExposure - key.nExposure) > std::max(1L, key.nExposure / 100) ) {
+                continue;
+            }
+            if ( m.temperature && key.temperature ) {
+                const auto dDiff = std::abs(*m.temperature - *key.temperature);
+                if ( dDiff > 2.0 ) {
+                    continue;
+                }
+                dScore += dDiff;
+            } else {
+                // unknown temperature ranks behind any measured match
+                dScore += 2.0;
+            }
+        } else if ( m.nGain != key.nGain ) {
+            dScore += 1.0;
+        }
+        // exact ROI before a crop of a larger master
+        if ( m.nWidth != key.nWidth || m.nHeight != key.nHeight ) {
+            dScore += 0.5;
+        }
+        if ( dScore < dBestScore ) {
+            dBestScore = dScore;
+            best = pMaster;
+        }
+    }
+    return best;
+}
+
+std::shared_ptr<Calibrator> CalibrationLibrary::Select(const CalibrationKey &key) const {
+    auto pDark = Find(MasterType::Dark, key);
+    if ( ! pDark ) {
+        pDark = Find(MasterType::Bias, key);
+    }
+    auto pFlat = Find(MasterType::Flat, key);
+    if ( ! pDark && ! pFlat ) {
+        return nullptr;
+    }
+    return std::make_shared<Calibrator>(pDark, pFlat);
+}
+
+std::string CalibrationLibrary::MasterPath(MasterType type, const CalibrationKey &key) const {
+    char temperature[16] = "tNA";
+    if ( key.temperature ) {
+        std::snprintf(temperature, sizeof(temperature), "t%+.0f", *key.temperature);
+    }
+    char name[256];
+    std::snprintf(name, sizeof(name), "%s_e%ld_g%ld_o%ld_b%d_%dx%d+%d+%d_%d_%s.master",
+                  MasterTypeName(type), type == MasterType::Dark ? key.nExposure : 0L, key.nGain, key.nOffset, key.nBin,
+                  key.nWidth, key.nHeight, key.nStartX, key.nStartY, key.nBytepp * 8, temperature);
+    return QDir(QString::fromStdString(directory)).filePath(name).toStdString();
+}
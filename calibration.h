@@ -0,0 +1,162 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <QFile>
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "framebuffer.h"
+#include "threadpool.h"
+
+
+enum class MasterType {
+    Bias = 0,
+    Dark,
+    Flat,
+};
+
+enum class CombineMethod {
+    Median,
+    SigmaClip,  // mean after rejecting > 3 sigma (two passes)
+};
+
+// capture settings a master frame was taken with
+struct CalibrationKey {
+    long nExposure = 0;     // us
+    long nGain = 0;
+    long nOffset = 0;
+    int nBin = 1;
+    int nStartX = 0;        // ROI in binned pixels
+    int nStartY = 0;
+    int nWidth = 0;
+    int nHeight = 0;
+    int nBytepp = 2;        // 1 (RAW8/MONO8), 2 (RAW16)
+    std::optional<double> temperature;  // C
+};
+
+const char *MasterTypeName(MasterType type);
+
+
+//
+// master frame file, memory mapped
+// 128 byte header followed by nWidth * nHeight float samples.
+// bias and dark hold ADU, a flat holds the per pixel gain (mean / flat)
+// so applying it is a single multiply.
+//
+class MasterFrame {
+public:
+    static std::shared_ptr<MasterFrame> Open(const std::string &path);
+    ~MasterFrame();
+
+    MasterFrame(const MasterFrame &) = delete;
+    MasterFrame &operator=(const MasterFrame &) = delete;
+
+    MasterType GetType() const;
+    const CalibrationKey &GetKey() const;
+    int GetFrameCount() const;
+    std::string GetPath() const;
+    const float *GetData() const;
+
+private:
+    MasterFrame();
+
+    QFile file;
+    const float *pData;
+    MasterType type;
+    CalibrationKey key;
+    int nFrames;
+};
+
+
+//
+// collects calibration frames and combines them into a master
+// frames are spooled to a file, combining reads them back in row tiles so
+// memory use stays within nMemoryLimit regardless of the frame count.
+//
+class MasterBuilder {
+public:
+    MasterBuilder(MasterType type, const CalibrationKey &key, const std::string &spoolPath);
+    ~MasterBuilder();
+
+    MasterBuilder(const MasterBuilder &) = delete;
+    MasterBuilder &operator=(const MasterBuilder &) = delete;
+
+    MasterType GetType() const;
+    const CalibrationKey &GetKey() const;
+
+    // buffer: one frame of key.nWidth * key.nHeight * key.nBytepp bytes
+    bool Add(const FrameBuffer &buffer);
+    int GetFrameCount() const;
+
+    // pBias is subtracted from flats before normalization
+    std::shared_ptr<MasterFrame> Build(const std::string &path, CombineMethod method, const MasterFrame *pBias = nullptr,
+                                       ThreadPool &pool = ThreadPool::Global(), std::size_t nMemoryLimit = 256 << 20);
+
+private:
+    MasterType type;
+    CalibrationKey key;
+    std::string spoolPath;
+    std::ofstream spool;
+    int nFrames;
+};
+
+
+//
+// subtracts a dark (or bias) and multiplies by a flat gain in one pass,
+// in place on RAW8/RAW16 frames
+//
+class Calibrator {
+public:
+    // either master may be null
+    Calibrator(std::shared_ptr<MasterFrame> pDark, std::shared_ptr<MasterFrame> pFlat);
+
+    std::shared_ptr<MasterFrame> GetDark() const;
+    std::shared_ptr<MasterFrame> GetFlat() const;
+
+    // nStartX/nStartY: frame ROI, must lie inside the masters
+    bool Apply(int nStartX, int nStartY, int nWidth, int nHeight, int nBytepp, FrameBuffer &buffer,
+               ThreadPool &pool = ThreadPool::Global()) const;
+
+private:
+    std::shared_ptr<MasterFrame> pDark;
+    std::shared_ptr<MasterFrame> pFlat;
+};
+
+
+//
+// directory of master frames indexed by their capture settings
+//
+class CalibrationLibrary {
+public:
+    explicit CalibrationLibrary(const std::string &directory);
+
+    std::string GetDirectory() const;
+    // (re)load every *.master in the directory
+    bool Scan();
+
+    // spools into the library directory
+    std::unique_ptr<MasterBuilder> CreateBuilder(MasterType type, const CalibrationKey &key) const;
+    // combines, stores and indexes the master
+    std::shared_ptr<MasterFrame> Build(MasterBuilder &builder, CombineMethod method);
+
+    // best match: same gain/offset/bin/format, ROI inside the master,
+    // dark exposure within 1%, nearest temperature (at most 2 C apart)
+    std::shared_ptr<MasterFrame> Find(MasterType type, const CalibrationKey &key) const;
+    // dark (bias if no dark) and flat for key, nullptr when nothing matches
+    std::shared_ptr<Calibrator> Select(const CalibrationKey &key) const;
+
+private:
+    std::string MasterPath(MasterType type, const CalibrationKey &key) const;
+
+    mutable std::mutex mtx;
+    std::string directory;
+    std::vector<std::shared_ptr<MasterFrame>> masters;
+};
+
+#endif // CALIBRATION_H
@@ -0,0 +1,153 @@
+#include "cameraexecutor.h"
+
+#include <algorithm>
+
+#include "playeronecamera.hpp"
+#include "threadconfig.h"
+
+
+CameraExecutor::CommandQueue::CommandQueue()
+    : pHead(&stub)
+    , pTail(&stub)
+    , stub()
+{}
+
+CameraExecutor::CommandQueue::~CommandQueue() {
+    while ( Node *pNode = Pop() ) {
+        delete pNode;
+    }
+}
+
+void CameraExecutor::CommandQueue::Push(Node *pNode) {
+    pNode->next.store(nullptr, std::memory_order_relaxed);
+    Node *pPrev = pHead.exchange(pNode, std::memory_order_acq_rel);
+    pPrev->next.store(pNode, std::memory_order_release);
+}
+
+CameraExecutor::Node *CameraExecutor::CommandQueue::Pop() {
+    Node *pTailNode = pTail;
+    Node *pNext = pTailNode->next.load(std::memory_order_acquire);
+    if ( pTailNode == &stub ) {
+        if ( ! pNext ) {
+            return nullptr;
+        }
+        pTail = pNext;
+        pTailNode = pNext;
+        pNext = pNext->next.load(std::memory_order_acquire);
+    }
+    if ( pNext ) {
+        pTail = pNext;
+        return pTailNode;
+    }
+    if ( pTailNode != pHead.load(std::memory_order_acquire) ) {
+        // a producer swapped the head but has not linked it yet
+        return nullptr;
+    }
+    // last node: park the stub behind it so it can be handed out
+    Push(&stub);
+    pNext = pTailNode->next.load(std::memory_order_acquire);
+    if ( pNext ) {
+        pTail = pNext;
+        return pTailNode;
+    }
+    return nullptr;
+}
+
+
+CameraExecutor::CameraExecutor(std::shared_ptr<PlayerOneCamera> pCamera)
+    : pCamera(std::move(pCamera))
+    , queues()
+    , nPending(0)
+    , bSleeping(false)
+    , nCommands(0)
+    , nBusySince(0)
+    , pSelf()
+    , mtx()
+    , cv()
+    , bStop(false)
+    , thread([this]() { ThreadProc(); })
+{}
+
+CameraExecutor::~CameraExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bStop = true;
+    }
+    cv.notify_all();
+    thread.join();
+}
+
+bool CameraExecutor::IsExecutorThread() const {
+    return std::this_thread::get_id() == thread.get_id();
+}
+
+const std::shared_ptr<PlayerOneCamera> &CameraExecutor::GetCamera() const {
+    return pCamera;
+}
+
+std::uint64_t CameraExecutor::GetCommandCount() const {
+    return nCommands;
+}
+
+std::optional<std::chrono::steady_clock::duration> CameraExecutor::GetBusyTime() const {
+    const auto nSince = nBusySince.load();
+    if ( nSince == 0 ) {
+        return std::nullopt;
+    }
+    const auto since = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(nSince));
+    return std::chrono::steady_clock::now() - since;
+}
+
+void CameraExecutor::Abandon() {
+    std::lock_guard<std::mutex> lock(mtx);
+    pSelf = shared_from_this();
+}
+
+void CameraExecutor::Push(CommandPriority priority, Task task) {
+    auto pNode = new Node;
+    pNode->task = std::move(task);
+    queues[static_cast<std::size_t>(priority)].Push(pNode);
+    // pairs with the sleeping check in ThreadProc (both sequentially consistent)
+    ++nPending;
+    if ( bSleeping ) {
+        std::lock_guard<std::mutex> lock(mtx);
+        cv.notify_one();
+    }
+}
+
+CameraExecutor::Node *CameraExecutor::PopNext() {
+    for (auto &queue : queues) {
+        if ( Node *pNode = queue.Pop() ) {
+            return pNode;
+        }
+    }
+    return nullptr;
+}
+
+void CameraExecutor::ThreadProc() {
+    SetCurrentThreadName("poa-executor");
+    while ( true ) {
+        if ( nPending == 0 ) {
+            std::unique_lock<std::mutex> lock(mtx);
+            bSleeping = true;
+            cv.wait(lock, [this]() { return bStop || nPending > 0; });
+            bSleeping = false;
+            if ( nPending == 0 ) {
+                // stopped and drained
+                return;
+            }
+        }
+        Node *pNode = PopNext();
+        if ( ! pNode ) {
+            // counted but not linked yet
+            std::this_thread::yield();
+            continue;
+        }
+        --nPending;
+        nBusySince = std::max<std::int64_t>(1, std::chrono::steady_clock::now().time_since_epoch().count());
+        pNode->task(*pCamera);
+        nBusySince = 0;
+        delete pNode;
+        ++nCommands;
+    }
+}
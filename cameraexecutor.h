@@ -0,0 +1,159 @@
+#ifndef CAMERAEXECUTOR_H
+#define CAMERAEXECUTOR_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+class PlayerOneCamera;
+
+enum class CommandPriority {
+    Urgent,     // abort, guide outputs
+    Normal,     // settings, exposure control
+    Background, // telemetry
+};
+
+//
+// single owner of the SDK calls of one camera
+// every POA* call for the camera runs on the executor thread, the most urgent
+// queued command first; callers get a future or block in Call(). producers
+// push onto lock-free lists, one per priority, and only take the mutex to
+// wake a sleeping executor. GetImageData is the one exception: the bulk
+// transfer runs on the capture thread so a download never holds up an abort
+// or a guide pulse, and StopExposure from the executor ends it.
+// the const PlayerOneCamera members (properties, ranges, ROI alignment) make
+// no SDK call and may be used from any thread.
+//
+class CameraExecutor : public std::enable_shared_from_this<CameraExecutor> {
+public:
+    explicit CameraExecutor(std::shared_ptr<PlayerOneCamera> pCamera);
+    // runs what is still queued, then stops
+    ~CameraExecutor();
+
+    CameraExecutor(const CameraExecutor &) = delete;
+    CameraExecutor &operator=(const CameraExecutor &) = delete;
+
+    template <typename Func>
+    auto Submit(CommandPriority priority, Func func) -> std::future<std::invoke_result_t<Func, PlayerOneCamera &>> {
+        using Result = std::invoke_result_t<Func, PlayerOneCamera &>;
+        auto pPromise = std::make_shared<std::promise<Result>>();
+        auto future = pPromise->get_future();
+        Push(priority, [pPromise, func = std::move(func)](PlayerOneCamera &camera) mutable {
+            try {
+                if constexpr ( std::is_void_v<Result> ) {
+                    func(camera);
+                    pPromise->set_value();
+                } else {
+                    pPromise->set_value(func(camera));
+                }
+            } catch (...) {
+                pPromise->set_exception(std::current_exception());
+            }
+        });
+        return future;
+    }
+
+    // blocks until the command ran; runs inline on the executor thread
+    template <typename Func>
+    auto Call(CommandPriority priority, Func func) -> std::invoke_result_t<Func, PlayerOneCamera &> {
+        if ( IsExecutorThread() ) {
+            return func(*pCamera);
+        }
+        return Submit(priority, std::move(func)).get();
+    }
+
+    // Call(&PlayerOneCamera::SetGain, nGain)
+    template <typename Result, typename... Params, typename... Args>
+    Result Call(Result (PlayerOneCamera::*method)(Params...), Args &&...args) {
+        return Call(CommandPriority::Normal, [&](PlayerOneCamera &camera) {
+            return (camera.*method)(std::forward<Args>(args)...);
+        });
+    }
+    template <typename Result, typename... Params, typename... Args>
+    Result Call(CommandPriority priority, Result (PlayerOneCamera::*method)(Params...), Args &&...args) {
+        return Call(priority, [&](PlayerOneCamera &camera) {
+            return (camera.*method)(std::forward<Args>(args)...);
+        });
+    }
+    // Call() for a worker that may have to give up on a stuck executor:
+    // Result() once bAbandon is set. the command keeps copies of the
+    // arguments and stays queued.
+    template <typename Result, typename... Params, typename... Args>
+    Result CallOrAbandon(const std::atomic<bool> &bAbandon, CommandPriority priority, Result (PlayerOneCamera::*method)(Params...), Args... args) {
+        auto future = Submit(priority, [method, args...](PlayerOneCamera &camera) {
+            return (camera.*method)(args...);
+        });
+        while ( future.wait_for(AbandonPollInterval) != std::future_status::ready ) {
+            if ( bAbandon ) {
+                return Result();
+            }
+        }
+        return future.get();
+    }
+
+    bool IsExecutorThread() const;
+    // properties only, see above
+    const std::shared_ptr<PlayerOneCamera> &GetCamera() const;
+    // commands run since construction
+    std::uint64_t GetCommandCount() const;
+    // time the running command has spent in the SDK so far, nullopt when idle
+    std::optional<std::chrono::steady_clock::duration> GetBusyTime() const;
+    // for a thread stuck in an SDK call: the executor keeps itself alive
+    // and is never joined, so dropping the last owner does not hang. if the
+    // call ever returns, the queued commands run against the old handle.
+    // only for an executor owned by a shared_ptr.
+    void Abandon();
+
+private:
+    using Task = std::function<void(PlayerOneCamera &)>;
+
+    // how often CallOrAbandon() looks at its flag
+    static constexpr std::chrono::milliseconds AbandonPollInterval{10};
+
+    // intrusive MPSC list (Vyukov): push is one exchange, pop is consumer only
+    struct Node {
+        std::atomic<Node *> next{nullptr};
+        Task task;
+    };
+    class CommandQueue {
+    public:
+        CommandQueue();
+        ~CommandQueue();
+        void Push(Node *pNode);
+        // null if empty or a push is half way
+        Node *Pop();
+
+    private:
+        std::atomic<Node *> pHead;
+        Node *pTail;
+        Node stub;
+    };
+
+    void Push(CommandPriority priority, Task task);
+    Node *PopNext();
+    void ThreadProc();
+
+    std::shared_ptr<PlayerOneCamera> pCamera;
+    std::array<CommandQueue, 3> queues;
+    std::atomic<int> nPending;
+    std::atomic<bool> bSleeping;
+    std::atomic<std::uint64_t> nCommands;
+    std::atomic<std::int64_t> nBusySince;   // steady_clock ticks, 0: idle
+    std::shared_ptr<CameraExecutor> pSelf;  // set by Abandon()
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool bStop;
+    std::thread thread;
+};
+
+#endif // CAMERAEXECUTOR_H
@@ -0,0 +1,126 @@
+#include "camerawatchdog.h"
+
+#include <algorithm>
+
+#include "cameraexecutor.h"
+#include "threadconfig.h"
+
+
+namespace {
+
+std::string Milliseconds(CameraWatchdog::clock::duration duration) {
+    return std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(duration).count()) + " ms";
+}
+
+}  // namespace
+
+
+CameraWatchdog::CameraWatchdog(Handler handler)
+    : handler(std::move(handler))
+    , pExecutor()
+    , nDownloadDeadline(0)
+    , mtx()
+    , cv()
+    , config()
+    , bArmed(false)
+    , pending()
+    , bStop(false)
+    , thread([this]() { ThreadProc(); })
+{}
+
+CameraWatchdog::~CameraWatchdog() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bStop = true;
+    }
+    cv.notify_all();
+    thread.join();
+}
+
+void CameraWatchdog::Watch(std::shared_ptr<CameraExecutor> pExecutor) {
+    std::lock_guard<std::mutex> lock(mtx);
+    bArmed = pExecutor != nullptr;
+    this->pExecutor = std::move(pExecutor);
+    pending.clear();
+    nDownloadDeadline = 0;
+}
+
+void CameraWatchdog::SetConfig(const WatchdogConfig &config) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        this->config = config;
+    }
+    cv.notify_all();
+}
+WatchdogConfig CameraWatchdog::GetConfig() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return config;
+}
+
+void CameraWatchdog::BeginDownload(std::chrono::milliseconds timeout) {
+    if ( timeout.count() < 0 ) {
+        // no SDK timeout, nothing to compare against
+        return;
+    }
+    nDownloadDeadline = std::max<std::int64_t>(1, (clock::now() + timeout).time_since_epoch().count());
+}
+void CameraWatchdog::EndDownload() {
+    nDownloadDeadline = 0;
+}
+
+bool CameraWatchdog::Trigger(const std::string &reason) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if ( ! pExecutor ) {
+            return false;
+        }
+        if ( ! bArmed || ! pending.empty() ) {
+            // already on it
+            return true;
+        }
+        pending = reason;
+    }
+    cv.notify_all();
+    return true;
+}
+
+std::string CameraWatchdog::CheckCalls() const {
+    if ( const auto busy = pExecutor->GetBusyTime(); busy && *busy > config.commandTimeout ) {
+        return "SDK command stuck for " + Milliseconds(*busy);
+    }
+    if ( const auto nDeadline = nDownloadDeadline.load(); nDeadline != 0 ) {
+        const auto overdue = clock::now() - clock::time_point(clock::duration(nDeadline));
+        if ( overdue > config.downloadGrace ) {
+            return "GetImageData stuck " + Milliseconds(overdue) + " past its timeout";
+        }
+    }
+    return std::string();
+}
+
+void CameraWatchdog::ThreadProc() {
+    SetCurrentThreadName("poa-watchdog");
+    std::unique_lock<std::mutex> lock(mtx);
+    while ( ! bStop ) {
+        cv.wait_for(lock, config.interval, [this]() { return bStop || ! pending.empty(); });
+        if ( bStop ) {
+            break;
+        }
+        if ( ! bArmed ) {
+            pending.clear();
+            continue;
+        }
+        if ( pending.empty() ) {
+            pending = CheckCalls();
+            if ( pending.empty() ) {
+                continue;
+            }
+        }
+        // once per Watch(): the handler reopens the camera and arms it again
+        bArmed = false;
+        const auto reason = std::move(pending);
+        pending.clear();
+        lock.unlock();
+        handler(reason);
+        lock.lock();
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef CAMERAWATCHDOG_H
+#define CAMERAWATCHDOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class CameraExecutor;
+
+struct WatchdogConfig {
+    // an executor command (settings, state polls) in the SDK this long is stuck
+    std::chrono::milliseconds commandTimeout = std::chrono::seconds(10);
+    // GetImageData may take its own timeout plus this
+    std::chrono::milliseconds downloadGrace = std::chrono::seconds(5);
+    // how long a recovery waits for the camera to enumerate again
+    std::chrono::milliseconds reopenTimeout = std::chrono::seconds(30);
+    std::chrono::milliseconds interval = std::chrono::milliseconds(250);
+};
+
+// automatic recoveries since Open()
+struct RecoveryStats {
+    std::uint64_t nRecoveries = 0;              // reopened, capture restarted
+    std::uint64_t nFailures = 0;                // gave up, aborted() was emitted
+    std::chrono::milliseconds lastDuration{0};  // detection -> capture restarted
+    std::chrono::milliseconds totalDuration{0};
+    std::string lastReason;
+};
+
+//
+// watchdog over the SDK calls of one camera
+// the executor reports how long its running command has been in the SDK, the
+// capture thread brackets GetImageData with BeginDownload()/EndDownload().
+// a call past its limit, or a Trigger() from a capture thread that saw the
+// camera go away, runs the handler once on the watchdog thread; the next
+// Watch() arms it again.
+//
+class CameraWatchdog {
+public:
+    using clock = std::chrono::steady_clock;
+    // the reason, on the watchdog thread
+    using Handler = std::function<void(const std::string &)>;
+
+    explicit CameraWatchdog(Handler handler);
+    ~CameraWatchdog();
+
+    CameraWatchdog(const CameraWatchdog &) = delete;
+    CameraWatchdog &operator=(const CameraWatchdog &) = delete;
+
+    // null: nothing to watch
+    void Watch(std::shared_ptr<CameraExecutor> pExecutor);
+    void SetConfig(const WatchdogConfig &config);
+    WatchdogConfig GetConfig() const;
+
+    // called by the capture thread around GetImageData
+    void BeginDownload(std::chrono::milliseconds timeout);
+    void EndDownload();
+
+    // runs the handler unless it already did since the last Watch(); false
+    // if nothing is watched
+    bool Trigger(const std::string &reason);
+
+private:
+    void ThreadProc();
+    // reason if a call is past its limit, empty otherwise
+    std::string CheckCalls() const;
+
+    Handler handler;
+    std::shared_ptr<CameraExecutor> pExecutor;
+    std::atomic<std::int64_t> nDownloadDeadline;    // steady_clock ticks, 0: none
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    WatchdogConfig config;
+    bool bArmed;
+    std::string pending;
+    bool bStop;
+    std::thread thread;
+};
+
+#endif // CAMERAWATCHDOG_H
@@ -1,486 +1,258 @@
 #include "ccdplayerone.h"
 
+#include <algorithm>
 #include <chrono>
-#include <map>
+#include <functional>
 #include <vector>
 
-#include "PlayerOneCamera.h"
+#include "packed12.h"
+#include "playeronecamera.hpp"
 
-#include "logging.hpp"
 
+namespace {
 
-class PlayerOneCamera {
-public:
-    PlayerOneCamera(const POACameraProperties &prop, const std::map<POAConfig, POAConfigAttributes> &attrib, const std::shared_ptr<logging::Logger> &pLogger)
-        : m_CamProp(prop)
-        , m_Attrib(attrib)
-        , m_pLogger(pLogger)
-    {}
-    ~PlayerOneCamera()
-    {}
+// a capture thread that has not left this long after POAStopExposure is
+// stuck in the SDK
+constexpr auto AbortJoinTimeout = std::chrono::seconds(2);
+// an urgent command that has not run this long: the executor is stuck
+constexpr auto RecoveryProbeTimeout = std::chrono::seconds(1);
+// between attempts to find and reopen a lost camera
+constexpr auto ReopenRetryInterval = std::chrono::milliseconds(500);
 
-    static std::vector<std::string> CameraList() {
-        const auto nCount = POAGetCameraCount();
-        if (nCount <= 0) {
-            // No camera detected.
-            return std::vector<std::string>();
-        }
-
-        // build camera list
-        std::vector<std::string> result;
-        result.reserve(nCount);
-        for (int i = 0; i < nCount; ++i) {
-            POACameraProperties prop = {};
-            if (POAGetCameraProperties(i, &prop) != POA_OK) {
-                // something wrong...
-                result.push_back(std::string());
-                continue;
-            }
-            result.push_back(prop.cameraModelName);
-        }
-        return result;
-    }
-
-    static std::shared_ptr<PlayerOneCamera> Open(int nIndex) {
-        LOGGING_GLOBAL_DECL();
-        LOGGING_GLOBAL_LOG_CREATE("gbxccd_playerone.log");
-
-        const auto nCameraCount = POAGetCameraCount();
-        if (nIndex < 0 || nIndex >= nCameraCount) {
-            // Out of range
-            LOGGING_GLOBAL_LOG_ERROR("Out of range: Count: ", nCameraCount, "At: ", nIndex);
-            return nullptr;
-        }
-
-        POAErrors nErr = POAErrors::POA_OK;
-        POACameraProperties prop = {};
-        if ( (nErr = POAGetCameraProperties(nIndex, &prop)) != POA_OK ) {
-            LOGGING_GLOBAL_LOG_ERROR("GetCameraProperties failed: ", nErr);
-            return nullptr;
-        }
-
-        if ( (nErr = POAOpenCamera(prop.cameraID)) != POA_OK ) {
-            LOGGING_GLOBAL_LOG_ERROR("OpenCamera failed: ", nErr);
-            return nullptr;
-        }
-
-        if ( (nErr = POAInitCamera(prop.cameraID)) != POA_OK ) {
-            LOGGING_GLOBAL_LOG_ERROR("InitCamera failed: ", nErr);
-            return nullptr;
-        }
-
-        return Create(prop);
-    }
-
-    POACameraProperties m_CamProp;
-    std::map<POAConfig, POAConfigAttributes> m_Attrib;
-    LOGGING_DECL();
-
-protected:
-    static std::shared_ptr<PlayerOneCamera> Create(const POACameraProperties &prop) {
-        std::shared_ptr<logging::Logger> pLogger;
-        LOGGING_CREATE_IMPL(pLogger, std::string("gbxccd_playerone_") + prop.cameraModelName + ".log");
-
-        std::map<POAConfig, POAConfigAttributes> attributes;
-        POAErrors nErr = POAErrors::POA_OK;
-        int nAttribCount = 0;
-        if ( (nErr = POAGetConfigsCount(prop.cameraID, &nAttribCount)) != POA_OK ) {
-            LOGGING_ERROR0(pLogger, "GetConfigsCount failed: ", nErr);
-            return nullptr;
-        }
-        LOGGING_INFO0(pLogger, "ConfigsCount: ", nAttribCount);
-        for (int i = 0; i < nAttribCount; ++i) {
-            POAConfigAttributes attrib;
-            if ( (nErr = POAGetConfigAttributes(prop.cameraID, i, &attrib)) == POA_OK ) {
-                LOGGING_INFO0(pLogger, "GetConfigAttributes[", i, "]:");
-                LOGGING_INFO0(pLogger, "  ID: ", attrib.configID);
-                LOGGING_INFO0(pLogger, "  IsSupportAuto: ", attrib.isSupportAuto);
-                LOGGING_INFO0(pLogger, "  IsWritable: ", attrib.isWritable);
-                LOGGING_INFO0(pLogger, "  IsReadable: ", attrib.isReadable);
-                LOGGING_INFO0(pLogger, "  ValueType: ", attrib.valueType);
-                if ( attrib.valueType == POAValueType::VAL_BOOL ) {
-                    LOGGING_INFO0(pLogger, "  MinValue: ", attrib.minValue.boolValue);
-                    LOGGING_INFO0(pLogger, "  MaxValue: ", attrib.maxValue.boolValue);
-                    LOGGING_INFO0(pLogger, "  DefaultValue: ", attrib.defaultValue.boolValue);
-                } else if ( attrib.valueType == POAValueType::VAL_FLOAT ) {
-                    LOGGING_INFO0(pLogger, "  MinValue: ", attrib.minValue.floatValue);
-                    LOGGING_INFO0(pLogger, "  MaxValue: ", attrib.maxValue.floatValue);
-                    LOGGING_INFO0(pLogger, "  DefaultValue: ", attrib.defaultValue.floatValue);
-                } else if ( attrib.valueType == POAValueType::VAL_INT ) {
-                    LOGGING_INFO0(pLogger, "  MinValue: ", attrib.minValue.intValue);
-                    LOGGING_INFO0(pLogger, "  MaxValue: ", attrib.maxValue.intValue);
-                    LOGGING_INFO0(pLogger, "  DefaultValue: ", attrib.defaultValue.intValue);
-                }
-                attributes.emplace(attrib.configID, attrib);
-            }
-            else {
-                LOGGING_ERROR0(pLogger, "GetConfigAttributes failed [", i, "]: ", nErr);
-            }
-        }
-
-        return std::make_shared<PlayerOneCamera>(prop, attributes, pLogger);
-    }
-
-public:
-    auto cameraID() const -> decltype(POACameraProperties::cameraID) {
-        return m_CamProp.cameraID;
-    }
-    void Close() {
-        LOGGING_INFO("CloseCamera");
-        POACloseCamera(cameraID());
-    }
-    std::tuple<int, int> GetMaxImageSize() const {
-        return std::make_tuple(m_CamProp.maxWidth, m_CamProp.maxHeight);
-    }
-    std::optional<std::tuple<long, long, long>> GetExposureRange() const {
-        return GetIntRange(POAConfig::POA_EXPOSURE);
-    }
-    std::optional<std::tuple<long, long, long>> GetGainRange() const {
-        return GetIntRange(POAConfig::POA_GAIN);
-    }
-
-    std::string GetDeviceName() const {
-        return m_CamProp.cameraModelName;
-    }
-
-    long GetCurrentExposure() {
-        auto exp = GetExposure();
-        if ( ! exp ) {
-            const auto it = m_Attrib.find(POAConfig::POA_EXPOSURE);
-            if ( it == m_Attrib.end() ) {
-                return -1;
-            }
-            return it->second.defaultValue.intValue;
-        }
-        return *exp;
-    }
-    std::optional<long> GetExposure() {
-        auto ret = GetIntConfig(POAConfig::POA_EXPOSURE);
-        if ( ! ret ) {
-            LOGGING_ERROR("GetExposure failed.");
-            return std::nullopt;
-        }
-        return std::get<0>(*ret);
-    }
-    bool SetExposure(long nExposure) {
-        const auto bRet = SetIntConfig(POAConfig::POA_EXPOSURE, nExposure, POABool::POA_FALSE);
-        if ( ! bRet ) {
-            LOGGING_ERROR("SetExposure failed.");
-        }
-        return bRet;
-    }
-
-    long GetCurrentGain() {
-        auto gain = GetGain();
-        if ( ! gain ) {
-            const auto it = m_Attrib.find(POAConfig::POA_GAIN);
-            if ( it == m_Attrib.end() ) {
-                return -1;
-            }
-            return it->second.defaultValue.intValue;
-        }
-        return *gain;
-    }
-    std::optional<long> GetGain() {
-        auto ret = GetIntConfig(POAConfig::POA_GAIN);
-        if ( ! ret ) {
-            LOGGING_ERROR("GetGain failed.");
-            return std::nullopt;
-        }
-        return std::get<0>(*ret);
-    }
-    bool SetGain(long nGain) {
-        const auto bRet = SetIntConfig(POAConfig::POA_GAIN, nGain, POABool::POA_FALSE);
-        if ( ! bRet ) {
-            LOGGING_ERROR("SetGain failed.");
-        }
-        return bRet;
-    }
-
-    std::optional<std::tuple<int, int>> GetImageSize() {
-        int nWidth = 0, nHeight = 0;
-        const auto nErr = POAGetImageSize(cameraID(), &nWidth, &nHeight);
-        if ( nErr != POAErrors::POA_OK ) {
-            LOGGING_ERROR("GetImageSize failed. code:", nErr);
-            return std::nullopt;
-        }
-        LOGGING_INFO("GetImageSize: width:", nWidth, ", height:", nHeight);
-        return std::make_tuple(nWidth, nHeight);
-    }
-
-    bool SetImageSize(int nWidth, int nHeight) {
-        LOGGING_INFO("SetImageSize: width:", nWidth, " height:", nHeight);
-        const auto nErr = POASetImageSize(cameraID(), nWidth, nHeight);
-        if ( nErr != POAErrors::POA_OK ) {
-            LOGGING_ERROR("SetImageSize failed. code:", nErr);
-            return false;
-        }
-        return true;
-    }
-
-    std::optional<POAImgFormat> GetImageFormat() {
-        POAImgFormat fmt;
-        const auto nErr = POAGetImageFormat(cameraID(), &fmt);
-        if ( nErr != POAErrors::POA_OK ) {
-            LOGGING_ERROR("GetImageFormat failed. code:", nErr);
-            return std::nullopt;
-        }
-        LOGGING_INFO("GetImageFormat: ", fmt);
-        return fmt;
-    }
-
-    std::optional<bool> ImageReady() {
-        POABool isReady = POABool::POA_FALSE;
-        const auto nErr = POAImageReady(cameraID(), &isReady);
-        if ( nErr != POAErrors::POA_OK ) {
-            LOGGING_ERROR("ImageReady failed. code:", nErr);
-            return std::nullopt;
-        }
-        LOGGING_INFO("ImageReady: ", isReady);
-        return isReady == POABool::POA_TRUE;
-    }
-
-    std::optional<POACameraState> GetCameraState() {
-        POACameraState state;
-        const auto nErr = POAGetCameraState(cameraID(), &state);
-        if ( nErr != POAErrors::POA_OK ) {
-            LOGGING_ERROR("GetCameraState failed. code:", nErr);
-            return std::nullopt;
-        }
-        LOGGING_INFO("GetCameraState: ", state);
-        return state;
-    }
-
-    bool GetImageData(std::vector<unsigned char>& buffer, int timeout_ms = -1) {
-        LOGGING_INFO("GetImageData: ", buffer.size(), "bytes timeout: ", timeout_ms);
-        const auto nErr = POAGetImageData(cameraID(), buffer.data(), buffer.size(), timeout_ms);
-        if ( nErr != POAErrors::POA_OK ) {
-            LOGGING_ERROR("GetImageData failed. code:", nErr);
-        }
-        LOGGING_INFO("OK");
-        return nErr == POAErrors::POA_OK;
-    }
-
-    bool StartExposure() {
-        const auto nErr = POAStartExposure(cameraID(), POABool::POA_TRUE);
-        if ( nErr != POAErrors::POA_OK ) {
-            LOGGING_ERROR("StartExposure failed. code:", nErr);
-            return false;
-        }
-        LOGGING_INFO("StartExposure");
-        return true;
-    }
-    bool StartLiveView() {
-        const auto nErr = POAStartExposure(cameraID(), POABool::POA_FALSE);
-        if ( nErr != POAErrors::POA_OK ) {
-            LOGGING_ERROR("StartLiveView failed. code:", nErr);
-            return false;
-        }
-        LOGGING_INFO("StartLiveView");
-        return true;
-    }
-
-    bool StopExposure() {
-        const auto nErr = POAStopExposure(cameraID());
-        if ( nErr != POAErrors::POA_OK ) {
-            LOGGING_ERROR("StopExposure failed. code:", nErr);
-        }
-        LOGGING_INFO("StopExposure");
-        return nErr == POAErrors::POA_OK;
-    }
-
-    std::optional<int> GetImageBin() {
-        int nBin = 0;
-        const auto nErr = POAGetImageBin(cameraID(), &nBin);
-        if ( nErr != POAErrors::POA_OK ) {
-            LOGGING_ERROR("GetImageBin failed. code:", nErr);
-            return std::nullopt;
-        }
-        LOGGING_INFO("GetImageBin: ", nBin);
-        return nBin;
-    }
-
-    bool SetImageBin(int nBin) {
-        LOGGING_INFO("SetImageBin: ", nBin);
-        const auto nErr = POASetImageBin(cameraID(), nBin);
-        if ( nErr != POAErrors::POA_OK ) {
-            LOGGING_ERROR("SetImageBin failed. code:", nErr);
-            return false;
-        }
-        return true;
-    }
+// clears the running flag of a capture thread on every exit path
+struct RunningGuard {
+    std::atomic<bool> &bRunning;
+    std::mutex &mtx;
+    std::condition_variable &cv;
 
-    std::optional<std::tuple<int, int>> GetImageStartPos() {
-        int nStartX, nStartY;
-        const auto nErr = POAGetImageStartPos(cameraID(), &nStartX, &nStartY);
-        if ( nErr != POAErrors::POA_OK ) {
-            LOGGING_ERROR("GetImageStartPos failed. code:", nErr);
-            return std::nullopt;
+    ~RunningGuard() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            bRunning = false;
         }
-        LOGGING_INFO("GetImageStartPos: x:", nStartX, "y:", nStartY);
-        return std::make_tuple(nStartX, nStartY);
+        cv.notify_all();
     }
+};
 
-    bool SetImageStartPos(int nStartX, int nStartY) {
-        LOGGING_INFO("SetImageStartPos: x:", nStartX, " y:", nStartY);
-        const auto nErr = POASetImageStartPos(cameraID(), nStartX, nStartY);
-        if ( nErr != POAErrors::POA_OK ) {
-            LOGGING_ERROR("SetImageStartPos failed. code:", nErr);
-            return false;
-        }
-        return true;
-    }
+// runs a function when the capture thread leaves, whatever the path
+struct DeferredGuard {
+    std::function<void()> func;
 
-protected:
-    std::optional<std::tuple<long, POABool>> GetIntConfig(POAConfig config) {
-        POAConfigValue value;
-        POABool isAuto;
-        POAErrors nErr;
-        if ( (nErr = POAGetConfig(cameraID(), config, &value, &isAuto)) != POAErrors::POA_OK ) {
-            LOGGING_ERROR("GetConfig (int) failed: ", nErr);
-            return std::nullopt;
-        }
-        LOGGING_INFO("GetConfig: id:", config, " value:", value.intValue, " isAuto:", isAuto);
-        return std::make_tuple(value.intValue, isAuto);
-    }
-    bool SetIntConfig(POAConfig config, long nValue, POABool isAuto) {
-        POAConfigValue value;
-        value.intValue = nValue;
-        LOGGING_INFO("SetConfig: id:", config, " value:", nValue, " isAuto:", isAuto);
-        const auto nErr = POASetConfig(cameraID(), config, value, isAuto);
-        if ( nErr != POAErrors::POA_OK ) {
-            LOGGING_ERROR("SetConfig (int) failed: ", nErr);
-        }
-        LOGGING_INFO("OK");
-        return nErr == POAErrors::POA_OK;
+    ~DeferredGuard() {
+        func();
     }
+};
 
-    // (min, max, default)
-    std::optional<std::tuple<long, long, long>> GetIntRange(POAConfig configID) const {
-        const auto it = m_Attrib.find(configID);
-        if ( it == m_Attrib.end() ) {
-            return std::nullopt;
-        }
-        if ( it->second.valueType != POAValueType::VAL_INT) {
-            return std::nullopt;
-        }
-        return std::make_tuple(it->second.minValue.intValue, it->second.maxValue.intValue, it->second.defaultValue.intValue);
-    }
-    std::optional<std::tuple<double, double, double>> GetFloatRange(POAConfig configID) const {
-        const auto it = m_Attrib.find(configID);
-        if ( it == m_Attrib.end() ) {
-            return std::nullopt;
-        }
-        if ( it->second.valueType != POAValueType::VAL_FLOAT ) {
-            return std::nullopt;
-        }
-        return std::make_tuple(it->second.minValue.floatValue, it->second.maxValue.floatValue, it->second.defaultValue.floatValue);
-    }
+std::size_t FrameBytes(const CaptureGeometry &geometry) {
+    const auto nBytepp = std::get<1>(PlayerOneImgFormatSize(static_cast<POAImgFormat>(geometry.nFormat)));
+    return static_cast<std::size_t>(geometry.nWidth) * geometry.nHeight * nBytepp;
+}
 
-};
+}  // namespace
 
 
 CcdPlayerOne::CcdPlayerOne()
-    : pCamera()
+    : pActiveExecutor()
     , m_nCurrentExposureCache(0)
+    , m_nCurrentGainCache(0)
+    , mtxExposureChange()
+    , nPreviousExposure(0)
+    , nPreviousGain(0)
+    , exposureChanged()
     , m_nCurrentBufferSize(0)
+    , m_nCurrentWidth(0)
+    , m_nCurrentHeight(0)
+    , m_nCurrentStartX(0)
+    , m_nCurrentStartY(0)
+    , mtxStartPosChange()
+    , nPreviousStartX(0)
+    , nPreviousStartY(0)
+    , startPosChanged()
     , mtxWaiting()
     , imageWaitingThread()
     , bAbortBulb(false)
     , bImageWaiting(false)
+    , mtxLiveView()
+    , liveViewThread()
+    , bStopLiveView(false)
+    , bLiveViewRunning(false)
+    , mtxAbort()
+    , cvAbort()
+    , nLastAbortLatency(-1)
+    , mtxLeftBehind()
+    , leftBehindThreads()
+    , bMuteLiveView(false)
+    , nLiveViewFrames(0)
+    , framePool()
+    , frameQueue()
+    , frameGraph(frameQueue)
+    , latencyStats()
+    , pCalibrationLibrary()
+    , pActiveGuider()
+    , pActiveTelemetry()
+    , statsEngine()
+    , bFrameStats(false)
+    , nSaturationLevel(0)
+    , bAutoExposure(false)
+    , autoExposure()
+    , clockSync()
+    , nFrameSequence(0)
+    , mtxThreadConfig()
+    , captureThreadConfig()
+    , binner()
+    , mtxSoftwareBin()
+    , softwareBin()
+    , mtxDeferred()
+    , nDeferring(0)
+    , deferredSettings()
+    , bPackedRaw12(false)
+    , bAutoRecovery(false)
+    , bCancelRecovery(false)
+    , restartCapture(Capture::None)
+    , nCaptureGeneration(0)
+    , mtxRecovery()
+    , mtxCapture()
+    , bCaptureChanged(false)
+    , mtxRecoveryState()
+    , savedSettings()
+    , recoveryStats()
+    , appliedTuning()
+    , readoutModel()
+    , watchdog([this](const std::string &reason) { Recover(reason); })
 {}
 
+CcdPlayerOne::~CcdPlayerOne() {
+    Close();
+    // Close() closed the handle their SDK call was stuck in, if anything
+    // ends it that does
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mtxLeftBehind);
+        threads.swap(leftBehindThreads);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
 bool CcdPlayerOne::Open(int nNo) {
     const auto aCameras = PlayerOneCamera::CameraList();
     if ( static_cast<int>(aCameras.size()) <= nNo ) {
         return false;
     }
-    pCamera = PlayerOneCamera::Open(nNo);
+    const auto pCamera = PlayerOneCamera::Open(nNo);
     if ( ! pCamera ) {
         return false;
     }
+    // from here on every SDK call for the camera goes through the executor
+    const auto pExecutor = std::make_shared<CameraExecutor>(pCamera);
+    std::atomic_store(&pActiveExecutor, pExecutor);
+    nFrameSequence = 0;
+    readoutModel.Reset();
+    if ( pCamera->HasST4Port() ) {
+        std::atomic_store(&pActiveGuider, std::make_shared<GuidePulser>(pExecutor));
+    }
+    if ( pCamera->HasConfig(POAConfig::POA_TEMPERATURE) ) {
+        std::atomic_store(&pActiveTelemetry, std::make_shared<TelemetryPoller>(pExecutor));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtxRecoveryState);
+        savedSettings.reset();
+        recoveryStats = RecoveryStats();
+    }
+    if ( bAutoRecovery ) {
+        watchdog.Watch(pExecutor);
+    }
 
     return true;
 }
 void CcdPlayerOne::Close() {
-    if ( imageWaitingThread.joinable() ) {
-        // terminate downloading thread
-        imageWaitingThread.join();
-    }
-    bAbortBulb = true;
+    // a recovery in progress gives up instead of reopening
+    {
+        std::lock_guard<std::mutex> lock(mtxAbort);
+        bCancelRecovery = true;
+    }
+    cvAbort.notify_all();
+    std::lock_guard<std::mutex> lock(mtxRecovery);
+    bCancelRecovery = false;
+    watchdog.Watch(nullptr);
+    StopLiveView();
+    // a running exposure is aborted, not waited for
+    AbortExposure();
     if ( bulbThread.joinable() ) {
         bulbThread.join();
     }
-    if ( ! pCamera ) {
+    // null if a stuck stop above abandoned it; the probe abandons a stuck one
+    // with the guider and telemetry instead of switching the outputs off
+    const auto pExecutor = std::atomic_exchange(&pActiveExecutor, std::shared_ptr<CameraExecutor>());
+    if ( ! pExecutor || ! StopExposureOrAbandon(pExecutor, "Close") ) {
         return;
     }
-    pCamera->Close();
-    pCamera = nullptr;
+    // outputs off before the camera goes away
+    std::atomic_store(&pActiveGuider, std::shared_ptr<GuidePulser>());
+    std::atomic_store(&pActiveTelemetry, std::shared_ptr<TelemetryPoller>());
+    auto closed = pExecutor->Submit(CommandPriority::Urgent, [](PlayerOneCamera &camera) {
+        camera.Close();
+    });
+    if ( closed.wait_for(RecoveryProbeTimeout) != std::future_status::ready ) {
+        AbandonExecutor(pExecutor);
+    }
 }
 
 std::string CcdPlayerOne::GetDeviceName() const {
-    if ( ! pCamera ) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
         return std::string();
     }
+    const auto &pCamera = pExecutor->GetCamera();
     return pCamera->m_CamProp.cameraModelName;
 }
 
 std::tuple<long, long> CcdPlayerOne::GetMaxSize() const {
-    if ( ! pCamera ) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
         return std::make_tuple(0, 0);
     }
+    const auto &pCamera = pExecutor->GetCamera();
     return std::make_tuple(
         pCamera->m_CamProp.maxWidth,
         pCamera->m_CamProp.maxHeight
     );
 }
 
-// (bits, bytes)
-inline std::tuple<int, int> PlayerOneImgFormatSize(POAImgFormat fmt) {
-    switch (fmt) {
-    case POAImgFormat::POA_RAW8:
-    case POAImgFormat::POA_MONO8:
-        return std::make_tuple(8, 1);
-    case POAImgFormat::POA_RAW16:
-        return std::make_tuple(16, 2);
-    case POAImgFormat::POA_RGB24:
-        return std::make_tuple(24, 3);
-    case POAImgFormat::POA_END:
-        assert(false);
-        break;
-    }
-#ifdef _DEBUG
-    assert(false);
-#endif  // _DEBUG
-    return std::make_tuple(1, 1);
-}
-
 bool CcdPlayerOne::StartExposure() {
-    if ( ! pCamera ) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
         return false;
     }
-    if ( imageWaitingThread.joinable() ) {
-        // terminate previous downloading thread
-        imageWaitingThread.join();
-    }
+    std::lock_guard<std::recursive_mutex> lockCapture(mtxCapture);
+    bCaptureChanged = true;
+    const auto &pCamera = pExecutor->GetCamera();
+    // terminate previous downloading thread
+    JoinImageThread();
 
     AbortExposure();
 
     // check state (see device log)
-    const auto state = pCamera->GetCameraState();
+    const auto state = pExecutor->Call(&PlayerOneCamera::GetCameraState);
     Q_UNUSED(state);
 
     bAbortBulb = false;
-    const auto imageSize = pCamera->GetImageSize();
+    frameQueue.Resume();
+    // the camera went away since the last frame: a recovery starts the exposure
+    auto setupFailed = [this, pExecutor]() {
+        return RequestRecovery(pExecutor, "StartExposure", Capture::Exposure);
+    };
+    const auto imageSize = pExecutor->Call(&PlayerOneCamera::GetImageSize);
     if ( ! imageSize ) {
-        return false;
+        return setupFailed();
     }
     const auto nWidth = std::get<0>(*imageSize);
     const auto nHeight = std::get<1>(*imageSize);
 
-    const auto imageFormat = pCamera->GetImageFormat();
+    const auto imageFormat = pExecutor->Call(&PlayerOneCamera::GetImageFormat);
     if ( ! imageFormat ) {
-        return false;
+        return setupFailed();
     }
     POAImgFormat fmt = *imageFormat;
 
@@ -489,78 +261,486 @@ bool CcdPlayerOne::StartExposure() {
     Q_UNUSED(bColorCam);
     const auto optExposureTime = GetExposure();
     const auto optGain = GetGain();
-    const auto optQuality = GetQuality();
-    if ( ! optExposureTime || ! optGain || ! optQuality ) {
-        return false;
+    const auto optBin = pExecutor->Call(&PlayerOneCamera::GetImageBin);
+    if ( ! optExposureTime || ! optGain || ! optBin ) {
+        return setupFailed();
     }
-    const auto nExposureTime = *optExposureTime;
-    Q_UNUSED(nExposureTime);
-    const auto nGain = *optGain;
-    Q_UNUSED(nGain);
-    const auto nQuality = *optQuality;
-    Q_UNUSED(nQuality);
     m_nCurrentBufferSize = nWidth * nHeight * nBytepp;
+    SetAppliedExposure(*optExposureTime, *optGain);
+    const auto startPos = pExecutor->Call(&PlayerOneCamera::GetImageStartPos);
+    const auto pCalibrator = SelectCalibrator();
+    const auto bin = SelectSoftwareBin(fmt, nWidth, nHeight);
+    const auto [nBinnedWidth, nBinnedHeight] = SoftwareBinner::GetOutputSize(nWidth, nHeight, bin);
+    // structured bindings cannot be captured in C++17
+    const auto nFrameBytepp = nBytepp;
+    const auto nFrameWidth = bin.IsEnabled() ? nBinnedWidth : nWidth;
+    const auto nFrameHeight = bin.IsEnabled() ? nBinnedHeight : nHeight;
+    const bool bPack12 = SelectPack12(nBytepp, pCalibrator != nullptr, bin);
+    const auto readoutKey = GetReadoutKey(fmt, *optBin);
+
+    // everything but the timing is known now
+    FrameMetadata baseMetadata;
+    baseMetadata.nExposure = *optExposureTime;
+    baseMetadata.nGain = *optGain;
+    baseMetadata.nOffset = pExecutor->Call(&PlayerOneCamera::GetOffset).value_or(0);
+    baseMetadata.nBin = *optBin;
+    baseMetadata.nSoftwareBinX = bin.nX;
+    baseMetadata.nSoftwareBinY = bin.nY;
+    if ( startPos ) {
+        std::tie(baseMetadata.nStartX, baseMetadata.nStartY) = *startPos;
+    }
+    baseMetadata.nWidth = nFrameWidth;
+    baseMetadata.nHeight = nFrameHeight;
+    baseMetadata.nFormat = fmt;
+    baseMetadata.nBytepp = nBytepp;
+    baseMetadata.bPacked12 = bPack12;
+    clockSync.Sync();
+    SaveSettings();
+
+    // state polls: often enough for short frames, an abort does not wait for one
+    const auto pollInterval = std::chrono::microseconds(std::clamp<long>(m_nCurrentExposureCache / 10, 1000, 100000));
 
+    // a thread left behind by a recovery keeps to the executor and camera it
+    // started with; GetImageData runs here, outside the executor
+    const auto pThreadExecutor = pExecutor;
+    const auto pThreadCamera = pThreadExecutor->GetCamera();
+    const auto nGeneration = nCaptureGeneration.load();
     auto abortProc = [=]() {
-        pCamera->StopExposure();
+        if ( IsRecovering(nGeneration) ) {
+            // the recovery restarts the exposure
+            return;
+        }
+        pThreadExecutor->Call(CommandPriority::Urgent, &PlayerOneCamera::StopExposure);
         emit aborted();
     };
+    auto failProc = [=](const char *szCall) {
+        if ( ! bAbortBulb && ! IsRecovering(nGeneration) && RequestRecovery(pThreadExecutor, szCall, Capture::Exposure) ) {
+            return;
+        }
+        abortProc();
+    };
+    std::lock_guard<std::mutex> lock(mtxWaiting);
+    bImageWaiting = true;
+    {
+        std::lock_guard<std::mutex> deferredLock(mtxDeferred);
+        ++nDeferring;
+    }
     std::thread thread([=]() {
-        if (!pCamera->StartExposure()) {
+        RunningGuard running{ bImageWaiting, mtxAbort, cvAbort };
+        // before bImageWaiting drops: a joined thread has applied the queue
+        DeferredGuard deferred{ [this]() { ApplyDeferredSettings(); } };
+        ConfigureCaptureThread("poa-exposure");
+
+        FrameTimestamps timestamps;
+        timestamps.exposureStart = FrameTimestamps::clock::now();
+        if ( bAbortBulb ) {
             abortProc();
             return;
         }
+        if ( ! pThreadExecutor->Call(&PlayerOneCamera::StartExposure) ) {
+            failProc("POAStartExposure");
+            return;
+        }
+        // the sensor started somewhere within the call, the camera times the rest
+        const auto exposureIssued = FrameTimestamps::clock::now();
+        FrameMetadata metadata = baseMetadata;
+        metadata.exposureStart = timestamps.exposureStart + (exposureIssued - timestamps.exposureStart) / 2;
+        metadata.exposureEnd = metadata.exposureStart + std::chrono::microseconds(metadata.nExposure);
+        metadata.startUncertainty = std::chrono::duration_cast<std::chrono::microseconds>(exposureIssued - timestamps.exposureStart) / 2
+            + clockSync.GetUncertainty();
+        metadata.endUncertainty = metadata.startUncertainty;
 
-        POACameraState state;
-        do {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            if ( bAbortBulb ) {
-                break;
-            }
-            const auto result = pCamera->GetCameraState();
+        while ( WaitFor(pollInterval, bAbortBulb) ) {
+            const auto result = pThreadExecutor->Call(&PlayerOneCamera::GetCameraState);
             if ( ! result ) {
-                bAbortBulb = true;
+                failProc("POAGetCameraState");
+                return;
             }
-            state = *result;
-        } while (state == POACameraState::STATE_EXPOSING);
+            if ( *result != POACameraState::STATE_EXPOSING ) {
+                break;
+            }
+        }
+        timestamps.exposureEnd = FrameTimestamps::clock::now();
         if ( bAbortBulb ) {
             abortProc();
             return;
         }
-        const auto ret = pCamera->ImageReady();
+        const auto ret = pThreadExecutor->Call(&PlayerOneCamera::ImageReady);
         if ( ! ret || ! *ret ) {
-            abortProc();
+            failProc("POAImageReady");
             return;
         }
+        timestamps.imageReady = FrameTimestamps::clock::now();
 
-        // TODO:
         const auto nSize = m_nCurrentBufferSize;
-        std::vector<unsigned char> buffer(nSize);
-        if ( ! pCamera->GetImageData(buffer, m_nCurrentExposureCache / 1000 + 500) ) {
-            abortProc();
+        const auto pBuffer = framePool.Acquire(nSize);
+        if ( ! DownloadImage(*pThreadCamera, *pBuffer, readoutModel.GetDownloadTimeout(readoutKey, nSize)) ) {
+            failProc("POAGetImageData");
             return;
         }
+        timestamps.downloaded = FrameTimestamps::clock::now();
+        readoutModel.RecordDownload(readoutKey, nSize, std::chrono::duration_cast<std::chrono::microseconds>(timestamps.downloaded - timestamps.imageReady));
+        readoutModel.RecordExposureOverhead(readoutKey, std::chrono::duration_cast<std::chrono::microseconds>(timestamps.imageReady - timestamps.exposureStart)
+                                                        - std::chrono::microseconds(metadata.nExposure));
+        if ( pCalibrator && startPos ) {
+            pCalibrator->Apply(std::get<0>(*startPos), std::get<1>(*startPos), nWidth, nHeight, nFrameBytepp, *pBuffer);
+        }
+        const auto pFrame = ApplySoftwareBin(bin, nWidth, nHeight, nFrameBytepp, pBuffer);
+        const auto pStats = ComputeFrameStats(nFrameWidth, nFrameHeight, nFrameBytepp, *pFrame);
+        CompleteMetadata(metadata);
 
-        emit imageReady(nWidth, nHeight, buffer);
+        timestamps.emitted = FrameTimestamps::clock::now();
+        latencyStats.RecordAcquisition(timestamps);
+        emit imageReady(nFrameWidth, nFrameHeight, *pFrame, timestamps, pStats, metadata);
+        PublishFrame(nFrameWidth, nFrameHeight, nFrameBytepp, pFrame, timestamps, metadata, pStats);
     });
     imageWaitingThread.swap(thread);
     return true;
 }
 
+bool CcdPlayerOne::IsShooting() const {
+    return bImageWaiting;
+}
 bool CcdPlayerOne::AbortExposure() {
-    bAbortBulb = true;
-    return EndExposure();
+    std::lock_guard<std::recursive_mutex> lockCapture(mtxCapture);
+    bCaptureChanged = true;
+    const auto requested = bImageWaiting ? FrameTimestamps::clock::now() : FrameTimestamps::clock::time_point();
+    {
+        std::lock_guard<std::mutex> lock(mtxAbort);
+        bAbortBulb = true;
+    }
+    cvAbort.notify_all();
+    // a capture thread blocked on a full recorder queue
+    frameQueue.Interrupt();
+    return StopImageThread(requested);
 }
 bool CcdPlayerOne::EndExposure() {
-    if (!pCamera) {
+    std::lock_guard<std::recursive_mutex> lockCapture(mtxCapture);
+    bCaptureChanged = true;
+    return StopImageThread(bImageWaiting ? FrameTimestamps::clock::now() : FrameTimestamps::clock::time_point());
+}
+bool CcdPlayerOne::StopImageThread(FrameTimestamps::clock::time_point requested) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
+        return false;
+    }
+    // ends a running exposure and wakes GetImageData on the capture thread
+    StopExposureOrAbandon(pExecutor, "POAStopExposure");
+    std::lock_guard<std::mutex> lock(mtxWaiting);
+    return JoinCaptureThread(imageWaitingThread, bImageWaiting, requested);
+}
+bool CcdPlayerOne::StopExposureOrAbandon(const std::shared_ptr<CameraExecutor> &pExecutor, const std::string &call) {
+    auto stopped = pExecutor->Submit(CommandPriority::Urgent, [](PlayerOneCamera &camera) {
+        camera.StopExposure();
+    });
+    if ( stopped.wait_for(RecoveryProbeTimeout) == std::future_status::ready ) {
+        return true;
+    }
+    AbandonExecutor(pExecutor);
+    // a recovery reopens the camera, without one it stays closed
+    if ( ! watchdog.Trigger(call + " stuck") ) {
+        auto pExpected = pExecutor;
+        std::atomic_compare_exchange_strong(&pActiveExecutor, &pExpected, std::shared_ptr<CameraExecutor>());
+    }
+    return false;
+}
+void CcdPlayerOne::AbandonExecutor(const std::shared_ptr<CameraExecutor> &pExecutor) {
+    // closing the handle under the stuck call is what ends it, if anything does
+    pExecutor->GetCamera()->Close();
+    pExecutor->Abandon();
+    // their threads may be waiting on it too
+    if ( const auto pGuider = std::atomic_exchange(&pActiveGuider, std::shared_ptr<GuidePulser>()) ) {
+        pGuider->Abandon();
+    }
+    if ( const auto pTelemetry = std::atomic_exchange(&pActiveTelemetry, std::shared_ptr<TelemetryPoller>()) ) {
+        pTelemetry->Abandon();
+    }
+}
+std::optional<std::chrono::microseconds> CcdPlayerOne::GetLastAbortLatency() const {
+    const auto nLatency = nLastAbortLatency.load();
+    if ( nLatency < 0 ) {
+        return std::nullopt;
+    }
+    return std::chrono::microseconds(nLatency);
+}
+
+bool CcdPlayerOne::DeferSetting(const std::function<void(DeferredSettings &)> &set) {
+    std::lock_guard<std::mutex> lock(mtxDeferred);
+    if ( nDeferring == 0 ) {
         return false;
     }
-    pCamera->StopExposure();
+    set(deferredSettings);
+    return true;
+}
+
+void CcdPlayerOne::ApplyDeferredSettings() {
+    DeferredSettings settings;
+    {
+        std::lock_guard<std::mutex> lock(mtxDeferred);
+        if ( --nDeferring > 0 ) {
+            return;
+        }
+        std::swap(settings, deferredSettings);
+    }
+    // bin first, the ROI is aligned to it. the setters returned true when
+    // they queued, so a failure now is the caller's only news of it
+    if ( settings.nQuality && ! SetQuality(*settings.nQuality) ) {
+        emit settingFailed("bin");
+    }
+    if ( settings.roi ) {
+        const auto [nX, nY, nW, nH] = *settings.roi;
+        if ( ! SetROI(nX, nY, nW, nH) ) {
+            emit settingFailed("roi");
+        }
+    }
+    if ( settings.nGain && ! SetGain(*settings.nGain) ) {
+        emit settingFailed("gain");
+    }
+}
+
+void CcdPlayerOne::JoinImageThread() {
+    // StartExposure, AbortExposure and the setters may run on different threads
+    std::lock_guard<std::mutex> lock(mtxWaiting);
     if ( imageWaitingThread.joinable() ) {
         imageWaitingThread.join();
     }
+}
+
+bool CcdPlayerOne::JoinCaptureThread(std::thread &thread, const std::atomic<bool> &bRunning, FrameTimestamps::clock::time_point requested) {
+    if ( ! thread.joinable() ) {
+        return true;
+    }
+    {
+        std::unique_lock<std::mutex> lock(mtxAbort);
+        if ( ! cvAbort.wait_for(lock, AbortJoinTimeout, [&]() { return ! bRunning; }) ) {
+            // better a thread left behind than a hanging Close(); the
+            // destructor waits for it
+            std::lock_guard<std::mutex> lockLeftBehind(mtxLeftBehind);
+            leftBehindThreads.push_back(std::move(thread));
+            return false;
+        }
+    }
+    const auto stopped = FrameTimestamps::clock::now();
+    thread.join();
+    if ( requested != FrameTimestamps::clock::time_point() ) {
+        nLastAbortLatency = std::chrono::duration_cast<std::chrono::microseconds>(stopped - requested).count();
+        latencyStats.RecordAbort(requested, stopped);
+    }
+    return true;
+}
+
+bool CcdPlayerOne::WaitFor(std::chrono::microseconds duration, const std::atomic<bool> &bCancel) {
+    std::unique_lock<std::mutex> lock(mtxAbort);
+    return ! cvAbort.wait_for(lock, duration, [&]() { return bCancel.load(); });
+}
+
+bool CcdPlayerOne::StartLiveView() {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
+        return false;
+    }
+    std::lock_guard<std::recursive_mutex> lockCapture(mtxCapture);
+    bCaptureChanged = true;
+    StopLiveView();
+    AbortExposure();
+
+    // the camera went away since the last stream: a recovery starts this one
+    auto setupFailed = [this, pExecutor]() {
+        return RequestRecovery(pExecutor, "StartLiveView", Capture::LiveView);
+    };
+    const auto imageSize = pExecutor->Call(&PlayerOneCamera::GetImageSize);
+    if ( ! imageSize ) {
+        return setupFailed();
+    }
+    const auto nWidth = std::get<0>(*imageSize);
+    const auto nHeight = std::get<1>(*imageSize);
+
+    const auto imageFormat = pExecutor->Call(&PlayerOneCamera::GetImageFormat);
+    if ( ! imageFormat ) {
+        return setupFailed();
+    }
+    const auto nBytepp = std::get<1>(PlayerOneImgFormatSize(*imageFormat));
+    m_nCurrentBufferSize = nWidth * nHeight * nBytepp;
+    m_nCurrentWidth = nWidth;
+    m_nCurrentHeight = nHeight;
+    if ( const auto startPos = pExecutor->Call(&PlayerOneCamera::GetImageStartPos) ) {
+        SetAppliedStartPos(std::get<0>(*startPos), std::get<1>(*startPos));
+    }
+    if ( const auto nGain = pExecutor->Call(&PlayerOneCamera::GetGain) ) {
+        SetAppliedExposure(std::nullopt, *nGain);
+    }
+    {
+        // the stream starts with the current settings
+        std::lock_guard<std::mutex> lock(mtxExposureChange);
+        exposureChanged = FrameTimestamps::clock::time_point();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtxStartPosChange);
+        startPosChanged = FrameTimestamps::clock::time_point();
+    }
+    const auto bin = SelectSoftwareBin(*imageFormat, nWidth, nHeight);
+    const auto [nBinnedWidth, nBinnedHeight] = SoftwareBinner::GetOutputSize(nWidth, nHeight, bin);
+    // structured bindings cannot be captured in C++17
+    const auto nFrameWidth = bin.IsEnabled() ? nBinnedWidth : nWidth;
+    const auto nFrameHeight = bin.IsEnabled() ? nBinnedHeight : nHeight;
+    // read once per stream; exposure, gain and ROI position follow the caches
+    FrameMetadata baseMetadata;
+    baseMetadata.nOffset = pExecutor->Call(&PlayerOneCamera::GetOffset).value_or(0);
+    baseMetadata.nBin = pExecutor->Call(&PlayerOneCamera::GetImageBin).value_or(1);
+    baseMetadata.nSoftwareBinX = bin.nX;
+    baseMetadata.nSoftwareBinY = bin.nY;
+    baseMetadata.nWidth = nFrameWidth;
+    baseMetadata.nHeight = nFrameHeight;
+    baseMetadata.nFormat = *imageFormat;
+    baseMetadata.nBytepp = nBytepp;
+    clockSync.Sync();
+    const auto pCalibrator = SelectCalibrator();
+    const bool bPack12 = SelectPack12(nBytepp, pCalibrator != nullptr, bin);
+    baseMetadata.bPacked12 = bPack12;
+    const auto readoutKey = GetReadoutKey(*imageFormat, baseMetadata.nBin);
+    // download + signal in flight, plus what the frame queue can hold; a
+    // binned or packed frame frees its download buffer right away
+    const auto nFrames = frameQueue.GetFrameBudget() + (bin.IsEnabled() || bPack12 ? 2 : 1);
+    framePool.Reserve(nFrames, m_nCurrentBufferSize);
+    frameQueue.Reserve(nFrames);
+    frameQueue.Resume();
+    autoExposure.Reset();
+    SaveSettings();
+
+    // a thread left behind by a recovery keeps to the executor and camera it
+    // started with; GetImageData runs here, outside the executor
+    const auto pThreadExecutor = pExecutor;
+    const auto pThreadCamera = pThreadExecutor->GetCamera();
+    const auto nGeneration = nCaptureGeneration.load();
+    auto failProc = [=](const char *szCall) {
+        if ( IsRecovering(nGeneration) || RequestRecovery(pThreadExecutor, szCall, Capture::LiveView) ) {
+            return;
+        }
+        pThreadExecutor->Call(CommandPriority::Urgent, &PlayerOneCamera::StopExposure);
+        emit aborted();
+    };
+    bStopLiveView = false;
+    bLiveViewRunning = true;
+    std::thread thread([=]() {
+        RunningGuard running{ bLiveViewRunning, mtxAbort, cvAbort };
+        ConfigureCaptureThread("poa-liveview");
+
+        if ( ! pThreadExecutor->Call(&PlayerOneCamera::StartLiveView) ) {
+            failProc("POAStartExposure");
+            return;
+        }
+        const auto nSize = m_nCurrentBufferSize;
+
+        // in live view the exposure start of a frame is not observable,
+        // the Exposure stage measures the frame interval instead.
+        auto exposureStart = FrameTimestamps::clock::now();
+        // last time the next frame was known not to be ready
+        auto lastPoll = exposureStart;
+        // the first interval includes the stream start
+        bool bFirstFrame = true;
+        PendingExposure pending;
+        while ( ! bStopLiveView ) {
+            CollectAutoExposure(pending);
+            const auto ready = pThreadExecutor->Call(&PlayerOneCamera::ImageReady);
+            if ( ! ready ) {
+                failProc("POAImageReady");
+                return;
+            }
+            if ( ! *ready ) {
+                lastPoll = FrameTimestamps::clock::now();
+                // the exposure may change with the stream running
+                WaitFor(std::chrono::microseconds(std::clamp<long>(m_nCurrentExposureCache / 10, 1000, 100000)), bStopLiveView);
+                continue;
+            }
+            FrameTimestamps timestamps;
+            timestamps.exposureStart = exposureStart;
+            timestamps.exposureEnd = FrameTimestamps::clock::now();
+            timestamps.imageReady = timestamps.exposureEnd;
+
+            const auto pBuffer = framePool.Acquire(nSize);
+            if ( ! DownloadImage(*pThreadCamera, *pBuffer, readoutModel.GetDownloadTimeout(readoutKey, nSize)) ) {
+                if ( bStopLiveView ) {
+                    break;
+                }
+                failProc("POAGetImageData");
+                return;
+            }
+            timestamps.downloaded = FrameTimestamps::clock::now();
+            // the frame became ready between the previous poll and this one;
+            // the readout before that is not modelled
+            const auto notReady = lastPoll;
+            const auto exposureEnd = timestamps.imageReady - (timestamps.imageReady - notReady) / 2;
+            const auto [nExposure, nGain] = GetAppliedExposure(exposureEnd);
+            // exposed (or on the wire) before an in-stream move: the old window
+            const auto [nStartX, nStartY] = GetAppliedStartPos(exposureEnd - std::chrono::microseconds(nExposure));
+            const auto download = std::chrono::duration_cast<std::chrono::microseconds>(timestamps.downloaded - timestamps.imageReady);
+            readoutModel.RecordDownload(readoutKey, nSize, download);
+            if ( ! bFirstFrame ) {
+                const auto interval = std::chrono::duration_cast<std::chrono::microseconds>(timestamps.imageReady - exposureStart);
+                readoutModel.RecordLiveOverhead(readoutKey, interval - std::max(std::chrono::microseconds(nExposure), download));
+            }
+            bFirstFrame = false;
+            exposureStart = timestamps.imageReady;
+            lastPoll = timestamps.imageReady;
+            ++nLiveViewFrames;
+            if ( bMuteLiveView ) {
+                continue;
+            }
+            if ( pCalibrator ) {
+                pCalibrator->Apply(nStartX, nStartY, nWidth, nHeight, nBytepp, *pBuffer);
+            }
+            const auto pFrame = ApplySoftwareBin(bin, nWidth, nHeight, nBytepp, pBuffer);
+            const auto pStats = ComputeFrameStats(nFrameWidth, nFrameHeight, nBytepp, *pFrame);
+
+            FrameMetadata metadata = baseMetadata;
+            metadata.nExposure = nExposure;
+            metadata.nGain = nGain;
+            metadata.nStartX = nStartX;
+            metadata.nStartY = nStartY;
+            metadata.exposureEnd = exposureEnd;
+            metadata.exposureStart = metadata.exposureEnd - std::chrono::microseconds(metadata.nExposure);
+            metadata.endUncertainty = std::chrono::duration_cast<std::chrono::microseconds>(timestamps.imageReady - notReady) / 2
+                + clockSync.GetUncertainty();
+            metadata.startUncertainty = metadata.endUncertainty;
+            CompleteMetadata(metadata);
+
+            timestamps.emitted = FrameTimestamps::clock::now();
+            latencyStats.RecordAcquisition(timestamps);
+            emit imageReady(nFrameWidth, nFrameHeight, *pFrame, timestamps, pStats, metadata);
+            PublishFrame(nFrameWidth, nFrameHeight, nBytepp, pFrame, timestamps, metadata, pStats);
+            if ( bAutoExposure && pStats ) {
+                UpdateAutoExposure(pThreadExecutor, pending, *pStats, metadata);
+            }
+        }
+        pThreadExecutor->Call(CommandPriority::Urgent, &PlayerOneCamera::StopExposure);
+    });
+    std::lock_guard<std::mutex> lock(mtxLiveView);
+    liveViewThread.swap(thread);
     return true;
 }
+bool CcdPlayerOne::StopLiveView() {
+    std::lock_guard<std::recursive_mutex> lockCapture(mtxCapture);
+    bCaptureChanged = true;
+    const auto requested = bLiveViewRunning ? FrameTimestamps::clock::now() : FrameTimestamps::clock::time_point();
+    {
+        std::lock_guard<std::mutex> lock(mtxAbort);
+        bStopLiveView = true;
+    }
+    cvAbort.notify_all();
+    frameQueue.Interrupt();
+    if ( ! liveViewThread.joinable() ) {
+        return false;
+    }
+    if ( const auto pExecutor = GetExecutor() ) {
+        // wake up GetImageData
+        StopExposureOrAbandon(pExecutor, "POAStopExposure");
+    }
+    std::lock_guard<std::mutex> lock(mtxLiveView);
+    return JoinCaptureThread(liveViewThread, bLiveViewRunning, requested);
+}
+bool CcdPlayerOne::IsLiveView() const {
+    return liveViewThread.joinable() && ! bStopLiveView;
+}
 
 std::optional<double> CcdPlayerOne::GetExposureSec() const {
     const auto value = GetExposure();
@@ -570,34 +750,38 @@ std::optional<double> CcdPlayerOne::GetExposureSec() const {
     return *value / static_cast<double>(1000000);
 }
 std::optional<long> CcdPlayerOne::GetExposure() const {
-    if ( ! pCamera ) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
         return std::nullopt;
     }
-    auto ret = pCamera->GetExposure();
+    auto ret = pExecutor->Call(&PlayerOneCamera::GetExposure);
     if ( ! ret ) {
         return std::nullopt;
     }
     return *ret;
 }
 bool CcdPlayerOne::SetExposure(long nDependValue) {
-    if ( ! pCamera ) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
         return false;
     }
-    bool bRet = pCamera->SetExposure(nDependValue);
+    bool bRet = pExecutor->Call(&PlayerOneCamera::SetExposure, nDependValue);
     if ( ! bRet ) {
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        bRet = pCamera->SetExposure(nDependValue);
+        bRet = pExecutor->Call(&PlayerOneCamera::SetExposure, nDependValue);
     }
     if ( bRet ) {
-        m_nCurrentExposureCache = nDependValue;
+        SetAppliedExposure(nDependValue, std::nullopt);
     }
 
     return bRet;
 }
 std::tuple<long, long, long> CcdPlayerOne::GetExposureDef() const {
-    if ( ! pCamera ) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
         return std::make_tuple(0, 0, 0);
     }
+    const auto &pCamera = pExecutor->GetCamera();
     if (const auto rng = pCamera->GetExposureRange()) {
         return *rng;
     }
@@ -605,25 +789,38 @@ std::tuple<long, long, long> CcdPlayerOne::GetExposureDef() const {
 }
 
 std::optional<long> CcdPlayerOne::GetGain() const {
-    if ( ! pCamera ) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
         return std::nullopt;
     }
-    return pCamera->GetGain();
+    return pExecutor->Call(&PlayerOneCamera::GetGain);
 }
 bool CcdPlayerOne::SetGain(long nDependValue) {
-    if ( ! pCamera ) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
         return false;
     }
-    if (imageWaitingThread.joinable()) {
-        // terminate previous downloading thread
-        imageWaitingThread.join();
+    // what can be checked now is, the SDK has the last word when applied
+    if ( const auto rng = pExecutor->GetCamera()->GetGainRange() ) {
+        if ( nDependValue < std::get<0>(*rng) || nDependValue > std::get<1>(*rng) ) {
+            return false;
+        }
     }
-    return pCamera->SetGain(nDependValue);
+    if ( DeferSetting([=](DeferredSettings &settings) { settings.nGain = nDependValue; }) ) {
+        return true;
+    }
+    if ( ! pExecutor->Call(&PlayerOneCamera::SetGain, nDependValue) ) {
+        return false;
+    }
+    SetAppliedExposure(std::nullopt, nDependValue);
+    return true;
 }
 std::tuple<long, long, long> CcdPlayerOne::GetGainDef() const {
-    if ( ! pCamera ) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
         return std::make_tuple(0, 0, 0);
     }
+    const auto &pCamera = pExecutor->GetCamera();
     if (const auto rng = pCamera->GetGainRange()) {
         return *rng;
     }
@@ -631,30 +828,1028 @@ std::tuple<long, long, long> CcdPlayerOne::GetGainDef() const {
 }
 
 std::optional<long> CcdPlayerOne::GetQuality() const {
-    if ( ! pCamera ) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
         return std::nullopt;
     }
-    const auto imageBin = pCamera->GetImageBin();
+    const auto imageBin = pExecutor->Call(&PlayerOneCamera::GetImageBin);
     if ( ! imageBin ) {
         return std::nullopt;
     }
-    return *imageBin;
+    const auto bin = GetSoftwareBin();
+    return bin.nX == bin.nY ? *imageBin * bin.nX : *imageBin;
 }
 bool CcdPlayerOne::SetQuality(long nDependValue) {
-    if ( ! pCamera ) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
         return false;
     }
-    if (imageWaitingThread.joinable()) {
-        // terminate previous downloading thread
-        imageWaitingThread.join();
+    const auto &pCamera = pExecutor->GetCamera();
+    const auto nBin = static_cast<int>(nDependValue & 0xff);
+    const auto &bins = pCamera->m_CamProp.bins;
+    const bool bHardware = nBin > 0 && std::find(std::begin(bins), std::end(bins), nBin) != std::end(bins);
+    SoftwareBin bin;
+    if ( ! bHardware ) {
+        if ( nBin < 2 || nBin > 8 ) {
+            return false;
+        }
+        bin.nX = nBin;
+        bin.nY = nBin;
+    }
+    if ( DeferSetting([=](DeferredSettings &settings) { settings.nQuality = nDependValue; }) ) {
+        return true;
+    }
+    if ( ! pExecutor->Call(&PlayerOneCamera::SetImageBin, bHardware ? nBin : 1) ) {
+        return false;
     }
-    const auto nBin = nDependValue & 0xff;
-    if ( ! pCamera->SetImageBin(nBin) ) {
+    return SetSoftwareBin(bin);
+}
+
+bool CcdPlayerOne::SetSoftwareBin(const SoftwareBin &bin) {
+    if ( bin.nX < 1 || bin.nX > 8 || bin.nY < 1 || bin.nY > 8 ) {
         return false;
     }
+    std::lock_guard<std::mutex> lock(mtxSoftwareBin);
+    softwareBin = bin;
     return true;
 }
 
-long CcdPlayerOne::GetBufferSize() const {
-    return m_nCurrentBufferSize;
+SoftwareBin CcdPlayerOne::GetSoftwareBin() const {
+    std::lock_guard<std::mutex> lock(mtxSoftwareBin);
+    return softwareBin;
+}
+
+std::optional<std::tuple<int, int, int, int>> CcdPlayerOne::GetROI() const {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
+        return std::nullopt;
+    }
+    const auto startPos = pExecutor->Call(&PlayerOneCamera::GetImageStartPos);
+    const auto imageSize = pExecutor->Call(&PlayerOneCamera::GetImageSize);
+    if ( ! startPos || ! imageSize ) {
+        return std::nullopt;
+    }
+    return std::tuple_cat(*startPos, *imageSize);
+}
+bool CcdPlayerOne::SetROI(int nStartX, int nStartY, int nWidth, int nHeight) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
+        return false;
+    }
+    const auto &pCamera = pExecutor->GetCamera();
+    // aligned when applied, the bin may be queued too
+    if ( DeferSetting([=](DeferredSettings &settings) { settings.roi = std::make_tuple(nStartX, nStartY, nWidth, nHeight); }) ) {
+        return true;
+    }
+    const auto nBin = pExecutor->Call(&PlayerOneCamera::GetImageBin);
+    if ( ! nBin ) {
+        return false;
+    }
+    const auto [nX, nY, nW, nH] = pCamera->AlignROI(nStartX, nStartY, nWidth, nHeight, *nBin);
+
+    const bool bLiveView = IsLiveView();
+    if ( bLiveView && nW == m_nCurrentWidth && nH == m_nCurrentHeight ) {
+        // same size: move the window while streaming
+        if ( ! pExecutor->Call(&PlayerOneCamera::SetImageStartPos, nX, nY) ) {
+            return false;
+        }
+        SetAppliedStartPos(nX, nY);
+        return true;
+    }
+
+    // size change needs a stopped camera
+    const auto previous = GetROI();
+    // stop and restart without a recovery restarting the stream in between
+    std::unique_lock<std::recursive_mutex> lockCapture(mtxCapture, std::defer_lock);
+    if ( bLiveView ) {
+        lockCapture.lock();
+        StopLiveView();
+    }
+    // a failed change leaves the stream running as before
+    auto restore = [&]() {
+        if ( previous ) {
+            const auto [nOldX, nOldY, nOldW, nOldH] = *previous;
+            pExecutor->Call(&PlayerOneCamera::SetImageSize, nOldW, nOldH);
+            pExecutor->Call(&PlayerOneCamera::SetImageStartPos, nOldX, nOldY);
+        }
+        if ( bLiveView ) {
+            StartLiveView();
+        }
+        return false;
+    };
+    if ( ! pExecutor->Call(&PlayerOneCamera::SetImageSize, nW, nH) || ! pExecutor->Call(&PlayerOneCamera::SetImageStartPos, nX, nY) ) {
+        return restore();
+    }
+    // pooled buffers are reused when the new frame fits
+    if ( bLiveView && ! StartLiveView() ) {
+        return restore();
+    }
+    return true;
+}
+
+long CcdPlayerOne::GetBufferSize() const {
+    return m_nCurrentBufferSize;
+}
+
+std::optional<long> CcdPlayerOne::GetUsbBandwidthLimit() const {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
+        return std::nullopt;
+    }
+    return pExecutor->Call(&PlayerOneCamera::GetUsbBandwidthLimit);
+}
+bool CcdPlayerOne::SetUsbBandwidthLimit(long nLimit) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
+        return false;
+    }
+    if ( ! pExecutor->Call(&PlayerOneCamera::SetUsbBandwidthLimit, nLimit) ) {
+        return false;
+    }
+    // the downloads so far were timed on the old link
+    readoutModel.Reset();
+    return true;
+}
+std::optional<long> CcdPlayerOne::GetFrameLimit() const {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
+        return std::nullopt;
+    }
+    return pExecutor->Call(&PlayerOneCamera::GetFrameLimit);
+}
+bool CcdPlayerOne::SetFrameLimit(long nLimit) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
+        return false;
+    }
+    return pExecutor->Call(&PlayerOneCamera::SetFrameLimit, nLimit);
+}
+std::optional<bool> CcdPlayerOne::GetHQI() const {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor || ! pExecutor->GetCamera()->HasConfig(POAConfig::POA_HQI) ) {
+        return std::nullopt;
+    }
+    return pExecutor->Call(&PlayerOneCamera::GetHQI);
+}
+bool CcdPlayerOne::SetHQI(bool bEnable) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor || ! pExecutor->GetCamera()->HasConfig(POAConfig::POA_HQI) ) {
+        return false;
+    }
+    return pExecutor->Call(&PlayerOneCamera::SetHQI, bEnable);
+}
+
+std::optional<BandwidthTrial> CcdPlayerOne::RunBandwidthTrial(long nBandwidth, long nFrameLimit, std::chrono::milliseconds trialDuration) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
+        return std::nullopt;
+    }
+    if ( ! pExecutor->Call(&PlayerOneCamera::SetUsbBandwidthLimit, nBandwidth) || ! pExecutor->Call(&PlayerOneCamera::SetFrameLimit, nFrameLimit) ) {
+        return std::nullopt;
+    }
+    readoutModel.Reset();
+    if ( ! StartLiveView() ) {
+        return std::nullopt;
+    }
+    // let the stream settle: first frame plus a little
+    const auto warmup = std::chrono::microseconds(m_nCurrentExposureCache) + std::chrono::milliseconds(200);
+    std::this_thread::sleep_for(warmup);
+
+    const auto nFramesBegin = nLiveViewFrames.load();
+    const auto nDroppedBegin = pExecutor->Call(&PlayerOneCamera::GetDroppedImagesCount);
+    const auto begin = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(trialDuration);
+    const auto nFramesEnd = nLiveViewFrames.load();
+    const auto nDroppedEnd = pExecutor->Call(&PlayerOneCamera::GetDroppedImagesCount);
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    const bool bRunning = IsLiveView();
+    StopLiveView();
+    if ( ! bRunning || ! nDroppedBegin || ! nDroppedEnd ) {
+        return std::nullopt;
+    }
+
+    BandwidthTrial trial;
+    trial.nBandwidth = nBandwidth;
+    trial.nFrameLimit = nFrameLimit;
+    trial.dFps = (nFramesEnd - nFramesBegin) / elapsed;
+    trial.nDropped = *nDroppedEnd - *nDroppedBegin;
+    return trial;
+}
+
+std::optional<BandwidthTuning> CcdPlayerOne::TuneBandwidth(std::chrono::milliseconds trialDuration) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
+        return std::nullopt;
+    }
+    const auto &pCamera = pExecutor->GetCamera();
+    const auto bandwidthRange = pCamera->GetUsbBandwidthLimitRange();
+    const auto frameLimitRange = pCamera->GetFrameLimitRange();
+    if ( ! bandwidthRange || ! frameLimitRange ) {
+        return std::nullopt;
+    }
+    const auto [nMinBandwidth, nMaxBandwidth, nDefBandwidth] = *bandwidthRange;
+    Q_UNUSED(nDefBandwidth);
+    const auto nMaxFrameLimit = std::get<1>(*frameLimitRange);
+
+    const auto nOrgBandwidth = pExecutor->Call(&PlayerOneCamera::GetUsbBandwidthLimit);
+    const auto nOrgFrameLimit = pExecutor->Call(&PlayerOneCamera::GetFrameLimit);
+
+    // the trial streams are not restarted by a recovery
+    std::lock_guard<std::recursive_mutex> lockCapture(mtxCapture);
+    StopLiveView();
+    AbortExposure();
+    bMuteLiveView = true;
+
+    BandwidthTuning tuning;
+    std::optional<BandwidthTrial> best;
+    // highest bandwidth first, stop at the first clean run
+    const long nStep = std::max<long>(1, (nMaxBandwidth - nMinBandwidth) / 6);
+    for (long nBandwidth = nMaxBandwidth; nBandwidth >= nMinBandwidth; nBandwidth -= nStep) {
+        const auto trial = RunBandwidthTrial(nBandwidth, 0, trialDuration);
+        if ( ! trial ) {
+            break;
+        }
+        tuning.trials.push_back(*trial);
+        if ( trial->nDropped == 0 ) {
+            best = trial;
+            break;
+        }
+    }
+    if ( ! best && ! tuning.trials.empty() ) {
+        // drops at any bandwidth: cap the frame rate below what the host delivered
+        const auto fewestDrops = std::min_element(tuning.trials.begin(), tuning.trials.end(), [](const BandwidthTrial &a, const BandwidthTrial &b) {
+            return a.nDropped < b.nDropped;
+        });
+        const auto nBandwidth = fewestDrops->nBandwidth;
+        const auto dFps = fewestDrops->dFps;
+        for (const double dRatio : { 0.9, 0.75, 0.5, 0.25 }) {
+            const auto nFrameLimit = std::clamp<long>(static_cast<long>(dFps * dRatio), 1, nMaxFrameLimit);
+            const auto trial = RunBandwidthTrial(nBandwidth, nFrameLimit, trialDuration);
+            if ( ! trial ) {
+                break;
+            }
+            tuning.trials.push_back(*trial);
+            if ( trial->nDropped == 0 ) {
+                best = trial;
+                break;
+            }
+        }
+    }
+    bMuteLiveView = false;
+    // the bandwidth is restored or set to the best below
+    readoutModel.Reset();
+
+    if ( ! best ) {
+        // restore
+        if ( nOrgBandwidth ) {
+            pExecutor->Call(&PlayerOneCamera::SetUsbBandwidthLimit, *nOrgBandwidth);
+        }
+        if ( nOrgFrameLimit ) {
+            pExecutor->Call(&PlayerOneCamera::SetFrameLimit, *nOrgFrameLimit);
+        }
+        return std::nullopt;
+    }
+    tuning.nBandwidth = best->nBandwidth;
+    tuning.nFrameLimit = best->nFrameLimit;
+    tuning.dFps = best->dFps;
+    ApplyBandwidthTuning(tuning);
+    return tuning;
+}
+
+bool CcdPlayerOne::ApplyBandwidthTuning(const BandwidthTuning &tuning) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
+        return false;
+    }
+    if ( ! pExecutor->Call(&PlayerOneCamera::SetUsbBandwidthLimit, tuning.nBandwidth)
+         || ! pExecutor->Call(&PlayerOneCamera::SetFrameLimit, tuning.nFrameLimit) ) {
+        return false;
+    }
+    readoutModel.Reset();
+    std::lock_guard<std::mutex> lock(mtxRecoveryState);
+    appliedTuning = tuning;
+    return true;
+}
+
+std::string CcdPlayerOne::GetBandwidthTuningKey() const {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
+        return std::string();
+    }
+    const auto &pCamera = pExecutor->GetCamera();
+    // path separators are not allowed in a settings key
+    std::string key = std::string(pCamera->m_CamProp.SN) + "@" + pCamera->m_CamProp.localPath;
+    std::replace(key.begin(), key.end(), '/', '_');
+    std::replace(key.begin(), key.end(), '\\', '_');
+    return key;
+}
+
+std::shared_ptr<PlayerOneCamera> CcdPlayerOne::GetCamera() const {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
+        return nullptr;
+    }
+    return pExecutor->GetCamera();
+}
+std::shared_ptr<CameraExecutor> CcdPlayerOne::GetExecutor() const {
+    return std::atomic_load(&pActiveExecutor);
+}
+
+void CcdPlayerOne::SetCalibrationLibrary(std::shared_ptr<CalibrationLibrary> pLibrary) {
+    pCalibrationLibrary = std::move(pLibrary);
+}
+
+std::optional<CalibrationKey> CcdPlayerOne::GetCalibrationKey() const {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
+        return std::nullopt;
+    }
+    const auto &pCamera = pExecutor->GetCamera();
+    const auto nGain = pExecutor->Call(&PlayerOneCamera::GetGain);
+    const auto nOffset = pExecutor->Call(&PlayerOneCamera::GetOffset);
+    const auto nBin = pExecutor->Call(&PlayerOneCamera::GetImageBin);
+    const auto startPos = pExecutor->Call(&PlayerOneCamera::GetImageStartPos);
+    const auto imageSize = pExecutor->Call(&PlayerOneCamera::GetImageSize);
+    const auto imageFormat = pExecutor->Call(&PlayerOneCamera::GetImageFormat);
+    if ( ! nGain || ! nOffset || ! nBin || ! startPos || ! imageSize || ! imageFormat ) {
+        return std::nullopt;
+    }
+    CalibrationKey key;
+    key.nExposure = m_nCurrentExposureCache;
+    key.nGain = *nGain;
+    key.nOffset = *nOffset;
+    key.nBin = *nBin;
+    std::tie(key.nStartX, key.nStartY) = *startPos;
+    std::tie(key.nWidth, key.nHeight) = *imageSize;
+    key.nBytepp = std::get<1>(PlayerOneImgFormatSize(*imageFormat));
+    const auto pTelemetrySnapshot = GetTelemetry();
+    if ( pTelemetrySnapshot && pTelemetrySnapshot->temperature ) {
+        key.temperature = pTelemetrySnapshot->temperature;
+    } else if ( pCamera->HasConfig(POAConfig::POA_TEMPERATURE) ) {
+        key.temperature = pExecutor->Call(&PlayerOneCamera::GetTemperature);
+    }
+    return key;
+}
+
+std::shared_ptr<Calibrator> CcdPlayerOne::SelectCalibrator() const {
+    if ( ! pCalibrationLibrary ) {
+        return nullptr;
+    }
+    const auto key = GetCalibrationKey();
+    if ( ! key ) {
+        return nullptr;
+    }
+    return pCalibrationLibrary->Select(*key);
+}
+
+SoftwareBin CcdPlayerOne::SelectSoftwareBin(int nFormat, int nWidth, int nHeight) const {
+    const auto fmt = static_cast<POAImgFormat>(nFormat);
+    auto bin = GetSoftwareBin();
+    if ( fmt == POAImgFormat::POA_RGB24 ) {
+        return SoftwareBin();
+    }
+    const auto pCamera = GetCamera();
+    bin.bBayer = pCamera && pCamera->m_CamProp.isColorCamera == POABool::POA_TRUE && fmt != POAImgFormat::POA_MONO8;
+    const auto [nOutWidth, nOutHeight] = SoftwareBinner::GetOutputSize(nWidth, nHeight, bin);
+    if ( ! bin.IsEnabled() || nOutWidth == 0 || nOutHeight == 0 ) {
+        return SoftwareBin();
+    }
+    return bin;
+}
+
+std::shared_ptr<FrameBufferPool::Buffer> CcdPlayerOne::ApplySoftwareBin(const SoftwareBin &bin, int nWidth, int nHeight, int nBytepp,
+                                                                        const std::shared_ptr<FrameBufferPool::Buffer> &pBuffer) {
+    if ( ! bin.IsEnabled() ) {
+        return pBuffer;
+    }
+    const auto [nOutWidth, nOutHeight] = SoftwareBinner::GetOutputSize(nWidth, nHeight, bin);
+    auto pBinned = framePool.Acquire(static_cast<std::size_t>(nOutWidth) * nOutHeight * nBytepp);
+    binner.Bin(nWidth, nHeight, nBytepp, *pBuffer, bin, *pBinned);
+    return pBinned;
+}
+
+bool CcdPlayerOne::DownloadImage(PlayerOneCamera &camera, FrameBuffer &buffer, std::chrono::milliseconds timeout) {
+    const auto pTelemetry = std::atomic_load(&pActiveTelemetry);
+    // telemetry polls stay out of the transfer
+    if ( pTelemetry ) {
+        pTelemetry->BeginReadout();
+    }
+    watchdog.BeginDownload(timeout);
+    const bool bRet = camera.GetImageData(buffer, static_cast<int>(timeout.count()));
+    watchdog.EndDownload();
+    if ( pTelemetry ) {
+        pTelemetry->EndReadout();
+    }
+    return bRet;
+}
+
+void CcdPlayerOne::PublishFrame(int nWidth, int nHeight, int nBytepp, const std::shared_ptr<FrameBufferPool::Buffer> &pBuffer,
+                                const FrameTimestamps &timestamps, const FrameMetadata &metadata, const std::shared_ptr<const FrameStats> &pStats) {
+    if ( frameQueue.GetSubscriberCount() == 0 ) {
+        return;
+    }
+    auto pFrame = frameQueue.Acquire();
+    pFrame->nWidth = nWidth;
+    pFrame->nHeight = nHeight;
+    pFrame->nBytepp = nBytepp;
+    pFrame->bPacked12 = metadata.bPacked12;
+    if ( metadata.bPacked12 ) {
+        // the 16bit buffer goes back to the pool as soon as imageReady is done
+        pFrame->pBuffer = framePool.Acquire(Packed12Size(static_cast<std::size_t>(nWidth) * nHeight));
+        PackFrame12(*pBuffer, *pFrame->pBuffer);
+    } else {
+        pFrame->pBuffer = pBuffer;
+    }
+    pFrame->timestamps = timestamps;
+    pFrame->metadata = metadata;
+    pFrame->pStats = pStats;
+    frameQueue.Publish(pFrame);
+}
+
+FrameQueue &CcdPlayerOne::GetFrameQueue() {
+    return frameQueue;
+}
+
+std::shared_ptr<FrameConsumer> CcdPlayerOne::AddFrameConsumer(const std::string &name, FrameHandler handler, const FrameConsumerOptions &options) {
+    return frameGraph.Add(name, std::move(handler), options);
+}
+
+bool CcdPlayerOne::RemoveFrameConsumer(const std::string &name) {
+    return frameGraph.Remove(name);
+}
+
+std::vector<FrameConsumerStatus> CcdPlayerOne::GetFrameConsumerStatus() const {
+    return frameGraph.GetStatus();
+}
+
+void CcdPlayerOne::FlushFrameConsumers() {
+    frameGraph.Flush();
+}
+
+bool CcdPlayerOne::SetCaptureThreadConfig(const ThreadConfig &config, std::string &error) {
+    if ( ! TestThreadConfig(config, error) ) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mtxThreadConfig);
+    captureThreadConfig = config;
+    return true;
+}
+
+ThreadConfig CcdPlayerOne::GetCaptureThreadConfig() const {
+    std::lock_guard<std::mutex> lock(mtxThreadConfig);
+    return captureThreadConfig;
+}
+
+bool CcdPlayerOne::SetFrameMemoryLocked(bool bLock, std::string &error) {
+    return framePool.SetLocked(bLock, error);
+}
+
+void CcdPlayerOne::SetFrameMemory(const FrameMemory &memory) {
+    framePool.SetMemory(memory);
+}
+
+FrameMemory CcdPlayerOne::GetFrameMemory() const {
+    return framePool.GetMemory();
+}
+
+void CcdPlayerOne::SetPackedRaw12(bool bEnable) {
+    bPackedRaw12 = bEnable;
+}
+
+bool CcdPlayerOne::IsPackedRaw12() const {
+    return bPackedRaw12;
+}
+
+bool CcdPlayerOne::SelectPack12(int nBytepp, bool bCalibrated, const SoftwareBin &bin) const {
+    const auto pCamera = GetCamera();
+    const auto nBitDepth = pCamera ? pCamera->m_CamProp.bitDepth : 0;
+    // calibration and averaging leave fractions of an ADU in the low bits;
+    // sums of MSB aligned samples keep them 0
+    return bPackedRaw12 && nBytepp == 2 && nBitDepth > 0 && nBitDepth <= 12 && ! bCalibrated
+           && ( ! bin.IsEnabled() || bin.mode == BinMode::Sum);
+}
+
+void CcdPlayerOne::ConfigureCaptureThread(const std::string &name) {
+    SetCurrentThreadName(name);
+    // checked by SetCaptureThreadConfig(), a failure here is not expected
+    std::string error;
+    ApplyThreadConfig(GetCaptureThreadConfig(), error);
+}
+
+void CcdPlayerOne::CompleteMetadata(FrameMetadata &metadata) {
+    metadata.nSequence = ++nFrameSequence;
+    metadata.exposureStartUtc = clockSync.ToUtc(metadata.exposureStart);
+    metadata.exposureEndUtc = clockSync.ToUtc(metadata.exposureEnd);
+    if ( const auto pTelemetrySnapshot = GetTelemetry() ) {
+        metadata.temperature = pTelemetrySnapshot->temperature;
+    }
+}
+
+std::shared_ptr<const CameraTelemetry> CcdPlayerOne::GetTelemetry() const {
+    const auto pTelemetry = std::atomic_load(&pActiveTelemetry);
+    if ( ! pTelemetry ) {
+        return nullptr;
+    }
+    return pTelemetry->GetSnapshot();
+}
+bool CcdPlayerOne::SetTelemetryInterval(std::chrono::milliseconds interval) {
+    const auto pTelemetry = std::atomic_load(&pActiveTelemetry);
+    if ( ! pTelemetry ) {
+        return false;
+    }
+    pTelemetry->SetInterval(interval);
+    return true;
+}
+
+void CcdPlayerOne::SetFrameStatsEnabled(bool bEnable) {
+    bFrameStats = bEnable;
+}
+bool CcdPlayerOne::IsFrameStatsEnabled() const {
+    return bFrameStats;
+}
+void CcdPlayerOne::SetSaturationLevel(std::uint32_t nLevel) {
+    nSaturationLevel = nLevel;
+}
+
+bool CcdPlayerOne::SetAutoExposure(bool bEnable, const AutoExposureConfig &config) {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
+        return false;
+    }
+    const auto &pCamera = pExecutor->GetCamera();
+    if ( bEnable ) {
+        auto limited = config;
+        if ( const auto range = pCamera->GetExposureRange() ) {
+            limited.nMinExposure = std::max(limited.nMinExposure, std::get<0>(*range));
+            limited.nMaxExposure = std::min(limited.nMaxExposure, std::get<1>(*range));
+        }
+        if ( const auto range = pCamera->GetGainRange() ) {
+            limited.nMinGain = std::max(limited.nMinGain, std::get<0>(*range));
+            limited.nMaxGain = std::min(limited.nMaxGain, std::get<1>(*range));
+        }
+        autoExposure.SetConfig(limited);
+        autoExposure.Reset();
+    }
+    bAutoExposure = bEnable;
+    return true;
+}
+bool CcdPlayerOne::IsAutoExposure() const {
+    return bAutoExposure;
+}
+AutoExposureStatus CcdPlayerOne::GetAutoExposureStatus() const {
+    return autoExposure.GetStatus();
+}
+
+void CcdPlayerOne::UpdateAutoExposure(const std::shared_ptr<CameraExecutor> &pThreadExecutor, PendingExposure &pending, const FrameStats &stats,
+                                      const FrameMetadata &metadata) {
+    if ( pending.exposure.valid() || pending.gain.valid() ) {
+        return;
+    }
+    if ( metadata.nExposure != m_nCurrentExposureCache || metadata.nGain != m_nCurrentGainCache ) {
+        // exposed before the last change landed
+        return;
+    }
+    const auto next = autoExposure.Update(stats, metadata.nExposure, metadata.nGain);
+    if ( ! next ) {
+        return;
+    }
+    // the caches follow once the SDK took the values, see CollectAutoExposure()
+    using Applied = std::optional<FrameTimestamps::clock::time_point>;
+    if ( next->nExposure != metadata.nExposure ) {
+        pending.nExposure = next->nExposure;
+        pending.exposure = pThreadExecutor->Submit(CommandPriority::Normal, [nExposure = next->nExposure](PlayerOneCamera &camera) {
+            return camera.SetExposure(nExposure) ? Applied(FrameTimestamps::clock::now()) : Applied();
+        });
+    }
+    if ( next->nGain != metadata.nGain ) {
+        pending.nGain = next->nGain;
+        pending.gain = pThreadExecutor->Submit(CommandPriority::Normal, [nGain = next->nGain](PlayerOneCamera &camera) {
+            return camera.SetGain(nGain) ? Applied(FrameTimestamps::clock::now()) : Applied();
+        });
+    }
+}
+
+void CcdPlayerOne::CollectAutoExposure(PendingExposure &pending) {
+    auto isReady = [](const auto &future) {
+        return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    };
+    if ( isReady(pending.exposure) ) {
+        if ( const auto applied = pending.exposure.get() ) {
+            SetAppliedExposure(pending.nExposure, std::nullopt, *applied);
+        }
+    }
+    if ( isReady(pending.gain) ) {
+        if ( const auto applied = pending.gain.get() ) {
+            SetAppliedExposure(std::nullopt, pending.nGain, *applied);
+        }
+    }
+}
+
+void CcdPlayerOne::SetAppliedExposure(std::optional<long> nExposure, std::optional<long> nGain, FrameTimestamps::clock::time_point applied) {
+    std::lock_guard<std::mutex> lock(mtxExposureChange);
+    const long nOldExposure = m_nCurrentExposureCache;
+    const long nOldGain = m_nCurrentGainCache;
+    if ( nExposure.value_or(nOldExposure) == nOldExposure && nGain.value_or(nOldGain) == nOldGain ) {
+        return;
+    }
+    nPreviousExposure = nOldExposure;
+    nPreviousGain = nOldGain;
+    exposureChanged = applied;
+    m_nCurrentExposureCache = nExposure.value_or(nOldExposure);
+    m_nCurrentGainCache = nGain.value_or(nOldGain);
+}
+
+std::pair<long, long> CcdPlayerOne::GetAppliedExposure(FrameTimestamps::clock::time_point exposureEnd) const {
+    std::lock_guard<std::mutex> lock(mtxExposureChange);
+    const long nExposure = m_nCurrentExposureCache;
+    if ( exposureEnd - std::chrono::microseconds(nExposure) >= exposureChanged ) {
+        return { nExposure, m_nCurrentGainCache };
+    }
+    return { nPreviousExposure, nPreviousGain };
+}
+
+void CcdPlayerOne::SetAppliedStartPos(int nStartX, int nStartY, FrameTimestamps::clock::time_point applied) {
+    std::lock_guard<std::mutex> lock(mtxStartPosChange);
+    if ( nStartX == m_nCurrentStartX && nStartY == m_nCurrentStartY ) {
+        return;
+    }
+    nPreviousStartX = m_nCurrentStartX;
+    nPreviousStartY = m_nCurrentStartY;
+    startPosChanged = applied;
+    m_nCurrentStartX = nStartX;
+    m_nCurrentStartY = nStartY;
+}
+
+std::pair<int, int> CcdPlayerOne::GetAppliedStartPos(FrameTimestamps::clock::time_point exposureStart) const {
+    std::lock_guard<std::mutex> lock(mtxStartPosChange);
+    if ( exposureStart >= startPosChanged ) {
+        return { m_nCurrentStartX, m_nCurrentStartY };
+    }
+    return { nPreviousStartX, nPreviousStartY };
+}
+
+std::shared_ptr<const FrameStats> CcdPlayerOne::ComputeFrameStats(int nWidth, int nHeight, int nBytepp, const FrameBuffer &buffer) {
+    if ( ! bFrameStats && ! bAutoExposure ) {
+        return nullptr;
+    }
+    auto nSaturation = nSaturationLevel.load();
+    const auto pCamera = GetCamera();
+    const auto nBitDepth = pCamera ? pCamera->m_CamProp.bitDepth : 0;
+    if ( nSaturation == 0 && nBytepp == 2 && nBitDepth > 0 && nBitDepth < 16 ) {
+        // samples are MSB aligned: 12bit full scale is 0xfff0
+        nSaturation = ((1u << nBitDepth) - 1) << (16 - nBitDepth);
+    }
+    auto pStats = statsEngine.Acquire();
+    if ( ! statsEngine.Compute(nWidth, nHeight, nBytepp, buffer, *pStats, nSaturation) ) {
+        return nullptr;
+    }
+    return pStats;
+}
+
+bool CcdPlayerOne::PulseGuide(GuideDirection direction, std::chrono::microseconds duration) {
+    const auto pGuider = std::atomic_load(&pActiveGuider);
+    if ( ! pGuider ) {
+        return false;
+    }
+    return pGuider->Pulse(direction, duration);
+}
+bool CcdPlayerOne::CancelGuide() {
+    const auto pGuider = std::atomic_load(&pActiveGuider);
+    if ( ! pGuider ) {
+        return false;
+    }
+    pGuider->Cancel();
+    return true;
+}
+bool CcdPlayerOne::IsPulseGuiding() const {
+    const auto pGuider = std::atomic_load(&pActiveGuider);
+    return pGuider && pGuider->IsGuiding();
+}
+std::optional<GuideTiming> CcdPlayerOne::GetGuideTiming() const {
+    const auto pGuider = std::atomic_load(&pActiveGuider);
+    if ( ! pGuider ) {
+        return std::nullopt;
+    }
+    return pGuider->GetTiming();
+}
+
+void CcdPlayerOne::SetAutoRecovery(bool bEnable) {
+    std::lock_guard<std::mutex> lock(mtxRecovery);
+    bAutoRecovery = bEnable;
+    watchdog.Watch(bEnable ? GetExecutor() : nullptr);
+}
+bool CcdPlayerOne::IsAutoRecovery() const {
+    return bAutoRecovery;
+}
+void CcdPlayerOne::SetWatchdogConfig(const WatchdogConfig &config) {
+    watchdog.SetConfig(config);
+}
+WatchdogConfig CcdPlayerOne::GetWatchdogConfig() const {
+    return watchdog.GetConfig();
+}
+RecoveryStats CcdPlayerOne::GetRecoveryStats() const {
+    std::lock_guard<std::mutex> lock(mtxRecoveryState);
+    return recoveryStats;
+}
+
+void CcdPlayerOne::SaveSettings() {
+    const auto pExecutor = GetExecutor();
+    if ( ! bAutoRecovery || ! pExecutor ) {
+        return;
+    }
+    const auto &pCamera = pExecutor->GetCamera();
+    const auto imageFormat = pExecutor->Call(&PlayerOneCamera::GetImageFormat);
+    const auto nBin = pExecutor->Call(&PlayerOneCamera::GetImageBin);
+    const auto startPos = pExecutor->Call(&PlayerOneCamera::GetImageStartPos);
+    const auto imageSize = pExecutor->Call(&PlayerOneCamera::GetImageSize);
+    const auto nExposure = pExecutor->Call(&PlayerOneCamera::GetExposure);
+    const auto nGain = pExecutor->Call(&PlayerOneCamera::GetGain);
+    const auto nOffset = pExecutor->Call(&PlayerOneCamera::GetOffset);
+    if ( ! imageFormat || ! nBin || ! startPos || ! imageSize || ! nExposure || ! nGain || ! nOffset ) {
+        return;
+    }
+    CameraSettings settings;
+    settings.nFormat = *imageFormat;
+    settings.nBin = *nBin;
+    std::tie(settings.nStartX, settings.nStartY) = *startPos;
+    std::tie(settings.nWidth, settings.nHeight) = *imageSize;
+    settings.nExposure = *nExposure;
+    settings.nGain = *nGain;
+    settings.nOffset = *nOffset;
+    settings.nUsbBandwidthLimit = pExecutor->Call(&PlayerOneCamera::GetUsbBandwidthLimit);
+    settings.nFrameLimit = pExecutor->Call(&PlayerOneCamera::GetFrameLimit);
+    if ( pCamera->HasConfig(POAConfig::POA_HQI) ) {
+        settings.bHQI = pExecutor->Call(&PlayerOneCamera::GetHQI);
+    }
+    if ( pCamera->HasConfig(POAConfig::POA_COOLER) ) {
+        settings.nTargetTemperature = pExecutor->Call(&PlayerOneCamera::GetTargetTemperature);
+        settings.bCooler = pExecutor->Call(&PlayerOneCamera::GetCooler);
+    }
+    std::lock_guard<std::mutex> lock(mtxRecoveryState);
+    savedSettings = settings;
+}
+
+bool CcdPlayerOne::RestoreSettings(const std::shared_ptr<CameraExecutor> &pExecutor, const CameraSettings &settings) {
+    // the size depends on the bin, the position on the size
+    const bool bRet = pExecutor->Call(&PlayerOneCamera::SetImageFormat, static_cast<POAImgFormat>(settings.nFormat))
+                      && pExecutor->Call(&PlayerOneCamera::SetImageBin, settings.nBin)
+                      && pExecutor->Call(&PlayerOneCamera::SetImageSize, settings.nWidth, settings.nHeight)
+                      && pExecutor->Call(&PlayerOneCamera::SetImageStartPos, settings.nStartX, settings.nStartY)
+                      && pExecutor->Call(&PlayerOneCamera::SetExposure, settings.nExposure)
+                      && pExecutor->Call(&PlayerOneCamera::SetGain, settings.nGain)
+                      && pExecutor->Call(&PlayerOneCamera::SetOffset, settings.nOffset);
+    // transfer and cooler settings are not worth failing the capture for
+    if ( settings.nUsbBandwidthLimit ) {
+        pExecutor->Call(&PlayerOneCamera::SetUsbBandwidthLimit, *settings.nUsbBandwidthLimit);
+    }
+    if ( settings.nFrameLimit ) {
+        pExecutor->Call(&PlayerOneCamera::SetFrameLimit, *settings.nFrameLimit);
+    }
+    if ( settings.bHQI ) {
+        pExecutor->Call(&PlayerOneCamera::SetHQI, *settings.bHQI);
+    }
+    if ( settings.nTargetTemperature ) {
+        pExecutor->Call(&PlayerOneCamera::SetTargetTemperature, *settings.nTargetTemperature);
+    }
+    if ( settings.bCooler ) {
+        pExecutor->Call(&PlayerOneCamera::SetCooler, *settings.bCooler);
+    }
+    return bRet;
+}
+
+bool CcdPlayerOne::IsRecovering(std::uint64_t nGeneration) const {
+    return nGeneration != nCaptureGeneration;
+}
+
+bool CcdPlayerOne::RequestRecovery(const std::shared_ptr<CameraExecutor> &pThreadExecutor, const std::string &call, Capture capture) {
+    if ( ! bAutoRecovery ) {
+        return false;
+    }
+    // a failed call of a camera that is still there is an ordinary error;
+    // a probe that does not run at all means the executor is stuck
+    auto connection = pThreadExecutor->Submit(CommandPriority::Urgent, [](PlayerOneCamera &camera) {
+        return camera.CheckConnection();
+    });
+    if ( connection.wait_for(RecoveryProbeTimeout) == std::future_status::ready && ! IsConnectionLost(connection.get()) ) {
+        return false;
+    }
+    restartCapture = capture;
+    if ( ! watchdog.Trigger(call + " failed, camera lost") ) {
+        restartCapture = Capture::None;
+        return false;
+    }
+    return true;
+}
+
+void CcdPlayerOne::Recover(const std::string &reason) {
+    std::lock_guard<std::mutex> lock(mtxRecovery);
+    const auto pOldExecutor = GetExecutor();
+    if ( ! pOldExecutor || bCancelRecovery ) {
+        return;
+    }
+    const auto &pOldCamera = pOldExecutor->GetCamera();
+    // a capture the user starts or stops from here on stands
+    bCaptureChanged = false;
+    const auto detected = std::chrono::steady_clock::now();
+    const auto config = watchdog.GetConfig();
+    const auto capture = restartCapture.exchange(Capture::None);
+    const bool bLiveView = IsLiveView() || capture == Capture::LiveView;
+    const bool bExposure = ! bLiveView && (bImageWaiting || capture == Capture::Exposure);
+
+    // the running capture threads belong to the old camera from here on;
+    // nothing below waits for the old executor, it may be the stuck one
+    ++nCaptureGeneration;
+    {
+        std::lock_guard<std::mutex> lockAbort(mtxAbort);
+        bAbortBulb = true;
+        bStopLiveView = true;
+    }
+    cvAbort.notify_all();
+    frameQueue.Interrupt();
+    auto closed = pOldExecutor->Submit(CommandPriority::Urgent, [](PlayerOneCamera &camera) {
+        camera.StopExposure();
+        camera.Close();
+    });
+    if ( closed.wait_for(RecoveryProbeTimeout) != std::future_status::ready ) {
+        AbandonExecutor(pOldExecutor);
+    }
+    {
+        std::lock_guard<std::mutex> lockWaiting(mtxWaiting);
+        JoinCaptureThread(imageWaitingThread, bImageWaiting, FrameTimestamps::clock::time_point());
+    }
+    {
+        std::lock_guard<std::mutex> lockLiveView(mtxLiveView);
+        JoinCaptureThread(liveViewThread, bLiveViewRunning, FrameTimestamps::clock::time_point());
+    }
+    // a stuck executor took them along already
+    std::atomic_store(&pActiveGuider, std::shared_ptr<GuidePulser>());
+    std::atomic_store(&pActiveTelemetry, std::shared_ptr<TelemetryPoller>());
+
+    // the camera may take a while to enumerate again after a USB reset. until
+    // then calls keep going to the closed handle and fail.
+    const std::string name = pOldCamera->m_CamProp.SN[0] != '\0' ? pOldCamera->m_CamProp.SN : pOldCamera->m_CamProp.cameraModelName;
+    std::shared_ptr<PlayerOneCamera> pNewCamera;
+    while ( true ) {
+        if ( const auto nIndex = PlayerOneCamera::FindIndex(name) ) {
+            pNewCamera = PlayerOneCamera::Open(*nIndex);
+        }
+        if ( pNewCamera || std::chrono::steady_clock::now() - detected >= config.reopenTimeout || ! WaitFor(ReopenRetryInterval, bCancelRecovery) ) {
+            break;
+        }
+    }
+
+    bool bRestarted = false;
+    if ( ! pNewCamera ) {
+        std::atomic_store(&pActiveExecutor, std::shared_ptr<CameraExecutor>());
+    } else {
+        // settings first, calls see the new executor once it is set up
+        const auto pNewExecutor = std::make_shared<CameraExecutor>(pNewCamera);
+        std::optional<CameraSettings> settings;
+        {
+            std::lock_guard<std::mutex> lockState(mtxRecoveryState);
+            settings = savedSettings;
+        }
+        if ( settings ) {
+            if ( m_nCurrentExposureCache > 0 ) {
+                settings->nExposure = m_nCurrentExposureCache;
+            }
+            settings->nGain = m_nCurrentGainCache;
+            if ( bLiveView ) {
+                // moved while streaming
+                settings->nStartX = m_nCurrentStartX;
+                settings->nStartY = m_nCurrentStartY;
+            }
+            bRestarted = RestoreSettings(pNewExecutor, *settings);
+            std::atomic_store(&pActiveExecutor, pNewExecutor);
+        } else {
+            std::atomic_store(&pActiveExecutor, pNewExecutor);
+            // no capture since auto recovery was enabled
+            std::optional<BandwidthTuning> tuning;
+            {
+                std::lock_guard<std::mutex> lock(mtxRecoveryState);
+                tuning = appliedTuning;
+            }
+            if ( tuning ) {
+                ApplyBandwidthTuning(*tuning);
+            }
+            bRestarted = true;
+        }
+        if ( pNewCamera->HasST4Port() ) {
+            std::atomic_store(&pActiveGuider, std::make_shared<GuidePulser>(pNewExecutor));
+        }
+        if ( pNewCamera->HasConfig(POAConfig::POA_TEMPERATURE) ) {
+            std::atomic_store(&pActiveTelemetry, std::make_shared<TelemetryPoller>(pNewExecutor));
+        }
+        // armed before the restart: losing the camera again starts over
+        watchdog.Watch(pNewExecutor);
+        std::lock_guard<std::recursive_mutex> lockCapture(mtxCapture);
+        if ( bCaptureChanged ) {
+            // started or stopped by the user meanwhile
+        } else if ( bRestarted && bLiveView ) {
+            bRestarted = StartLiveView();
+        } else if ( bRestarted && bExposure ) {
+            bRestarted = StartExposure();
+        }
+    }
+
+    const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - detected);
+    {
+        std::lock_guard<std::mutex> lockState(mtxRecoveryState);
+        recoveryStats.lastReason = reason;
+        if ( bRestarted ) {
+            ++recoveryStats.nRecoveries;
+            recoveryStats.lastDuration = duration;
+            recoveryStats.totalDuration += duration;
+        } else {
+            ++recoveryStats.nFailures;
+        }
+    }
+    if ( ! GetExecutor() ) {
+        watchdog.Watch(nullptr);
+    }
+    if ( ! bRestarted ) {
+        emit aborted();
+    }
+}
+
+ReadoutKey CcdPlayerOne::GetReadoutKey(int nFormat, int nBin) const {
+    ReadoutKey key;
+    key.nFormat = nFormat;
+    key.nBin = nBin;
+    const auto pCamera = GetCamera();
+    key.bUsb3 = pCamera && pCamera->m_CamProp.isUSB3Speed == POABool::POA_TRUE;
+    return key;
+}
+
+std::optional<CaptureGeometry> CcdPlayerOne::GetCaptureGeometry() const {
+    const auto pExecutor = GetExecutor();
+    if ( ! pExecutor ) {
+        return std::nullopt;
+    }
+    const auto imageFormat = pExecutor->Call(&PlayerOneCamera::GetImageFormat);
+    const auto imageSize = pExecutor->Call(&PlayerOneCamera::GetImageSize);
+    const auto nBin = pExecutor->Call(&PlayerOneCamera::GetImageBin);
+    if ( ! imageFormat || ! imageSize || ! nBin ) {
+        return std::nullopt;
+    }
+    CaptureGeometry geometry;
+    geometry.nFormat = *imageFormat;
+    geometry.nBin = *nBin;
+    std::tie(geometry.nWidth, geometry.nHeight) = *imageSize;
+    return geometry;
+}
+
+std::optional<ReadoutEstimate> CcdPlayerOne::PredictReadout(const CaptureGeometry &geometry) const {
+    if ( ! GetExecutor() || geometry.nWidth <= 0 || geometry.nHeight <= 0 ) {
+        return std::nullopt;
+    }
+    return readoutModel.Predict(GetReadoutKey(geometry.nFormat, geometry.nBin), FrameBytes(geometry));
+}
+
+std::optional<std::chrono::microseconds> CcdPlayerOne::PredictFrameInterval(const CaptureGeometry &geometry, long nExposure, bool bLiveView) const {
+    if ( ! GetExecutor() || geometry.nWidth <= 0 || geometry.nHeight <= 0 ) {
+        return std::nullopt;
+    }
+    auto interval = readoutModel.PredictFrameInterval(GetReadoutKey(geometry.nFormat, geometry.nBin), FrameBytes(geometry),
+                                                      std::chrono::microseconds(nExposure), bLiveView);
+    if ( bLiveView ) {
+        if ( const auto nFrameLimit = GetFrameLimit(); nFrameLimit && *nFrameLimit > 0 ) {
+            interval = std::max(interval, std::chrono::microseconds(1000000 / *nFrameLimit));
+        }
+    }
+    return interval;
+}
+
+std::optional<double> CcdPlayerOne::PredictFps(const CaptureGeometry &geometry, long nExposure, bool bLiveView) const {
+    const auto interval = PredictFrameInterval(geometry, nExposure, bLiveView);
+    if ( ! interval || interval->count() <= 0 ) {
+        return std::nullopt;
+    }
+    return 1e6 / interval->count();
+}
+
+std::vector<ReadoutProfile> CcdPlayerOne::GetReadoutProfiles() const {
+    return readoutModel.GetProfiles();
+}
+std::string CcdPlayerOne::GetReadoutReport() const {
+    return readoutModel.GetReport();
+}
+
+std::vector<LatencySummary> CcdPlayerOne::GetLatencySummary() const {
+    return latencyStats.GetSummary();
+}
+std::string CcdPlayerOne::GetLatencyReport() const {
+    return latencyStats.GetReport();
+}
+void CcdPlayerOne::ResetLatencyStats() {
+    latencyStats.Reset();
+}
+void CcdPlayerOne::RecordFrameDisplayed(const FrameTimestamps &timestamps) {
+    if ( timestamps.displayed != FrameTimestamps::clock::time_point() ) {
+        latencyStats.RecordDisplay(timestamps);
+        return;
+    }
+    FrameTimestamps result = timestamps;
+    result.displayed = FrameTimestamps::clock::now();
+    latencyStats.RecordDisplay(result);
 }
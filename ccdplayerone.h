@@ -2,20 +2,89 @@
 #define CCDPLAYERONE_H
 
 #include <QObject>
+#include <QString>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <thread>
+#include <vector>
 
+#include "autoexposure.h"
+#include "calibration.h"
+#include "cameraexecutor.h"
+#include "camerawatchdog.h"
+#include "framebuffer.h"
+#include "framegraph.h"
+#include "framemetadata.h"
+#include "framepool.h"
+#include "framequeue.h"
+#include "framestats.h"
+#include "guidepulser.h"
+#include "latencystats.h"
+#include "readoutmodel.h"
+#include "softwarebin.h"
+#include "telemetry.h"
+#include "threadconfig.h"
 
 class PlayerOneCamera;
 
+// one live view run of the bandwidth tuner
+struct BandwidthTrial {
+    long nBandwidth = 0;    // POA_USB_BANDWIDTH_LIMIT (%)
+    long nFrameLimit = 0;   // POA_FRAME_LIMIT (fps, 0: none)
+    double dFps = 0;
+    long nDropped = 0;
+};
+
+struct BandwidthTuning {
+    long nBandwidth = 0;
+    long nFrameLimit = 0;
+    double dFps = 0;
+    std::vector<BandwidthTrial> trials;
+};
+
+// what a recovery writes back to the reopened camera; exposure and gain
+// follow SetExposure()/SetGain() after the snapshot
+struct CameraSettings {
+    int nFormat = 0;        // POAImgFormat
+    int nBin = 1;
+    int nStartX = 0;
+    int nStartY = 0;
+    int nWidth = 0;
+    int nHeight = 0;
+    long nExposure = 0;
+    long nGain = 0;
+    long nOffset = 0;
+    std::optional<long> nUsbBandwidthLimit;
+    std::optional<long> nFrameLimit;
+    std::optional<bool> bHQI;
+    std::optional<long> nTargetTemperature;
+    std::optional<bool> bCooler;
+};
+
+// frame settings a readout prediction is made for; the ROI size in binned
+// pixels
+struct CaptureGeometry {
+    int nFormat = 0;        // POAImgFormat
+    int nBin = 1;
+    int nWidth = 0;
+    int nHeight = 0;
+};
+
 class CcdPlayerOne : public QObject
 {
     Q_OBJECT
 public:
     CcdPlayerOne();
+    // Close(), then waits for the capture threads a stop left behind
+    ~CcdPlayerOne() override;
 
     bool Open(int nNo);
     void Close();
@@ -26,8 +95,19 @@ public:
 
     bool StartExposure();
     bool IsShooting() const;
+    // stops the exposure or download at once (POAStopExposure on the urgent
+    // lane) and waits a bounded time for the capture thread. false if the
+    // thread is stuck in an SDK call; it is left behind instead of blocking.
     bool AbortExposure();
     bool EndExposure();
+    // request -> capture thread stopped of the last abort (also the Abort
+    // latency stage), nullopt before the first one
+    std::optional<std::chrono::microseconds> GetLastAbortLatency() const;
+
+    // continuous capture, emits imageReady for every frame
+    bool StartLiveView();
+    bool StopLiveView();
+    bool IsLiveView() const;
 
     std::optional<double> GetExposureSec() const;
     std::optional<long> GetExposure() const;
@@ -35,30 +115,343 @@ public:
     std::tuple<long, long, long> GetExposureDef() const;
 
     std::optional<long> GetGain() const;
+    // SetGain, SetQuality and SetROI do not wait for a single exposure: while
+    // one runs the change is queued and applied when it ends, before the next
+    // StartExposure(). a gain out of range or a bin the camera cannot do fails
+    // at once; a queued change the camera rejects emits settingFailed().
     bool SetGain(long nDependValue);
     std::tuple<long, long, long> GetGainDef() const;
 
+    // hardware bin times a square software bin
     std::optional<long> GetQuality() const;
+    // a bin the camera does not offer (POACameraProperties::bins) is averaged
+    // in software on top of hardware bin 1
     bool SetQuality(long nDependValue);
+    // binning in software after calibration, on top of the hardware bin;
+    // used from the next exposure or live view. RAW frames of color sensors
+    // are binned per CFA color, RGB24 is not binned.
+    bool SetSoftwareBin(const SoftwareBin &bin);
+    SoftwareBin GetSoftwareBin() const;
+
+    // region of interest in binned pixels (x, y, width, height)
+    // aligned to the SDK constraints. in live view a pure move is applied
+    // without stopping the stream, a resize restarts it (with the old ROI if
+    // the new one fails).
+    std::optional<std::tuple<int, int, int, int>> GetROI() const;
+    bool SetROI(int nStartX, int nStartY, int nWidth, int nHeight);
 
     long GetBufferSize() const;
 
+    // USB transfer settings
+    std::optional<long> GetUsbBandwidthLimit() const;
+    bool SetUsbBandwidthLimit(long nLimit);
+    std::optional<long> GetFrameLimit() const;
+    bool SetFrameLimit(long nLimit);
+    std::optional<bool> GetHQI() const;
+    bool SetHQI(bool bEnable);
+
+    // runs short live view trials with the current exposure/ROI/format and
+    // picks the highest bandwidth (then frame limit) without dropped frames.
+    // the result is applied and returned; storing it is up to the caller.
+    std::optional<BandwidthTuning> TuneBandwidth(std::chrono::milliseconds trialDuration = std::chrono::milliseconds(2000));
+    // bandwidth and frame limit of a stored tuning; a recovery applies the
+    // last one again
+    bool ApplyBandwidthTuning(const BandwidthTuning &tuning);
+    // "<SN>@<USB port>" without path separators, to store a tuning under;
+    // empty without a camera
+    std::string GetBandwidthTuningKey() const;
+
+    // properties only (m_CamProp, ranges); SDK calls go through GetExecutor()
+    std::shared_ptr<PlayerOneCamera> GetCamera() const;
+    std::shared_ptr<CameraExecutor> GetExecutor() const;
+
+    // dark/bias and flat correction of captured frames. the masters are
+    // selected when a capture starts (see GetCalibrationKey), nullptr disables.
+    void SetCalibrationLibrary(std::shared_ptr<CalibrationLibrary> pLibrary);
+    // current capture settings (reads exposure/gain/offset/bin/ROI/temperature)
+    std::optional<CalibrationKey> GetCalibrationKey() const;
+
+    // histogram statistics after each download, passed with imageReady
+    void SetFrameStatsEnabled(bool bEnable);
+    bool IsFrameStatsEnabled() const;
+    // saturated sample threshold, 0: full scale of the sensor bit depth
+    void SetSaturationLevel(std::uint32_t nLevel);
+
+    // software auto exposure of the live view from the histogram of every
+    // frame (computed while it is on), within the limits of config clamped to
+    // the camera ranges. a change updates the exposure/gain caches and is
+    // queued to the executor without waiting for it; the camera's own auto
+    // mode stays off.
+    bool SetAutoExposure(bool bEnable, const AutoExposureConfig &config = AutoExposureConfig());
+    bool IsAutoExposure() const;
+    AutoExposureStatus GetAutoExposureStatus() const;
+
+    // last temperature/cooler poll, no SDK call (null without a sensor or
+    // before the first poll)
+    std::shared_ptr<const CameraTelemetry> GetTelemetry() const;
+    bool SetTelemetryInterval(std::chrono::milliseconds interval);
+
+    // ST4 guiding (cameras with an ST4 port)
+    bool PulseGuide(GuideDirection direction, std::chrono::microseconds duration);
+    bool CancelGuide();
+    bool IsPulseGuiding() const;
+    std::optional<GuideTiming> GetGuideTiming() const;
+
+    // every captured frame is also published here, the buffer is shared
+    // with imageReady. subscribe before starting the capture so the pool is
+    // sized for the subscription.
+    FrameQueue &GetFrameQueue();
+
+    // display, writer and analysis stages, each on its own thread or the
+    // shared pool, all reading the same frame. a consumer that must see
+    // every frame (bMayDrop false) holds the capture up when it falls behind.
+    std::shared_ptr<FrameConsumer> AddFrameConsumer(const std::string &name, FrameHandler handler, const FrameConsumerOptions &options = FrameConsumerOptions());
+    bool RemoveFrameConsumer(const std::string &name);
+    std::vector<FrameConsumerStatus> GetFrameConsumerStatus() const;
+    // waits until the consumers have handled every published frame
+    void FlushFrameConsumers();
+
+    // affinity and scheduling of the exposure and live view threads, checked
+    // right away (false and the missing privilege in error), applied when a
+    // capture starts. writer and processing threads: FrameConsumerOptions::
+    // thread and ThreadPool::SetThreadConfig().
+    bool SetCaptureThreadConfig(const ThreadConfig &config, std::string &error);
+    ThreadConfig GetCaptureThreadConfig() const;
+    // keeps the download buffers resident (mlock) so a page fault or swap
+    // never stalls a download
+    bool SetFrameMemoryLocked(bool bLock, std::string &error);
+    // alignment, huge pages and prefault of the download buffers; takes
+    // effect as the buffers in flight come back
+    void SetFrameMemory(const FrameMemory &memory);
+    FrameMemory GetFrameMemory() const;
+    // frames of sensors up to 12bit go to the frame queue as packed 12bit
+    // RAW16 (CapturedFrame::bPacked12), 25% less memory per queued frame.
+    // only where it is lossless: no calibration, no averaging software bin;
+    // FrameMetadata::bPacked12 tells whether a capture got it. imageReady
+    // keeps the 16bit samples.
+    void SetPackedRaw12(bool bEnable);
+    bool IsPackedRaw12() const;
+
+    // watchdog over the SDK calls. a call stuck past its limit, or a camera
+    // that went away (POA_ERROR_NOT_OPENED and alike), closes the camera,
+    // finds it again by serial number, reopens it with the settings of the
+    // last capture and restarts the live view or the exposure; aborted() is
+    // only emitted if that fails. off by default.
+    void SetAutoRecovery(bool bEnable);
+    bool IsAutoRecovery() const;
+    void SetWatchdogConfig(const WatchdogConfig &config);
+    WatchdogConfig GetWatchdogConfig() const;
+    RecoveryStats GetRecoveryStats() const;
+
+    // download times of every frame feed a readout model per format, bin
+    // and USB speed; the GetImageData timeout follows it. schedulers use it
+    // to plan: the interval (us) between frames of a capture with these
+    // settings, live view limited by POA_FRAME_LIMIT.
+    std::optional<CaptureGeometry> GetCaptureGeometry() const;
+    std::optional<ReadoutEstimate> PredictReadout(const CaptureGeometry &geometry) const;
+    std::optional<std::chrono::microseconds> PredictFrameInterval(const CaptureGeometry &geometry, long nExposure, bool bLiveView) const;
+    std::optional<double> PredictFps(const CaptureGeometry &geometry, long nExposure, bool bLiveView) const;
+    std::vector<ReadoutProfile> GetReadoutProfiles() const;
+    std::string GetReadoutReport() const;
+
+    // per stage latency histograms
+    std::vector<LatencySummary> GetLatencySummary() const;
+    std::string GetLatencyReport() const;
+    void ResetLatencyStats();
+    // call after the frame has been shown (fills timestamps.displayed if not set)
+    void RecordFrameDisplayed(const FrameTimestamps &timestamps);
+
 private:
-    std::shared_ptr<PlayerOneCamera> pCamera;
+    // a recovery replaces it from the watchdog thread: std::atomic_load/store
+    // only (GetExecutor()), every call works on one snapshot. the camera is
+    // the executor's, so the two always match.
+    std::shared_ptr<CameraExecutor> pActiveExecutor;
 
     bool bDisconnectedSent;
 
-    long m_nCurrentExposureCache;
+    // as the SDK has them: written once a SetExposure/SetGain call returned
+    std::atomic<long> m_nCurrentExposureCache;
+    std::atomic<long> m_nCurrentGainCache;
+    // the values before the last change and when it landed; a live view
+    // frame that started earlier was taken with those
+    mutable std::mutex mtxExposureChange;
+    long nPreviousExposure;
+    long nPreviousGain;
+    FrameTimestamps::clock::time_point exposureChanged;
     long m_nCurrentBufferSize;
+    int m_nCurrentWidth;
+    int m_nCurrentHeight;
+    std::atomic<int> m_nCurrentStartX;
+    std::atomic<int> m_nCurrentStartY;
+    // the window before the last in-stream move and when it landed, as for
+    // the exposure above
+    mutable std::mutex mtxStartPosChange;
+    int nPreviousStartX;
+    int nPreviousStartY;
+    FrameTimestamps::clock::time_point startPosChanged;
+    // guards the imageWaitingThread handle
     std::mutex mtxWaiting;
     std::thread imageWaitingThread;
     std::thread bulbThread;
-    bool bAbortBulb;
-    bool bImageWaiting;
+    std::atomic<bool> bAbortBulb;
+    std::atomic<bool> bImageWaiting;
+    // guards the liveViewThread handle (a recovery joins it too)
+    std::mutex mtxLiveView;
+    std::thread liveViewThread;
+    std::atomic<bool> bStopLiveView;
+    std::atomic<bool> bLiveViewRunning;
+    // wakes the waits of the capture threads on abort/stop, and the bounded
+    // joins when a capture thread leaves
+    std::mutex mtxAbort;
+    std::condition_variable cvAbort;
+    std::atomic<std::int64_t> nLastAbortLatency;    // us, -1: none
+    // capture threads that did not stop within AbortJoinTimeout; they still
+    // use the members, the destructor joins them
+    std::mutex mtxLeftBehind;
+    std::vector<std::thread> leftBehindThreads;
+    std::atomic<bool> bMuteLiveView;
+    std::atomic<long> nLiveViewFrames;
+    FrameBufferPool framePool;
+    FrameQueue frameQueue;
+    FrameGraph frameGraph;
+    LatencyStats latencyStats;
+    std::shared_ptr<CalibrationLibrary> pCalibrationLibrary;
+    // replaced along with pActiveExecutor, atomic access as well
+    std::shared_ptr<GuidePulser> pActiveGuider;
+    std::shared_ptr<TelemetryPoller> pActiveTelemetry;
+    FrameStatsEngine statsEngine;
+    std::atomic<bool> bFrameStats;
+    std::atomic<std::uint32_t> nSaturationLevel;
+    std::atomic<bool> bAutoExposure;
+    AutoExposure autoExposure;
+    ClockSync clockSync;
+    std::atomic<std::uint64_t> nFrameSequence;
+    mutable std::mutex mtxThreadConfig;
+    ThreadConfig captureThreadConfig;
+    SoftwareBinner binner;
+    mutable std::mutex mtxSoftwareBin;
+    SoftwareBin softwareBin;
+    // setters called while a single exposure runs, latest value wins
+    struct DeferredSettings {
+        std::optional<long> nQuality;
+        std::optional<std::tuple<int, int, int, int>> roi;
+        std::optional<long> nGain;
+    };
+    // guards nDeferring and deferredSettings; nDeferring counts the exposure
+    // threads still running (one left behind by an abort timeout included)
+    std::mutex mtxDeferred;
+    int nDeferring;
+    DeferredSettings deferredSettings;
+    std::atomic<bool> bPackedRaw12;
+    std::atomic<bool> bAutoRecovery;
+    std::atomic<bool> bCancelRecovery;
+    // what Recover() restarts when no capture thread tells (StartExposure()
+    // or StartLiveView() on a lost camera)
+    enum class Capture { None, Exposure, LiveView };
+    std::atomic<Capture> restartCapture;
+    // bumped by every recovery; a capture thread of an older one stays quiet
+    std::atomic<std::uint64_t> nCaptureGeneration;
+    // held by Recover(), Close() and SetAutoRecovery()
+    std::mutex mtxRecovery;
+    // starting and stopping captures, by the caller or the restart of a
+    // recovery; recursive: a start stops the running capture first
+    std::recursive_mutex mtxCapture;
+    // a capture was started or stopped since the recovery began; it stands
+    // instead of the restart
+    std::atomic<bool> bCaptureChanged;
+    // guards savedSettings and recoveryStats
+    mutable std::mutex mtxRecoveryState;
+    std::optional<CameraSettings> savedSettings;
+    RecoveryStats recoveryStats;
+    std::optional<BandwidthTuning> appliedTuning;
+    ReadoutModel readoutModel;
+    // last: its thread runs Recover()
+    CameraWatchdog watchdog;
+
+    // metadata.bPacked12: packed into a pool buffer for the queue
+    void PublishFrame(int nWidth, int nHeight, int nBytepp, const std::shared_ptr<FrameBufferPool::Buffer> &pBuffer,
+                      const FrameTimestamps &timestamps, const FrameMetadata &metadata, const std::shared_ptr<const FrameStats> &pStats);
+    // whether a capture with these settings can publish packed 12bit frames
+    bool SelectPack12(int nBytepp, bool bCalibrated, const SoftwareBin &bin) const;
+    // name and captureThreadConfig, on the capture thread
+    void ConfigureCaptureThread(const std::string &name);
+    // sequence number, UTC and temperature; no SDK call
+    void CompleteMetadata(FrameMetadata &metadata);
+    std::shared_ptr<const FrameStats> ComputeFrameStats(int nWidth, int nHeight, int nBytepp, const FrameBuffer &buffer);
+    // auto exposure settings submitted by the live view thread; each call
+    // returns when the SDK took the value, none if it failed
+    struct PendingExposure {
+        std::future<std::optional<FrameTimestamps::clock::time_point>> exposure;
+        long nExposure = 0;
+        std::future<std::optional<FrameTimestamps::clock::time_point>> gain;
+        long nGain = 0;
+    };
+    // live view thread, after the frame taken with metadata.nExposure/nGain;
+    // no new request while one is in flight or the frame predates the last
+    void UpdateAutoExposure(const std::shared_ptr<CameraExecutor> &pThreadExecutor, PendingExposure &pending, const FrameStats &stats,
+                            const FrameMetadata &metadata);
+    // the caches take the requests the SDK has finished
+    void CollectAutoExposure(PendingExposure &pending);
+    // updates the caches once the SDK took a value, at applied
+    void SetAppliedExposure(std::optional<long> nExposure, std::optional<long> nGain,
+                            FrameTimestamps::clock::time_point applied = FrameTimestamps::clock::now());
+    // exposure and gain of a live view frame that ended at exposureEnd
+    std::pair<long, long> GetAppliedExposure(FrameTimestamps::clock::time_point exposureEnd) const;
+    // the window position once the SDK took it, at applied
+    void SetAppliedStartPos(int nStartX, int nStartY, FrameTimestamps::clock::time_point applied = FrameTimestamps::clock::now());
+    // position of a live view frame that started at exposureStart
+    std::pair<int, int> GetAppliedStartPos(FrameTimestamps::clock::time_point exposureStart) const;
+
+    std::shared_ptr<Calibrator> SelectCalibrator() const;
+    // softwareBin for a capture in this format (POAImgFormat), disabled if it
+    // does not apply
+    SoftwareBin SelectSoftwareBin(int nFormat, int nWidth, int nHeight) const;
+    // the binned frame in a pool buffer, pBuffer itself if bin is disabled
+    std::shared_ptr<FrameBufferPool::Buffer> ApplySoftwareBin(const SoftwareBin &bin, int nWidth, int nHeight, int nBytepp,
+                                                              const std::shared_ptr<FrameBufferPool::Buffer> &pBuffer);
+
+    // the camera of the capture thread, which may be older than the current one
+    bool DownloadImage(PlayerOneCamera &camera, FrameBuffer &buffer, std::chrono::milliseconds timeout);
+    // readoutModel key of a capture in this format (POAImgFormat) and bin
+    ReadoutKey GetReadoutKey(int nFormat, int nBin) const;
+    void JoinImageThread();
+    // queues the setting if an exposure thread runs; false: apply it now
+    bool DeferSetting(const std::function<void(DeferredSettings &)> &set);
+    // end of an exposure thread, the last one applies the queue
+    void ApplyDeferredSettings();
+    bool StopImageThread(FrameTimestamps::clock::time_point requested);
+    // POAStopExposure on the urgent lane; false if the executor did not run
+    // it in time. it is stuck then and abandoned: a recovery reopens the
+    // camera, without one it stays closed.
+    bool StopExposureOrAbandon(const std::shared_ptr<CameraExecutor> &pExecutor, const std::string &call);
+    // closes the handle under the stuck call; the guider and telemetry are
+    // abandoned with it, nothing waits for the executor again
+    void AbandonExecutor(const std::shared_ptr<CameraExecutor> &pExecutor);
+    // requested: time of the abort, default if the thread was not running
+    bool JoinCaptureThread(std::thread &thread, const std::atomic<bool> &bRunning, FrameTimestamps::clock::time_point requested);
+    // sleeps up to duration, false as soon as bCancel is set
+    bool WaitFor(std::chrono::microseconds duration, const std::atomic<bool> &bCancel);
+
+    // settings for a recovery, read when a capture starts (auto recovery only)
+    void SaveSettings();
+    bool RestoreSettings(const std::shared_ptr<CameraExecutor> &pExecutor, const CameraSettings &settings);
+    bool IsRecovering(std::uint64_t nGeneration) const;
+    // a capture thread whose SDK call failed: true if the camera is gone and
+    // a recovery takes over
+    bool RequestRecovery(const std::shared_ptr<CameraExecutor> &pThreadExecutor, const std::string &call, Capture capture);
+    // on the watchdog thread
+    void Recover(const std::string &reason);
+
+    std::optional<BandwidthTrial> RunBandwidthTrial(long nBandwidth, long nFrameLimit, std::chrono::milliseconds trialDuration);
 
 signals:
-    void imageReady(int nWidth, int nHeight, const std::vector<unsigned char> &buffer);
+    // pStats is null unless frame statistics or auto exposure are enabled
+    void imageReady(int nWidth, int nHeight, const FrameBuffer &buffer, const FrameTimestamps &timestamps, std::shared_ptr<const FrameStats> pStats,
+                    const FrameMetadata &metadata);
     void aborted();
+    // a setting queued during an exposure failed when applied ("gain", "bin"
+    // or "roi"); on the capture thread that ended the exposure
+    void settingFailed(const QString &setting);
 };
 
 #endif // CCDPLAYERONE_H
@@ -0,0 +1,835 @@
+//
+// headless capture tool
+//
+// playerone_cli --camera SN1234 --exposure 2000000 --gain 120 --bin 2 --count 10 --output light_%04d.fits
+// playerone_cli --plan session.plan
+//
+// a plan file holds "key = value" lines with the same keys as the long options.
+// each [section] starts a new capture step which inherits the previous values.
+//
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QSettings>
+#include <QTextStream>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "ccdplayerone.h"
+#include "calibration.h"
+#include "framebuffer.h"
+#include "framewriter.h"
+#include "livestacker.h"
+#include "softwarebin.h"
+#include "stardetector.h"
+#include "threadconfig.h"
+#include "threadpool.h"
+#include "playeronecamera.hpp"
+
+
+namespace {
+
+struct CaptureStep {
+    QString name;
+    long nExposure = 1000000;   // us
+    long nGain = -1;            // -1: keep
+    int nBin = 1;
+    QString softBin;            // NxM[:sum|avg] on top of nBin, empty: none
+    QString format;             // empty: keep
+    QList<int> roi;             // x,y,w,h (empty: full frame)
+    int nCount = 1;
+    bool bLive = false;
+    QString output = "frame_%05d.fits";
+    QString master;             // bias, dark or flat: combine into a master
+};
+
+const QStringList StepKeys = { "exposure", "gain", "bin", "softbin", "format", "roi", "count", "live", "output", "master" };
+
+bool ApplyKey(CaptureStep &step, const QString &key, const QString &value) {
+    bool bOk = true;
+    if ( key == "exposure" ) {
+        step.nExposure = value.toLong(&bOk);
+    } else if ( key == "gain" ) {
+        step.nGain = value.toLong(&bOk);
+    } else if ( key == "bin" ) {
+        step.nBin = value.toInt(&bOk);
+    } else if ( key == "softbin" ) {
+        step.softBin = value;
+        bOk = value.isEmpty() || ParseSoftwareBin(value.toStdString()).has_value();
+    } else if ( key == "format" ) {
+        step.format = value.toUpper();
+    } else if ( key == "roi" ) {
+        step.roi.clear();
+        for (const auto &v : value.split(',', Qt::SkipEmptyParts)) {
+            step.roi.append(v.trimmed().toInt(&bOk));
+            if ( ! bOk ) {
+                break;
+            }
+        }
+        bOk = bOk && (step.roi.isEmpty() || step.roi.size() == 4);
+    } else if ( key == "count" ) {
+        step.nCount = value.toInt(&bOk);
+    } else if ( key == "live" ) {
+        step.bLive = value == "1" || value.compare("true", Qt::CaseInsensitive) == 0;
+    } else if ( key == "output" ) {
+        step.output = value;
+    } else if ( key == "master" ) {
+        step.master = value.toLower();
+        bOk = step.master.isEmpty() || step.master == "bias" || step.master == "dark" || step.master == "flat";
+    } else {
+        bOk = false;
+    }
+    return bOk;
+}
+
+// [section] / key = value
+bool LoadPlan(const QString &path, const CaptureStep &base, QString &camera, QList<CaptureStep> &steps) {
+    QFile file(path);
+    if ( ! file.open(QIODevice::ReadOnly | QIODevice::Text) ) {
+        std::cerr << "cannot open plan: " << path.toStdString() << std::endl;
+        return false;
+    }
+    CaptureStep current = base;
+    bool bHasValues = false;
+    QTextStream stream(&file);
+    while ( ! stream.atEnd() ) {
+        auto line = stream.readLine();
+        line = line.left(line.indexOf('#')).trimmed();
+        if ( line.isEmpty() ) {
+            continue;
+        }
+        if ( line.startsWith('[') && line.endsWith(']') ) {
+            if ( bHasValues ) {
+                steps.append(current);
+            }
+            current.name = line.mid(1, line.size() - 2);
+            bHasValues = false;
+            continue;
+        }
+        const auto eq = line.indexOf('=');
+        const auto key = line.left(eq).trimmed();
+        const auto value = line.mid(eq + 1).trimmed();
+        if ( eq < 0 ) {
+            std::cerr << "invalid plan line: " << line.toStdString() << std::endl;
+            return false;
+        }
+        if ( key == "camera" ) {
+            camera = value;
+            continue;
+        }
+        if ( ! ApplyKey(current, key, value) ) {
+            std::cerr << "invalid plan value: " << line.toStdString() << std::endl;
+            return false;
+        }
+        bHasValues = true;
+    }
+    if ( bHasValues || steps.isEmpty() ) {
+        steps.append(current);
+    }
+    return true;
+}
+
+std::optional<POAImgFormat> ParseFormat(const QString &name) {
+    if ( name == "RAW8" ) {
+        return POAImgFormat::POA_RAW8;
+    }
+    if ( name == "RAW16" ) {
+        return POAImgFormat::POA_RAW16;
+    }
+    if ( name == "RGB24" ) {
+        return POAImgFormat::POA_RGB24;
+    }
+    if ( name == "MONO8" ) {
+        return POAImgFormat::POA_MONO8;
+    }
+    return std::nullopt;
+}
+
+
+// timing and capture settings of the frame
+std::vector<FitsKeyword> MetadataKeywords(const FrameMetadata &metadata) {
+    std::vector<FitsKeyword> keywords;
+    char value[32];
+    keywords.push_back({ "DATE-OBS", "'" + FormatUtc(metadata.exposureStartUtc) + "'", "exposure start (UTC)" });
+    keywords.push_back({ "DATE-END", "'" + FormatUtc(metadata.exposureEndUtc) + "'", "exposure end (UTC)" });
+    std::snprintf(value, sizeof(value), "%.6f", metadata.startUncertainty.count() / 1e6);
+    keywords.push_back({ "TIMSYER", value, "DATE-OBS uncertainty (s)" });
+    std::snprintf(value, sizeof(value), "%.6f", metadata.nExposure / 1e6);
+    keywords.push_back({ "EXPTIME", value, "exposure (s)" });
+    keywords.push_back({ "GAIN", std::to_string(metadata.nGain), "sensor gain" });
+    keywords.push_back({ "OFFSET", std::to_string(metadata.nOffset), "sensor offset" });
+    keywords.push_back({ "XBINNING", std::to_string(metadata.nBin * metadata.nSoftwareBinX), "" });
+    keywords.push_back({ "YBINNING", std::to_string(metadata.nBin * metadata.nSoftwareBinY), "" });
+    keywords.push_back({ "XORGSUBF", std::to_string(metadata.nStartX), "ROI origin (binned)" });
+    keywords.push_back({ "YORGSUBF", std::to_string(metadata.nStartY), "ROI origin (binned)" });
+    keywords.push_back({ "FRAMENO", std::to_string(metadata.nSequence), "frame since open" });
+    return keywords;
+}
+
+// temperature and cooler cards from the telemetry snapshot of the frame
+std::vector<FitsKeyword> TelemetryKeywords(const CameraTelemetry *pTelemetry) {
+    std::vector<FitsKeyword> keywords;
+    if ( ! pTelemetry ) {
+        return keywords;
+    }
+    if ( pTelemetry->temperature ) {
+        char value[32];
+        std::snprintf(value, sizeof(value), "%.1f", *pTelemetry->temperature);
+        keywords.push_back({ "CCD-TEMP", value, "sensor temperature (C)" });
+    }
+    if ( pTelemetry->nTargetTemperature ) {
+        keywords.push_back({ "SET-TEMP", std::to_string(*pTelemetry->nTargetTemperature), "cooler set point (C)" });
+    }
+    if ( pTelemetry->nCoolerPower ) {
+        keywords.push_back({ "COOLPOWR", std::to_string(*pTelemetry->nCoolerPower), "cooler power (%)" });
+    }
+    if ( pTelemetry->bCooler ) {
+        keywords.push_back({ "COOLER", *pTelemetry->bCooler ? "T" : "F", "cooler on" });
+    }
+    return keywords;
+}
+
+// tunings are kept per camera serial number and USB port in the user
+// playerone/playerone.ini, shared with the GUI
+QString BandwidthTuningGroup(const CcdPlayerOne &ccd) {
+    return "bandwidth/" + QString::fromStdString(ccd.GetBandwidthTuningKey());
+}
+
+bool LoadBandwidthTuning(CcdPlayerOne &ccd) {
+    QSettings settings(QSettings::IniFormat, QSettings::UserScope, "playerone", "playerone");
+    settings.beginGroup(BandwidthTuningGroup(ccd));
+    if ( ! settings.contains("usbBandwidthLimit") ) {
+        return false;
+    }
+    BandwidthTuning tuning;
+    tuning.nBandwidth = static_cast<long>(settings.value("usbBandwidthLimit").toLongLong());
+    tuning.nFrameLimit = static_cast<long>(settings.value("frameLimit", 0).toLongLong());
+    tuning.dFps = settings.value("fps", 0).toDouble();
+    return ccd.ApplyBandwidthTuning(tuning);
+}
+
+void SaveBandwidthTuning(const CcdPlayerOne &ccd, const BandwidthTuning &tuning) {
+    QSettings settings(QSettings::IniFormat, QSettings::UserScope, "playerone", "playerone");
+    settings.beginGroup(BandwidthTuningGroup(ccd));
+    settings.setValue("usbBandwidthLimit", static_cast<qlonglong>(tuning.nBandwidth));
+    settings.setValue("frameLimit", static_cast<qlonglong>(tuning.nFrameLimit));
+    settings.setValue("fps", tuning.dFps);
+}
+
+// --<prefix>-cpus 2,3 and --<prefix>-sched fifo:50 | rr:50 | nice:-5
+bool ParseThreadOptions(const QCommandLineParser &parser, const QString &prefix, ThreadConfig &config) {
+    const auto cpusKey = prefix + "-cpus";
+    if ( parser.isSet(cpusKey) ) {
+        const auto cpus = ParseCpuList(parser.value(cpusKey).toStdString());
+        if ( ! cpus ) {
+            std::cerr << "invalid value: --" << cpusKey.toStdString() << " " << parser.value(cpusKey).toStdString() << std::endl;
+            return false;
+        }
+        config.cpus = *cpus;
+    }
+    const auto schedKey = prefix + "-sched";
+    if ( parser.isSet(schedKey) ) {
+        const auto parts = parser.value(schedKey).split(':');
+        const auto policy = ParseThreadPolicy(parts[0].toLower().toStdString());
+        bool bNumber = parts.size() == 2;
+        const int nPriority = bNumber ? parts[1].toInt(&bNumber) : 0;
+        if ( ! policy || (*policy != ThreadPolicy::Default && ! bNumber) ) {
+            std::cerr << "invalid value: --" << schedKey.toStdString() << " " << parser.value(schedKey).toStdString() << std::endl;
+            return false;
+        }
+        config.policy = *policy;
+        config.nPriority = nPriority;
+    }
+    return true;
+}
+
+// frames of the current step, the consumers skip the others (extra live
+// view frames, frames of the previous step)
+struct StepFrames {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::uint64_t nFirstSequence = 0;   // of the first frame received
+    int nReceived = 0;
+    int nWanted = 0;
+    int nHandled = 0;                   // by the consumers that see every frame
+    bool bAborted = false;
+    int nWritten = 0;
+    long long nBytes = 0;
+    int nFailed = 0;
+    int nUnpacked = 0;                  // RAW16 frames --pack12 did not apply to
+
+    // index of the frame in the step
+    std::optional<int> GetIndex(const CapturedFrame &frame) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if ( nReceived == 0 || frame.metadata.nSequence < nFirstSequence ) {
+            return std::nullopt;
+        }
+        const auto nIndex = frame.metadata.nSequence - nFirstSequence;
+        if ( nIndex >= static_cast<std::uint64_t>(nWanted) ) {
+            return std::nullopt;
+        }
+        return static_cast<int>(nIndex);
+    }
+    void Handled() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            ++nHandled;
+        }
+        cv.notify_all();
+    }
+};
+
+}  // namespace
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("PlayerOne headless capture");
+    parser.addHelpOption();
+    parser.addOptions({
+        { "list", "list cameras and exit" },
+        { "camera", "camera serial number, model name or index (a serial number wins)", "camera", "0" },
+        { "plan", "capture plan file", "file" },
+        { "exposure", "exposure time (us)", "us" },
+        { "gain", "gain", "gain" },
+        { "bin", "bin, in software if the camera does not offer it", "bin" },
+        { "softbin", "software bin on top of --bin: NxM[:sum|avg], 1..8", "bin" },
+        { "format", "RAW8, RAW16, RGB24 or MONO8", "format" },
+        { "roi", "x,y,width,height (binned pixels)", "roi" },
+        { "count", "number of frames", "count" },
+        { "live", "capture in live (video) mode" },
+        { "tune", "tune USB bandwidth / frame limit before live capture" },
+        { "master", "combine the frames into a bias, dark or flat master", "type" },
+        { "calibration", "master frame directory, lights are calibrated from it", "dir" },
+        { "combine", "master combine method: median or sigma", "method", "median" },
+        { "stars", "detect stars and print count, HFR and the brightest centroid per frame" },
+        { "stack", "stack the frames of each step: mean or sigma", "mode" },
+        { "stack-output", "stacked image path (default stack.fits)", "path", "stack.fits" },
+        { "stack-preview", "write the stack every n frames", "n", "0" },
+        { "output", "output path pattern (.fits, .fits.fz, .pgm, .raw)", "pattern" },
+        { "capture-cpus", "CPUs of the capture thread, e.g. 2,3 or 2-3", "cpus" },
+        { "capture-sched", "capture thread scheduling: fifo:N, rr:N (1..99) or nice:N", "policy" },
+        { "writer-cpus", "CPUs of the writer, stacker and master threads", "cpus" },
+        { "writer-sched", "writer thread scheduling: fifo:N, rr:N or nice:N", "policy" },
+        { "pool-cpus", "CPUs of the processing pool", "cpus" },
+        { "pool-sched", "processing pool scheduling: fifo:N, rr:N or nice:N", "policy" },
+        { "mlock", "keep the frame buffers resident in memory" },
+        { "hugepages", "frame buffers on huge pages: thp or explicit (hugetlbfs, thp if none are free)", "kind" },
+        { "prefault", "fault the frame buffers in when they are allocated" },
+        { "pack12", "queue RAW16 frames of 12bit sensors packed (12 bits per pixel), .raw12 writes them as is" },
+        { "recover", "reopen the camera and resume when an SDK call hangs or the camera drops off the bus" },
+        { "readout", "print the readout model (download time per format, bin and USB speed) at the end" },
+        { "auto-exposure", "live view: exposure, then gain, from the frame histogram, median at this fraction of full scale (e.g. 0.25)", "level" },
+    });
+    parser.process(app);
+
+    if ( parser.isSet("list") ) {
+        const auto cameras = PlayerOneCamera::CameraList();
+        for (std::size_t i = 0; i < cameras.size(); ++i) {
+            std::cout << i << ": " << cameras[i] << std::endl;
+        }
+        return 0;
+    }
+
+    // plan file first, command line options override every step
+    auto camera = parser.value("camera");
+    QList<CaptureStep> steps;
+    if ( parser.isSet("plan") ) {
+        if ( ! LoadPlan(parser.value("plan"), CaptureStep(), camera, steps) ) {
+            return 1;
+        }
+        if ( parser.isSet("camera") ) {
+            camera = parser.value("camera");
+        }
+    } else {
+        steps.append(CaptureStep());
+    }
+    for (auto &step : steps) {
+        for (const auto &key : StepKeys) {
+            if ( key == "live" ) {
+                if ( parser.isSet(key) ) {
+                    step.bLive = true;
+                }
+                continue;
+            }
+            if ( parser.isSet(key) && ! ApplyKey(step, key, parser.value(key)) ) {
+                std::cerr << "invalid value: --" << key.toStdString() << " " << parser.value(key).toStdString() << std::endl;
+                return 1;
+            }
+        }
+        if ( ! FrameWriter::FormatFromPath(step.output.toStdString()) ) {
+            std::cerr << "unknown output format: " << step.output.toStdString() << std::endl;
+            return 1;
+        }
+    }
+
+    std::optional<StackMode> stackMode;
+    if ( parser.isSet("stack") ) {
+        const auto mode = parser.value("stack").toLower();
+        if ( mode == "mean" ) {
+            stackMode = StackMode::Mean;
+        } else if ( mode == "sigma" ) {
+            stackMode = StackMode::SigmaClip;
+        } else {
+            std::cerr << "invalid value: --stack " << mode.toStdString() << std::endl;
+            return 1;
+        }
+    }
+    const auto stackOutput = parser.value("stack-output").toStdString();
+    if ( stackMode && ! FrameWriter::FormatFromPath(stackOutput) ) {
+        std::cerr << "unknown output format: " << stackOutput << std::endl;
+        return 1;
+    }
+
+    std::shared_ptr<CalibrationLibrary> pLibrary;
+    if ( parser.isSet("calibration") ) {
+        pLibrary = std::make_shared<CalibrationLibrary>(parser.value("calibration").toStdString());
+        if ( ! pLibrary->Scan() ) {
+            std::cerr << "cannot open calibration directory: " << pLibrary->GetDirectory() << std::endl;
+            return 1;
+        }
+    }
+    ThreadConfig captureThread;
+    ThreadConfig writerThread;
+    ThreadConfig poolThread;
+    if ( ! ParseThreadOptions(parser, "capture", captureThread) || ! ParseThreadOptions(parser, "writer", writerThread)
+         || ! ParseThreadOptions(parser, "pool", poolThread) ) {
+        return 1;
+    }
+    const auto combine = parser.value("combine").toLower() == "sigma" ? CombineMethod::SigmaClip : CombineMethod::Median;
+    for (const auto &step : steps) {
+        if ( ! step.master.isEmpty() && ! pLibrary ) {
+            std::cerr << "master frames need --calibration" << std::endl;
+            return 1;
+        }
+    }
+
+    // camera selection: serial number or model name first, so an all digit
+    // serial number is not taken for an index
+    int nIndex = 0;
+    if ( const auto found = PlayerOneCamera::FindIndex(camera.toStdString()) ) {
+        nIndex = *found;
+    } else {
+        bool bIndex = false;
+        nIndex = camera.toInt(&bIndex);
+        if ( ! bIndex ) {
+            std::cerr << "camera not found: " << camera.toStdString() << std::endl;
+            return 1;
+        }
+    }
+    CcdPlayerOne ccd;
+    if ( ! ccd.Open(nIndex) ) {
+        std::cerr << "open failed: " << camera.toStdString() << std::endl;
+        return 1;
+    }
+    // properties only; the executor is fetched per call, a recovery replaces it
+    const auto pDevice = ccd.GetCamera();
+    std::cerr << "camera: " << ccd.GetDeviceName() << " (" << pDevice->m_CamProp.SN << ")" << std::endl;
+    if ( LoadBandwidthTuning(ccd) ) {
+        std::cerr << "bandwidth: stored tuning applied" << std::endl;
+    }
+
+    // missing privileges are reported up front instead of silently running
+    // with the default scheduling
+    std::string threadError;
+    if ( ! ccd.SetCaptureThreadConfig(captureThread, threadError) ) {
+        std::cerr << "capture thread: " << threadError << std::endl;
+        return 1;
+    }
+    if ( ! TestThreadConfig(writerThread, threadError) ) {
+        std::cerr << "writer thread: " << threadError << std::endl;
+        return 1;
+    }
+    if ( ! ThreadPool::Global().SetThreadConfig(poolThread, threadError) ) {
+        std::cerr << "processing pool: " << threadError << std::endl;
+        return 1;
+    }
+    FrameMemory frameMemory;
+    frameMemory.bPrefault = parser.isSet("prefault");
+    if ( parser.isSet("hugepages") ) {
+        const auto kind = parser.value("hugepages");
+        if ( kind == "thp" ) {
+            frameMemory.hugePages = HugePages::Transparent;
+        } else if ( kind == "explicit" ) {
+            frameMemory.hugePages = HugePages::Explicit;
+        } else {
+            std::cerr << "invalid --hugepages " << kind.toStdString() << std::endl;
+            return 1;
+        }
+    }
+    ccd.SetFrameMemory(frameMemory);
+    ccd.SetPackedRaw12(parser.isSet("pack12"));
+    ccd.SetAutoRecovery(parser.isSet("recover"));
+    if ( parser.isSet("auto-exposure") ) {
+        bool bLevel = false;
+        AutoExposureConfig autoExposure;
+        autoExposure.dTarget = parser.value("auto-exposure").toDouble(&bLevel);
+        if ( ! bLevel || autoExposure.dTarget <= 0 || autoExposure.dTarget >= 1 ) {
+            std::cerr << "invalid auto exposure level: " << parser.value("auto-exposure").toStdString() << std::endl;
+            return 1;
+        }
+        ccd.SetAutoExposure(true, autoExposure);
+    }
+    if ( parser.isSet("mlock") && ! ccd.SetFrameMemoryLocked(true, threadError) ) {
+        std::cerr << "mlock: " << threadError << std::endl;
+        return 1;
+    }
+
+    StepFrames frames;
+    // runs on the capture thread, before the frame is handed to the consumers
+    QObject::connect(&ccd, &CcdPlayerOne::imageReady, [&](int, int, const FrameBuffer &, const FrameTimestamps &,
+                                                          std::shared_ptr<const FrameStats>, const FrameMetadata &metadata) {
+        std::lock_guard<std::mutex> lock(frames.mtx);
+        if ( frames.nReceived >= frames.nWanted ) {
+            return;
+        }
+        if ( frames.nReceived == 0 ) {
+            frames.nFirstSequence = metadata.nSequence;
+        }
+        if ( metadata.nBytepp == 2 && ccd.IsPackedRaw12() && ! metadata.bPacked12 ) {
+            ++frames.nUnpacked;
+        }
+        ++frames.nReceived;
+        frames.cv.notify_all();
+    });
+    QObject::connect(&ccd, &CcdPlayerOne::aborted, [&]() {
+        std::lock_guard<std::mutex> lock(frames.mtx);
+        frames.bAborted = true;
+        frames.cv.notify_all();
+    });
+    QObject::connect(&ccd, &CcdPlayerOne::settingFailed, [](const QString &setting) {
+        std::cerr << "queued " << setting.toStdString() << " failed" << std::endl;
+    });
+
+    StarDetector starDetector;
+    const bool bStars = parser.isSet("stars");
+    LiveStacker stacker;
+    if ( stackMode ) {
+        stacker.Configure(*stackMode);
+    }
+    int nResult = 0;
+    int nStep = 0;
+    for (const auto &step : steps) {
+        // one stack per step
+        const auto stackPath = steps.size() > 1 ? FrameWriter::ExpandPath(stackOutput, nStep) : stackOutput;
+        ++nStep;
+        if ( stackMode ) {
+            stacker.Reset();
+            stacker.SetPreviewCallback(parser.value("stack-preview").toInt(), [stackPath](int nWidth, int nHeight, int nBytepp, const FrameBuffer &preview, int nFrames) {
+                FrameWriter::Write(stackPath, nWidth, nHeight, nBytepp, preview);
+                std::cerr << "stack: " << nFrames << " frames" << std::endl;
+            });
+        }
+        if ( ! step.name.isEmpty() ) {
+            std::cerr << "[" << step.name.toStdString() << "]" << std::endl;
+        }
+        ccd.StopLiveView();
+        ccd.AbortExposure();
+        if ( ! ccd.GetExecutor() ) {
+            // a recovery gave up on it
+            std::cerr << "camera lost" << std::endl;
+            nResult = 1;
+            break;
+        }
+
+        // configure
+        if ( ! step.format.isEmpty() ) {
+            const auto fmt = ParseFormat(step.format);
+            if ( ! fmt || ! ccd.GetExecutor()->Call(&PlayerOneCamera::SetImageFormat, *fmt) ) {
+                std::cerr << "SetImageFormat failed: " << step.format.toStdString() << std::endl;
+                nResult = 1;
+                break;
+            }
+        }
+        if ( ! ccd.SetQuality(step.nBin) ) {
+            std::cerr << "SetBin failed: " << step.nBin << std::endl;
+            nResult = 1;
+            break;
+        }
+        if ( ! step.softBin.isEmpty() ) {
+            auto softBin = ParseSoftwareBin(step.softBin.toStdString());
+            if ( ccd.GetSoftwareBin().IsEnabled() ) {
+                // --bin fell back to software, stack the two
+                const auto current = ccd.GetSoftwareBin();
+                softBin->nX *= current.nX;
+                softBin->nY *= current.nY;
+            }
+            if ( ! ccd.SetSoftwareBin(*softBin) ) {
+                std::cerr << "software bin out of range: " << step.softBin.toStdString() << std::endl;
+                nResult = 1;
+                break;
+            }
+        }
+        if ( ! step.master.isEmpty() && ccd.GetSoftwareBin().IsEnabled() ) {
+            // masters calibrate frames before the software bin
+            std::cerr << "master frames cannot be binned in software, use a hardware bin" << std::endl;
+            nResult = 1;
+            break;
+        }
+        bool bRoi = false;
+        if ( step.roi.size() == 4 ) {
+            bRoi = ccd.SetROI(step.roi[0], step.roi[1], step.roi[2], step.roi[3]);
+        } else {
+            // ROI is in hardware binned pixels
+            const auto [nMaxWidth, nMaxHeight] = pDevice->GetMaxImageSize();
+            const auto nHardwareBin = ccd.GetExecutor()->Call(&PlayerOneCamera::GetImageBin).value_or(1);
+            bRoi = ccd.SetROI(0, 0, nMaxWidth / nHardwareBin, nMaxHeight / nHardwareBin);
+        }
+        if ( ! bRoi ) {
+            std::cerr << "SetROI failed" << std::endl;
+            nResult = 1;
+            break;
+        }
+        if ( ! ccd.SetExposure(step.nExposure) ) {
+            std::cerr << "SetExposure failed: " << step.nExposure << std::endl;
+            nResult = 1;
+            break;
+        }
+        if ( step.nGain >= 0 && ! ccd.SetGain(step.nGain) ) {
+            std::cerr << "SetGain failed: " << step.nGain << std::endl;
+            nResult = 1;
+            break;
+        }
+        if ( step.bLive && parser.isSet("tune") ) {
+            const auto tuning = ccd.TuneBandwidth();
+            if ( ! tuning ) {
+                std::cerr << "bandwidth tuning found no setting without drops" << std::endl;
+            } else {
+                for (const auto &trial : tuning->trials) {
+                    std::cerr << "  bandwidth " << trial.nBandwidth << "% limit " << trial.nFrameLimit
+                              << ": " << trial.dFps << " fps, dropped " << trial.nDropped << std::endl;
+                }
+                std::cerr << "bandwidth: " << tuning->nBandwidth << "% frame limit: " << tuning->nFrameLimit << std::endl;
+                SaveBandwidthTuning(ccd, *tuning);
+            }
+        }
+        const auto fmt = ccd.GetExecutor()->Call(&PlayerOneCamera::GetImageFormat);
+        if ( ! fmt ) {
+            nResult = 1;
+            break;
+        }
+        const auto nBytepp = std::get<1>(PlayerOneImgFormatSize(*fmt));
+
+        // calibration frames stay raw, lights are calibrated by the capture thread
+        std::unique_ptr<MasterBuilder> pBuilder;
+        if ( ! step.master.isEmpty() ) {
+            const auto key = ccd.GetCalibrationKey();
+            if ( ! key ) {
+                nResult = 1;
+                break;
+            }
+            const auto type = step.master == "bias" ? MasterType::Bias : step.master == "dark" ? MasterType::Dark : MasterType::Flat;
+            pBuilder = pLibrary->CreateBuilder(type, *key);
+            ccd.SetCalibrationLibrary(nullptr);
+        } else {
+            ccd.SetCalibrationLibrary(pLibrary);
+        }
+        // every frame goes to the writer and, without a copy, to the stacker,
+        // the master builder and the star detector. those that must see every
+        // frame hold the capture up when they fall behind; star detection
+        // only reports and skips frames instead.
+        const auto pattern = step.output.toStdString();
+        int nMustSee = 1;
+        FrameConsumerOptions everyFrame;
+        everyFrame.bMayDrop = false;
+        everyFrame.thread = writerThread;
+        ccd.AddFrameConsumer("writer", [&, pattern](const FramePtr &pFrame) {
+            const auto nIndex = frames.GetIndex(*pFrame);
+            if ( ! nIndex ) {
+                return;
+            }
+            const auto path = FrameWriter::ExpandPath(pattern, *nIndex);
+            auto keywords = MetadataKeywords(pFrame->metadata);
+            const auto pTelemetry = ccd.GetTelemetry();
+            const auto telemetryKeywords = TelemetryKeywords(pTelemetry.get());
+            keywords.insert(keywords.end(), telemetryKeywords.begin(), telemetryKeywords.end());
+            const bool bOk = FrameWriter::Write(path, pFrame->nWidth, pFrame->nHeight, pFrame->nBytepp, *pFrame->pBuffer, keywords,
+                                                pFrame->bPacked12);
+            if ( ! bOk ) {
+                std::cerr << "write failed: " << path << std::endl;
+            }
+            {
+                std::lock_guard<std::mutex> lock(frames.mtx);
+                if ( bOk ) {
+                    ++frames.nWritten;
+                    frames.nBytes += static_cast<long long>(pFrame->pBuffer->size());
+                } else {
+                    ++frames.nFailed;
+                }
+            }
+            frames.Handled();
+        }, everyFrame);
+        // unpacked samples of packed frames, one per consumer thread
+        FrameBuffer stackSamples;
+        FrameBuffer masterSamples;
+        FrameBuffer starSamples;
+        if ( stackMode ) {
+            ++nMustSee;
+            ccd.AddFrameConsumer("stack", [&](const FramePtr &pFrame) {
+                if ( frames.GetIndex(*pFrame) ) {
+                    stacker.Add(pFrame->nWidth, pFrame->nHeight, pFrame->nBytepp, pFrame->GetSamples(stackSamples));
+                    frames.Handled();
+                }
+            }, everyFrame);
+        }
+        if ( pBuilder ) {
+            ++nMustSee;
+            ccd.AddFrameConsumer("master", [&](const FramePtr &pFrame) {
+                if ( frames.GetIndex(*pFrame) ) {
+                    pBuilder->Add(pFrame->GetSamples(masterSamples));
+                    frames.Handled();
+                }
+            }, everyFrame);
+        }
+        if ( bStars && nBytepp != 3 ) {
+            FrameConsumerOptions analysis;
+            analysis.bSharedPool = true;
+            ccd.AddFrameConsumer("stars", [&](const FramePtr &pFrame) {
+                const auto nIndex = frames.GetIndex(*pFrame);
+                if ( ! nIndex ) {
+                    return;
+                }
+                const auto stars = starDetector.Detect(pFrame->nWidth, pFrame->nHeight, pFrame->nBytepp, pFrame->GetSamples(starSamples));
+                std::vector<double> hfr;
+                for (const auto &star : stars) {
+                    hfr.push_back(star.dHFR);
+                }
+                std::sort(hfr.begin(), hfr.end());
+                std::cerr << "frame " << *nIndex << ": stars " << stars.size();
+                if ( ! stars.empty() ) {
+                    std::cerr << " hfr " << hfr[hfr.size() / 2]
+                              << " brightest (" << stars.front().dX << ", " << stars.front().dY << ")";
+                }
+                std::cerr << std::endl;
+            }, analysis);
+        }
+        {
+            std::lock_guard<std::mutex> lock(frames.mtx);
+            frames.nFirstSequence = 0;
+            frames.nReceived = 0;
+            frames.nWanted = step.nCount;
+            frames.nHandled = 0;
+            frames.bAborted = false;
+            frames.nWritten = 0;
+            frames.nBytes = 0;
+            frames.nFailed = 0;
+            frames.nUnpacked = 0;
+        }
+
+        // capture
+        const auto start = std::chrono::steady_clock::now();
+        auto frameTimeout = std::chrono::milliseconds(step.nExposure / 1000 * 2 + 10000);
+        if ( ccd.IsAutoRecovery() ) {
+            // a frame may wait for the camera to come back
+            frameTimeout += ccd.GetWatchdogConfig().reopenTimeout;
+        }
+        const auto recoveryBefore = ccd.GetRecoveryStats();
+        bool bOk = true;
+        if ( step.bLive ) {
+            bOk = ccd.StartLiveView();
+            std::unique_lock<std::mutex> lock(frames.mtx);
+            while ( bOk && frames.nReceived < frames.nWanted && ! frames.bAborted ) {
+                const auto nBefore = frames.nReceived;
+                if ( ! frames.cv.wait_for(lock, frameTimeout, [&]() { return frames.nReceived != nBefore || frames.bAborted; }) ) {
+                    bOk = false;
+                }
+            }
+            bOk = bOk && ! frames.bAborted;
+        } else {
+            for (int i = 0; bOk && i < step.nCount; ++i) {
+                bOk = ccd.StartExposure();
+                std::unique_lock<std::mutex> lock(frames.mtx);
+                bOk = bOk && frames.cv.wait_for(lock, frameTimeout, [&]() { return frames.nReceived > i || frames.bAborted; }) && ! frames.bAborted;
+            }
+        }
+        std::optional<int> dropped;
+        if ( step.bLive && ccd.GetExecutor() ) {
+            dropped = ccd.GetExecutor()->Call(&PlayerOneCamera::GetDroppedImagesCount);
+        }
+        const auto captured = std::chrono::steady_clock::now();
+        {
+            // stopping releases a producer blocked on a full queue, so let
+            // the last wanted frame reach every consumer first
+            std::unique_lock<std::mutex> lock(frames.mtx);
+            frames.cv.wait_for(lock, frameTimeout, [&]() { return frames.nHandled >= frames.nReceived * nMustSee || frames.bAborted; });
+        }
+        ccd.StopLiveView();
+        ccd.FlushFrameConsumers();
+        for (const auto &name : { "writer", "stack", "master", "stars" }) {
+            ccd.RemoveFrameConsumer(name);
+        }
+        const auto finished = std::chrono::steady_clock::now();
+
+        const int nReceived = frames.nReceived;
+        const int nWritten = frames.nWritten;
+        const long long nBytes = frames.nBytes;
+        const int nFailed = frames.nFailed;
+        const auto dCapture = std::chrono::duration<double>(captured - start).count();
+        const auto dTotal = std::chrono::duration<double>(finished - start).count();
+        std::cerr << "frames: " << nWritten << "/" << step.nCount
+                  << " capture: " << dCapture << " s (" << (dCapture > 0 ? nReceived / dCapture : 0) << " fps)"
+                  << " written: " << nBytes / 1e6 << " MB (" << (dTotal > 0 ? nBytes / 1e6 / dTotal : 0) << " MB/s)";
+        if ( dropped ) {
+            std::cerr << " dropped: " << *dropped;
+        }
+        if ( frames.nUnpacked > 0 ) {
+            std::cerr << " pack12: off (calibrated, averaged or over 12 bit)";
+        }
+        if ( step.bLive && ccd.IsAutoExposure() ) {
+            const auto autoExposure = ccd.GetAutoExposureStatus();
+            std::cerr << " auto exposure: " << ccd.GetExposure().value_or(0) << " us gain " << ccd.GetGain().value_or(0)
+                      << (autoExposure.bConverged ? "" : " (not converged)") << (autoExposure.bLimited ? " (limited)" : "");
+        }
+        const auto recovery = ccd.GetRecoveryStats();
+        if ( recovery.nRecoveries + recovery.nFailures > recoveryBefore.nRecoveries + recoveryBefore.nFailures ) {
+            std::cerr << " recoveries: " << recovery.nRecoveries - recoveryBefore.nRecoveries
+                      << " (" << (recovery.totalDuration - recoveryBefore.totalDuration).count() << " ms, last: " << recovery.lastReason << ")";
+            if ( recovery.nFailures > recoveryBefore.nFailures ) {
+                std::cerr << " failed: " << recovery.nFailures - recoveryBefore.nFailures;
+            }
+        }
+        std::cerr << std::endl;
+        if ( pBuilder && pBuilder->GetFrameCount() > 0 ) {
+            const auto pMaster = pLibrary->Build(*pBuilder, combine);
+            if ( ! pMaster ) {
+                std::cerr << "master build failed" << std::endl;
+                nResult = 1;
+                break;
+            }
+            std::cerr << "master: " << pMaster->GetFrameCount() << " frames -> " << pMaster->GetPath() << std::endl;
+        }
+        FrameBuffer stacked;
+        if ( stackMode && stacker.GetPreview(stacked) ) {
+            if ( ! FrameWriter::Write(stackPath, stacker.GetWidth(), stacker.GetHeight(), stacker.GetBytepp(), stacked) ) {
+                std::cerr << "write failed: " << stackPath << std::endl;
+                nResult = 1;
+                break;
+            }
+            std::cerr << "stack: " << stacker.GetFrameCount() << " frames -> " << stackPath << std::endl;
+        }
+        if ( ! bOk || nFailed > 0 ) {
+            std::cerr << (bOk ? "write failed" : "capture failed") << std::endl;
+            nResult = 1;
+            break;
+        }
+    }
+
+    if ( parser.isSet("readout") ) {
+        std::cerr << ccd.GetReadoutReport();
+    }
+    ccd.Close();
+    return nResult;
+}
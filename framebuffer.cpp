@@ -0,0 +1,175 @@
+#include "framebuffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+constexpr std::size_t HugePageSize = std::size_t(2) << 20;
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+std::atomic<std::uint64_t> nHugePageFallbacks(0);
+
+// just in front of every block
+struct BlockHeader {
+    void *pBase;            // start of the allocation
+    std::size_t nMapped;    // bytes mapped, 0: heap
+};
+
+std::size_t PageSize() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    static const auto nPageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return nPageSize;
+#endif
+}
+
+std::size_t RoundUp(std::size_t nValue, std::size_t nMultiple) {
+    return (nValue + nMultiple - 1) / nMultiple * nMultiple;
+}
+
+void *Map(std::size_t nSize, bool bHuge) {
+#ifdef _WIN32
+    DWORD nType = MEM_RESERVE | MEM_COMMIT;
+    if ( bHuge ) {
+        // needs SeLockMemoryPrivilege
+        nType |= MEM_LARGE_PAGES;
+    }
+    return VirtualAlloc(nullptr, nSize, nType, PAGE_READWRITE);
+#else
+    int nFlags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_HUGETLB
+    if ( bHuge ) {
+        nFlags |= MAP_HUGETLB;
+    }
+#else
+    if ( bHuge ) {
+        return nullptr;
+    }
+#endif
+    void *p = mmap(nullptr, nSize, PROT_READ | PROT_WRITE, nFlags, -1, 0);
+    return p == MAP_FAILED ? nullptr : p;
+#endif
+}
+
+void Unmap(void *p, std::size_t nSize) {
+#ifdef _WIN32
+    (void)nSize;
+    VirtualFree(p, 0, MEM_RELEASE);
+#else
+    munmap(p, nSize);
+#endif
+}
+
+void Prefault(void *p, std::size_t nSize) {
+    const auto nPage = PageSize();
+#ifdef __linux__
+    // one call instead of a fault per page (Linux 5.14+)
+    const auto nBegin = reinterpret_cast<std::uintptr_t>(p) / nPage * nPage;
+    const auto nEnd = reinterpret_cast<std::uintptr_t>(p) + nSize;
+    if ( madvise(reinterpret_cast<void *>(nBegin), nEnd - nBegin, MADV_POPULATE_WRITE) == 0 ) {
+        return;
+    }
+#endif
+    auto *pBytes = static_cast<volatile unsigned char *>(p);
+    for (std::size_t i = 0; i < nSize; i += nPage) {
+        pBytes[i] = 0;
+    }
+    if ( nSize > 0 ) {
+        pBytes[nSize - 1] = 0;
+    }
+}
+
+void *Place(void *pBase, std::size_t nMapped, std::uintptr_t nData) {
+    auto *pHeader = reinterpret_cast<BlockHeader *>(nData) - 1;
+    pHeader->pBase = pBase;
+    pHeader->nMapped = nMapped;
+    return reinterpret_cast<void *>(nData);
+}
+
+}  // namespace
+
+
+void *AllocateFrameMemory(std::size_t nSize, const FrameMemory &memory) {
+    // room for the header in front of an aligned start
+    std::size_t nAlignment = alignof(std::max_align_t);
+    while ( nAlignment < std::max(memory.nAlignment, sizeof(BlockHeader)) ) {
+        nAlignment *= 2;
+    }
+
+    void *pData = nullptr;
+    auto hugePages = memory.hugePages;
+    if ( hugePages != HugePages::None && nSize < HugePageSize / 2 ) {
+        // not worth a huge page
+        hugePages = HugePages::None;
+    }
+    if ( hugePages == HugePages::Explicit ) {
+        const auto nMapped = RoundUp(nSize + nAlignment, HugePageSize);
+        if ( void *pBase = Map(nMapped, true) ) {
+            pData = Place(pBase, nMapped, reinterpret_cast<std::uintptr_t>(pBase) + nAlignment);
+        } else {
+            ++nHugePageFallbacks;
+            hugePages = HugePages::Transparent;
+        }
+    }
+    if ( ! pData && hugePages == HugePages::Transparent ) {
+        // a 2 MB aligned range inside, so the kernel can back it with huge pages
+        const auto nMapped = RoundUp(nSize + nAlignment + HugePageSize, PageSize());
+        if ( void *pBase = Map(nMapped, false) ) {
+            const auto nAligned = RoundUp(reinterpret_cast<std::uintptr_t>(pBase), HugePageSize);
+#ifdef MADV_HUGEPAGE
+            // whole huge pages inside the mapping, the tail past them stays small
+            const auto nEnd = reinterpret_cast<std::uintptr_t>(pBase) + nMapped;
+            const auto nAdvised = std::min(RoundUp(nSize + nAlignment, HugePageSize), (nEnd - nAligned) / HugePageSize * HugePageSize);
+            if ( nAdvised > 0 ) {
+                madvise(reinterpret_cast<void *>(nAligned), nAdvised, MADV_HUGEPAGE);
+            }
+#endif
+            pData = Place(pBase, nMapped, nAligned + nAlignment);
+        }
+    }
+    if ( ! pData ) {
+        void *pBase = std::malloc(nSize + nAlignment + sizeof(BlockHeader));
+        if ( ! pBase ) {
+            throw std::bad_alloc();
+        }
+        const auto nData = RoundUp(reinterpret_cast<std::uintptr_t>(pBase) + sizeof(BlockHeader), nAlignment);
+        pData = Place(pBase, 0, nData);
+    }
+    if ( memory.bPrefault ) {
+        Prefault(pData, nSize);
+    }
+    return pData;
+}
+
+void FreeFrameMemory(void *p) noexcept {
+    if ( ! p ) {
+        return;
+    }
+    const auto *pHeader = static_cast<const BlockHeader *>(p) - 1;
+    if ( pHeader->nMapped == 0 ) {
+        std::free(pHeader->pBase);
+    } else {
+        Unmap(pHeader->pBase, pHeader->nMapped);
+    }
+}
+
+std::uint64_t GetHugePageFallbackCount() {
+    return nHugePageFallbacks;
+}
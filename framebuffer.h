@@ -0,0 +1,102 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+enum class HugePages {
+    None,
+    Transparent,    // 2 MB aligned mapping with MADV_HUGEPAGE (Linux)
+    Explicit,       // MAP_HUGETLB / MEM_LARGE_PAGES, transparent if none are free
+};
+
+struct FrameMemory {
+    std::size_t nAlignment = 64;    // power of two, 4096 for page alignment
+    HugePages hugePages = HugePages::None;
+    bool bPrefault = false;         // touch every page when the storage is allocated
+
+    bool operator==(const FrameMemory &other) const {
+        return nAlignment == other.nAlignment && hugePages == other.hugePages && bPrefault == other.bPrefault;
+    }
+    bool operator!=(const FrameMemory &other) const {
+        return ! (*this == other);
+    }
+};
+
+// raw storage; every block records how it was allocated, so FreeFrameMemory()
+// needs no options
+void *AllocateFrameMemory(std::size_t nSize, const FrameMemory &memory);
+void FreeFrameMemory(void *p) noexcept;
+// explicit huge page requests that fell back to normal pages
+std::uint64_t GetHugePageFallbackCount();
+
+//
+// allocator of the frame buffers
+// elements are default initialized: growing a buffer does not clear it, the
+// download overwrites it anyway.
+// instances with different FrameMemory options still compare equal
+// (is_always_equal): any instance may free any block, because every block
+// carries a header saying how it was allocated (see FreeFrameMemory). the
+// options only decide how new blocks are allocated, and a container keeps
+// its own allocator on move/swap, so a buffer that must change options is
+// replaced rather than reassigned.
+//
+template <typename T>
+class FrameAllocator {
+public:
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    FrameAllocator() noexcept
+        : memory()
+    {}
+    explicit FrameAllocator(const FrameMemory &memory) noexcept
+        : memory(memory)
+    {}
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U> &other) noexcept
+        : memory(other.GetMemory())
+    {}
+
+    T *allocate(std::size_t nCount) {
+        return static_cast<T *>(AllocateFrameMemory(nCount * sizeof(T), memory));
+    }
+    void deallocate(T *p, std::size_t) noexcept {
+        FreeFrameMemory(p);
+    }
+
+    template <typename U>
+    void construct(U *p) noexcept(std::is_nothrow_default_constructible<U>::value) {
+        ::new (static_cast<void *>(p)) U;
+    }
+    template <typename U, typename... Args>
+    void construct(U *p, Args &&...args) {
+        ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+    }
+
+    const FrameMemory &GetMemory() const noexcept {
+        return memory;
+    }
+
+private:
+    FrameMemory memory;
+};
+
+template <typename T, typename U>
+bool operator==(const FrameAllocator<T> &, const FrameAllocator<U> &) noexcept {
+    return true;
+}
+template <typename T, typename U>
+bool operator!=(const FrameAllocator<T> &, const FrameAllocator<U> &) noexcept {
+    return false;
+}
+
+// image data as downloaded and passed through the pipeline
+using FrameBuffer = std::vector<unsigned char, FrameAllocator<unsigned char>>;
+
+#endif // FRAMEBUFFER_H
@@ -0,0 +1,231 @@
+#include "framegraph.h"
+
+#include <algorithm>
+
+
+FrameConsumer::FrameConsumer(std::shared_ptr<FrameSubscription> pSubscription, FrameHandler handler, bool bSharedPool, const ThreadConfig &threadConfig, ThreadPool &pool)
+    : pSubscription(std::move(pSubscription))
+    , handler(std::move(handler))
+    , bSharedPool(bSharedPool)
+    , threadConfig(threadConfig)
+    , pool(pool)
+    , mtx()
+    , cvIdle()
+    , bBusy(false)
+    , bScheduled(false)
+    , nHandlerTime(0)
+    , nMaxHandlerTime(0)
+    , threadError()
+    , bStop(false)
+    , thread()
+{}
+
+FrameConsumer::~FrameConsumer() {
+    Stop();
+}
+
+const std::string &FrameConsumer::GetName() const {
+    return pSubscription->GetName();
+}
+
+FrameConsumerStatus FrameConsumer::GetStatus() const {
+    FrameConsumerStatus status;
+    status.name = pSubscription->GetName();
+    status.policy = pSubscription->GetPolicy();
+    status.bSharedPool = bSharedPool;
+    status.nDepth = pSubscription->GetDepth();
+    status.counters = pSubscription->GetCounters();
+    std::lock_guard<std::mutex> lock(mtx);
+    status.nHandlerTime = nHandlerTime;
+    status.nMaxHandlerTime = nMaxHandlerTime;
+    status.threadError = threadError;
+    return status;
+}
+
+void FrameConsumer::Flush() {
+    std::unique_lock<std::mutex> lock(mtx);
+    cvIdle.wait(lock, [this]() {
+        return bStop || (! bBusy && ! bScheduled && pSubscription->GetDepth() == 0);
+    });
+}
+
+void FrameConsumer::Stop() {
+    if ( bStop.exchange(true) ) {
+        return;
+    }
+    pSubscription->SetNotify(nullptr);
+    // wakes Pop() and a producer blocked on the queue
+    pSubscription->Close();
+    if ( thread.joinable() ) {
+        thread.join();
+    }
+    // a pool task may still be running the handler
+    std::unique_lock<std::mutex> lock(mtx);
+    cvIdle.notify_all();
+    cvIdle.wait(lock, [this]() { return ! bBusy && ! bScheduled; });
+}
+
+void FrameConsumer::Start() {
+    if ( bSharedPool ) {
+        std::weak_ptr<FrameConsumer> pWeak = shared_from_this();
+        pSubscription->SetNotify([pWeak]() {
+            if ( const auto pConsumer = pWeak.lock() ) {
+                pConsumer->Schedule();
+            }
+        });
+        // frames that arrived before the notifier was set
+        Schedule();
+    } else {
+        thread = std::thread([this]() { ThreadProc(); });
+    }
+}
+
+void FrameConsumer::ThreadProc() {
+    SetCurrentThreadName("poa-" + pSubscription->GetName());
+    std::string error;
+    if ( ! ApplyThreadConfig(threadConfig, error) ) {
+        std::lock_guard<std::mutex> lock(mtx);
+        threadError = error;
+    }
+    while ( ! bStop ) {
+        HandleNext(std::chrono::milliseconds(100));
+    }
+}
+
+void FrameConsumer::Schedule() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if ( bScheduled || bStop ) {
+            return;
+        }
+        bScheduled = true;
+    }
+    auto pSelf = shared_from_this();
+    pool.Submit([pSelf]() { pSelf->Drain(); });
+}
+
+void FrameConsumer::Drain() {
+    // one frame per task, a busy consumer does not starve the others
+    if ( ! bStop ) {
+        HandleNext(std::chrono::microseconds(0));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bScheduled = false;
+    }
+    cvIdle.notify_all();
+    // frames queued meanwhile, their notify found the task still scheduled
+    if ( ! bStop && pSubscription->GetDepth() > 0 ) {
+        Schedule();
+    }
+}
+
+bool FrameConsumer::HandleNext(std::chrono::microseconds timeout) {
+    // the idle wait is not busy, Flush() returns at once meanwhile
+    if ( timeout.count() > 0 && ! pSubscription->Wait(timeout) ) {
+        return false;
+    }
+    FramePtr pFrame;
+    {
+        // popped and busy in one step under the lock Flush() waits on, so it
+        // never sees an empty queue and an idle consumer while a frame is on
+        // its way to the handler
+        std::lock_guard<std::mutex> lock(mtx);
+        pFrame = pSubscription->TryPop();
+        if ( ! pFrame ) {
+            return false;
+        }
+        bBusy = true;
+    }
+    Handle(pFrame);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bBusy = false;
+    }
+    cvIdle.notify_all();
+    return true;
+}
+
+void FrameConsumer::Handle(const FramePtr &pFrame) {
+    const auto begin = std::chrono::steady_clock::now();
+    handler(pFrame);
+    const auto nElapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+    std::lock_guard<std::mutex> lock(mtx);
+    nHandlerTime += nElapsed;
+    nMaxHandlerTime = std::max(nMaxHandlerTime, nElapsed);
+}
+
+
+FrameGraph::FrameGraph(FrameQueue &queue, ThreadPool &pool)
+    : queue(queue)
+    , pool(pool)
+    , mtx()
+    , consumers()
+{}
+
+FrameGraph::~FrameGraph() {
+    RemoveAll();
+}
+
+std::shared_ptr<FrameConsumer> FrameGraph::Add(const std::string &name, FrameHandler handler, const FrameConsumerOptions &options) {
+    Remove(name);
+    FramePolicy policy = FramePolicy::Block;
+    if ( options.bMayDrop ) {
+        policy = options.bLatestOnly ? FramePolicy::KeepLatest : FramePolicy::DropOldest;
+    }
+    auto pSubscription = queue.Subscribe(name, policy, options.nCapacity);
+    std::shared_ptr<FrameConsumer> pConsumer(new FrameConsumer(std::move(pSubscription), std::move(handler), options.bSharedPool, options.thread, pool));
+    pConsumer->Start();
+    std::lock_guard<std::mutex> lock(mtx);
+    consumers.push_back(pConsumer);
+    return pConsumer;
+}
+
+bool FrameGraph::Remove(const std::string &name) {
+    std::shared_ptr<FrameConsumer> pRemoved;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        const auto it = std::find_if(consumers.begin(), consumers.end(), [&](const std::shared_ptr<FrameConsumer> &pConsumer) {
+            return pConsumer->GetName() == name;
+        });
+        if ( it == consumers.end() ) {
+            return false;
+        }
+        pRemoved = std::move(*it);
+        consumers.erase(it);
+    }
+    pRemoved->Stop();
+    return true;
+}
+
+void FrameGraph::RemoveAll() {
+    std::vector<std::shared_ptr<FrameConsumer>> removed;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        removed.swap(consumers);
+    }
+    for (const auto &pConsumer : removed) {
+        pConsumer->Stop();
+    }
+}
+
+void FrameGraph::Flush() {
+    std::vector<std::shared_ptr<FrameConsumer>> current;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        current = consumers;
+    }
+    for (const auto &pConsumer : current) {
+        pConsumer->Flush();
+    }
+}
+
+std::vector<FrameConsumerStatus> FrameGraph::GetStatus() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<FrameConsumerStatus> result;
+    result.reserve(consumers.size());
+    for (const auto &pConsumer : consumers) {
+        result.push_back(pConsumer->GetStatus());
+    }
+    return result;
+}
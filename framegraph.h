@@ -0,0 +1,121 @@
+#ifndef FRAMEGRAPH_H
+#define FRAMEGRAPH_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "framequeue.h"
+#include "threadconfig.h"
+#include "threadpool.h"
+
+
+struct FrameConsumerOptions {
+    bool bMayDrop = true;       // false: acquisition waits for the consumer
+    bool bLatestOnly = false;   // with bMayDrop: keep only the newest frame
+    std::size_t nCapacity = 4;  // queued frames
+    bool bSharedPool = false;   // run on the shared thread pool, not an own thread
+    ThreadConfig thread;        // own thread only, named "poa-<name>"
+};
+
+// the frame is shared with the other consumers, read only
+using FrameHandler = std::function<void(const FramePtr &pFrame)>;
+
+struct FrameConsumerStatus {
+    std::string name;
+    FramePolicy policy = FramePolicy::Block;
+    bool bSharedPool = false;
+    std::size_t nDepth = 0;
+    FrameConsumerCounters counters;
+    std::int64_t nHandlerTime = 0;      // us in the handler, total
+    std::int64_t nMaxHandlerTime = 0;   // us, slowest frame
+    std::string threadError;            // ThreadConfig that could not be applied
+};
+
+//
+// one registered consumer: a subscription plus whatever runs its handler
+// frames are handled one at a time and in order, either on an own thread or
+// as tasks on the shared pool (at most one in flight per consumer).
+//
+class FrameConsumer : public std::enable_shared_from_this<FrameConsumer> {
+public:
+    ~FrameConsumer();
+
+    FrameConsumer(const FrameConsumer &) = delete;
+    FrameConsumer &operator=(const FrameConsumer &) = delete;
+
+    const std::string &GetName() const;
+    FrameConsumerStatus GetStatus() const;
+    // waits until every frame queued so far has been handled
+    void Flush();
+    // unsubscribes; queued frames are released unhandled
+    void Stop();
+
+private:
+    friend class FrameGraph;
+
+    FrameConsumer(std::shared_ptr<FrameSubscription> pSubscription, FrameHandler handler, bool bSharedPool, const ThreadConfig &threadConfig, ThreadPool &pool);
+
+    // after the shared_ptr exists, the pool tasks hold a reference
+    void Start();
+    void ThreadProc();
+    void Schedule();
+    void Drain();
+    void Handle(const FramePtr &pFrame);
+    // false when the queue was empty
+    bool HandleNext(std::chrono::microseconds timeout);
+
+    std::shared_ptr<FrameSubscription> pSubscription;
+    FrameHandler handler;
+    const bool bSharedPool;
+    const ThreadConfig threadConfig;
+    ThreadPool &pool;
+    mutable std::mutex mtx;
+    std::condition_variable cvIdle;
+    bool bBusy;
+    bool bScheduled;
+    std::int64_t nHandlerTime;
+    std::int64_t nMaxHandlerTime;
+    std::string threadError;
+    std::atomic<bool> bStop;
+    std::thread thread;
+};
+
+//
+// fan-out of the captured frames to display, writer and analysis stages
+// each consumer declares whether it may drop frames: one that may not
+// (recorder) applies backpressure through a Block queue, the others never
+// slow acquisition down.
+//
+class FrameGraph {
+public:
+    explicit FrameGraph(FrameQueue &queue, ThreadPool &pool = ThreadPool::Global());
+    ~FrameGraph();
+
+    FrameGraph(const FrameGraph &) = delete;
+    FrameGraph &operator=(const FrameGraph &) = delete;
+
+    // add before the capture starts, the frame pools are sized then.
+    // a consumer with the same name is replaced.
+    std::shared_ptr<FrameConsumer> Add(const std::string &name, FrameHandler handler, const FrameConsumerOptions &options = FrameConsumerOptions());
+    bool Remove(const std::string &name);
+    void RemoveAll();
+
+    // waits for every consumer
+    void Flush();
+    std::vector<FrameConsumerStatus> GetStatus() const;
+
+private:
+    FrameQueue &queue;
+    ThreadPool &pool;
+    mutable std::mutex mtx;
+    std::vector<std::shared_ptr<FrameConsumer>> consumers;
+};
+
+#endif // FRAMEGRAPH_H
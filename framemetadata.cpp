@@ -0,0 +1,76 @@
+#include "framemetadata.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+
+std::string FormatUtc(FrameMetadata::utc_clock::time_point time) {
+    using namespace std::chrono;
+    const auto sinceEpoch = duration_cast<microseconds>(time.time_since_epoch());
+    auto nSeconds = duration_cast<seconds>(sinceEpoch).count();
+    auto nMicroSec = (sinceEpoch - seconds(nSeconds)).count();
+    if ( nMicroSec < 0 ) {
+        // before 1970
+        --nSeconds;
+        nMicroSec += 1000000;
+    }
+    const std::time_t t = static_cast<std::time_t>(nSeconds);
+    std::tm tm = {};
+#ifdef _WIN32
+    gmtime_s(&tm, &t);
+#else
+    gmtime_r(&t, &tm);
+#endif
+    // room for any int fields, so no truncation whatever gmtime returns
+    char szBuffer[80];
+    std::snprintf(szBuffer, sizeof(szBuffer), "%04d-%02d-%02dT%02d:%02d:%02d.%06ld",
+                  tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                  static_cast<long>(std::clamp<decltype(nMicroSec)>(nMicroSec, 0, 999999)));
+    return szBuffer;
+}
+
+
+ClockSync::ClockSync()
+    : mtx()
+    , monotonicBase()
+    , utcBase()
+    , uncertainty(0)
+{
+    Sync();
+}
+
+void ClockSync::Sync() {
+    using monotonic_clock = FrameMetadata::monotonic_clock;
+    using utc_clock = FrameMetadata::utc_clock;
+
+    // a preemption between the reads widens one try, not the best of five
+    auto bestWidth = monotonic_clock::duration::max();
+    monotonic_clock::time_point bestMonotonic;
+    utc_clock::time_point bestUtc;
+    for (int i = 0; i < 5; ++i) {
+        const auto before = monotonic_clock::now();
+        const auto utc = utc_clock::now();
+        const auto after = monotonic_clock::now();
+        if ( after - before < bestWidth ) {
+            bestWidth = after - before;
+            bestMonotonic = before + (after - before) / 2;
+            bestUtc = utc;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    monotonicBase = bestMonotonic;
+    utcBase = bestUtc;
+    uncertainty = std::chrono::duration_cast<std::chrono::nanoseconds>(bestWidth / 2);
+}
+
+FrameMetadata::utc_clock::time_point ClockSync::ToUtc(FrameMetadata::monotonic_clock::time_point time) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return utcBase + std::chrono::duration_cast<FrameMetadata::utc_clock::duration>(time - monotonicBase);
+}
+
+std::chrono::microseconds ClockSync::GetUncertainty() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    // round up, a sub-microsecond bracket still counts as 1 us
+    return std::chrono::duration_cast<std::chrono::microseconds>(uncertainty + std::chrono::nanoseconds(999));
+}
@@ -0,0 +1,71 @@
+#ifndef FRAMEMETADATA_H
+#define FRAMEMETADATA_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+
+
+// capture settings and timing of one frame
+// a plain value (no heap members), copied along with the frame
+struct FrameMetadata {
+    using monotonic_clock = std::chrono::steady_clock;     // CLOCK_MONOTONIC
+    using utc_clock = std::chrono::system_clock;
+
+    std::uint64_t nSequence = 0;            // frames emitted since Open(), from 1
+
+    // best estimate of the exposure window; the true instants lie within
+    // +-uncertainty of these
+    monotonic_clock::time_point exposureStart;
+    monotonic_clock::time_point exposureEnd;
+    utc_clock::time_point exposureStartUtc;
+    utc_clock::time_point exposureEndUtc;
+    std::chrono::microseconds startUncertainty{0};
+    std::chrono::microseconds endUncertainty{0};
+
+    long nExposure = 0;     // us
+    long nGain = 0;
+    long nOffset = 0;
+    int nBin = 1;           // hardware
+    int nSoftwareBinX = 1;  // on top of nBin, see SoftwareBin
+    int nSoftwareBinY = 1;
+    int nStartX = 0;        // ROI in hardware binned pixels
+    int nStartY = 0;
+    int nWidth = 0;         // as delivered, after the software bin
+    int nHeight = 0;
+    int nFormat = 0;        // POAImgFormat
+    int nBytepp = 1;
+    // RAW16 goes to the frame consumers packed 12bit (SetPackedRaw12); false
+    // where packing would lose bits, imageReady always has the 16bit samples
+    bool bPacked12 = false;
+    std::optional<double> temperature;  // C, last telemetry poll
+};
+
+// "2026-10-18T21:04:05.123456" (UTC, microseconds), as FITS DATE-OBS
+std::string FormatUtc(FrameMetadata::utc_clock::time_point time);
+
+//
+// maps monotonic timestamps to UTC
+// Sync() reads the UTC clock between two monotonic reads and keeps the
+// tightest of a few tries; the offset error is half that bracket. mapping is
+// then an addition, so per frame it costs no clock read. resync at capture
+// start to follow NTP adjustments.
+//
+class ClockSync {
+public:
+    ClockSync();
+
+    void Sync();
+    FrameMetadata::utc_clock::time_point ToUtc(FrameMetadata::monotonic_clock::time_point time) const;
+    std::chrono::microseconds GetUncertainty() const;
+
+private:
+    mutable std::mutex mtx;
+    FrameMetadata::monotonic_clock::time_point monotonicBase;
+    FrameMetadata::utc_clock::time_point utcBase;
+    std::chrono::nanoseconds uncertainty;
+};
+
+#endif // FRAMEMETADATA_H
@@ -0,0 +1,170 @@
+#include "framepool.h"
+
+#include <algorithm>
+
+#include "threadconfig.h"
+
+
+FrameBufferPool::FrameBufferPool()
+    : m_pState(std::make_shared<State>())
+    , m_pBlocks(std::make_shared<BlockPool>())
+{}
+
+void FrameBufferPool::Reserve(std::size_t nCount, std::size_t nSize) {
+    std::lock_guard<std::mutex> lock(m_pState->mtx);
+    auto &freeBuffers = m_pState->freeBuffers;
+    for (auto &pBuffer : freeBuffers) {
+        if ( pBuffer->capacity() < nSize ) {
+            ForgetStorage(*m_pState, *pBuffer);
+            // nothing to keep: a fresh vector, not a copy into a larger block
+            pBuffer = std::make_unique<Buffer>(FrameAllocator<unsigned char>(m_pState->memory));
+            pBuffer->reserve(nSize);
+            ++m_pState->nAllocations;
+        }
+    }
+    while ( freeBuffers.size() < nCount ) {
+        auto pBuffer = std::make_unique<Buffer>(FrameAllocator<unsigned char>(m_pState->memory));
+        pBuffer->reserve(nSize);
+        freeBuffers.push_back(std::move(pBuffer));
+        ++m_pState->nAllocations;
+    }
+    if ( m_pState->bLocked ) {
+        for (const auto &pBuffer : freeBuffers) {
+            LockStorage(*m_pState, *pBuffer);
+        }
+    }
+}
+
+std::shared_ptr<FrameBufferPool::Buffer> FrameBufferPool::Acquire(std::size_t nSize) {
+    std::unique_ptr<Buffer> pBuffer;
+    FrameMemory memory;
+    {
+        std::lock_guard<std::mutex> lock(m_pState->mtx);
+        memory = m_pState->memory;
+        auto &freeBuffers = m_pState->freeBuffers;
+        // prefer a buffer that fits
+        auto it = std::find_if(freeBuffers.begin(), freeBuffers.end(), [nSize](const std::unique_ptr<Buffer> &p) {
+            return p->capacity() >= nSize;
+        });
+        if ( it == freeBuffers.end() && ! freeBuffers.empty() ) {
+            it = freeBuffers.begin();
+        }
+        if ( it != freeBuffers.end() ) {
+            pBuffer = std::move(*it);
+            freeBuffers.erase(it);
+        }
+        if ( ! pBuffer || pBuffer->capacity() < nSize ) {
+            ++m_pState->nAllocations;
+        }
+    }
+    if ( ! pBuffer ) {
+        pBuffer = std::make_unique<Buffer>(FrameAllocator<unsigned char>(memory));
+    }
+    const bool bGrow = pBuffer->capacity() < nSize;
+    if ( bGrow ) {
+        if ( m_pState->bLocked ) {
+            std::lock_guard<std::mutex> lock(m_pState->mtx);
+            ForgetStorage(*m_pState, *pBuffer);
+        }
+        // a fresh vector instead of resize(), which would copy the old frame
+        // into the new block; it also takes the current memory options
+        pBuffer = std::make_unique<Buffer>(FrameAllocator<unsigned char>(memory));
+    }
+    pBuffer->resize(nSize);
+    if ( bGrow && m_pState->bLocked ) {
+        std::lock_guard<std::mutex> lock(m_pState->mtx);
+        LockStorage(*m_pState, *pBuffer);
+    }
+
+    std::weak_ptr<State> pWeakState = m_pState;
+    return std::shared_ptr<Buffer>(pBuffer.release(), [pWeakState](Buffer *p) {
+        std::unique_ptr<Buffer> pReturned(p);
+        if ( auto pState = pWeakState.lock() ) {
+            std::lock_guard<std::mutex> lock(pState->mtx);
+            if ( pReturned->get_allocator().GetMemory() != pState->memory ) {
+                // allocated under options changed since
+                ForgetStorage(*pState, *pReturned);
+                return;
+            }
+            pState->freeBuffers.push_back(std::move(pReturned));
+        }
+    }, BlockAllocator<Buffer>(m_pBlocks));
+}
+
+void FrameBufferPool::SetMemory(const FrameMemory &memory) {
+    std::vector<std::unique_ptr<Buffer>> dropped;
+    std::lock_guard<std::mutex> lock(m_pState->mtx);
+    if ( memory == m_pState->memory ) {
+        return;
+    }
+    m_pState->memory = memory;
+    for (const auto &pBuffer : m_pState->freeBuffers) {
+        ForgetStorage(*m_pState, *pBuffer);
+    }
+    dropped.swap(m_pState->freeBuffers);
+}
+
+FrameMemory FrameBufferPool::GetMemory() const {
+    std::lock_guard<std::mutex> lock(m_pState->mtx);
+    return m_pState->memory;
+}
+
+bool FrameBufferPool::SetLocked(bool bLock, std::string &error) {
+    std::lock_guard<std::mutex> lock(m_pState->mtx);
+    m_pState->bLocked = bLock;
+    m_pState->lockError.clear();
+    if ( ! bLock ) {
+        for (const auto &entry : m_pState->locked) {
+            UnlockMemory(entry.first, entry.second);
+        }
+        m_pState->locked.clear();
+        return true;
+    }
+    // buffers in flight are locked when they grow or by the next Reserve()
+    bool bOk = true;
+    for (const auto &pBuffer : m_pState->freeBuffers) {
+        bOk = LockStorage(*m_pState, *pBuffer) && bOk;
+    }
+    error = m_pState->lockError;
+    return bOk;
+}
+
+bool FrameBufferPool::IsLocked() const {
+    return m_pState->bLocked;
+}
+
+bool FrameBufferPool::LockStorage(State &state, const Buffer &buffer) {
+    if ( buffer.capacity() == 0 ) {
+        return true;
+    }
+    auto &nLocked = state.locked[buffer.data()];
+    if ( nLocked >= buffer.capacity() ) {
+        return true;
+    }
+    std::string error;
+    if ( ! LockMemory(buffer.data(), buffer.capacity(), error) ) {
+        state.locked.erase(buffer.data());
+        state.lockError = error;
+        return false;
+    }
+    nLocked = buffer.capacity();
+    return true;
+}
+
+void FrameBufferPool::ForgetStorage(State &state, const Buffer &buffer) {
+    const auto it = state.locked.find(buffer.data());
+    if ( it != state.locked.end() ) {
+        UnlockMemory(it->first, it->second);
+        state.locked.erase(it);
+    }
+}
+
+std::size_t FrameBufferPool::GetFreeCount() const {
+    std::lock_guard<std::mutex> lock(m_pState->mtx);
+    return m_pState->freeBuffers.size();
+}
+
+std::size_t FrameBufferPool::GetAllocationCount() const {
+    std::lock_guard<std::mutex> lock(m_pState->mtx);
+    return m_pState->nAllocations;
+}
@@ -0,0 +1,71 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "blockpool.h"
+#include "framebuffer.h"
+
+
+//
+// reusable download buffers
+// Acquire() hands out a buffer that goes back to the pool when the last
+// shared_ptr is released. a buffer whose capacity already fits the requested
+// size is resized in place, so shrinking or moving the ROI never reallocates.
+// storage comes from a FrameAllocator: aligned for the SIMD kernels and,
+// with huge pages, prefault and SetLocked(), never faulting in a download.
+//
+class FrameBufferPool {
+public:
+    using Buffer = FrameBuffer;
+
+    FrameBufferPool();
+
+    // preallocate nCount buffers of nSize bytes
+    void Reserve(std::size_t nCount, std::size_t nSize);
+    std::shared_ptr<Buffer> Acquire(std::size_t nSize);
+
+    // mlock the storage of every buffer, now and as buffers are created or
+    // grow. false with the reason (RLIMIT_MEMLOCK) if a buffer could not be
+    // locked; the others stay locked.
+    bool SetLocked(bool bLock, std::string &error);
+    bool IsLocked() const;
+
+    // alignment, huge pages and prefault of buffers created from now on; the
+    // free buffers are dropped, buffers in flight are dropped on return
+    void SetMemory(const FrameMemory &memory);
+    FrameMemory GetMemory() const;
+
+    std::size_t GetFreeCount() const;
+    // buffers created or grown since construction
+    std::size_t GetAllocationCount() const;
+
+private:
+    struct State {
+        mutable std::mutex mtx;
+        std::vector<std::unique_ptr<Buffer>> freeBuffers;
+        std::size_t nAllocations = 0;
+        std::atomic<bool> bLocked{false};
+        // storage -> locked bytes
+        std::unordered_map<const void *, std::size_t> locked;
+        std::string lockError;
+        FrameMemory memory;
+    };
+
+    // with the state mutex held
+    static bool LockStorage(State &state, const Buffer &buffer);
+    static void ForgetStorage(State &state, const Buffer &buffer);
+
+    // shared with in-flight buffers so they can outlive the pool
+    std::shared_ptr<State> m_pState;
+    // control blocks of the buffers handed out
+    std::shared_ptr<BlockPool> m_pBlocks;
+};
+
+#endif // FRAMEPOOL_H
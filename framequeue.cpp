@@ -0,0 +1,261 @@
+#include "framequeue.h"
+
+#include <algorithm>
+
+#include "packed12.h"
+
+
+const FrameBuffer &CapturedFrame::GetSamples(FrameBuffer &scratch) const {
+    if ( ! bPacked12 ) {
+        return *pBuffer;
+    }
+    UnpackFrame12(*pBuffer, static_cast<std::size_t>(nWidth) * nHeight, scratch);
+    return scratch;
+}
+
+FrameSubscription::FrameSubscription(std::string name, FramePolicy policy, std::size_t nCapacity)
+    : name(std::move(name))
+    , policy(policy)
+    , nCapacity(policy == FramePolicy::KeepLatest ? 1 : std::max<std::size_t>(nCapacity, 1))
+    , mtx()
+    , cvFrame()
+    , cvRoom()
+    , ring(this->nCapacity)
+    , nHead(0)
+    , nCount(0)
+    , bClosed(false)
+    , counters()
+    , notify()
+{}
+
+FrameSubscription::~FrameSubscription() {
+    Close();
+}
+
+FramePtr FrameSubscription::Pop(std::chrono::microseconds timeout) {
+    std::unique_lock<std::mutex> lock(mtx);
+    if ( ! cvFrame.wait_for(lock, timeout, [this]() { return nCount > 0 || bClosed; }) || nCount == 0 ) {
+        return nullptr;
+    }
+    auto pFrame = std::move(ring[nHead]);
+    nHead = (nHead + 1) % nCapacity;
+    --nCount;
+    ++counters.nConsumed;
+    lock.unlock();
+    cvRoom.notify_one();
+    return pFrame;
+}
+
+FramePtr FrameSubscription::TryPop() {
+    return Pop(std::chrono::microseconds(0));
+}
+
+bool FrameSubscription::Wait(std::chrono::microseconds timeout) {
+    std::unique_lock<std::mutex> lock(mtx);
+    return cvFrame.wait_for(lock, timeout, [this]() { return nCount > 0 || bClosed; });
+}
+
+void FrameSubscription::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bClosed = true;
+    }
+    cvFrame.notify_all();
+    cvRoom.notify_all();
+}
+
+bool FrameSubscription::IsClosed() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return bClosed;
+}
+
+void FrameSubscription::SetNotify(std::function<void()> notify) {
+    std::lock_guard<std::mutex> lock(mtx);
+    this->notify = std::move(notify);
+}
+
+const std::string &FrameSubscription::GetName() const {
+    return name;
+}
+FramePolicy FrameSubscription::GetPolicy() const {
+    return policy;
+}
+std::size_t FrameSubscription::GetCapacity() const {
+    return nCapacity;
+}
+std::size_t FrameSubscription::GetDepth() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return nCount;
+}
+FrameConsumerCounters FrameSubscription::GetCounters() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return counters;
+}
+
+bool FrameSubscription::Push(const FramePtr &pFrame, const std::atomic<bool> &bInterrupted) {
+    // a dropped frame goes back to the pool after the unlock
+    FramePtr pDropped;
+    std::unique_lock<std::mutex> lock(mtx);
+    if ( bClosed ) {
+        return false;
+    }
+    if ( nCount == nCapacity ) {
+        switch (policy) {
+        case FramePolicy::Block: {
+            const auto begin = std::chrono::steady_clock::now();
+            ++counters.nBlocked;
+            cvRoom.wait(lock, [&]() { return nCount < nCapacity || bClosed || bInterrupted; });
+            counters.nBlockedTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+            if ( bClosed ) {
+                return false;
+            }
+            if ( nCount == nCapacity ) {
+                ++counters.nDropped;
+                return false;
+            }
+            break;
+        }
+        case FramePolicy::DropOldest:
+        case FramePolicy::KeepLatest: {
+            pDropped = std::move(ring[nHead]);
+            nHead = (nHead + 1) % nCapacity;
+            --nCount;
+            ++counters.nDropped;
+            break;
+        }
+        case FramePolicy::DropNewest:
+            ++counters.nDropped;
+            return false;
+        }
+    }
+    ring[(nHead + nCount) % nCapacity] = pFrame;
+    ++nCount;
+    ++counters.nReceived;
+    counters.nMaxDepth = std::max(counters.nMaxDepth, nCount);
+    const auto notifyConsumer = notify;
+    lock.unlock();
+    cvFrame.notify_one();
+    if ( notifyConsumer ) {
+        notifyConsumer();
+    }
+    return true;
+}
+
+void FrameSubscription::Wake() {
+    {
+        // pairs with the predicate check under the lock in Push()
+        std::lock_guard<std::mutex> lock(mtx);
+    }
+    cvRoom.notify_all();
+}
+
+
+FrameQueue::FrameQueue()
+    : mtxSubscribers()
+    , pSubscribers(std::make_shared<const Subscribers>())
+    , pFreeList(std::make_shared<FreeList>())
+    , pBlocks(std::make_shared<BlockPool>())
+    , nPublished(0)
+    , bInterrupted(false)
+{}
+
+std::shared_ptr<FrameSubscription> FrameQueue::Subscribe(const std::string &name, FramePolicy policy, std::size_t nCapacity) {
+    std::shared_ptr<FrameSubscription> pSubscription(new FrameSubscription(name, policy, nCapacity));
+    std::lock_guard<std::mutex> lock(mtxSubscribers);
+    auto pNext = std::make_shared<Subscribers>();
+    for (const auto &pWeak : *std::atomic_load(&pSubscribers)) {
+        if ( ! pWeak.expired() ) {
+            pNext->push_back(pWeak);
+        }
+    }
+    pNext->push_back(pSubscription);
+    std::atomic_store(&pSubscribers, std::shared_ptr<const Subscribers>(std::move(pNext)));
+    return pSubscription;
+}
+
+std::size_t FrameQueue::GetSubscriberCount() const {
+    const auto pCurrent = std::atomic_load(&pSubscribers);
+    return std::count_if(pCurrent->begin(), pCurrent->end(), [](const std::weak_ptr<FrameSubscription> &pWeak) {
+        const auto pSubscription = pWeak.lock();
+        return pSubscription && ! pSubscription->IsClosed();
+    });
+}
+
+std::size_t FrameQueue::GetFrameBudget() const {
+    std::size_t nBudget = 1;
+    for (const auto &pWeak : *std::atomic_load(&pSubscribers)) {
+        if ( const auto pSubscription = pWeak.lock() ) {
+            nBudget += pSubscription->GetCapacity() + 1;
+        }
+    }
+    return nBudget;
+}
+
+void FrameQueue::Reserve(std::size_t nCount) {
+    std::lock_guard<std::mutex> lock(pFreeList->mtx);
+    auto &items = pFreeList->items;
+    // records in flight are not counted, a few spare ones are harmless
+    while ( items.size() < nCount ) {
+        items.push_back(std::make_unique<CapturedFrame>());
+        ++pFreeList->nAllocations;
+    }
+}
+
+std::shared_ptr<CapturedFrame> FrameQueue::Acquire() {
+    std::unique_ptr<CapturedFrame> pFrame;
+    {
+        std::lock_guard<std::mutex> lock(pFreeList->mtx);
+        if ( ! pFreeList->items.empty() ) {
+            pFrame = std::move(pFreeList->items.back());
+            pFreeList->items.pop_back();
+        } else {
+            ++pFreeList->nAllocations;
+        }
+    }
+    if ( ! pFrame ) {
+        pFrame = std::make_unique<CapturedFrame>();
+    }
+
+    std::weak_ptr<FreeList> pWeakFreeList = pFreeList;
+    return std::shared_ptr<CapturedFrame>(pFrame.release(), [pWeakFreeList](CapturedFrame *p) {
+        std::unique_ptr<CapturedFrame> pReturned(p);
+        // the buffer and stats go back to their own pools now
+        pReturned->pBuffer.reset();
+        pReturned->pStats.reset();
+        if ( auto pFreeList = pWeakFreeList.lock() ) {
+            std::lock_guard<std::mutex> lock(pFreeList->mtx);
+            pFreeList->items.push_back(std::move(pReturned));
+        }
+    }, BlockAllocator<CapturedFrame>(pBlocks));
+}
+
+void FrameQueue::Publish(const FramePtr &pFrame) {
+    ++nPublished;
+    const auto pCurrent = std::atomic_load(&pSubscribers);
+    for (const auto &pWeak : *pCurrent) {
+        if ( const auto pSubscription = pWeak.lock() ) {
+            pSubscription->Push(pFrame, bInterrupted);
+        }
+    }
+}
+
+void FrameQueue::Interrupt() {
+    bInterrupted = true;
+    for (const auto &pWeak : *std::atomic_load(&pSubscribers)) {
+        if ( const auto pSubscription = pWeak.lock() ) {
+            pSubscription->Wake();
+        }
+    }
+}
+void FrameQueue::Resume() {
+    bInterrupted = false;
+}
+
+std::uint64_t FrameQueue::GetPublishedCount() const {
+    return nPublished;
+}
+
+std::size_t FrameQueue::GetAllocationCount() const {
+    std::lock_guard<std::mutex> lock(pFreeList->mtx);
+    return pFreeList->nAllocations;
+}
@@ -0,0 +1,163 @@
+#ifndef FRAMEQUEUE_H
+#define FRAMEQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "blockpool.h"
+#include "framemetadata.h"
+#include "framepool.h"
+#include "framestats.h"
+#include "latencystats.h"
+
+
+// one downloaded frame as handed to the consumers, never copied
+struct CapturedFrame {
+    int nWidth = 0;
+    int nHeight = 0;
+    int nBytepp = 1;
+    std::shared_ptr<FrameBufferPool::Buffer> pBuffer;
+    bool bPacked12 = false;     // RAW16 held as packed 12bit (see Pack12)
+    FrameTimestamps timestamps;
+    FrameMetadata metadata;
+    std::shared_ptr<const FrameStats> pStats;   // null unless enabled
+
+    // the samples in the nBytepp format: *pBuffer, or unpacked into scratch
+    const FrameBuffer &GetSamples(FrameBuffer &scratch) const;
+};
+using FramePtr = std::shared_ptr<const CapturedFrame>;
+
+enum class FramePolicy {
+    Block,          // the producer waits for room (recorder, never loses a frame)
+    DropOldest,     // the oldest queued frame makes room
+    DropNewest,     // a full queue rejects the new frame
+    KeepLatest,     // only the newest frame is kept (display)
+};
+
+struct FrameConsumerCounters {
+    std::uint64_t nReceived = 0;    // queued for the consumer
+    std::uint64_t nConsumed = 0;    // taken by Pop()
+    std::uint64_t nDropped = 0;     // lost by the policy (or an interrupted block)
+    std::uint64_t nBlocked = 0;     // publishes that had to wait
+    std::int64_t nBlockedTime = 0;  // us the producer waited in total
+    std::size_t nMaxDepth = 0;      // highest queue depth seen
+};
+
+class FrameQueue;
+
+//
+// the queue of one consumer, a fixed ring of nCapacity frames
+// Pop() from one consumer thread; closing (or releasing the handle)
+// unsubscribes and releases a producer blocked on it.
+//
+class FrameSubscription {
+public:
+    ~FrameSubscription();
+
+    FrameSubscription(const FrameSubscription &) = delete;
+    FrameSubscription &operator=(const FrameSubscription &) = delete;
+
+    // null on timeout or when closed and drained
+    FramePtr Pop(std::chrono::microseconds timeout);
+    FramePtr TryPop();
+    // until a frame is queued or the subscription closed, false on timeout
+    bool Wait(std::chrono::microseconds timeout);
+    void Close();
+    bool IsClosed() const;
+    // called on the producer thread after a frame was queued, for consumers
+    // without a thread of their own
+    void SetNotify(std::function<void()> notify);
+
+    const std::string &GetName() const;
+    FramePolicy GetPolicy() const;
+    std::size_t GetCapacity() const;
+    std::size_t GetDepth() const;
+    FrameConsumerCounters GetCounters() const;
+
+private:
+    friend class FrameQueue;
+
+    FrameSubscription(std::string name, FramePolicy policy, std::size_t nCapacity);
+
+    // producer side, false if the frame was dropped
+    bool Push(const FramePtr &pFrame, const std::atomic<bool> &bInterrupted);
+    void Wake();
+
+    const std::string name;
+    const FramePolicy policy;
+    const std::size_t nCapacity;
+    mutable std::mutex mtx;
+    std::condition_variable cvFrame;
+    std::condition_variable cvRoom;
+    std::vector<FramePtr> ring;
+    std::size_t nHead;
+    std::size_t nCount;
+    bool bClosed;
+    FrameConsumerCounters counters;
+    std::function<void()> notify;
+};
+
+//
+// bounded single producer / multiple consumer frame fan-out
+// every subscription gets every frame under its own policy, so a slow
+// KeepLatest display never holds up a Block recorder. frames come from a
+// preallocated pool sized to what the subscriptions can hold; memory stays
+// fixed however far the consumers fall behind.
+//
+class FrameQueue {
+public:
+    FrameQueue();
+
+    FrameQueue(const FrameQueue &) = delete;
+    FrameQueue &operator=(const FrameQueue &) = delete;
+
+    // KeepLatest always has a capacity of 1
+    std::shared_ptr<FrameSubscription> Subscribe(const std::string &name, FramePolicy policy, std::size_t nCapacity = 4);
+    std::size_t GetSubscriberCount() const;
+
+    // frames that can be alive at once: one being filled, the queued ones
+    // and one in the hands of each consumer
+    std::size_t GetFrameBudget() const;
+    // preallocate the frame records (buffers come from a FrameBufferPool)
+    void Reserve(std::size_t nCount);
+
+    // producer side: a recycled record, then Publish() it
+    std::shared_ptr<CapturedFrame> Acquire();
+    void Publish(const FramePtr &pFrame);
+
+    // releases a producer blocked on a full Block queue (the frame counts
+    // as dropped) until Resume(); for abort/stop
+    void Interrupt();
+    void Resume();
+
+    std::uint64_t GetPublishedCount() const;
+    // records created since construction
+    std::size_t GetAllocationCount() const;
+
+private:
+    using Subscribers = std::vector<std::weak_ptr<FrameSubscription>>;
+
+    struct FreeList {
+        std::mutex mtx;
+        std::vector<std::unique_ptr<CapturedFrame>> items;
+        std::size_t nAllocations = 0;
+    };
+
+    std::mutex mtxSubscribers;
+    // std::atomic_load / std::atomic_store only, rebuilt on subscribe
+    std::shared_ptr<const Subscribers> pSubscribers;
+    std::shared_ptr<FreeList> pFreeList;
+    // control blocks of the records handed out
+    std::shared_ptr<BlockPool> pBlocks;
+    std::atomic<std::uint64_t> nPublished;
+    std::atomic<bool> bInterrupted;
+};
+
+#endif // FRAMEQUEUE_H
@@ -0,0 +1,272 @@
+#include "framereader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+
+#include "ricecodec.h"
+#include "threadpool.h"
+
+
+namespace {
+
+using FitsKeys = std::map<std::string, std::string>;
+
+std::string Trim(const std::string &s) {
+    const auto first = s.find_first_not_of(' ');
+    if ( first == std::string::npos ) {
+        return std::string();
+    }
+    return s.substr(first, s.find_last_not_of(' ') - first + 1);
+}
+
+// one header starting at nPos, nPos ends up at the data
+bool ParseHeader(const std::vector<unsigned char> &file, std::size_t &nPos, FitsKeys &keys) {
+    keys.clear();
+    while ( nPos + 2880 <= file.size() ) {
+        const auto pBlock = reinterpret_cast<const char *>(file.data() + nPos);
+        nPos += 2880;
+        for (int i = 0; i < 36; ++i) {
+            const std::string card(pBlock + i * 80, 80);
+            const auto key = Trim(card.substr(0, 8));
+            if ( key == "END" ) {
+                return true;
+            }
+            if ( card.compare(8, 2, "= ") != 0 ) {
+                continue;
+            }
+            auto value = Trim(card.substr(10));
+            if ( ! value.empty() && value[0] == '\'' ) {
+                const auto end = value.find('\'', 1);
+                value = Trim(value.substr(1, end == std::string::npos ? std::string::npos : end - 1));
+            } else {
+                value = Trim(value.substr(0, value.find('/')));
+            }
+            keys[key] = value;
+        }
+    }
+    return false;
+}
+
+long long GetInt(const FitsKeys &keys, const std::string &key, long long nDefault) {
+    const auto it = keys.find(key);
+    return it == keys.end() ? nDefault : std::strtoll(it->second.c_str(), nullptr, 10);
+}
+
+std::string GetString(const FitsKeys &keys, const std::string &key) {
+    const auto it = keys.find(key);
+    return it == keys.end() ? std::string() : it->second;
+}
+
+// bytes of the data unit including the padding
+std::size_t DataSize(const FitsKeys &keys) {
+    const auto nAxis = GetInt(keys, "NAXIS", 0);
+    if ( nAxis == 0 ) {
+        return 0;
+    }
+    long long nElements = 1;
+    for (int i = 1; i <= nAxis; ++i) {
+        nElements *= GetInt(keys, "NAXIS" + std::to_string(i), 0);
+    }
+    const auto nBytes = std::llabs(GetInt(keys, "BITPIX", 8)) / 8 * GetInt(keys, "GCOUNT", 1) * (GetInt(keys, "PCOUNT", 0) + nElements);
+    return static_cast<std::size_t>((nBytes + 2879) / 2880 * 2880);
+}
+
+struct ImageShape {
+    int nBitpix;
+    int nWidth;
+    int nHeight;
+    int nPlanes;
+};
+
+// prefix "Z" for the image inside a compressed table
+bool GetShape(const FitsKeys &keys, const std::string &prefix, ImageShape &shape) {
+    shape.nBitpix = static_cast<int>(GetInt(keys, prefix + "BITPIX", 0));
+    const auto nAxis = GetInt(keys, prefix + "NAXIS", 0);
+    shape.nWidth = static_cast<int>(GetInt(keys, prefix + "NAXIS1", 0));
+    shape.nHeight = static_cast<int>(GetInt(keys, prefix + "NAXIS2", 0));
+    shape.nPlanes = nAxis == 3 ? static_cast<int>(GetInt(keys, prefix + "NAXIS3", 0)) : 1;
+    if ( nAxis != 2 && nAxis != 3 ) {
+        return false;
+    }
+    if ( shape.nWidth <= 0 || shape.nHeight <= 0 ) {
+        return false;
+    }
+    // RGB24 is the only format with planes, always 8bit
+    if ( shape.nBitpix == 16 ) {
+        return shape.nPlanes == 1;
+    }
+    return shape.nBitpix == 8 && (shape.nPlanes == 1 || shape.nPlanes == 3);
+}
+
+void Allocate(const ImageShape &shape, int &nWidth, int &nHeight, int &nBytepp, FrameBuffer &buffer) {
+    nWidth = shape.nWidth;
+    nHeight = shape.nHeight;
+    nBytepp = shape.nBitpix == 16 ? 2 : shape.nPlanes;
+    buffer.resize(static_cast<std::size_t>(nWidth) * nHeight * nBytepp);
+}
+
+bool ReadImage(const std::vector<unsigned char> &file, std::size_t nPos, const FitsKeys &keys,
+               int &nWidth, int &nHeight, int &nBytepp, FrameBuffer &buffer) {
+    ImageShape shape;
+    if ( ! GetShape(keys, "", shape) ) {
+        return false;
+    }
+    const auto nPixels = static_cast<std::size_t>(shape.nWidth) * shape.nHeight;
+    if ( nPos + nPixels * shape.nPlanes * (shape.nBitpix / 8) > file.size() ) {
+        return false;
+    }
+    Allocate(shape, nWidth, nHeight, nBytepp, buffer);
+    const auto pData = file.data() + nPos;
+    if ( shape.nBitpix == 16 ) {
+        // big endian signed, BZERO 32768 for unsigned
+        const auto nZero = GetInt(keys, "BZERO", 0);
+        const auto nScale = GetInt(keys, "BSCALE", 1);
+        const auto pOut = reinterpret_cast<std::uint16_t *>(buffer.data());
+        for (std::size_t i = 0; i < nPixels; ++i) {
+            const auto nValue = static_cast<std::int16_t>((pData[i * 2] << 8) | pData[i * 2 + 1]);
+            pOut[i] = static_cast<std::uint16_t>(nValue * nScale + nZero);
+        }
+    } else if ( shape.nPlanes == 3 ) {
+        // R, G, B planes -> BGR interleaved
+        for (std::size_t i = 0; i < nPixels; ++i) {
+            buffer[i * 3 + 2] = pData[i];
+            buffer[i * 3 + 1] = pData[nPixels + i];
+            buffer[i * 3 + 0] = pData[nPixels * 2 + i];
+        }
+    } else {
+        std::copy(pData, pData + nPixels, buffer.begin());
+    }
+    return true;
+}
+
+bool ReadCompressed(const std::vector<unsigned char> &file, std::size_t nPos, const FitsKeys &keys,
+                    int &nWidth, int &nHeight, int &nBytepp, FrameBuffer &buffer) {
+    ImageShape shape;
+    if ( ! GetShape(keys, "Z", shape) ) {
+        return false;
+    }
+    if ( GetString(keys, "ZCMPTYPE") != "RICE_1" || GetString(keys, "TTYPE1") != "COMPRESSED_DATA" ) {
+        return false;
+    }
+    int nBlockSize = RiceCodec::DefaultBlockSize;
+    int nBytePix = 4;
+    for (int i = 1; keys.count("ZNAME" + std::to_string(i)); ++i) {
+        const auto name = GetString(keys, "ZNAME" + std::to_string(i));
+        const auto nValue = static_cast<int>(GetInt(keys, "ZVAL" + std::to_string(i), 0));
+        if ( name == "BLOCKSIZE" ) {
+            nBlockSize = nValue;
+        } else if ( name == "BYTEPIX" ) {
+            nBytePix = nValue;
+        }
+    }
+    // full row tiles only, as written by FrameWriter and fpack
+    const auto nTileRows = static_cast<int>(GetInt(keys, "ZTILE2", 1));
+    if ( nBytePix != shape.nBitpix / 8 || nBlockSize <= 0 || nTileRows <= 0
+         || GetInt(keys, "ZTILE1", shape.nWidth) != shape.nWidth || GetInt(keys, "ZTILE3", 1) != 1 ) {
+        return false;
+    }
+
+    // descriptors: 1P (32bit) or 1Q (64bit) pairs of (size, heap offset)
+    const auto form = GetString(keys, "TFORM1");
+    const auto nDescriptor = form.find('Q') != std::string::npos ? 16 : (form.find('P') != std::string::npos ? 8 : 0);
+    const auto nRowBytes = static_cast<std::size_t>(GetInt(keys, "NAXIS1", 0));
+    const auto nTiles = static_cast<std::size_t>(GetInt(keys, "NAXIS2", 0));
+    const auto nTilesPerPlane = static_cast<std::size_t>((shape.nHeight + nTileRows - 1) / nTileRows);
+    if ( nDescriptor == 0 || nRowBytes < static_cast<std::size_t>(nDescriptor) || nTiles != nTilesPerPlane * shape.nPlanes ) {
+        return false;
+    }
+    const auto nHeap = nPos + static_cast<std::size_t>(GetInt(keys, "THEAP", static_cast<long long>(nRowBytes * nTiles)));
+    const auto nHeapEnd = nHeap + static_cast<std::size_t>(GetInt(keys, "PCOUNT", 0));
+    if ( nPos + nRowBytes * nTiles > file.size() || nHeapEnd > file.size() ) {
+        return false;
+    }
+
+    // the codec output is the stored value + 32768; physical = stored * BSCALE + BZERO
+    const auto nZero = GetInt(keys, "BZERO", 0);
+    const auto nScale = GetInt(keys, "BSCALE", 1);
+    const bool bRescale = shape.nBitpix == 16 && (nZero != 32768 || nScale != 1);
+
+    Allocate(shape, nWidth, nHeight, nBytepp, buffer);
+    std::atomic<bool> bOk(true);
+    ThreadPool::Global().ParallelFor(nTiles, [&](std::size_t nFirst, std::size_t nLast) {
+        std::vector<std::uint8_t> plane;
+        for (std::size_t t = nFirst; t < nLast && bOk; ++t) {
+            const auto pEntry = file.data() + nPos + t * nRowBytes;
+            std::uint64_t nSize = 0;
+            std::uint64_t nOffset = 0;
+            const int nHalf = nDescriptor / 2;
+            for (int i = 0; i < nHalf; ++i) {
+                nSize = (nSize << 8) | pEntry[i];
+                nOffset = (nOffset << 8) | pEntry[nHalf + i];
+            }
+            if ( nHeap + nOffset + nSize > nHeapEnd ) {
+                bOk = false;
+                break;
+            }
+            const auto pTile = file.data() + nHeap + nOffset;
+            const auto nChannel = t / nTilesPerPlane;
+            const auto nRow = (t % nTilesPerPlane) * nTileRows;
+            const auto nCount = std::min<std::size_t>(nTileRows, shape.nHeight - nRow) * shape.nWidth;
+            bool bTile;
+            if ( shape.nBitpix == 16 ) {
+                const auto pOut = reinterpret_cast<std::uint16_t *>(buffer.data()) + nRow * shape.nWidth;
+                bTile = RiceCodec::Decompress16(pTile, nSize, pOut, nCount, nBlockSize);
+                if ( bRescale ) {
+                    for (std::size_t i = 0; i < nCount; ++i) {
+                        const auto nStored = static_cast<std::int16_t>(pOut[i] ^ 0x8000);
+                        pOut[i] = static_cast<std::uint16_t>(nStored * nScale + nZero);
+                    }
+                }
+            } else if ( shape.nPlanes == 3 ) {
+                // plane rows -> BGR interleaved
+                plane.resize(nCount);
+                bTile = RiceCodec::Decompress8(pTile, nSize, plane.data(), nCount, nBlockSize);
+                const auto pOut = buffer.data() + nRow * shape.nWidth * 3 + (2 - nChannel);
+                for (std::size_t i = 0; i < nCount; ++i) {
+                    pOut[i * 3] = plane[i];
+                }
+            } else {
+                bTile = RiceCodec::Decompress8(pTile, nSize, buffer.data() + nRow * shape.nWidth, nCount, nBlockSize);
+            }
+            if ( ! bTile ) {
+                bOk = false;
+            }
+        }
+    }, 8);
+    return bOk;
+}
+
+}  // namespace
+
+
+bool FrameReader::Read(const std::string &path, int &nWidth, int &nHeight, int &nBytepp, FrameBuffer &buffer) {
+    std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+    if ( ! ifs ) {
+        return false;
+    }
+    std::vector<unsigned char> file(static_cast<std::size_t>(ifs.tellg()));
+    ifs.seekg(0);
+    ifs.read(reinterpret_cast<char *>(file.data()), file.size());
+    if ( ! ifs ) {
+        return false;
+    }
+
+    // first HDU with an image, plain or compressed
+    std::size_t nPos = 0;
+    FitsKeys keys;
+    while ( ParseHeader(file, nPos, keys) ) {
+        if ( GetString(keys, "ZIMAGE") == "T" ) {
+            return ReadCompressed(file, nPos, keys, nWidth, nHeight, nBytepp, buffer);
+        }
+        const auto extension = GetString(keys, "XTENSION");
+        if ( GetInt(keys, "NAXIS", 0) >= 2 && (extension.empty() || extension == "IMAGE") ) {
+            return ReadImage(file, nPos, keys, nWidth, nHeight, nBytepp, buffer);
+        }
+        nPos += DataSize(keys);
+    }
+    return false;
+}
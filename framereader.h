@@ -0,0 +1,21 @@
+#ifndef FRAMEREADER_H
+#define FRAMEREADER_H
+
+#include <string>
+#include <vector>
+
+#include "framebuffer.h"
+
+
+//
+// reads frames written by FrameWriter back into the download layout:
+// RAW8/MONO8 bytes, RAW16 little endian, RGB24 interleaved BGR.
+// plain FITS (BITPIX 8/16) and RICE_1 tile compressed FITS (.fz) with
+// full row tiles; compressed tiles are decoded in parallel.
+//
+class FrameReader {
+public:
+    static bool Read(const std::string &path, int &nWidth, int &nHeight, int &nBytepp, FrameBuffer &buffer);
+};
+
+#endif // FRAMEREADER_H
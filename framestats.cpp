@@ -0,0 +1,168 @@
+#include "framestats.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+// 8 bit samples hit few bins, four interleaved sub-histograms keep
+// consecutive equal values from stalling on the same counter
+constexpr std::size_t SubHistograms8 = 4;
+
+void Histogram8(const unsigned char *p, std::size_t n, std::uint32_t *pHist) {
+    std::uint32_t *h0 = pHist;
+    std::uint32_t *h1 = pHist + 256;
+    std::uint32_t *h2 = pHist + 512;
+    std::uint32_t *h3 = pHist + 768;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        ++h0[p[i + 0]];
+        ++h1[p[i + 1]];
+        ++h2[p[i + 2]];
+        ++h3[p[i + 3]];
+    }
+    for (; i < n; ++i) {
+        ++h0[p[i]];
+    }
+}
+
+void Histogram16(const std::uint16_t *p, std::size_t n, std::uint32_t *pHist) {
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        ++pHist[p[i + 0]];
+        ++pHist[p[i + 1]];
+        ++pHist[p[i + 2]];
+        ++pHist[p[i + 3]];
+    }
+    for (; i < n; ++i) {
+        ++pHist[p[i]];
+    }
+}
+
+}  // namespace
+
+
+std::uint32_t FrameStats::GetPercentile(double dPercent) const {
+    if ( nCount == 0 || histogram.empty() ) {
+        return 0;
+    }
+    const auto nTarget = static_cast<std::uint64_t>(std::ceil(std::clamp(dPercent, 0.0, 100.0) / 100.0 * nCount));
+    std::uint64_t nSum = 0;
+    for (std::size_t v = 0; v < histogram.size(); ++v) {
+        nSum += histogram[v];
+        if ( nSum >= std::max<std::uint64_t>(1, nTarget) ) {
+            return static_cast<std::uint32_t>(v);
+        }
+    }
+    return nMax;
+}
+
+
+FrameStatsEngine::FrameStatsEngine(ThreadPool &pool)
+    : pool(pool)
+    , mtx()
+    , partials()
+    , pFreeList(std::make_shared<FreeList>())
+    , pBlocks(std::make_shared<BlockPool>())
+{}
+
+bool FrameStatsEngine::Compute(int nWidth, int nHeight, int nBytepp, const FrameBuffer &buffer, FrameStats &stats,
+                               std::uint32_t nSaturation) {
+    if ( nWidth <= 0 || nHeight <= 0 || nBytepp < 1 || nBytepp > 3 ) {
+        return false;
+    }
+    const auto nSamples = static_cast<std::size_t>(nWidth) * nHeight * (nBytepp == 3 ? 3 : 1);
+    const bool b16 = nBytepp == 2;
+    if ( buffer.size() < nSamples * (b16 ? 2 : 1) ) {
+        return false;
+    }
+    const std::size_t nBins = b16 ? 65536 : 256;
+    const std::size_t nPartBins = b16 ? nBins : nBins * SubHistograms8;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    // one range per thread, small frames stay on the caller
+    const auto nParts = std::clamp<std::size_t>(nSamples / (256 * 1024), 1, pool.GetThreadCount() + 1);
+    partials.resize(std::max(partials.size(), nParts));
+    const auto nPartSize = (nSamples + nParts - 1) / nParts;
+    pool.ParallelFor(nParts, [&](std::size_t nBegin, std::size_t nEnd) {
+        for (auto nPart = nBegin; nPart < nEnd; ++nPart) {
+            auto &hist = partials[nPart];
+            hist.assign(nPartBins, 0);
+            const auto nFirst = nPart * nPartSize;
+            const auto nLast = std::min(nSamples, nFirst + nPartSize);
+            if ( nFirst >= nLast ) {
+                continue;
+            }
+            if ( b16 ) {
+                Histogram16(reinterpret_cast<const std::uint16_t *>(buffer.data()) + nFirst, nLast - nFirst, hist.data());
+            } else {
+                Histogram8(buffer.data() + nFirst, nLast - nFirst, hist.data());
+            }
+        }
+    });
+
+    // merge
+    stats.histogram.assign(nBins, 0);
+    for (std::size_t nPart = 0; nPart < nParts; ++nPart) {
+        const auto &hist = partials[nPart];
+        for (std::size_t nSub = 0; nSub < nPartBins; nSub += nBins) {
+            for (std::size_t v = 0; v < nBins; ++v) {
+                stats.histogram[v] += hist[nSub + v];
+            }
+        }
+    }
+
+    // derived values
+    const auto nMaxValue = static_cast<std::uint32_t>(nBins - 1);
+    stats.nSaturation = nSaturation > 0 ? std::min(nSaturation, nMaxValue) : nMaxValue;
+    stats.nCount = nSamples;
+    stats.nMin = 0;
+    stats.nMax = 0;
+    stats.nSaturated = 0;
+    double dSum = 0;
+    double dSumSq = 0;
+    bool bFirst = true;
+    for (std::size_t v = 0; v < nBins; ++v) {
+        const auto n = stats.histogram[v];
+        if ( n == 0 ) {
+            continue;
+        }
+        if ( bFirst ) {
+            stats.nMin = static_cast<std::uint32_t>(v);
+            bFirst = false;
+        }
+        stats.nMax = static_cast<std::uint32_t>(v);
+        dSum += static_cast<double>(n) * v;
+        dSumSq += static_cast<double>(n) * v * v;
+        if ( v >= stats.nSaturation ) {
+            stats.nSaturated += n;
+        }
+    }
+    stats.dMean = dSum / nSamples;
+    stats.dStdDev = std::sqrt(std::max(0.0, dSumSq / nSamples - stats.dMean * stats.dMean));
+    stats.nMedian = stats.GetPercentile(50.0);
+    return true;
+}
+
+std::shared_ptr<FrameStats> FrameStatsEngine::Acquire() {
+    std::unique_ptr<FrameStats> pStats;
+    {
+        std::lock_guard<std::mutex> lock(pFreeList->mtx);
+        if ( ! pFreeList->items.empty() ) {
+            pStats = std::move(pFreeList->items.back());
+            pFreeList->items.pop_back();
+        }
+    }
+    if ( ! pStats ) {
+        pStats = std::make_unique<FrameStats>();
+    }
+    std::weak_ptr<FreeList> pWeakList = pFreeList;
+    return std::shared_ptr<FrameStats>(pStats.release(), [pWeakList](FrameStats *p) {
+        std::unique_ptr<FrameStats> pReturned(p);
+        if ( auto pList = pWeakList.lock() ) {
+            std::lock_guard<std::mutex> lock(pList->mtx);
+            pList->items.push_back(std::move(pReturned));
+        }
+    }, BlockAllocator<FrameStats>(pBlocks));
+}
@@ -0,0 +1,62 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "blockpool.h"
+#include "framebuffer.h"
+#include "threadpool.h"
+
+
+// per frame statistics, all derived from the full histogram
+struct FrameStats {
+    std::uint64_t nCount = 0;       // samples (RGB24: 3 per pixel)
+    std::uint32_t nMin = 0;
+    std::uint32_t nMax = 0;
+    std::uint32_t nMedian = 0;
+    double dMean = 0;
+    double dStdDev = 0;
+    std::uint32_t nSaturation = 0;  // threshold used for nSaturated
+    std::uint64_t nSaturated = 0;   // samples >= nSaturation
+    std::vector<std::uint32_t> histogram;   // 256 or 65536 bins
+
+    // value below which dPercent of the samples fall
+    std::uint32_t GetPercentile(double dPercent) const;
+};
+
+//
+// one pass statistics for a downloaded frame
+// the buffer is split into one contiguous range per thread, each builds a
+// private histogram; min/max/mean/stddev/median come from the merged
+// histogram, so the pixels are read exactly once and nothing is sorted.
+//
+class FrameStatsEngine {
+public:
+    explicit FrameStatsEngine(ThreadPool &pool = ThreadPool::Global());
+
+    // nBytepp: 1 (RAW8/MONO8), 2 (RAW16), 3 (RGB24, all channels)
+    // nSaturation 0: the largest value of the format
+    bool Compute(int nWidth, int nHeight, int nBytepp, const FrameBuffer &buffer, FrameStats &stats,
+                 std::uint32_t nSaturation = 0);
+
+    // recycled stats object, goes back to the engine when released
+    std::shared_ptr<FrameStats> Acquire();
+
+private:
+    ThreadPool &pool;
+    std::mutex mtx;
+    std::vector<std::vector<std::uint32_t>> partials;
+
+    struct FreeList {
+        std::mutex mtx;
+        std::vector<std::unique_ptr<FrameStats>> items;
+    };
+    std::shared_ptr<FreeList> pFreeList;
+    // control blocks of the stats handed out
+    std::shared_ptr<BlockPool> pBlocks;
+};
+
+#endif // FRAMESTATS_H
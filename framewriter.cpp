@@ -0,0 +1,367 @@
+#include "framewriter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+#include "packed12.h"
+#include "ricecodec.h"
+#include "threadpool.h"
+
+
+namespace {
+
+std::string ToLower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return s;
+}
+
+// FITS header card: 80 columns
+std::string FitsCard(const std::string &key, const std::string &value, const std::string &comment = std::string()) {
+    char card[81];
+    if ( comment.empty() ) {
+        std::snprintf(card, sizeof(card), "%-8.8s= %20s", key.c_str(), value.c_str());
+    } else {
+        std::snprintf(card, sizeof(card), "%-8.8s= %20s / %s", key.c_str(), value.c_str(), comment.c_str());
+    }
+    std::string result(card);
+    result.resize(80, ' ');
+    return result;
+}
+
+// quoted string value, padded to 8 characters
+std::string FitsStringCard(const std::string &key, const std::string &value) {
+    char card[81];
+    std::snprintf(card, sizeof(card), "%-8.8s= '%-8s'", key.c_str(), value.c_str());
+    std::string result(card);
+    result.resize(80, ' ');
+    return result;
+}
+
+// header with END, padded to the 2880 byte block
+std::string FitsHeader(const std::vector<std::string> &cards) {
+    std::string header;
+    for (const auto &card : cards) {
+        header += card;
+    }
+    header += std::string("END").append(77, ' ');
+    header.resize((header.size() + 2879) / 2880 * 2880, ' ');
+    return header;
+}
+
+void PutBigEndian32(unsigned char *p, std::uint32_t v) {
+    p[0] = static_cast<unsigned char>(v >> 24);
+    p[1] = static_cast<unsigned char>(v >> 16);
+    p[2] = static_cast<unsigned char>(v >> 8);
+    p[3] = static_cast<unsigned char>(v);
+}
+
+}  // namespace
+
+
+std::optional<FrameFileFormat> FrameWriter::FormatFromPath(const std::string &path) {
+    const auto dot = path.find_last_of('.');
+    if ( dot == std::string::npos ) {
+        return std::nullopt;
+    }
+    const auto ext = ToLower(path.substr(dot + 1));
+    if ( ext == "raw" ) {
+        return FrameFileFormat::Raw;
+    }
+    if ( ext == "raw12" ) {
+        return FrameFileFormat::Raw12;
+    }
+    if ( ext == "pgm" || ext == "ppm" || ext == "pnm" ) {
+        return FrameFileFormat::Pnm;
+    }
+    if ( ext == "fits" || ext == "fit" || ext == "fts" ) {
+        return FrameFileFormat::Fits;
+    }
+    if ( ext == "fz" ) {
+        return FrameFileFormat::FitsRice;
+    }
+    return std::nullopt;
+}
+
+std::string FrameWriter::ExpandPath(const std::string &pattern, int nSequence) {
+    auto format = pattern;
+    if ( format.find('%') == std::string::npos ) {
+        const auto slash = format.find_last_of("/\\");
+        auto dot = format.find_last_of('.');
+        // keep ".fits.fz" together
+        if ( dot != std::string::npos && dot > 0 && ToLower(format.substr(dot)) == ".fz" ) {
+            const auto inner = format.find_last_of('.', dot - 1);
+            if ( inner != std::string::npos && (slash == std::string::npos || inner > slash) ) {
+                dot = inner;
+            }
+        }
+        const auto pos = (dot == std::string::npos || (slash != std::string::npos && dot < slash)) ? format.size() : dot;
+        format.insert(pos, "_%05d");
+    }
+    std::vector<char> buffer(format.size() + 32);
+    std::snprintf(buffer.data(), buffer.size(), format.c_str(), nSequence);
+    return buffer.data();
+}
+
+bool FrameWriter::Write(const std::string &path, int nWidth, int nHeight, int nBytepp, const FrameBuffer &buffer,
+                        const std::vector<FitsKeyword> &keywords, bool bPacked12) {
+    const auto nSamples = static_cast<std::size_t>(nWidth) * nHeight;
+    if ( bPacked12 ? (nBytepp != 2 || Packed12Size(nSamples) > buffer.size()) : nSamples * nBytepp > buffer.size() ) {
+        return false;
+    }
+    const auto format = FormatFromPath(path);
+    if ( ! format ) {
+        return false;
+    }
+    if ( bPacked12 && *format != FrameFileFormat::Raw12 ) {
+        FrameBuffer samples;
+        UnpackFrame12(buffer, nSamples, samples);
+        return Write(path, nWidth, nHeight, nBytepp, samples, keywords);
+    }
+    switch (*format) {
+    case FrameFileFormat::Raw:
+        return WriteRaw(path, buffer);
+    case FrameFileFormat::Raw12: {
+        if ( nBytepp != 2 ) {
+            return false;
+        }
+        if ( bPacked12 ) {
+            return WriteRaw(path, buffer);
+        }
+        FrameBuffer packed;
+        PackFrame12(buffer, packed);
+        return WriteRaw(path, packed);
+    }
+    case FrameFileFormat::Pnm:
+        return WritePnm(path, nWidth, nHeight, nBytepp, buffer);
+    case FrameFileFormat::Fits:
+        return WriteFits(path, nWidth, nHeight, nBytepp, buffer, keywords);
+    case FrameFileFormat::FitsRice:
+        return WriteFitsRice(path, nWidth, nHeight, nBytepp, buffer, keywords);
+    }
+    return false;
+}
+
+bool FrameWriter::WriteRaw(const std::string &path, const FrameBuffer &buffer) {
+    std::ofstream ofs(path, std::ios::binary);
+    ofs.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+    return static_cast<bool>(ofs);
+}
+
+bool FrameWriter::WritePnm(const std::string &path, int nWidth, int nHeight, int nBytepp, const FrameBuffer &buffer) {
+    std::ofstream ofs(path, std::ios::binary);
+    const auto nPixels = static_cast<std::size_t>(nWidth) * nHeight;
+    if ( nBytepp == 3 ) {
+        ofs << "P6 " << nWidth << " " << nHeight << " 255\n";
+        // SDK order is BGR
+        std::vector<unsigned char> rgb(nPixels * 3);
+        for (std::size_t i = 0; i < nPixels; ++i) {
+            rgb[i * 3 + 0] = buffer[i * 3 + 2];
+            rgb[i * 3 + 1] = buffer[i * 3 + 1];
+            rgb[i * 3 + 2] = buffer[i * 3 + 0];
+        }
+        ofs.write(reinterpret_cast<const char *>(rgb.data()), rgb.size());
+    } else if ( nBytepp == 2 ) {
+        ofs << "P5 " << nWidth << " " << nHeight << " 65535\n";
+        // big endian
+        std::vector<unsigned char> be(nPixels * 2);
+        for (std::size_t i = 0; i < nPixels; ++i) {
+            be[i * 2 + 0] = buffer[i * 2 + 1];
+            be[i * 2 + 1] = buffer[i * 2 + 0];
+        }
+        ofs.write(reinterpret_cast<const char *>(be.data()), be.size());
+    } else {
+        ofs << "P5 " << nWidth << " " << nHeight << " 255\n";
+        ofs.write(reinterpret_cast<const char *>(buffer.data()), nPixels);
+    }
+    return static_cast<bool>(ofs);
+}
+
+bool FrameWriter::WriteFits(const std::string &path, int nWidth, int nHeight, int nBytepp, const FrameBuffer &buffer,
+                            const std::vector<FitsKeyword> &keywords) {
+    const auto nPixels = static_cast<std::size_t>(nWidth) * nHeight;
+    const bool bColor = nBytepp == 3;
+
+    std::vector<std::string> cards;
+    cards.push_back(FitsCard("SIMPLE", "T"));
+    cards.push_back(FitsCard("BITPIX", nBytepp == 2 ? "16" : "8"));
+    cards.push_back(FitsCard("NAXIS", bColor ? "3" : "2"));
+    cards.push_back(FitsCard("NAXIS1", std::to_string(nWidth)));
+    cards.push_back(FitsCard("NAXIS2", std::to_string(nHeight)));
+    if ( bColor ) {
+        cards.push_back(FitsCard("NAXIS3", "3"));
+    }
+    if ( nBytepp == 2 ) {
+        // unsigned 16bit
+        cards.push_back(FitsCard("BZERO", "32768"));
+        cards.push_back(FitsCard("BSCALE", "1"));
+    }
+    for (const auto &keyword : keywords) {
+        cards.push_back(FitsCard(keyword.key, keyword.value, keyword.comment));
+    }
+    const auto header = FitsHeader(cards);
+
+    std::vector<unsigned char> data;
+    if ( nBytepp == 2 ) {
+        // big endian, signed with BZERO
+        data.resize(nPixels * 2);
+        for (std::size_t i = 0; i < nPixels; ++i) {
+            data[i * 2 + 0] = static_cast<unsigned char>(buffer[i * 2 + 1] ^ 0x80);
+            data[i * 2 + 1] = buffer[i * 2 + 0];
+        }
+    } else if ( bColor ) {
+        // BGR interleaved -> R, G, B planes
+        data.resize(nPixels * 3);
+        for (std::size_t i = 0; i < nPixels; ++i) {
+            data[i] = buffer[i * 3 + 2];
+            data[nPixels + i] = buffer[i * 3 + 1];
+            data[nPixels * 2 + i] = buffer[i * 3 + 0];
+        }
+    } else {
+        data.assign(buffer.begin(), buffer.begin() + nPixels);
+    }
+    data.resize((data.size() + 2879) / 2880 * 2880, 0);
+
+    std::ofstream ofs(path, std::ios::binary);
+    ofs.write(header.data(), header.size());
+    ofs.write(reinterpret_cast<const char *>(data.data()), data.size());
+    return static_cast<bool>(ofs);
+}
+
+bool FrameWriter::WriteFitsRice(const std::string &path, int nWidth, int nHeight, int nBytepp, const FrameBuffer &buffer,
+                                const std::vector<FitsKeyword> &keywords) {
+    const bool bColor = nBytepp == 3;
+    const int nPlanes = bColor ? 3 : 1;
+    auto &pool = ThreadPool::Global();
+    const auto pSamples = reinterpret_cast<const std::uint16_t *>(buffer.data());
+
+    // RAW16 from a 12/14bit sensor has constant low bits; they are shifted out
+    // and come back through BSCALE, otherwise Rice pays for them in every sample
+    int nShift = 0;
+    if ( nBytepp == 2 ) {
+        std::mutex mtx;
+        std::uint32_t nBits = 0;
+        pool.ParallelFor(static_cast<std::size_t>(nWidth) * nHeight, [&](std::size_t nFirst, std::size_t nLast) {
+            std::uint32_t nLocal = 0;
+            for (std::size_t i = nFirst; i < nLast; ++i) {
+                nLocal |= pSamples[i];
+            }
+            std::lock_guard<std::mutex> lock(mtx);
+            nBits |= nLocal;
+        }, 1 << 16);
+        while ( nBits != 0 && nShift < 15 && ! (nBits & (1u << nShift)) ) {
+            ++nShift;
+        }
+    }
+
+    // one tile per row and plane, compressed in parallel
+    const auto nTiles = static_cast<std::size_t>(nHeight) * nPlanes;
+    std::vector<std::vector<unsigned char>> tiles(nTiles);
+    pool.ParallelFor(nTiles, [&](std::size_t nFirst, std::size_t nLast) {
+        std::vector<std::uint8_t> row(bColor ? nWidth : 0);
+        std::vector<std::uint16_t> row16(nShift > 0 ? nWidth : 0);
+        for (std::size_t t = nFirst; t < nLast; ++t) {
+            auto &tile = tiles[t];
+            tile.clear();
+            if ( nBytepp == 2 ) {
+                const auto pRow = pSamples + t * nWidth;
+                if ( nShift > 0 ) {
+                    // stored = (value - BZERO) / BSCALE, in the codec's unsigned view
+                    const auto nOffset = static_cast<std::uint16_t>(32768 - (32768 >> nShift));
+                    for (int x = 0; x < nWidth; ++x) {
+                        row16[x] = static_cast<std::uint16_t>((pRow[x] >> nShift) + nOffset);
+                    }
+                    RiceCodec::Compress16(row16.data(), nWidth, tile);
+                } else {
+                    RiceCodec::Compress16(pRow, nWidth, tile);
+                }
+            } else if ( bColor ) {
+                // BGR interleaved -> R, G, B planes
+                const auto nChannel = 2 - static_cast<int>(t / nHeight);
+                const auto pRow = buffer.data() + (t % nHeight) * nWidth * 3;
+                for (int x = 0; x < nWidth; ++x) {
+                    row[x] = pRow[x * 3 + nChannel];
+                }
+                RiceCodec::Compress8(row.data(), nWidth, tile);
+            } else {
+                RiceCodec::Compress8(buffer.data() + t * nWidth, nWidth, tile);
+            }
+        }
+    }, 8);
+
+    // binary table of (size, heap offset) descriptors followed by the heap
+    std::vector<unsigned char> table(nTiles * 8);
+    std::size_t nHeap = 0;
+    std::size_t nMaxTile = 0;
+    for (std::size_t t = 0; t < nTiles; ++t) {
+        PutBigEndian32(&table[t * 8], static_cast<std::uint32_t>(tiles[t].size()));
+        PutBigEndian32(&table[t * 8 + 4], static_cast<std::uint32_t>(nHeap));
+        nHeap += tiles[t].size();
+        nMaxTile = std::max(nMaxTile, tiles[t].size());
+    }
+
+    std::vector<std::string> primary;
+    primary.push_back(FitsCard("SIMPLE", "T"));
+    primary.push_back(FitsCard("BITPIX", "8"));
+    primary.push_back(FitsCard("NAXIS", "0"));
+    primary.push_back(FitsCard("EXTEND", "T"));
+
+    std::vector<std::string> cards;
+    cards.push_back(FitsStringCard("XTENSION", "BINTABLE"));
+    cards.push_back(FitsCard("BITPIX", "8"));
+    cards.push_back(FitsCard("NAXIS", "2"));
+    cards.push_back(FitsCard("NAXIS1", "8"));
+    cards.push_back(FitsCard("NAXIS2", std::to_string(nTiles)));
+    cards.push_back(FitsCard("PCOUNT", std::to_string(nHeap)));
+    cards.push_back(FitsCard("GCOUNT", "1"));
+    cards.push_back(FitsCard("TFIELDS", "1"));
+    cards.push_back(FitsStringCard("TTYPE1", "COMPRESSED_DATA"));
+    cards.push_back(FitsStringCard("TFORM1", "1PB(" + std::to_string(nMaxTile) + ")"));
+    cards.push_back(FitsCard("ZIMAGE", "T"));
+    cards.push_back(FitsCard("ZBITPIX", nBytepp == 2 ? "16" : "8"));
+    cards.push_back(FitsCard("ZNAXIS", bColor ? "3" : "2"));
+    cards.push_back(FitsCard("ZNAXIS1", std::to_string(nWidth)));
+    cards.push_back(FitsCard("ZNAXIS2", std::to_string(nHeight)));
+    if ( bColor ) {
+        cards.push_back(FitsCard("ZNAXIS3", "3"));
+    }
+    cards.push_back(FitsCard("ZTILE1", std::to_string(nWidth)));
+    cards.push_back(FitsCard("ZTILE2", "1"));
+    if ( bColor ) {
+        cards.push_back(FitsCard("ZTILE3", "1"));
+    }
+    cards.push_back(FitsStringCard("ZCMPTYPE", "RICE_1"));
+    cards.push_back(FitsStringCard("ZNAME1", "BLOCKSIZE"));
+    cards.push_back(FitsCard("ZVAL1", std::to_string(RiceCodec::DefaultBlockSize)));
+    cards.push_back(FitsStringCard("ZNAME2", "BYTEPIX"));
+    cards.push_back(FitsCard("ZVAL2", nBytepp == 2 ? "2" : "1"));
+    if ( nBytepp == 2 ) {
+        // unsigned 16bit
+        cards.push_back(FitsCard("BZERO", "32768"));
+        cards.push_back(FitsCard("BSCALE", std::to_string(1 << nShift)));
+    }
+    for (const auto &keyword : keywords) {
+        cards.push_back(FitsCard(keyword.key, keyword.value, keyword.comment));
+    }
+
+    std::ofstream ofs(path, std::ios::binary);
+    const auto primaryHeader = FitsHeader(primary);
+    const auto header = FitsHeader(cards);
+    ofs.write(primaryHeader.data(), primaryHeader.size());
+    ofs.write(header.data(), header.size());
+    ofs.write(reinterpret_cast<const char *>(table.data()), table.size());
+    for (const auto &tile : tiles) {
+        ofs.write(reinterpret_cast<const char *>(tile.data()), tile.size());
+    }
+    const auto nData = table.size() + nHeap;
+    const std::vector<char> padding((nData + 2879) / 2880 * 2880 - nData, 0);
+    ofs.write(padding.data(), padding.size());
+    return static_cast<bool>(ofs);
+}
@@ -0,0 +1,51 @@
+#ifndef FRAMEWRITER_H
+#define FRAMEWRITER_H
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "framebuffer.h"
+
+
+enum class FrameFileFormat {
+    Raw,    // as downloaded
+    Raw12,  // RAW16 as packed 12bit (Pack12), headerless
+    Pnm,    // PGM (RAW8/RAW16/MONO8), PPM (RGB24)
+    Fits,   // FITS primary HDU
+    FitsRice,   // tile compressed FITS (RICE_1, one tile per row), fpack compatible
+};
+
+// extra FITS header card, value formatted as it goes into the card
+// ("-10.5", "'text'", "T"); the other formats ignore them
+struct FitsKeyword {
+    std::string key;
+    std::string value;
+    std::string comment;
+};
+
+class FrameWriter {
+public:
+    // .raw / .raw12 / .pgm / .ppm / .fits / .fit / .fz
+    static std::optional<FrameFileFormat> FormatFromPath(const std::string &path);
+
+    // "dir/frame_%05d.fits" -> "dir/frame_00012.fits"
+    // a pattern without '%' gets "_%05d" before the extension (before ".fits.fz")
+    static std::string ExpandPath(const std::string &pattern, int nSequence);
+
+    // nBytepp: 1 (RAW8/MONO8), 2 (RAW16, little endian), 3 (RGB24)
+    // bPacked12: the RAW16 buffer is packed 12bit (CapturedFrame::bPacked12);
+    // .raw12 takes it as is, the other formats unpack it
+    static bool Write(const std::string &path, int nWidth, int nHeight, int nBytepp, const FrameBuffer &buffer,
+                      const std::vector<FitsKeyword> &keywords = std::vector<FitsKeyword>(), bool bPacked12 = false);
+
+private:
+    static bool WriteRaw(const std::string &path, const FrameBuffer &buffer);
+    static bool WritePnm(const std::string &path, int nWidth, int nHeight, int nBytepp, const FrameBuffer &buffer);
+    static bool WriteFits(const std::string &path, int nWidth, int nHeight, int nBytepp, const FrameBuffer &buffer,
+                          const std::vector<FitsKeyword> &keywords);
+    static bool WriteFitsRice(const std::string &path, int nWidth, int nHeight, int nBytepp, const FrameBuffer &buffer,
+                              const std::vector<FitsKeyword> &keywords);
+};
+
+#endif // FRAMEWRITER_H
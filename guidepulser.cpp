@@ -0,0 +1,262 @@
+#include "guidepulser.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "cameraexecutor.h"
+#include "playeronecamera.hpp"
+#include "threadconfig.h"
+
+
+namespace {
+
+// the thread sleeps until this long before a deadline, then spins
+constexpr auto SpinMargin = std::chrono::milliseconds(2);
+
+std::size_t AxisIndex(GuideDirection direction) {
+    return direction == GuideDirection::East || direction == GuideDirection::West ? 0 : 1;
+}
+
+POAConfig GuideConfig(GuideDirection direction) {
+    switch (direction) {
+    case GuideDirection::North:
+        return POAConfig::POA_GUIDE_NORTH;
+    case GuideDirection::South:
+        return POAConfig::POA_GUIDE_SOUTH;
+    case GuideDirection::East:
+        return POAConfig::POA_GUIDE_EAST;
+    case GuideDirection::West:
+        return POAConfig::POA_GUIDE_WEST;
+    }
+    return POAConfig::POA_GUIDE_NORTH;
+}
+
+double Milliseconds(GuidePulser::clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+// best effort, needs privileges for real time scheduling on Linux
+void RaiseThreadPriority() {
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+#else
+    sched_param param{};
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO) + 1;
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+#endif
+}
+
+}  // namespace
+
+
+GuidePulser::GuidePulser(std::shared_ptr<CameraExecutor> pExecutor)
+    : pExecutor(std::move(pExecutor))
+    , mtx()
+    , cv()
+    , cvIdle()
+    , axes()
+    , bStop(false)
+    , bAbandoned(false)
+    , timing()
+    , dErrorSum(0)
+    , dStartSum(0)
+    , thread([this]() { ThreadProc(); })
+{}
+
+GuidePulser::~GuidePulser() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bStop = true;
+    }
+    cv.notify_all();
+    thread.join();
+}
+
+void GuidePulser::Abandon() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bStop = true;
+        bAbandoned = true;
+    }
+    cv.notify_all();
+}
+
+bool GuidePulser::Pulse(GuideDirection direction, std::chrono::microseconds duration) {
+    if ( ! pExecutor || ! pExecutor->GetCamera()->HasST4Port() || duration.count() <= 0 ) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto &axis = axes[AxisIndex(direction)];
+        axis.pending = direction;
+        axis.pendingDuration = duration;
+        axis.pendingRequested = clock::now();
+    }
+    cv.notify_all();
+    return true;
+}
+
+void GuidePulser::Cancel() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto &axis : axes) {
+            axis.pending.reset();
+            axis.bCancel = true;
+        }
+    }
+    cv.notify_all();
+}
+
+bool GuidePulser::IsGuiding() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return std::any_of(axes.begin(), axes.end(), [](const Axis &axis) {
+        return axis.active || axis.pending;
+    });
+}
+
+bool GuidePulser::WaitIdle(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mtx);
+    return cvIdle.wait_for(lock, timeout, [this]() {
+        return std::none_of(axes.begin(), axes.end(), [](const Axis &axis) {
+            return axis.active || axis.pending;
+        });
+    });
+}
+
+GuideTiming GuidePulser::GetTiming() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return timing;
+}
+
+void GuidePulser::ResetTiming() {
+    std::lock_guard<std::mutex> lock(mtx);
+    timing = GuideTiming();
+    dErrorSum = 0;
+    dStartSum = 0;
+}
+
+bool GuidePulser::SetOutput(GuideDirection direction, bool bOn) {
+    return pExecutor->CallOrAbandon(bAbandoned, CommandPriority::Urgent, &PlayerOneCamera::SetGuideOutput, GuideConfig(direction), bOn);
+}
+
+void GuidePulser::RecordPulse(const Axis &axis, clock::time_point end) {
+    // both ends are taken after the SDK call returned, so the call latency cancels
+    const auto dError = Milliseconds(end - axis.start) - Milliseconds(axis.duration);
+    const auto dStart = Milliseconds(axis.start - axis.requested);
+    ++timing.nPulses;
+    dErrorSum += dError;
+    dStartSum += dStart;
+    timing.dLastError = dError;
+    timing.dMeanError = dErrorSum / timing.nPulses;
+    timing.dMaxError = std::max(timing.dMaxError, std::abs(dError));
+    timing.dMeanStart = dStartSum / timing.nPulses;
+    timing.dMaxStart = std::max(timing.dMaxStart, dStart);
+}
+
+void GuidePulser::ThreadProc() {
+    SetCurrentThreadName("poa-guide");
+    RaiseThreadPriority();
+
+    std::unique_lock<std::mutex> lock(mtx);
+    while ( true ) {
+        // new requests and cancels
+        for (auto &axis : axes) {
+            if ( ! axis.pending && ! axis.bCancel ) {
+                continue;
+            }
+            const auto active = axis.active;
+            const auto pending = axis.pending;
+            const auto duration = axis.pendingDuration;
+            const auto requested = axis.pendingRequested;
+            axis.pending.reset();
+            axis.bCancel = false;
+            axis.active.reset();
+            lock.unlock();
+            if ( active && active != pending ) {
+                SetOutput(*active, false);
+            }
+            bool bOn = false;
+            if ( pending ) {
+                bOn = active == pending || SetOutput(*pending, true);
+            }
+            const auto start = clock::now();
+            lock.lock();
+            if ( bOn ) {
+                axis.active = pending;
+                axis.requested = requested;
+                axis.duration = duration;
+                axis.start = start;
+                axis.deadline = start + duration;
+            }
+        }
+        if ( bStop ) {
+            break;
+        }
+
+        // earliest deadline
+        std::optional<clock::time_point> deadline;
+        for (const auto &axis : axes) {
+            if ( axis.active && ( ! deadline || axis.deadline < *deadline) ) {
+                deadline = axis.deadline;
+            }
+        }
+        if ( ! deadline ) {
+            cvIdle.notify_all();
+            cv.wait(lock, [this]() {
+                return bStop || std::any_of(axes.begin(), axes.end(), [](const Axis &axis) {
+                    return axis.pending || axis.bCancel;
+                });
+            });
+            continue;
+        }
+        const auto wakeup = *deadline - SpinMargin;
+        if ( clock::now() < wakeup ) {
+            cv.wait_until(lock, wakeup, [this]() {
+                return bStop || std::any_of(axes.begin(), axes.end(), [](const Axis &axis) {
+                    return axis.pending || axis.bCancel;
+                });
+            });
+            continue;
+        }
+
+        // spin to the deadline without the lock
+        lock.unlock();
+        while ( clock::now() < *deadline ) {
+            std::this_thread::yield();
+        }
+        lock.lock();
+        for (auto &axis : axes) {
+            if ( ! axis.active || axis.deadline > *deadline || axis.pending || axis.bCancel ) {
+                continue;
+            }
+            const auto direction = *axis.active;
+            lock.unlock();
+            SetOutput(direction, false);
+            const auto end = clock::now();
+            lock.lock();
+            RecordPulse(axis, end);
+            axis.active.reset();
+        }
+    }
+
+    // leave every output off, unless the camera is gone with the executor
+    if ( ! bAbandoned ) {
+        lock.unlock();
+        for (auto direction : { GuideDirection::North, GuideDirection::South, GuideDirection::East, GuideDirection::West }) {
+            SetOutput(direction, false);
+        }
+        lock.lock();
+    }
+    for (auto &axis : axes) {
+        axis.active.reset();
+        axis.pending.reset();
+    }
+    cvIdle.notify_all();
+}
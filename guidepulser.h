@@ -0,0 +1,97 @@
+#ifndef GUIDEPULSER_H
+#define GUIDEPULSER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+class CameraExecutor;
+
+enum class GuideDirection {
+    North,  // Dec+
+    South,  // Dec-
+    East,   // RA-
+    West,   // RA+
+};
+
+// measured pulse timing (ms)
+struct GuideTiming {
+    long nPulses = 0;           // completed (not cancelled or replaced)
+    double dLastError = 0;      // measured - requested duration
+    double dMeanError = 0;
+    double dMaxError = 0;       // largest |error|
+    double dMeanStart = 0;      // Pulse() -> output on
+    double dMaxStart = 0;
+};
+
+//
+// ST4 guide pulses on a dedicated high priority thread
+// RA (east/west) and Dec (north/south) run independently and may overlap.
+// deadlines are on the monotonic clock; the thread sleeps until shortly
+// before a deadline and spins the rest. the outputs are switched through the
+// urgent lane of the camera executor, which downloads never occupy, so a
+// pulse does not wait for a GetImageData on another thread.
+//
+class GuidePulser {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit GuidePulser(std::shared_ptr<CameraExecutor> pExecutor);
+    // cancels running pulses
+    ~GuidePulser();
+    // for a stuck executor: the thread stops waiting for its command and
+    // ends without switching the outputs off; the destructor does not wait
+    // for the executor then
+    void Abandon();
+
+    GuidePulser(const GuidePulser &) = delete;
+    GuidePulser &operator=(const GuidePulser &) = delete;
+
+    // replaces a running pulse on the same axis
+    bool Pulse(GuideDirection direction, std::chrono::microseconds duration);
+    // switch every output off now
+    void Cancel();
+    bool IsGuiding() const;
+    // false on timeout
+    bool WaitIdle(std::chrono::milliseconds timeout);
+
+    GuideTiming GetTiming() const;
+    void ResetTiming();
+
+private:
+    struct Axis {
+        std::optional<GuideDirection> pending;
+        std::chrono::microseconds pendingDuration{0};
+        clock::time_point pendingRequested;
+        bool bCancel = false;
+
+        std::optional<GuideDirection> active;
+        clock::time_point requested;
+        std::chrono::microseconds duration{0};
+        clock::time_point start;
+        clock::time_point deadline;
+    };
+
+    void ThreadProc();
+    bool SetOutput(GuideDirection direction, bool bOn);
+    void RecordPulse(const Axis &axis, clock::time_point end);
+
+    std::shared_ptr<CameraExecutor> pExecutor;
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    std::condition_variable cvIdle;
+    std::array<Axis, 2> axes;   // RA, Dec
+    bool bStop;
+    std::atomic<bool> bAbandoned;
+    GuideTiming timing;
+    double dErrorSum;
+    double dStartSum;
+    std::thread thread;
+};
+
+#endif // GUIDEPULSER_H
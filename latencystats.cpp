@@ -0,0 +1,196 @@
+#include "latencystats.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+
+const char *LatencyStageName(LatencyStage stage) {
+    switch (stage) {
+    case LatencyStage::Exposure:
+        return "Exposure";
+    case LatencyStage::ReadyWait:
+        return "ReadyWait";
+    case LatencyStage::Download:
+        return "Download";
+    case LatencyStage::Emit:
+        return "Emit";
+    case LatencyStage::Display:
+        return "Display";
+    case LatencyStage::Total:
+        return "Total";
+    case LatencyStage::Abort:
+        return "Abort";
+    case LatencyStage::Count:
+        break;
+    }
+    return "Unknown";
+}
+
+
+LatencyHistogram::LatencyHistogram()
+    : m_aCounts()
+    , m_nTotalCount(0)
+    , m_nMin(std::numeric_limits<std::int64_t>::max())
+    , m_nMax(0)
+    , m_dSum(0)
+{}
+
+std::size_t LatencyHistogram::IndexOf(std::int64_t nValue) {
+    if ( nValue < SubBucketCount ) {
+        return static_cast<std::size_t>(nValue);
+    }
+    // position of the most significant bit
+    int nMsb = 0;
+    for (auto v = static_cast<std::uint64_t>(nValue); v > 1; v >>= 1) {
+        ++nMsb;
+    }
+    // keep (SubBucketBits - 1) significant bits below the msb
+    const int nShift = nMsb - (SubBucketBits - 1);
+    const auto nSub = (nValue >> nShift) - SubBucketHalfCount;
+    return static_cast<std::size_t>(SubBucketCount + (nShift - 1) * SubBucketHalfCount + nSub);
+}
+
+std::int64_t LatencyHistogram::HighestEquivalentValue(std::size_t nIndex) {
+    if ( nIndex < static_cast<std::size_t>(SubBucketCount) ) {
+        return static_cast<std::int64_t>(nIndex);
+    }
+    const auto k = static_cast<std::int64_t>(nIndex) - SubBucketCount;
+    const auto nShift = k / SubBucketHalfCount + 1;
+    const auto nSub = k % SubBucketHalfCount + SubBucketHalfCount;
+    return ((nSub + 1) << nShift) - 1;
+}
+
+void LatencyHistogram::Record(std::int64_t nValue) {
+    constexpr auto nMaxValue = (std::int64_t(1) << MaxValueBits) - 1;
+    nValue = std::clamp<std::int64_t>(nValue, 0, nMaxValue);
+    ++m_aCounts[IndexOf(nValue)];
+    ++m_nTotalCount;
+    m_nMin = std::min(m_nMin, nValue);
+    m_nMax = std::max(m_nMax, nValue);
+    m_dSum += static_cast<double>(nValue);
+}
+
+void LatencyHistogram::Reset() {
+    m_aCounts.fill(0);
+    m_nTotalCount = 0;
+    m_nMin = std::numeric_limits<std::int64_t>::max();
+    m_nMax = 0;
+    m_dSum = 0;
+}
+
+std::uint64_t LatencyHistogram::GetCount() const {
+    return m_nTotalCount;
+}
+std::int64_t LatencyHistogram::GetMin() const {
+    return m_nTotalCount == 0 ? 0 : m_nMin;
+}
+std::int64_t LatencyHistogram::GetMax() const {
+    return m_nMax;
+}
+double LatencyHistogram::GetMean() const {
+    if ( m_nTotalCount == 0 ) {
+        return 0;
+    }
+    return m_dSum / static_cast<double>(m_nTotalCount);
+}
+
+std::int64_t LatencyHistogram::GetValueAtPercentile(double dPercentile) const {
+    if ( m_nTotalCount == 0 ) {
+        return 0;
+    }
+    dPercentile = std::clamp(dPercentile, 0.0, 100.0);
+    auto nTarget = static_cast<std::uint64_t>(dPercentile / 100.0 * static_cast<double>(m_nTotalCount) + 0.5);
+    nTarget = std::max<std::uint64_t>(nTarget, 1);
+    std::uint64_t nAccum = 0;
+    for (std::size_t i = 0; i < m_aCounts.size(); ++i) {
+        nAccum += m_aCounts[i];
+        if ( nAccum >= nTarget ) {
+            return std::min(HighestEquivalentValue(i), m_nMax);
+        }
+    }
+    return m_nMax;
+}
+
+
+LatencyStats::LatencyStats()
+    : m_mtx()
+    , m_aHistograms()
+{}
+
+void LatencyStats::RecordStage(LatencyStage stage, FrameTimestamps::clock::time_point begin, FrameTimestamps::clock::time_point end) {
+    using time_point = FrameTimestamps::clock::time_point;
+    if ( begin == time_point() || end == time_point() ) {
+        // stage not reached
+        return;
+    }
+    const auto nMicroSec = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+    m_aHistograms[static_cast<std::size_t>(stage)].Record(nMicroSec);
+}
+
+void LatencyStats::RecordAcquisition(const FrameTimestamps &timestamps) {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    RecordStage(LatencyStage::Exposure, timestamps.exposureStart, timestamps.exposureEnd);
+    RecordStage(LatencyStage::ReadyWait, timestamps.exposureEnd, timestamps.imageReady);
+    RecordStage(LatencyStage::Download, timestamps.imageReady, timestamps.downloaded);
+    RecordStage(LatencyStage::Emit, timestamps.downloaded, timestamps.emitted);
+}
+
+void LatencyStats::RecordDisplay(const FrameTimestamps &timestamps) {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    RecordStage(LatencyStage::Display, timestamps.emitted, timestamps.displayed);
+    RecordStage(LatencyStage::Total, timestamps.exposureStart, timestamps.displayed);
+}
+
+void LatencyStats::RecordAbort(FrameTimestamps::clock::time_point requested, FrameTimestamps::clock::time_point stopped) {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    RecordStage(LatencyStage::Abort, requested, stopped);
+}
+
+void LatencyStats::Reset() {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    for (auto &histogram : m_aHistograms) {
+        histogram.Reset();
+    }
+}
+
+std::vector<LatencySummary> LatencyStats::GetSummary() const {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    std::vector<LatencySummary> result;
+    result.reserve(m_aHistograms.size());
+    for (std::size_t i = 0; i < m_aHistograms.size(); ++i) {
+        const auto &histogram = m_aHistograms[i];
+        LatencySummary summary = {};
+        summary.stage = static_cast<LatencyStage>(i);
+        summary.nCount = histogram.GetCount();
+        summary.nMin = histogram.GetMin();
+        summary.nP50 = histogram.GetValueAtPercentile(50);
+        summary.nP90 = histogram.GetValueAtPercentile(90);
+        summary.nP99 = histogram.GetValueAtPercentile(99);
+        summary.nMax = histogram.GetMax();
+        summary.dMean = histogram.GetMean();
+        result.push_back(summary);
+    }
+    return result;
+}
+
+std::string LatencyStats::GetReport() const {
+    std::ostringstream oss;
+    oss << std::left << std::setw(10) << "stage(ms)"
+        << std::right << std::setw(6) << "n"
+        << std::setw(9) << "p50"
+        << std::setw(9) << "p90"
+        << std::setw(9) << "p99"
+        << std::setw(9) << "max" << "\n";
+    oss << std::fixed << std::setprecision(1);
+    for (const auto &summary : GetSummary()) {
+        oss << std::left << std::setw(10) << LatencyStageName(summary.stage)
+            << std::right << std::setw(6) << summary.nCount
+            << std::setw(9) << summary.nP50 / 1000.0
+            << std::setw(9) << summary.nP90 / 1000.0
+            << std::setw(9) << summary.nP99 / 1000.0
+            << std::setw(9) << summary.nMax / 1000.0 << "\n";
+    }
+    return oss.str();
+}
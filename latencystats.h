@@ -0,0 +1,107 @@
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+// monotonic timestamps of one frame through the capture pipeline
+struct FrameTimestamps {
+    using clock = std::chrono::steady_clock;
+
+    clock::time_point exposureStart;    // StartExposure() issued
+    clock::time_point exposureEnd;      // camera left STATE_EXPOSING (as detected by polling)
+    clock::time_point imageReady;       // ImageReady() returned true
+    clock::time_point downloaded;       // GetImageData() completed
+    clock::time_point emitted;          // imageReady signal emitted
+    clock::time_point displayed;        // MainWindow finished drawing
+};
+
+enum class LatencyStage {
+    Exposure = 0,   // exposureStart -> exposureEnd
+    ReadyWait,      // exposureEnd -> imageReady
+    Download,       // imageReady -> downloaded
+    Emit,           // downloaded -> emitted
+    Display,        // emitted -> displayed
+    Total,          // exposureStart -> displayed
+    Abort,          // AbortExposure()/StopLiveView() -> capture thread stopped
+    Count
+};
+
+const char *LatencyStageName(LatencyStage stage);
+
+
+//
+// HdrHistogram style log-linear histogram (unit: us)
+// values below 128 are exact, larger values keep ~1.6% relative precision.
+//
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void Record(std::int64_t nValue);
+    void Reset();
+
+    std::uint64_t GetCount() const;
+    std::int64_t GetMin() const;
+    std::int64_t GetMax() const;
+    double GetMean() const;
+    // dPercentile: [0, 100]
+    std::int64_t GetValueAtPercentile(double dPercentile) const;
+
+private:
+    static constexpr int SubBucketBits = 7;
+    static constexpr std::int64_t SubBucketCount = std::int64_t(1) << SubBucketBits;
+    static constexpr std::int64_t SubBucketHalfCount = SubBucketCount / 2;
+    static constexpr int MaxValueBits = 40;     // about 12 days
+    static constexpr std::size_t BucketCount = SubBucketCount + (MaxValueBits - SubBucketBits) * SubBucketHalfCount;
+
+    static std::size_t IndexOf(std::int64_t nValue);
+    static std::int64_t HighestEquivalentValue(std::size_t nIndex);
+
+    std::array<std::uint64_t, BucketCount> m_aCounts;
+    std::uint64_t m_nTotalCount;
+    std::int64_t m_nMin;
+    std::int64_t m_nMax;
+    double m_dSum;
+};
+
+
+struct LatencySummary {
+    LatencyStage stage;
+    std::uint64_t nCount;
+    std::int64_t nMin;      // us
+    std::int64_t nP50;      // us
+    std::int64_t nP90;      // us
+    std::int64_t nP99;      // us
+    std::int64_t nMax;      // us
+    double dMean;           // us
+};
+
+// per stage histograms, thread safe
+class LatencyStats {
+public:
+    LatencyStats();
+
+    // capture side: Exposure, ReadyWait, Download, Emit
+    void RecordAcquisition(const FrameTimestamps &timestamps);
+    // display side: Display, Total
+    void RecordDisplay(const FrameTimestamps &timestamps);
+    void RecordAbort(FrameTimestamps::clock::time_point requested, FrameTimestamps::clock::time_point stopped);
+    void Reset();
+
+    std::vector<LatencySummary> GetSummary() const;
+    std::string GetReport() const;
+
+private:
+    void RecordStage(LatencyStage stage, FrameTimestamps::clock::time_point begin, FrameTimestamps::clock::time_point end);
+
+    mutable std::mutex m_mtx;
+    std::array<LatencyHistogram, static_cast<std::size_t>(LatencyStage::Count)> m_aHistograms;
+};
+
+#endif // LATENCYSTATS_H
@@ -0,0 +1,297 @@
+#include "livestacker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+
+namespace {
+
+// rows per ParallelFor chunk: at least ~64k samples
+std::size_t MinRows(std::size_t nRowSamples) {
+    return std::max<std::size_t>(1, 65536 / std::max<std::size_t>(1, nRowSamples));
+}
+
+template <typename T, typename Acc>
+inline T RoundSample(Acc value) {
+    const Acc maxValue = static_cast<Acc>(std::numeric_limits<T>::max());
+    return static_cast<T>(std::min(maxValue, std::max(Acc(0), value + Acc(0.5))));
+}
+
+}  // namespace
+
+
+LiveStacker::LiveStacker(ThreadPool &pool)
+    : pool(pool)
+    , mtx()
+    , mode(StackMode::Mean)
+    , precision(StackPrecision::Float)
+    , nWindow(16)
+    , dSigma(3.0)
+    , nPreviewInterval(0)
+    , previewCallback()
+    , nWidth(0)
+    , nHeight(0)
+    , nBytepp(0)
+    , nRowSamples(0)
+    , nFrames(0)
+    , nWindowPos(0)
+    , nWindowCount(0)
+{}
+
+void LiveStacker::Configure(StackMode mode, StackPrecision precision, int nWindow, double dSigma) {
+    std::lock_guard<std::mutex> lock(mtx);
+    this->mode = mode;
+    this->precision = precision;
+    this->nWindow = std::max(2, nWindow);
+    this->dSigma = dSigma > 0 ? dSigma : 3.0;
+    Restart(0, 0, 0);
+}
+
+void LiveStacker::SetPreviewCallback(int nInterval, PreviewCallback callback) {
+    std::lock_guard<std::mutex> lock(mtx);
+    nPreviewInterval = std::max(0, nInterval);
+    previewCallback = std::move(callback);
+}
+
+void LiveStacker::Reset() {
+    std::lock_guard<std::mutex> lock(mtx);
+    Restart(0, 0, 0);
+}
+
+bool LiveStacker::Add(int nWidth, int nHeight, int nBytepp, const FrameBuffer &buffer) {
+    if ( nWidth <= 0 || nHeight <= 0 || nBytepp < 1 || nBytepp > 3 ) {
+        return false;
+    }
+    const auto nSamples = static_cast<std::size_t>(nWidth) * nHeight * (nBytepp == 3 ? 3 : 1);
+    if ( buffer.size() < nSamples * (nBytepp == 2 ? 2 : 1) ) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(mtx);
+    if ( nWidth != this->nWidth || nHeight != this->nHeight || nBytepp != this->nBytepp ) {
+        Restart(nWidth, nHeight, nBytepp);
+    }
+    ++nFrames;
+    if ( nBytepp == 2 ) {
+        const auto pSrc = reinterpret_cast<const std::uint16_t *>(buffer.data());
+        if ( mode == StackMode::SigmaClip ) {
+            AddWindow(pSrc);
+        } else if ( precision == StackPrecision::Double ) {
+            AddMean(pSrc, accDouble);
+        } else {
+            AddMean(pSrc, accFloat);
+        }
+    } else {
+        const auto pSrc = buffer.data();
+        if ( mode == StackMode::SigmaClip ) {
+            AddWindow(pSrc);
+        } else if ( precision == StackPrecision::Double ) {
+            AddMean(pSrc, accDouble);
+        } else {
+            AddMean(pSrc, accFloat);
+        }
+    }
+
+    if ( nPreviewInterval > 0 && previewCallback && nFrames % nPreviewInterval == 0 ) {
+        // hand the reusable buffer to the callback without holding the lock
+        FrameBuffer preview;
+        preview.swap(previewBuffer);
+        RenderPreview(preview);
+        const auto callback = previewCallback;
+        const auto nStacked = nFrames;
+        lock.unlock();
+        callback(nWidth, nHeight, nBytepp, preview, nStacked);
+        lock.lock();
+        if ( previewBuffer.capacity() < preview.capacity() ) {
+            previewBuffer.swap(preview);
+        }
+    }
+    return true;
+}
+
+int LiveStacker::GetFrameCount() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return nFrames;
+}
+int LiveStacker::GetWidth() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return nWidth;
+}
+int LiveStacker::GetHeight() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return nHeight;
+}
+int LiveStacker::GetBytepp() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return nBytepp;
+}
+
+bool LiveStacker::GetPreview(FrameBuffer &buffer) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return RenderPreview(buffer);
+}
+
+void LiveStacker::Restart(int nWidth, int nHeight, int nBytepp) {
+    this->nWidth = nWidth;
+    this->nHeight = nHeight;
+    this->nBytepp = nBytepp;
+    nRowSamples = static_cast<std::size_t>(nWidth) * (nBytepp == 3 ? 3 : 1);
+    nFrames = 0;
+    nWindowPos = 0;
+    nWindowCount = 0;
+
+    const auto nSamples = nRowSamples * nHeight;
+    const bool bMean = mode == StackMode::Mean;
+    accFloat.assign(bMean && precision == StackPrecision::Float ? nSamples : 0, 0.0f);
+    accDouble.assign(bMean && precision == StackPrecision::Double ? nSamples : 0, 0.0);
+    if ( bMean ) {
+        window.clear();
+        windowSum.clear();
+        windowSumSq.clear();
+    } else {
+        window.resize(nWindow);
+        for (auto &frame : window) {
+            frame.resize(nSamples * (nBytepp == 2 ? 2 : 1));
+        }
+        windowSum.assign(nSamples, 0);
+        windowSumSq.assign(nSamples, 0);
+    }
+}
+
+template <typename T, typename Acc>
+void LiveStacker::AddMean(const T *pSrc, std::vector<Acc> &acc) {
+    // running mean keeps a float accumulator exact enough for long stacks
+    const Acc inv = Acc(1) / nFrames;
+    const auto nRowSamples = this->nRowSamples;
+    Acc *pAcc = acc.data();
+    pool.ParallelFor(nHeight, [=](std::size_t nBegin, std::size_t nEnd) {
+        for (auto y = nBegin; y < nEnd; ++y) {
+            const T *s = pSrc + y * nRowSamples;
+            Acc *a = pAcc + y * nRowSamples;
+            for (std::size_t i = 0; i < nRowSamples; ++i) {
+                a[i] += (static_cast<Acc>(s[i]) - a[i]) * inv;
+            }
+        }
+    }, MinRows(nRowSamples));
+}
+
+template <typename T>
+void LiveStacker::AddWindow(const T *pSrc) {
+    // the oldest frame leaves the integer sums as the new one enters
+    const bool bEvict = nWindowCount == nWindow;
+    T *pSlot = reinterpret_cast<T *>(window[nWindowPos].data());
+    std::uint32_t *pSum = windowSum.data();
+    std::uint64_t *pSumSq = windowSumSq.data();
+    const auto nRowSamples = this->nRowSamples;
+    pool.ParallelFor(nHeight, [=](std::size_t nBegin, std::size_t nEnd) {
+        for (auto y = nBegin; y < nEnd; ++y) {
+            const auto nOffset = y * nRowSamples;
+            const T *s = pSrc + nOffset;
+            T *old = pSlot + nOffset;
+            std::uint32_t *sum = pSum + nOffset;
+            std::uint64_t *sumSq = pSumSq + nOffset;
+            if ( bEvict ) {
+                for (std::size_t i = 0; i < nRowSamples; ++i) {
+                    const std::uint32_t v = s[i];
+                    const std::uint32_t o = old[i];
+                    sum[i] += v - o;
+                    sumSq[i] += static_cast<std::uint64_t>(v) * v - static_cast<std::uint64_t>(o) * o;
+                }
+            } else {
+                for (std::size_t i = 0; i < nRowSamples; ++i) {
+                    const std::uint32_t v = s[i];
+                    sum[i] += v;
+                    sumSq[i] += static_cast<std::uint64_t>(v) * v;
+                }
+            }
+            std::memcpy(old, s, nRowSamples * sizeof(T));
+        }
+    }, MinRows(nRowSamples));
+    nWindowPos = (nWindowPos + 1) % nWindow;
+    nWindowCount = std::min(nWindowCount + 1, nWindow);
+}
+
+template <typename T, typename Acc>
+void LiveStacker::RenderMean(const std::vector<Acc> &acc, T *pDst) const {
+    const Acc *pAcc = acc.data();
+    const auto nRowSamples = this->nRowSamples;
+    pool.ParallelFor(nHeight, [=](std::size_t nBegin, std::size_t nEnd) {
+        for (auto y = nBegin; y < nEnd; ++y) {
+            const Acc *a = pAcc + y * nRowSamples;
+            T *d = pDst + y * nRowSamples;
+            for (std::size_t i = 0; i < nRowSamples; ++i) {
+                d[i] = RoundSample<T>(a[i]);
+            }
+        }
+    }, MinRows(nRowSamples));
+}
+
+template <typename T, typename Acc>
+void LiveStacker::RenderClipped(T *pDst) const {
+    std::vector<const T *> frames;
+    for (int i = 0; i < nWindowCount; ++i) {
+        frames.push_back(reinterpret_cast<const T *>(window[i].data()));
+    }
+    const std::uint32_t *pSum = windowSum.data();
+    const std::uint64_t *pSumSq = windowSumSq.data();
+    const auto nRowSamples = this->nRowSamples;
+    const Acc n = static_cast<Acc>(nWindowCount);
+    const Acc k = static_cast<Acc>(dSigma);
+    pool.ParallelFor(nHeight, [&, pDst, pSum, pSumSq, nRowSamples, n, k](std::size_t nBegin, std::size_t nEnd) {
+        std::vector<Acc> mean(nRowSamples), limit(nRowSamples), acc(nRowSamples), count(nRowSamples);
+        for (auto y = nBegin; y < nEnd; ++y) {
+            const auto nOffset = y * nRowSamples;
+            const std::uint32_t *sum = pSum + nOffset;
+            const std::uint64_t *sumSq = pSumSq + nOffset;
+            for (std::size_t i = 0; i < nRowSamples; ++i) {
+                const Acc m = static_cast<Acc>(sum[i]) / n;
+                const Acc var = std::max(Acc(0), static_cast<Acc>(sumSq[i]) / n - m * m);
+                mean[i] = m;
+                // keep at least +-0.5 so a constant pixel is never rejected
+                limit[i] = std::max(Acc(0.5), k * std::sqrt(var));
+                acc[i] = 0;
+                count[i] = 0;
+            }
+            for (const T *frame : frames) {
+                const T *s = frame + nOffset;
+                for (std::size_t i = 0; i < nRowSamples; ++i) {
+                    const Acc v = static_cast<Acc>(s[i]);
+                    const bool bKeep = std::abs(v - mean[i]) <= limit[i];
+                    acc[i] += bKeep ? v : Acc(0);
+                    count[i] += bKeep ? Acc(1) : Acc(0);
+                }
+            }
+            T *d = pDst + nOffset;
+            for (std::size_t i = 0; i < nRowSamples; ++i) {
+                d[i] = RoundSample<T>(count[i] > 0 ? acc[i] / count[i] : mean[i]);
+            }
+        }
+    }, MinRows(nRowSamples));
+}
+
+bool LiveStacker::RenderPreview(FrameBuffer &buffer) const {
+    if ( nFrames == 0 ) {
+        return false;
+    }
+    const auto nSamples = nRowSamples * nHeight;
+    buffer.resize(nSamples * (nBytepp == 2 ? 2 : 1));
+    const bool bDouble = precision == StackPrecision::Double;
+    if ( nBytepp == 2 ) {
+        auto pDst = reinterpret_cast<std::uint16_t *>(buffer.data());
+        if ( mode == StackMode::SigmaClip ) {
+            bDouble ? RenderClipped<std::uint16_t, double>(pDst) : RenderClipped<std::uint16_t, float>(pDst);
+        } else {
+            bDouble ? RenderMean(accDouble, pDst) : RenderMean(accFloat, pDst);
+        }
+    } else {
+        auto pDst = buffer.data();
+        if ( mode == StackMode::SigmaClip ) {
+            bDouble ? RenderClipped<unsigned char, double>(pDst) : RenderClipped<unsigned char, float>(pDst);
+        } else {
+            bDouble ? RenderMean(accDouble, pDst) : RenderMean(accFloat, pDst);
+        }
+    }
+    return true;
+}
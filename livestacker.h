@@ -0,0 +1,91 @@
+#ifndef LIVESTACKER_H
+#define LIVESTACKER_H
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "framebuffer.h"
+#include "threadpool.h"
+
+
+enum class StackMode {
+    Mean,       // running mean of every frame
+    SigmaClip,  // mean of the last N frames without per pixel outliers
+};
+
+enum class StackPrecision {
+    Float,      // 32bit accumulator
+    Double,     // 64bit accumulator
+};
+
+//
+// real time stacking of captured frames
+// samples are stacked as delivered (no debayer, no registration), so RAW
+// Bayer data stays RAW. rows are split across the thread pool and the per
+// row loops are kept simple enough for the compiler to vectorize.
+//
+class LiveStacker {
+public:
+    // nFrames: frames stacked so far, preview in the input sample format
+    using PreviewCallback = std::function<void(int nWidth, int nHeight, int nBytepp, const FrameBuffer &preview, int nFrames)>;
+
+    explicit LiveStacker(ThreadPool &pool = ThreadPool::Global());
+
+    // nWindow and dSigma are used by SigmaClip. resets the stack.
+    void Configure(StackMode mode, StackPrecision precision = StackPrecision::Float, int nWindow = 16, double dSigma = 3.0);
+    // call every nInterval frames from Add() (0: never)
+    void SetPreviewCallback(int nInterval, PreviewCallback callback);
+    void Reset();
+
+    // nBytepp: 1 (RAW8/MONO8), 2 (RAW16), 3 (RGB24)
+    // a frame of another size or format restarts the stack
+    bool Add(int nWidth, int nHeight, int nBytepp, const FrameBuffer &buffer);
+
+    int GetFrameCount() const;
+    int GetWidth() const;
+    int GetHeight() const;
+    int GetBytepp() const;
+
+    // stacked image, rounded to the input sample format
+    bool GetPreview(FrameBuffer &buffer) const;
+
+private:
+    void Restart(int nWidth, int nHeight, int nBytepp);
+    template <typename T, typename Acc> void AddMean(const T *pSrc, std::vector<Acc> &acc);
+    template <typename T> void AddWindow(const T *pSrc);
+    template <typename T, typename Acc> void RenderMean(const std::vector<Acc> &acc, T *pDst) const;
+    template <typename T, typename Acc> void RenderClipped(T *pDst) const;
+    bool RenderPreview(FrameBuffer &buffer) const;
+
+    ThreadPool &pool;
+    mutable std::mutex mtx;
+
+    StackMode mode;
+    StackPrecision precision;
+    int nWindow;
+    double dSigma;
+    int nPreviewInterval;
+    PreviewCallback previewCallback;
+
+    int nWidth;
+    int nHeight;
+    int nBytepp;
+    std::size_t nRowSamples;
+    int nFrames;
+
+    // Mean
+    std::vector<float> accFloat;
+    std::vector<double> accDouble;
+    // SigmaClip: last nWindow frames and their exact integer sums
+    std::vector<std::vector<unsigned char>> window;
+    int nWindowPos;
+    int nWindowCount;
+    std::vector<std::uint32_t> windowSum;
+    std::vector<std::uint64_t> windowSumSq;
+
+    FrameBuffer previewBuffer;
+};
+
+#endif // LIVESTACKER_H
@@ -5,6 +5,7 @@
 #include <fstream>
 #include <iomanip>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 
@@ -102,6 +103,7 @@ struct scoped_ios_format {
     scoped_ios_format &operator =(const scoped_ios_format &) = delete;
 
     scoped_ios_format(StreamT &stream) :
+        stream(stream),
         format(nullptr)
     {
         format.copyfmt(stream);
@@ -112,12 +114,12 @@ struct scoped_ios_format {
     }
 
     StreamT &stream;
-    StreamT format;
+    std::basic_ios<typename StreamT::char_type, typename StreamT::traits_type> format;
 };
 
 template <typename StreamT>
 scoped_ios_format<StreamT> make_scoped_ios_format(StreamT &stream) {
-    return make_scoped_ios_format(stream);
+    return scoped_ios_format<StreamT>(stream);
 }
 
 template <typename StreamT, typename ValueT>
@@ -286,10 +288,13 @@ public:
     }
 
     void write(const char *type, const std::string &msg) {
+        // capture, guide and UI threads share one logger
+        std::lock_guard<std::mutex> lock(m_mtx);
         m_file << current_time() << ":" << type << ":" << msg << std::endl;
     }
 
     std::ofstream m_file;
+    std::mutex m_mtx;
 
 public:
     static std::unique_ptr<Logger> create(const std::string& filepath) {
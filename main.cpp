@@ -2,11 +2,19 @@
 
 #include <QApplication>
 
+#include "framebuffer.h"
+#include "framemetadata.h"
+#include "framestats.h"
+#include "latencystats.h"
+
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
 
-    qRegisterMetaType<std::vector<unsigned char>>("std::vector<unsigned char>");
+    qRegisterMetaType<FrameBuffer>("FrameBuffer");
+    qRegisterMetaType<FrameTimestamps>("FrameTimestamps");
+    qRegisterMetaType<std::shared_ptr<const FrameStats>>("std::shared_ptr<const FrameStats>");
+    qRegisterMetaType<FrameMetadata>("FrameMetadata");
 
     MainWindow w;
     w.show();
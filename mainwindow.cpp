@@ -1,6 +1,7 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
+#include <cstdint>
 #include <cstring>
 #include <sstream>
 
@@ -8,6 +9,7 @@
 #include <QGraphicsView>
 #include <QMessageBox>
 #include <QPixmap>
+#include <QSettings>
 
 #include "ccdplayerone.h"
 
@@ -16,22 +18,44 @@ MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , bWaiting(false)
+    , bClosing(false)
+    , mtxWaiting()
+    , cvWaiting()
+    , pDisplayFrame()
+    , bDisplayPending(false)
 {
     ui->setupUi(this);
 
     connect(this, &MainWindow::done, this, &MainWindow::exposure_done);
+    connect(this, &MainWindow::frameReady, this, &MainWindow::camera_frameReady, Qt::QueuedConnection);
 }
 
 MainWindow::~MainWindow()
 {
-    delete ui;
-
+    // neither the sequence nor the camera waits for a running exposure
+    bClosing = true;
+    setWaiting(false);
     if ( pCamera ) {
         pCamera->AbortExposure();
     }
     if ( exposureThread.joinable() ) {
         exposureThread.join();
     }
+    if ( pCamera ) {
+        pCamera->RemoveFrameConsumer("display");
+        pCamera->Close();
+    }
+
+    delete ui;
+}
+
+void MainWindow::setWaiting(bool bValue)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtxWaiting);
+        bWaiting = bValue;
+    }
+    cvWaiting.notify_all();
 }
 
 void MainWindow::on_pushButtonConnect_clicked()
@@ -41,8 +65,31 @@ void MainWindow::on_pushButtonConnect_clicked()
         QMessageBox::critical(this, tr("Connection failed"), tr("Connection failed"));
         return;
     }
-    connect(pCamera.get(), &CcdPlayerOne::imageReady, this, &MainWindow::camera_imageReady);
+    // a tuning stored by playerone_cli --tune for this camera and USB port
+    QSettings settings(QSettings::IniFormat, QSettings::UserScope, "playerone", "playerone");
+    settings.beginGroup("bandwidth/" + QString::fromStdString(pCamera->GetBandwidthTuningKey()));
+    if ( settings.contains("usbBandwidthLimit") ) {
+        BandwidthTuning tuning;
+        tuning.nBandwidth = static_cast<long>(settings.value("usbBandwidthLimit").toLongLong());
+        tuning.nFrameLimit = static_cast<long>(settings.value("frameLimit", 0).toLongLong());
+        tuning.dFps = settings.value("fps", 0).toDouble();
+        pCamera->ApplyBandwidthTuning(tuning);
+    }
+    // the sequence goes on as soon as the frame is downloaded, the display
+    // catches up on its own
+    connect(pCamera.get(), &CcdPlayerOne::imageReady, this, [this]() { setWaiting(false); }, Qt::DirectConnection);
     connect(pCamera.get(), &CcdPlayerOne::aborted, this, &MainWindow::camera_aborted);
+    connect(pCamera.get(), &CcdPlayerOne::settingFailed, this, &MainWindow::camera_settingFailed);
+    FrameConsumerOptions display;
+    display.bLatestOnly = true;
+    display.bSharedPool = true;
+    pCamera->AddFrameConsumer("display", [this](const FramePtr &pFrame) {
+        std::atomic_store(&pDisplayFrame, pFrame);
+        if ( ! bDisplayPending.exchange(true) ) {
+            emit frameReady();
+        }
+    }, display);
+    pCamera->SetFrameStatsEnabled(true);
     ui->pushButtonConnect->setEnabled(false);
     ui->pushButtonDisconnect->setEnabled(true);
     ui->pushButtonExposure->setEnabled(true);
@@ -72,8 +119,7 @@ void MainWindow::on_pushButtonExposure_clicked()
 
     ui->pushButtonExposure->setEnabled(false);
     std::thread thread([=](){
-        bWaiting = true;
-        for (int i = 0; i < 2; ++i) {
+        for (int i = 0; i < 2 && ! bClosing; ++i) {
             if ( ! pCamera->SetExposure(1 * 1000000) ) {
                 QMessageBox::critical(this, tr("Exposure failed"), tr("SetExposure failed."));
                 return;
@@ -86,15 +132,18 @@ void MainWindow::on_pushButtonExposure_clicked()
                 QMessageBox::critical(this, tr("Exposure failed"), tr("SetBin failed."));
                 return;
             }
+            setWaiting(true);
             if ( ! pCamera->StartExposure() ) {
                 QMessageBox::critical(this, tr("Exposure failed"), tr("StartExposure failed."));
                 return;
             }
-            while ( bWaiting ) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(200));
-            }
+            std::unique_lock<std::mutex> lock(mtxWaiting);
+            cvWaiting.wait(lock, [this]() { return ! bWaiting || bClosing; });
+        }
+        std::unique_lock<std::mutex> lock(mtxWaiting);
+        if ( cvWaiting.wait_for(lock, std::chrono::milliseconds(1000), [this]() { return bClosing.load(); }) ) {
+            return;
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
         emit done();
     });
     exposureThread.swap(thread);
@@ -106,39 +155,109 @@ void MainWindow::on_pushButtonAbortExposure_clicked()
         return;
     }
     pCamera->AbortExposure();
-    bWaiting = false;
+    setWaiting(false);
     ui->pushButtonExposure->setEnabled(true);
 }
 
-void MainWindow::camera_imageReady(int nWidth, int nHeight, const std::vector<unsigned char> &image)
+void MainWindow::camera_frameReady()
 {
-    // build PGM
+    bDisplayPending = false;
+    const auto pFrame = std::atomic_exchange(&pDisplayFrame, FramePtr());
+    if ( ! pFrame ) {
+        return;
+    }
+    const auto nWidth = pFrame->nWidth;
+    const auto nHeight = pFrame->nHeight;
+    const auto nBytepp = pFrame->nBytepp;
+    // packed 12bit frames are unpacked to RAW16
+    FrameBuffer scratch;
+    const auto &image = pFrame->GetSamples(scratch);
+    const auto &pStats = pFrame->pStats;
+
+    // build PGM (PPM for RGB24), 8bit: RAW16 keeps the high byte
+    const auto nPixels = static_cast<std::size_t>(nWidth) * nHeight;
+    const auto nChannels = nBytepp == 3 ? 3 : 1;
     std::ostringstream oss;
-    oss << "P5 " << nWidth << " " << nHeight << " " << 0xff << "\n";
+    oss << (nChannels == 3 ? "P6 " : "P5 ") << nWidth << " " << nHeight << " " << 0xff << "\n";
     const auto header = oss.str();
-    std::vector<unsigned char> buffer(header.size() + image.size());
+    std::vector<unsigned char> buffer(header.size() + nPixels * nChannels);
     std::memcpy(&buffer[0], header.c_str(), header.size());
-    std::memcpy(&buffer[header.size()], image.data(), image.size());
+    if ( nBytepp == 2 ) {
+        for (std::size_t i = 0; i < nPixels; ++i) {
+            std::uint16_t nSample;
+            std::memcpy(&nSample, &image[i * 2], sizeof(nSample));
+            buffer[header.size() + i] = static_cast<unsigned char>(nSample >> 8);
+        }
+    } else if ( nChannels == 3 ) {
+        // the SDK delivers BGR
+        for (std::size_t i = 0; i < nPixels; ++i) {
+            buffer[header.size() + i * 3] = image[i * 3 + 2];
+            buffer[header.size() + i * 3 + 1] = image[i * 3 + 1];
+            buffer[header.size() + i * 3 + 2] = image[i * 3];
+        }
+    } else {
+        std::memcpy(&buffer[header.size()], image.data(), nPixels);
+    }
 
     // show image
     QPixmap pixmap;
-    pixmap.loadFromData(buffer.data(), buffer.size(), "PGM");
+    pixmap.loadFromData(buffer.data(), buffer.size(), nChannels == 3 ? "PPM" : "PGM");
 
     auto scene = new QGraphicsScene();
     QGraphicsPixmapItem *image_item = new QGraphicsPixmapItem(pixmap);
     scene->addItem(image_item);
     ui->graphicsView->setScene(scene);
+    ui->graphicsView->viewport()->repaint();
 
-    QMessageBox::information(this, tr("Done"), tr("captured."));
-    bWaiting = false;
+    if ( pCamera ) {
+        pCamera->RecordFrameDisplayed(pFrame->timestamps);
+    }
+    updateLatencyStats();
+    if ( pStats ) {
+        auto message = tr("mean %1  median %2  min %3  max %4  stddev %5  saturated %6")
+            .arg(pStats->dMean, 0, 'f', 1).arg(pStats->nMedian).arg(pStats->nMin).arg(pStats->nMax)
+            .arg(pStats->dStdDev, 0, 'f', 1).arg(pStats->nSaturated);
+        // cached by the telemetry poller, no SDK call here
+        const auto pTelemetry = pCamera ? pCamera->GetTelemetry() : nullptr;
+        if ( pTelemetry && pTelemetry->temperature ) {
+            message += tr("  %1 C").arg(*pTelemetry->temperature, 0, 'f', 1);
+        }
+        if ( pTelemetry && pTelemetry->nCoolerPower ) {
+            message += tr("  cooler %1%").arg(*pTelemetry->nCoolerPower);
+        }
+        ui->statusbar->showMessage(message);
+    }
 }
 
 void MainWindow::camera_aborted()
 {
+    setWaiting(false);
     QMessageBox::warning(this, tr("Aborted"), tr("aborted."));
 }
 
+void MainWindow::camera_settingFailed(const QString &setting)
+{
+    QMessageBox::warning(this, tr("Setting failed"), tr("%1 could not be applied after the exposure.").arg(setting));
+}
+
 void MainWindow::exposure_done()
 {
     ui->pushButtonExposure->setEnabled(true);
 }
+
+void MainWindow::on_pushButtonResetLatency_clicked()
+{
+    if ( pCamera ) {
+        pCamera->ResetLatencyStats();
+    }
+    updateLatencyStats();
+}
+
+void MainWindow::updateLatencyStats()
+{
+    if ( ! pCamera ) {
+        ui->labelLatencyStats->clear();
+        return;
+    }
+    ui->labelLatencyStats->setText(QString::fromStdString(pCamera->GetLatencyReport()));
+}
@@ -1,11 +1,18 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <thread>
 
 #include <QMainWindow>
 
+#include "framequeue.h"
+#include "framestats.h"
+#include "latencystats.h"
+
 class CcdPlayerOne;
 
 QT_BEGIN_NAMESPACE
@@ -22,20 +29,36 @@ public:
 
 signals:
     void done();
+    // a frame is waiting in pDisplayFrame, from the display consumer
+    void frameReady();
 
 public slots:
     void on_pushButtonConnect_clicked();
     void on_pushButtonDisconnect_clicked();
     void on_pushButtonExposure_clicked();
     void on_pushButtonAbortExposure_clicked();
-    void camera_imageReady(int nWidth, int nHeight, const std::vector<unsigned char> &image);
+    void camera_frameReady();
     void camera_aborted();
+    void camera_settingFailed(const QString &setting);
     void exposure_done();
+    void on_pushButtonResetLatency_clicked();
+
+private:
+    void updateLatencyStats();
+    void setWaiting(bool bValue);
 
 private:
     Ui::MainWindow *ui;
     std::shared_ptr<CcdPlayerOne> pCamera;
     std::thread exposureThread;
-    bool bWaiting;
+    // exposure sequence: waits for the frame, wakes on abort/close
+    std::atomic<bool> bWaiting;
+    std::atomic<bool> bClosing;
+    std::mutex mtxWaiting;
+    std::condition_variable cvWaiting;
+    // latest frame for the GUI thread (std::atomic_* only); at most one
+    // frameReady is queued, older frames are replaced rather than piling up
+    FramePtr pDisplayFrame;
+    std::atomic<bool> bDisplayPending;
 };
 #endif // MAINWINDOW_H
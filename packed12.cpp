@@ -0,0 +1,262 @@
+#include "packed12.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PACKED12_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PACKED12_TARGET(name) __attribute__((target(name)))
+#else
+// MSVC compiles the intrinsics without a flag
+#define PACKED12_TARGET(name)
+#endif
+
+
+namespace {
+
+// samples per ParallelFor chunk, even so no pair is split
+constexpr std::size_t ChunkSamples = 65536;
+
+using PackFunc = void (*)(const std::uint16_t *, std::size_t, unsigned char *);
+using UnpackFunc = void (*)(const unsigned char *, std::size_t, std::uint16_t *);
+
+void PackScalar(const std::uint16_t *pSrc, std::size_t nSamples, unsigned char *pDst) {
+    std::size_t i = 0;
+    for (; i + 2 <= nSamples; i += 2) {
+        const unsigned a = pSrc[i] >> 4;
+        const unsigned b = pSrc[i + 1] >> 4;
+        pDst[0] = static_cast<unsigned char>(a);
+        pDst[1] = static_cast<unsigned char>((a >> 8) | (b << 4));
+        pDst[2] = static_cast<unsigned char>(b >> 4);
+        pDst += 3;
+    }
+    if ( i < nSamples ) {
+        // odd count: the last sample takes 2 bytes, b = 0
+        const unsigned a = pSrc[i] >> 4;
+        pDst[0] = static_cast<unsigned char>(a);
+        pDst[1] = static_cast<unsigned char>(a >> 8);
+    }
+}
+
+void UnpackScalar(const unsigned char *pSrc, std::size_t nSamples, std::uint16_t *pDst) {
+    std::size_t i = 0;
+    for (; i + 2 <= nSamples; i += 2) {
+        pDst[i] = static_cast<std::uint16_t>((pSrc[0] | ((pSrc[1] & 0x0f) << 8)) << 4);
+        pDst[i + 1] = static_cast<std::uint16_t>(((pSrc[1] >> 4) | (pSrc[2] << 4)) << 4);
+        pSrc += 3;
+    }
+    if ( i < nSamples ) {
+        pDst[i] = static_cast<std::uint16_t>((pSrc[0] | ((pSrc[1] & 0x0f) << 8)) << 4);
+    }
+}
+
+#ifdef PACKED12_X86
+
+// each 32bit lane holds a | b << 12 (24 bits): keep 3 of its 4 bytes
+#define PACKED12_COMPACT 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1
+// 3 packed bytes -> one 32bit lane
+#define PACKED12_EXPAND 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1
+
+PACKED12_TARGET("ssse3")
+void PackSsse3(const std::uint16_t *pSrc, std::size_t nSamples, unsigned char *pDst) {
+    const __m128i compact = _mm_setr_epi8(PACKED12_COMPACT);
+    const __m128i weights = _mm_setr_epi16(1, 4096, 1, 4096, 1, 4096, 1, 4096);
+    std::size_t i = 0;
+    // 8 samples -> 12 bytes; the 16 byte store runs into the next group, so
+    // stop while one is left
+    for (; i + 16 <= nSamples; i += 8) {
+        const __m128i v = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pSrc + i)), 4);
+        const __m128i pairs = _mm_madd_epi16(v, weights);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pDst), _mm_shuffle_epi8(pairs, compact));
+        pDst += 12;
+    }
+    PackScalar(pSrc + i, nSamples - i, pDst);
+}
+
+PACKED12_TARGET("ssse3")
+void UnpackSsse3(const unsigned char *pSrc, std::size_t nSamples, std::uint16_t *pDst) {
+    const __m128i expand = _mm_setr_epi8(PACKED12_EXPAND);
+    const __m128i lowMask = _mm_set1_epi32(0x0000fff0);
+    const __m128i highMask = _mm_set1_epi32(static_cast<int>(0xfff00000u));
+    std::size_t i = 0;
+    // 12 bytes -> 8 samples, the load reads 4 bytes ahead
+    for (; i + 16 <= nSamples; i += 8) {
+        const __m128i p = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pSrc)), expand);
+        const __m128i v = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(p, 4), lowMask), _mm_and_si128(_mm_slli_epi32(p, 8), highMask));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pDst + i), v);
+        pSrc += 12;
+    }
+    UnpackScalar(pSrc, nSamples - i, pDst + i);
+}
+
+PACKED12_TARGET("avx2")
+void PackAvx2(const std::uint16_t *pSrc, std::size_t nSamples, unsigned char *pDst) {
+    const __m256i compact = _mm256_setr_epi8(PACKED12_COMPACT, PACKED12_COMPACT);
+    const __m256i weights = _mm256_setr_epi16(1, 4096, 1, 4096, 1, 4096, 1, 4096, 1, 4096, 1, 4096, 1, 4096, 1, 4096);
+    // the 12 bytes of each 128bit lane next to each other
+    const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+    std::size_t i = 0;
+    // 16 samples -> 24 bytes, the 32 byte store runs 8 bytes ahead
+    for (; i + 32 <= nSamples; i += 16) {
+        const __m256i v = _mm256_srli_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(pSrc + i)), 4);
+        const __m256i pairs = _mm256_madd_epi16(v, weights);
+        const __m256i packed = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(pairs, compact), join);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(pDst), packed);
+        pDst += 24;
+    }
+    PackSsse3(pSrc + i, nSamples - i, pDst);
+}
+
+PACKED12_TARGET("avx2")
+void UnpackAvx2(const unsigned char *pSrc, std::size_t nSamples, std::uint16_t *pDst) {
+    const __m256i expand = _mm256_setr_epi8(PACKED12_EXPAND, PACKED12_EXPAND);
+    // bytes 12..27 into the upper lane
+    const __m256i split = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+    const __m256i lowMask = _mm256_set1_epi32(0x0000fff0);
+    const __m256i highMask = _mm256_set1_epi32(static_cast<int>(0xfff00000u));
+    std::size_t i = 0;
+    // 24 bytes -> 16 samples, the load reads 8 bytes ahead
+    for (; i + 32 <= nSamples; i += 16) {
+        const __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(pSrc)), split);
+        const __m256i p = _mm256_shuffle_epi8(bytes, expand);
+        const __m256i v = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi32(p, 4), lowMask),
+                                          _mm256_and_si256(_mm256_slli_epi32(p, 8), highMask));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(pDst + i), v);
+        pSrc += 24;
+    }
+    UnpackSsse3(pSrc, nSamples - i, pDst + i);
+}
+
+enum class Cpu {
+    Scalar,
+    Ssse3,
+    Avx2,
+};
+
+Cpu DetectCpu() {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports("avx2") ) {
+        return Cpu::Avx2;
+    }
+    if ( __builtin_cpu_supports("ssse3") ) {
+        return Cpu::Ssse3;
+    }
+    return Cpu::Scalar;
+#elif defined(_MSC_VER)
+    int aInfo[4];
+    __cpuid(aInfo, 1);
+    const bool bSsse3 = (aInfo[2] & (1 << 9)) != 0;
+    // AVX state enabled by the OS (XSAVE + XCR0)
+    const bool bAvxState = (aInfo[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(aInfo, 7, 0);
+    if ( bAvxState && (aInfo[1] & (1 << 5)) ) {
+        return Cpu::Avx2;
+    }
+    return bSsse3 ? Cpu::Ssse3 : Cpu::Scalar;
+#else
+    return Cpu::Scalar;
+#endif
+}
+
+const Cpu cpu = DetectCpu();
+
+#else
+
+enum class Cpu {
+    Scalar,
+};
+
+const Cpu cpu = Cpu::Scalar;
+
+#endif
+
+PackFunc SelectPack() {
+#ifdef PACKED12_X86
+    switch (cpu) {
+    case Cpu::Avx2:
+        return PackAvx2;
+    case Cpu::Ssse3:
+        return PackSsse3;
+    case Cpu::Scalar:
+        break;
+    }
+#endif
+    return PackScalar;
+}
+
+UnpackFunc SelectUnpack() {
+#ifdef PACKED12_X86
+    switch (cpu) {
+    case Cpu::Avx2:
+        return UnpackAvx2;
+    case Cpu::Ssse3:
+        return UnpackSsse3;
+    case Cpu::Scalar:
+        break;
+    }
+#endif
+    return UnpackScalar;
+}
+
+}  // namespace
+
+
+std::size_t Packed12Size(std::size_t nSamples) {
+    return (nSamples * 3 + 1) / 2;
+}
+
+void Pack12(const std::uint16_t *pSrc, std::size_t nSamples, unsigned char *pDst) {
+    static const auto pack = SelectPack();
+    pack(pSrc, nSamples, pDst);
+}
+
+void Unpack12(const unsigned char *pSrc, std::size_t nSamples, std::uint16_t *pDst) {
+    static const auto unpack = SelectUnpack();
+    unpack(pSrc, nSamples, pDst);
+}
+
+const char *GetPacked12Kernel() {
+#ifdef PACKED12_X86
+    switch (cpu) {
+    case Cpu::Avx2:
+        return "avx2";
+    case Cpu::Ssse3:
+        return "ssse3";
+    case Cpu::Scalar:
+        break;
+    }
+#endif
+    return "scalar";
+}
+
+void PackFrame12(const FrameBuffer &input, FrameBuffer &output, ThreadPool &pool) {
+    const auto nSamples = input.size() / 2;
+    output.resize(Packed12Size(nSamples));
+    const auto pSrc = reinterpret_cast<const std::uint16_t *>(input.data());
+    const auto pDst = output.data();
+    const auto nChunks = (nSamples + ChunkSamples - 1) / ChunkSamples;
+    pool.ParallelFor(nChunks, [=](std::size_t nBegin, std::size_t nEnd) {
+        const auto nFirst = nBegin * ChunkSamples;
+        const auto nLast = std::min(nSamples, nEnd * ChunkSamples);
+        Pack12(pSrc + nFirst, nLast - nFirst, pDst + nFirst / 2 * 3);
+    });
+}
+
+void UnpackFrame12(const FrameBuffer &input, std::size_t nSamples, FrameBuffer &output, ThreadPool &pool) {
+    output.resize(nSamples * 2);
+    const auto pSrc = input.data();
+    const auto pDst = reinterpret_cast<std::uint16_t *>(output.data());
+    const auto nChunks = (nSamples + ChunkSamples - 1) / ChunkSamples;
+    pool.ParallelFor(nChunks, [=](std::size_t nBegin, std::size_t nEnd) {
+        const auto nFirst = nBegin * ChunkSamples;
+        const auto nLast = std::min(nSamples, nEnd * ChunkSamples);
+        Unpack12(pSrc + nFirst / 2 * 3, nLast - nFirst, pDst + nFirst);
+    });
+}
@@ -0,0 +1,33 @@
+#ifndef PACKED12_H
+#define PACKED12_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "framebuffer.h"
+#include "threadpool.h"
+
+
+//
+// packed 12bit samples for RAW16 frames of 12bit sensors
+// the SDK delivers them MSB aligned (the low 4 bits are 0), so two samples
+// fit in 3 bytes without loss: a[7:0], a[11:8] | b[3:0] << 4, b[11:4]
+// (GenICam Mono12p order). pack and unpack use SSSE3 or AVX2 shuffles when
+// the CPU has them, picked once at run time.
+//
+// bytes of nSamples packed samples
+std::size_t Packed12Size(std::size_t nSamples);
+
+// the low 4 bits of every sample are dropped
+void Pack12(const std::uint16_t *pSrc, std::size_t nSamples, unsigned char *pDst);
+// samples come back MSB aligned
+void Unpack12(const unsigned char *pSrc, std::size_t nSamples, std::uint16_t *pDst);
+
+// "avx2", "ssse3" or "scalar"
+const char *GetPacked12Kernel();
+
+// whole RAW16 frames, split across the pool; output is resized
+void PackFrame12(const FrameBuffer &input, FrameBuffer &output, ThreadPool &pool = ThreadPool::Global());
+void UnpackFrame12(const FrameBuffer &input, std::size_t nSamples, FrameBuffer &output, ThreadPool &pool = ThreadPool::Global());
+
+#endif // PACKED12_H
@@ -0,0 +1,98 @@
+# capture core shared by the GUI, the benchmark and the command line tool
+
+INCLUDEPATH += $$PWD $$PWD/include/
+
+SOURCES += \
+    $$PWD/autoexposure.cpp \
+    $$PWD/blockpool.cpp \
+    $$PWD/calibration.cpp \
+    $$PWD/cameraexecutor.cpp \
+    $$PWD/camerawatchdog.cpp \
+    $$PWD/ccdplayerone.cpp \
+    $$PWD/framebuffer.cpp \
+    $$PWD/framegraph.cpp \
+    $$PWD/framemetadata.cpp \
+    $$PWD/framepool.cpp \
+    $$PWD/framequeue.cpp \
+    $$PWD/framereader.cpp \
+    $$PWD/framestats.cpp \
+    $$PWD/framewriter.cpp \
+    $$PWD/guidepulser.cpp \
+    $$PWD/latencystats.cpp \
+    $$PWD/livestacker.cpp \
+    $$PWD/packed12.cpp \
+    $$PWD/readoutmodel.cpp \
+    $$PWD/ricecodec.cpp \
+    $$PWD/softwarebin.cpp \
+    $$PWD/stardetector.cpp \
+    $$PWD/telemetry.cpp \
+    $$PWD/threadconfig.cpp \
+    $$PWD/threadpool.cpp
+
+HEADERS += \
+    $$PWD/autoexposure.h \
+    $$PWD/blockpool.h \
+    $$PWD/calibration.h \
+    $$PWD/cameraexecutor.h \
+    $$PWD/camerawatchdog.h \
+    $$PWD/ccdplayerone.h \
+    $$PWD/framebuffer.h \
+    $$PWD/framegraph.h \
+    $$PWD/framemetadata.h \
+    $$PWD/framepool.h \
+    $$PWD/framequeue.h \
+    $$PWD/framereader.h \
+    $$PWD/framestats.h \
+    $$PWD/framewriter.h \
+    $$PWD/guidepulser.h \
+    $$PWD/latencystats.h \
+    $$PWD/livestacker.h \
+    $$PWD/logging.hpp \
+    $$PWD/packed12.h \
+    $$PWD/playeronecamera.hpp \
+    $$PWD/readoutmodel.h \
+    $$PWD/ricecodec.h \
+    $$PWD/softwarebin.h \
+    $$PWD/stardetector.h \
+    $$PWD/telemetry.h \
+    $$PWD/threadconfig.h \
+    $$PWD/threadpool.h
+
+defineTest(copyToDestDir) {
+    sources = $$1
+    dest = $$2
+
+    for(FILE, sources) {
+        DDIR = $$dest
+
+        # Replace slashes in paths with backslashes for Windows
+        win32:FILE ~= s,/,\\,g
+        win32:DDIR ~= s,/,\\,g
+
+        QMAKE_POST_LINK += $$QMAKE_COPY $$quote($$FILE) $$quote($$DDIR) $$escape_expand(\\n\\t)
+    }
+
+    export(QMAKE_POST_LINK)
+}
+
+# CONFIG+=playerone_sim links the simulated SDK (sim/playeronesim.pro)
+playerone_sim {
+    POA_LIBDIR = $$PWD/sim/lib
+} else {
+    POA_LIBDIR = $$PWD/lib
+}
+
+unix {
+    QMAKE_LIBDIR_FLAGS += -Wl,-rpath $$POA_LIBDIR
+    LIBS += -L$$POA_LIBDIR/ -lPlayerOneCamera
+}
+win32 {
+    LIBS += $$POA_LIBDIR/PlayerOneCamera.lib
+
+    CONFIG(debug, debug|release) {
+        OUTDIR = $$OUT_PWD/debug
+    } else {
+        OUTDIR = $$OUT_PWD/release
+    }
+    copyToDestDir($$POA_LIBDIR/PlayerOneCamera.dll, $$OUTDIR)
+}
@@ -0,0 +1,656 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "PlayerOneCamera.h"
+
+#include "framebuffer.h"
+#include "logging.hpp"
+
+
+class PlayerOneCamera {
+public:
+    PlayerOneCamera(const POACameraProperties &prop, const std::map<POAConfig, POAConfigAttributes> &attrib, const std::shared_ptr<logging::Logger> &pLogger)
+        : m_CamProp(prop)
+        , m_Attrib(attrib)
+        , m_pLogger(pLogger)
+    {}
+    ~PlayerOneCamera()
+    {}
+
+    static std::vector<std::string> CameraList() {
+        const auto nCount = POAGetCameraCount();
+        if (nCount <= 0) {
+            // No camera detected.
+            return std::vector<std::string>();
+        }
+
+        // build camera list
+        std::vector<std::string> result;
+        result.reserve(nCount);
+        for (int i = 0; i < nCount; ++i) {
+            POACameraProperties prop = {};
+            if (POAGetCameraProperties(i, &prop) != POA_OK) {
+                // something wrong...
+                result.push_back(std::string());
+                continue;
+            }
+            result.push_back(prop.cameraModelName);
+        }
+        return result;
+    }
+
+    // index of the camera with serial number (or model name) `name`
+    static std::optional<int> FindIndex(const std::string &name) {
+        const auto nCount = POAGetCameraCount();
+        for (int i = 0; i < nCount; ++i) {
+            POACameraProperties prop = {};
+            if (POAGetCameraProperties(i, &prop) != POA_OK) {
+                continue;
+            }
+            if ( name == prop.SN || name == prop.cameraModelName ) {
+                return i;
+            }
+        }
+        return std::nullopt;
+    }
+
+    static std::shared_ptr<PlayerOneCamera> Open(int nIndex) {
+        LOGGING_GLOBAL_DECL();
+        LOGGING_GLOBAL_LOG_CREATE("gbxccd_playerone.log");
+
+        const auto nCameraCount = POAGetCameraCount();
+        if (nIndex < 0 || nIndex >= nCameraCount) {
+            // Out of range
+            LOGGING_GLOBAL_LOG_ERROR("Out of range: Count: ", nCameraCount, "At: ", nIndex);
+            return nullptr;
+        }
+
+        POAErrors nErr = POAErrors::POA_OK;
+        POACameraProperties prop = {};
+        if ( (nErr = POAGetCameraProperties(nIndex, &prop)) != POA_OK ) {
+            LOGGING_GLOBAL_LOG_ERROR("GetCameraProperties failed: ", nErr);
+            return nullptr;
+        }
+
+        if ( (nErr = POAOpenCamera(prop.cameraID)) != POA_OK ) {
+            LOGGING_GLOBAL_LOG_ERROR("OpenCamera failed: ", nErr);
+            return nullptr;
+        }
+
+        if ( (nErr = POAInitCamera(prop.cameraID)) != POA_OK ) {
+            LOGGING_GLOBAL_LOG_ERROR("InitCamera failed: ", nErr);
+            return nullptr;
+        }
+
+        return Create(prop);
+    }
+
+    POACameraProperties m_CamProp;
+    std::map<POAConfig, POAConfigAttributes> m_Attrib;
+    LOGGING_DECL();
+
+protected:
+    static std::shared_ptr<PlayerOneCamera> Create(const POACameraProperties &prop) {
+        std::shared_ptr<logging::Logger> pLogger;
+        LOGGING_CREATE_IMPL(pLogger, std::string("gbxccd_playerone_") + prop.cameraModelName + ".log");
+
+        std::map<POAConfig, POAConfigAttributes> attributes;
+        POAErrors nErr = POAErrors::POA_OK;
+        int nAttribCount = 0;
+        if ( (nErr = POAGetConfigsCount(prop.cameraID, &nAttribCount)) != POA_OK ) {
+            LOGGING_ERROR0(pLogger, "GetConfigsCount failed: ", nErr);
+            return nullptr;
+        }
+        LOGGING_INFO0(pLogger, "ConfigsCount: ", nAttribCount);
+        for (int i = 0; i < nAttribCount; ++i) {
+            POAConfigAttributes attrib;
+            if ( (nErr = POAGetConfigAttributes(prop.cameraID, i, &attrib)) == POA_OK ) {
+                LOGGING_INFO0(pLogger, "GetConfigAttributes[", i, "]:");
+                LOGGING_INFO0(pLogger, "  ID: ", attrib.configID);
+                LOGGING_INFO0(pLogger, "  IsSupportAuto: ", attrib.isSupportAuto);
+                LOGGING_INFO0(pLogger, "  IsWritable: ", attrib.isWritable);
+                LOGGING_INFO0(pLogger, "  IsReadable: ", attrib.isReadable);
+                LOGGING_INFO0(pLogger, "  ValueType: ", attrib.valueType);
+                if ( attrib.valueType == POAValueType::VAL_BOOL ) {
+                    LOGGING_INFO0(pLogger, "  MinValue: ", attrib.minValue.boolValue);
+                    LOGGING_INFO0(pLogger, "  MaxValue: ", attrib.maxValue.boolValue);
+                    LOGGING_INFO0(pLogger, "  DefaultValue: ", attrib.defaultValue.boolValue);
+                } else if ( attrib.valueType == POAValueType::VAL_FLOAT ) {
+                    LOGGING_INFO0(pLogger, "  MinValue: ", attrib.minValue.floatValue);
+                    LOGGING_INFO0(pLogger, "  MaxValue: ", attrib.maxValue.floatValue);
+                    LOGGING_INFO0(pLogger, "  DefaultValue: ", attrib.defaultValue.floatValue);
+                } else if ( attrib.valueType == POAValueType::VAL_INT ) {
+                    LOGGING_INFO0(pLogger, "  MinValue: ", attrib.minValue.intValue);
+                    LOGGING_INFO0(pLogger, "  MaxValue: ", attrib.maxValue.intValue);
+                    LOGGING_INFO0(pLogger, "  DefaultValue: ", attrib.defaultValue.intValue);
+                }
+                attributes.emplace(attrib.configID, attrib);
+            }
+            else {
+                LOGGING_ERROR0(pLogger, "GetConfigAttributes failed [", i, "]: ", nErr);
+            }
+        }
+
+        return std::make_shared<PlayerOneCamera>(prop, attributes, pLogger);
+    }
+
+public:
+    auto cameraID() const -> decltype(POACameraProperties::cameraID) {
+        return m_CamProp.cameraID;
+    }
+    void Close() {
+        LOGGING_INFO("CloseCamera");
+        POACloseCamera(cameraID());
+    }
+    std::tuple<int, int> GetMaxImageSize() const {
+        return std::make_tuple(m_CamProp.maxWidth, m_CamProp.maxHeight);
+    }
+    std::optional<std::tuple<long, long, long>> GetExposureRange() const {
+        return GetIntRange(POAConfig::POA_EXPOSURE);
+    }
+    std::optional<std::tuple<long, long, long>> GetGainRange() const {
+        return GetIntRange(POAConfig::POA_GAIN);
+    }
+
+    std::string GetDeviceName() const {
+        return m_CamProp.cameraModelName;
+    }
+
+    long GetCurrentExposure() {
+        auto exp = GetExposure();
+        if ( ! exp ) {
+            const auto it = m_Attrib.find(POAConfig::POA_EXPOSURE);
+            if ( it == m_Attrib.end() ) {
+                return -1;
+            }
+            return it->second.defaultValue.intValue;
+        }
+        return *exp;
+    }
+    std::optional<long> GetExposure() {
+        auto ret = GetIntConfig(POAConfig::POA_EXPOSURE);
+        if ( ! ret ) {
+            LOGGING_ERROR("GetExposure failed.");
+            return std::nullopt;
+        }
+        return std::get<0>(*ret);
+    }
+    bool SetExposure(long nExposure) {
+        const auto bRet = SetIntConfig(POAConfig::POA_EXPOSURE, nExposure, POABool::POA_FALSE);
+        if ( ! bRet ) {
+            LOGGING_ERROR("SetExposure failed.");
+        }
+        return bRet;
+    }
+
+    long GetCurrentGain() {
+        auto gain = GetGain();
+        if ( ! gain ) {
+            const auto it = m_Attrib.find(POAConfig::POA_GAIN);
+            if ( it == m_Attrib.end() ) {
+                return -1;
+            }
+            return it->second.defaultValue.intValue;
+        }
+        return *gain;
+    }
+    std::optional<long> GetGain() {
+        auto ret = GetIntConfig(POAConfig::POA_GAIN);
+        if ( ! ret ) {
+            LOGGING_ERROR("GetGain failed.");
+            return std::nullopt;
+        }
+        return std::get<0>(*ret);
+    }
+    bool SetGain(long nGain) {
+        const auto bRet = SetIntConfig(POAConfig::POA_GAIN, nGain, POABool::POA_FALSE);
+        if ( ! bRet ) {
+            LOGGING_ERROR("SetGain failed.");
+        }
+        return bRet;
+    }
+
+    std::optional<long> GetOffset() {
+        auto ret = GetIntConfig(POAConfig::POA_OFFSET);
+        if ( ! ret ) {
+            LOGGING_ERROR("GetOffset failed.");
+            return std::nullopt;
+        }
+        return std::get<0>(*ret);
+    }
+    bool SetOffset(long nOffset) {
+        const auto bRet = SetIntConfig(POAConfig::POA_OFFSET, nOffset, POABool::POA_FALSE);
+        if ( ! bRet ) {
+            LOGGING_ERROR("SetOffset failed.");
+        }
+        return bRet;
+    }
+
+    // sensor temperature (C)
+    std::optional<double> GetTemperature() {
+        auto ret = GetFloatConfig(POAConfig::POA_TEMPERATURE);
+        if ( ! ret ) {
+            LOGGING_ERROR("GetTemperature failed.");
+            return std::nullopt;
+        }
+        return *ret;
+    }
+
+    bool HasCooler() const {
+        return m_CamProp.isHasCooler == POABool::POA_TRUE;
+    }
+    // cooler power (percent)
+    std::optional<long> GetCoolerPower() {
+        auto ret = GetIntConfig(POAConfig::POA_COOLER_POWER);
+        if ( ! ret ) {
+            LOGGING_ERROR("GetCoolerPower failed.");
+            return std::nullopt;
+        }
+        return std::get<0>(*ret);
+    }
+    // cooler set point (C)
+    std::optional<long> GetTargetTemperature() {
+        auto ret = GetIntConfig(POAConfig::POA_TARGET_TEMP);
+        if ( ! ret ) {
+            LOGGING_ERROR("GetTargetTemperature failed.");
+            return std::nullopt;
+        }
+        return std::get<0>(*ret);
+    }
+    bool SetTargetTemperature(long nTemperature) {
+        const auto bRet = SetIntConfig(POAConfig::POA_TARGET_TEMP, nTemperature, POABool::POA_FALSE);
+        if ( ! bRet ) {
+            LOGGING_ERROR("SetTargetTemperature failed.");
+        }
+        return bRet;
+    }
+    std::optional<bool> GetCooler() {
+        auto ret = GetBoolConfig(POAConfig::POA_COOLER);
+        if ( ! ret ) {
+            LOGGING_ERROR("GetCooler failed.");
+            return std::nullopt;
+        }
+        return *ret;
+    }
+    bool SetCooler(bool bEnable) {
+        const auto bRet = SetBoolConfig(POAConfig::POA_COOLER, bEnable);
+        if ( ! bRet ) {
+            LOGGING_ERROR("SetCooler failed.");
+        }
+        return bRet;
+    }
+
+    // USB bandwidth limit (percent)
+    std::optional<std::tuple<long, long, long>> GetUsbBandwidthLimitRange() const {
+        return GetIntRange(POAConfig::POA_USB_BANDWIDTH_LIMIT);
+    }
+    std::optional<long> GetUsbBandwidthLimit() {
+        auto ret = GetIntConfig(POAConfig::POA_USB_BANDWIDTH_LIMIT);
+        if ( ! ret ) {
+            LOGGING_ERROR("GetUsbBandwidthLimit failed.");
+            return std::nullopt;
+        }
+        return std::get<0>(*ret);
+    }
+    bool SetUsbBandwidthLimit(long nLimit) {
+        const auto bRet = SetIntConfig(POAConfig::POA_USB_BANDWIDTH_LIMIT, nLimit, POABool::POA_FALSE);
+        if ( ! bRet ) {
+            LOGGING_ERROR("SetUsbBandwidthLimit failed.");
+        }
+        return bRet;
+    }
+
+    // frame rate limit (fps, 0: no limit)
+    std::optional<std::tuple<long, long, long>> GetFrameLimitRange() const {
+        return GetIntRange(POAConfig::POA_FRAME_LIMIT);
+    }
+    std::optional<long> GetFrameLimit() {
+        auto ret = GetIntConfig(POAConfig::POA_FRAME_LIMIT);
+        if ( ! ret ) {
+            LOGGING_ERROR("GetFrameLimit failed.");
+            return std::nullopt;
+        }
+        return std::get<0>(*ret);
+    }
+    bool SetFrameLimit(long nLimit) {
+        const auto bRet = SetIntConfig(POAConfig::POA_FRAME_LIMIT, nLimit, POABool::POA_FALSE);
+        if ( ! bRet ) {
+            LOGGING_ERROR("SetFrameLimit failed.");
+        }
+        return bRet;
+    }
+
+    // high quality image (cameras without DDR)
+    std::optional<bool> GetHQI() {
+        auto ret = GetBoolConfig(POAConfig::POA_HQI);
+        if ( ! ret ) {
+            LOGGING_ERROR("GetHQI failed.");
+            return std::nullopt;
+        }
+        return *ret;
+    }
+    bool SetHQI(bool bEnable) {
+        const auto bRet = SetBoolConfig(POAConfig::POA_HQI, bEnable);
+        if ( ! bRet ) {
+            LOGGING_ERROR("SetHQI failed.");
+        }
+        return bRet;
+    }
+
+    bool HasConfig(POAConfig configID) const {
+        return m_Attrib.find(configID) != m_Attrib.end();
+    }
+
+    bool HasST4Port() const {
+        return m_CamProp.isHasST4Port == POABool::POA_TRUE;
+    }
+    // POA_GUIDE_NORTH / SOUTH / EAST / WEST on or off.
+    // logs failures only, the call sits on the guide pulse timing path.
+    bool SetGuideOutput(POAConfig configID, bool bOn) {
+        POAConfigValue value;
+        value.boolValue = bOn ? POABool::POA_TRUE : POABool::POA_FALSE;
+        const auto nErr = POASetConfig(cameraID(), configID, value, POABool::POA_FALSE);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("SetGuideOutput failed. id:", configID, " code:", nErr);
+            return false;
+        }
+        return true;
+    }
+
+    std::optional<std::tuple<int, int>> GetImageSize() {
+        int nWidth = 0, nHeight = 0;
+        const auto nErr = POAGetImageSize(cameraID(), &nWidth, &nHeight);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("GetImageSize failed. code:", nErr);
+            return std::nullopt;
+        }
+        LOGGING_INFO("GetImageSize: width:", nWidth, ", height:", nHeight);
+        return std::make_tuple(nWidth, nHeight);
+    }
+
+    bool SetImageSize(int nWidth, int nHeight) {
+        LOGGING_INFO("SetImageSize: width:", nWidth, " height:", nHeight);
+        const auto nErr = POASetImageSize(cameraID(), nWidth, nHeight);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("SetImageSize failed. code:", nErr);
+            return false;
+        }
+        return true;
+    }
+
+    // SDK constraints: width % 4 == 0, height % 2 == 0, inside the sensor at nBin.
+    // color sensors keep an even start position to preserve the bayer phase.
+    std::tuple<int, int, int, int> AlignROI(int nStartX, int nStartY, int nWidth, int nHeight, int nBin) const {
+        nBin = std::max(nBin, 1);
+        const auto nMaxWidth = m_CamProp.maxWidth / nBin / 4 * 4;
+        const auto nMaxHeight = m_CamProp.maxHeight / nBin / 2 * 2;
+        nWidth = std::clamp(nWidth, 4, std::max(nMaxWidth, 4)) / 4 * 4;
+        nHeight = std::clamp(nHeight, 2, std::max(nMaxHeight, 2)) / 2 * 2;
+        nStartX = std::clamp(nStartX, 0, std::max(m_CamProp.maxWidth / nBin - nWidth, 0));
+        nStartY = std::clamp(nStartY, 0, std::max(m_CamProp.maxHeight / nBin - nHeight, 0));
+        if ( m_CamProp.isColorCamera == POABool::POA_TRUE ) {
+            nStartX &= ~1;
+            nStartY &= ~1;
+        }
+        return std::make_tuple(nStartX, nStartY, nWidth, nHeight);
+    }
+
+    std::optional<POAImgFormat> GetImageFormat() {
+        POAImgFormat fmt;
+        const auto nErr = POAGetImageFormat(cameraID(), &fmt);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("GetImageFormat failed. code:", nErr);
+            return std::nullopt;
+        }
+        LOGGING_INFO("GetImageFormat: ", fmt);
+        return fmt;
+    }
+
+    bool SetImageFormat(POAImgFormat fmt) {
+        LOGGING_INFO("SetImageFormat: ", fmt);
+        const auto nErr = POASetImageFormat(cameraID(), fmt);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("SetImageFormat failed. code:", nErr);
+            return false;
+        }
+        return true;
+    }
+
+    std::optional<int> GetDroppedImagesCount() {
+        int nCount = 0;
+        const auto nErr = POAGetDroppedImagesCount(cameraID(), &nCount);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("GetDroppedImagesCount failed. code:", nErr);
+            return std::nullopt;
+        }
+        return nCount;
+    }
+
+    std::optional<bool> ImageReady() {
+        POABool isReady = POABool::POA_FALSE;
+        const auto nErr = POAImageReady(cameraID(), &isReady);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("ImageReady failed. code:", nErr);
+            return std::nullopt;
+        }
+        LOGGING_INFO("ImageReady: ", isReady);
+        return isReady == POABool::POA_TRUE;
+    }
+
+    std::optional<POACameraState> GetCameraState() {
+        POACameraState state;
+        const auto nErr = POAGetCameraState(cameraID(), &state);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("GetCameraState failed. code:", nErr);
+            return std::nullopt;
+        }
+        LOGGING_INFO("GetCameraState: ", state);
+        return state;
+    }
+    // POA_OK, or the error that says the handle is no longer usable
+    POAErrors CheckConnection() {
+        POACameraState state;
+        const auto nErr = POAGetCameraState(cameraID(), &state);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("CheckConnection failed. code:", nErr);
+            return nErr;
+        }
+        return state == POACameraState::STATE_CLOSED ? POAErrors::POA_ERROR_NOT_OPENED : POAErrors::POA_OK;
+    }
+
+    bool GetImageData(FrameBuffer& buffer, int timeout_ms = -1) {
+        LOGGING_INFO("GetImageData: ", buffer.size(), "bytes timeout: ", timeout_ms);
+        const auto nErr = POAGetImageData(cameraID(), buffer.data(), buffer.size(), timeout_ms);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("GetImageData failed. code:", nErr);
+        }
+        LOGGING_INFO("OK");
+        return nErr == POAErrors::POA_OK;
+    }
+
+    bool StartExposure() {
+        const auto nErr = POAStartExposure(cameraID(), POABool::POA_TRUE);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("StartExposure failed. code:", nErr);
+            return false;
+        }
+        LOGGING_INFO("StartExposure");
+        return true;
+    }
+    bool StartLiveView() {
+        const auto nErr = POAStartExposure(cameraID(), POABool::POA_FALSE);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("StartLiveView failed. code:", nErr);
+            return false;
+        }
+        LOGGING_INFO("StartLiveView");
+        return true;
+    }
+
+    bool StopExposure() {
+        const auto nErr = POAStopExposure(cameraID());
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("StopExposure failed. code:", nErr);
+        }
+        LOGGING_INFO("StopExposure");
+        return nErr == POAErrors::POA_OK;
+    }
+
+    std::optional<int> GetImageBin() {
+        int nBin = 0;
+        const auto nErr = POAGetImageBin(cameraID(), &nBin);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("GetImageBin failed. code:", nErr);
+            return std::nullopt;
+        }
+        LOGGING_INFO("GetImageBin: ", nBin);
+        return nBin;
+    }
+
+    bool SetImageBin(int nBin) {
+        LOGGING_INFO("SetImageBin: ", nBin);
+        const auto nErr = POASetImageBin(cameraID(), nBin);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("SetImageBin failed. code:", nErr);
+            return false;
+        }
+        return true;
+    }
+
+    std::optional<std::tuple<int, int>> GetImageStartPos() {
+        int nStartX, nStartY;
+        const auto nErr = POAGetImageStartPos(cameraID(), &nStartX, &nStartY);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("GetImageStartPos failed. code:", nErr);
+            return std::nullopt;
+        }
+        LOGGING_INFO("GetImageStartPos: x:", nStartX, "y:", nStartY);
+        return std::make_tuple(nStartX, nStartY);
+    }
+
+    bool SetImageStartPos(int nStartX, int nStartY) {
+        LOGGING_INFO("SetImageStartPos: x:", nStartX, " y:", nStartY);
+        const auto nErr = POASetImageStartPos(cameraID(), nStartX, nStartY);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("SetImageStartPos failed. code:", nErr);
+            return false;
+        }
+        return true;
+    }
+
+protected:
+    std::optional<std::tuple<long, POABool>> GetIntConfig(POAConfig config) {
+        POAConfigValue value;
+        POABool isAuto;
+        POAErrors nErr;
+        if ( (nErr = POAGetConfig(cameraID(), config, &value, &isAuto)) != POAErrors::POA_OK ) {
+            LOGGING_ERROR("GetConfig (int) failed: ", nErr);
+            return std::nullopt;
+        }
+        LOGGING_INFO("GetConfig: id:", config, " value:", value.intValue, " isAuto:", isAuto);
+        return std::make_tuple(value.intValue, isAuto);
+    }
+    bool SetIntConfig(POAConfig config, long nValue, POABool isAuto) {
+        POAConfigValue value;
+        value.intValue = nValue;
+        LOGGING_INFO("SetConfig: id:", config, " value:", nValue, " isAuto:", isAuto);
+        const auto nErr = POASetConfig(cameraID(), config, value, isAuto);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("SetConfig (int) failed: ", nErr);
+        }
+        LOGGING_INFO("OK");
+        return nErr == POAErrors::POA_OK;
+    }
+
+    std::optional<double> GetFloatConfig(POAConfig config) {
+        POAConfigValue value;
+        POABool isAuto;
+        POAErrors nErr;
+        if ( (nErr = POAGetConfig(cameraID(), config, &value, &isAuto)) != POAErrors::POA_OK ) {
+            LOGGING_ERROR("GetConfig (float) failed: ", nErr);
+            return std::nullopt;
+        }
+        LOGGING_INFO("GetConfig: id:", config, " value:", value.floatValue);
+        return value.floatValue;
+    }
+    std::optional<bool> GetBoolConfig(POAConfig config) {
+        POAConfigValue value;
+        POABool isAuto;
+        POAErrors nErr;
+        if ( (nErr = POAGetConfig(cameraID(), config, &value, &isAuto)) != POAErrors::POA_OK ) {
+            LOGGING_ERROR("GetConfig (bool) failed: ", nErr);
+            return std::nullopt;
+        }
+        LOGGING_INFO("GetConfig: id:", config, " value:", value.boolValue);
+        return value.boolValue == POABool::POA_TRUE;
+    }
+    bool SetBoolConfig(POAConfig config, bool bValue) {
+        POAConfigValue value;
+        value.boolValue = bValue ? POABool::POA_TRUE : POABool::POA_FALSE;
+        LOGGING_INFO("SetConfig: id:", config, " value:", bValue);
+        const auto nErr = POASetConfig(cameraID(), config, value, POABool::POA_FALSE);
+        if ( nErr != POAErrors::POA_OK ) {
+            LOGGING_ERROR("SetConfig (bool) failed: ", nErr);
+        }
+        LOGGING_INFO("OK");
+        return nErr == POAErrors::POA_OK;
+    }
+
+    // (min, max, default)
+    std::optional<std::tuple<long, long, long>> GetIntRange(POAConfig configID) const {
+        const auto it = m_Attrib.find(configID);
+        if ( it == m_Attrib.end() ) {
+            return std::nullopt;
+        }
+        if ( it->second.valueType != POAValueType::VAL_INT) {
+            return std::nullopt;
+        }
+        return std::make_tuple(it->second.minValue.intValue, it->second.maxValue.intValue, it->second.defaultValue.intValue);
+    }
+    std::optional<std::tuple<double, double, double>> GetFloatRange(POAConfig configID) const {
+        const auto it = m_Attrib.find(configID);
+        if ( it == m_Attrib.end() ) {
+            return std::nullopt;
+        }
+        if ( it->second.valueType != POAValueType::VAL_FLOAT ) {
+            return std::nullopt;
+        }
+        return std::make_tuple(it->second.minValue.floatValue, it->second.maxValue.floatValue, it->second.defaultValue.floatValue);
+    }
+
+};
+
+
+// the camera was closed under us or went away (unplugged, USB reset)
+inline bool IsConnectionLost(POAErrors nErr) {
+    return nErr == POAErrors::POA_ERROR_NOT_OPENED || nErr == POAErrors::POA_ERROR_INVALID_ID
+           || nErr == POAErrors::POA_ERROR_DEVICE_NOT_FOUND;
+}
+
+// (bits, bytes)
+inline std::tuple<int, int> PlayerOneImgFormatSize(POAImgFormat fmt) {
+    switch (fmt) {
+    case POAImgFormat::POA_RAW8:
+    case POAImgFormat::POA_MONO8:
+        return std::make_tuple(8, 1);
+    case POAImgFormat::POA_RAW16:
+        return std::make_tuple(16, 2);
+    case POAImgFormat::POA_RGB24:
+        return std::make_tuple(24, 3);
+    case POAImgFormat::POA_END:
+        assert(false);
+        break;
+    }
+#ifdef _DEBUG
+    assert(false);
+#endif  // _DEBUG
+    return std::make_tuple(1, 1);
+}
@@ -0,0 +1,202 @@
+#include "readoutmodel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <tuple>
+
+#include "playeronecamera.hpp"
+
+
+namespace {
+
+// weight of the older samples per new one, ~20 downloads of memory
+constexpr double Forget = 0.95;
+// smoothing of the per frame overheads
+constexpr double OverheadAlpha = 0.1;
+// downloads before the fit replaces the guess
+constexpr std::uint64_t MinSamples = 3;
+// x spread (relative) below which the line goes through the origin
+constexpr double MinRelativeSpread = 0.01;
+
+// before the first downloads: a conservative link throughput
+constexpr double GuessFixedMs = 2.0;
+constexpr double GuessMsPerMByteUsb3 = 1000.0 / 200.0;
+constexpr double GuessMsPerMByteUsb2 = 1000.0 / 25.0;
+
+double MBytes(std::size_t nBytes) {
+    return nBytes / 1e6;
+}
+
+std::chrono::microseconds Microseconds(double dMs) {
+    return std::chrono::microseconds(std::llround(std::max(0.0, dMs) * 1000.0));
+}
+
+double Milliseconds(std::chrono::microseconds duration) {
+    return duration.count() / 1000.0;
+}
+
+double Smooth(double dPrevious, double dValue) {
+    return dPrevious < 0 ? dValue : dPrevious + OverheadAlpha * (dValue - dPrevious);
+}
+
+const char *FormatName(int nFormat) {
+    switch (nFormat) {
+    case POA_RAW8:
+        return "RAW8";
+    case POA_RAW16:
+        return "RAW16";
+    case POA_RGB24:
+        return "RGB24";
+    case POA_MONO8:
+        return "MONO8";
+    }
+    return "?";
+}
+
+}  // namespace
+
+
+bool ReadoutKey::operator<(const ReadoutKey &other) const {
+    return std::tie(nFormat, nBin, bUsb3) < std::tie(other.nFormat, other.nBin, other.bUsb3);
+}
+
+
+void ReadoutModel::LineFit::Add(double dX, double dY) {
+    if ( nSamples > 0 ) {
+        const auto dResidual = dY - Predict(dX);
+        dVariance = Forget * dVariance + (1 - Forget) * dResidual * dResidual;
+    }
+    dWeight = Forget * dWeight + 1;
+    dSumX = Forget * dSumX + dX;
+    dSumY = Forget * dSumY + dY;
+    dSumXX = Forget * dSumXX + dX * dX;
+    dSumXY = Forget * dSumXY + dX * dY;
+    ++nSamples;
+}
+
+std::pair<double, double> ReadoutModel::LineFit::Solve() const {
+    if ( dWeight <= 0 ) {
+        return { 0, 0 };
+    }
+    const auto dMeanX = dSumX / dWeight;
+    const auto dMeanY = dSumY / dWeight;
+    const auto dVarX = dSumXX / dWeight - dMeanX * dMeanX;
+    if ( dVarX > (MinRelativeSpread * dMeanX) * (MinRelativeSpread * dMeanX) ) {
+        const auto dSlope = (dSumXY / dWeight - dMeanX * dMeanY) / dVarX;
+        const auto dFixed = dMeanY - dSlope * dMeanX;
+        if ( dSlope >= 0 && dFixed >= 0 ) {
+            return { dFixed, dSlope };
+        }
+    }
+    // one ROI so far (or a fit that makes no sense): proportional to the size
+    if ( dMeanX <= 0 ) {
+        return { dMeanY, 0 };
+    }
+    return { 0, dMeanY / dMeanX };
+}
+
+double ReadoutModel::LineFit::Predict(double dX) const {
+    const auto [dFixed, dSlope] = Solve();
+    return dFixed + dSlope * dX;
+}
+
+
+ReadoutModel::ReadoutModel()
+    : mtx()
+    , entries()
+{}
+
+void ReadoutModel::RecordDownload(const ReadoutKey &key, std::size_t nBytes, std::chrono::microseconds duration) {
+    std::lock_guard<std::mutex> lock(mtx);
+    entries[key].download.Add(MBytes(nBytes), Milliseconds(duration));
+}
+
+void ReadoutModel::RecordExposureOverhead(const ReadoutKey &key, std::chrono::microseconds overhead) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto &entry = entries[key];
+    entry.dExposureOverheadMs = Smooth(entry.dExposureOverheadMs, std::max(0.0, Milliseconds(overhead)));
+}
+
+void ReadoutModel::RecordLiveOverhead(const ReadoutKey &key, std::chrono::microseconds overhead) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto &entry = entries[key];
+    entry.dLiveOverheadMs = Smooth(entry.dLiveOverheadMs, std::max(0.0, Milliseconds(overhead)));
+}
+
+void ReadoutModel::Reset() {
+    std::lock_guard<std::mutex> lock(mtx);
+    entries.clear();
+}
+
+ReadoutEstimate ReadoutModel::Estimate(const ReadoutKey &key, std::size_t nBytes) const {
+    ReadoutEstimate estimate;
+    const auto it = entries.find(key);
+    if ( it != entries.end() ) {
+        const auto &entry = it->second;
+        estimate.exposureOverhead = Microseconds(entry.dExposureOverheadMs);
+        estimate.liveOverhead = Microseconds(entry.dLiveOverheadMs);
+        if ( entry.download.nSamples >= MinSamples ) {
+            estimate.download = Microseconds(entry.download.Predict(MBytes(nBytes)));
+            estimate.spread = Microseconds(std::sqrt(entry.download.dVariance));
+            estimate.nSamples = entry.download.nSamples;
+            return estimate;
+        }
+    }
+    const auto dGuessMs = GuessFixedMs + MBytes(nBytes) * (key.bUsb3 ? GuessMsPerMByteUsb3 : GuessMsPerMByteUsb2);
+    estimate.download = Microseconds(dGuessMs);
+    estimate.spread = Microseconds(dGuessMs / 2);
+    return estimate;
+}
+
+ReadoutEstimate ReadoutModel::Predict(const ReadoutKey &key, std::size_t nBytes) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return Estimate(key, nBytes);
+}
+
+std::chrono::milliseconds ReadoutModel::GetDownloadTimeout(const ReadoutKey &key, std::size_t nBytes) const {
+    const auto estimate = Predict(key, nBytes);
+    const auto dDownloadMs = Milliseconds(estimate.download);
+    const auto dSpreadMs = Milliseconds(estimate.spread);
+    // the guess is for a slow link already, a slow start (first frame after
+    // a format change) still fits
+    const auto dTimeoutMs = estimate.nSamples == 0 ? 4 * dDownloadMs + 500 : 3 * (dDownloadMs + 4 * dSpreadMs) + 100;
+    return std::chrono::milliseconds(std::llround(std::ceil(dTimeoutMs)));
+}
+
+std::chrono::microseconds ReadoutModel::PredictFrameInterval(const ReadoutKey &key, std::size_t nBytes, std::chrono::microseconds exposure, bool bLiveView) const {
+    const auto estimate = Predict(key, nBytes);
+    if ( bLiveView ) {
+        return std::max(exposure, estimate.download) + estimate.liveOverhead;
+    }
+    return exposure + estimate.exposureOverhead + estimate.download;
+}
+
+std::vector<ReadoutProfile> ReadoutModel::GetProfiles() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<ReadoutProfile> profiles;
+    for (const auto &[key, entry] : entries) {
+        ReadoutProfile profile;
+        profile.key = key;
+        std::tie(profile.dFixedMs, profile.dMsPerMByte) = entry.download.Solve();
+        profile.dSpreadMs = std::sqrt(entry.download.dVariance);
+        profile.dExposureOverheadMs = std::max(0.0, entry.dExposureOverheadMs);
+        profile.dLiveOverheadMs = std::max(0.0, entry.dLiveOverheadMs);
+        profile.nSamples = entry.download.nSamples;
+        profiles.push_back(profile);
+    }
+    return profiles;
+}
+
+std::string ReadoutModel::GetReport() const {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2);
+    for (const auto &profile : GetProfiles()) {
+        oss << FormatName(profile.key.nFormat) << " bin" << profile.key.nBin << (profile.key.bUsb3 ? " USB3" : " USB2")
+            << ": " << profile.dFixedMs << " ms + " << profile.dMsPerMByte << " ms/MB"
+            << " (sd " << profile.dSpreadMs << " ms, " << profile.nSamples << " frames)"
+            << " overhead exposure " << profile.dExposureOverheadMs << " ms, live " << profile.dLiveOverheadMs << " ms\n";
+    }
+    return oss.str();
+}
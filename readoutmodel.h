@@ -0,0 +1,103 @@
+#ifndef READOUTMODEL_H
+#define READOUTMODEL_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// what the download time of a frame depends on besides its size
+struct ReadoutKey {
+    int nFormat = 0;        // POAImgFormat
+    int nBin = 1;           // hardware bin
+    bool bUsb3 = true;      // POACameraProperties::isUSB3Speed
+
+    bool operator<(const ReadoutKey &other) const;
+};
+
+struct ReadoutEstimate {
+    std::chrono::microseconds download{0};      // GetImageData
+    std::chrono::microseconds spread{0};        // standard deviation of download
+    // per frame on top of exposure and download: state polls, ImageReady,
+    // command latency (single frames) or the stream gaps (live view)
+    std::chrono::microseconds exposureOverhead{0};
+    std::chrono::microseconds liveOverhead{0};
+    std::uint64_t nSamples = 0;                 // downloads behind it, 0: USB speed guess
+};
+
+// the fit of one key
+struct ReadoutProfile {
+    ReadoutKey key;
+    double dFixedMs = 0;        // download time of an empty frame
+    double dMsPerMByte = 0;
+    double dSpreadMs = 0;
+    double dExposureOverheadMs = 0;
+    double dLiveOverheadMs = 0;
+    std::uint64_t nSamples = 0;
+};
+
+//
+// running model of the frame readout of one camera
+// every download is recorded with its size; per format, hardware bin and USB
+// speed an exponentially weighted least squares line (fixed part + time per
+// byte, the ROI only changes the size) and the spread around it follow the
+// link as it speeds up or slows down. it gives the GetImageData timeout and
+// the frame interval of a planned capture. thread safe.
+//
+class ReadoutModel {
+public:
+    ReadoutModel();
+
+    void RecordDownload(const ReadoutKey &key, std::size_t nBytes, std::chrono::microseconds duration);
+    // single frame: StartExposure issued -> ImageReady, minus the exposure
+    void RecordExposureOverhead(const ReadoutKey &key, std::chrono::microseconds overhead);
+    // live view: frame interval minus max(exposure, download)
+    void RecordLiveOverhead(const ReadoutKey &key, std::chrono::microseconds overhead);
+    // e.g. after a USB bandwidth change
+    void Reset();
+
+    ReadoutEstimate Predict(const ReadoutKey &key, std::size_t nBytes) const;
+    // for GetImageData once ImageReady said yes: a few spreads above the
+    // prediction, generous while there are few samples
+    std::chrono::milliseconds GetDownloadTimeout(const ReadoutKey &key, std::size_t nBytes) const;
+    // start of one frame to the start of the next; live view overlaps the
+    // exposure with the transfer of the previous frame
+    std::chrono::microseconds PredictFrameInterval(const ReadoutKey &key, std::size_t nBytes, std::chrono::microseconds exposure, bool bLiveView) const;
+
+    std::vector<ReadoutProfile> GetProfiles() const;
+    // one line per profile
+    std::string GetReport() const;
+
+private:
+    // exponentially weighted least squares of y = a + b x
+    struct LineFit {
+        double dWeight = 0;
+        double dSumX = 0;
+        double dSumY = 0;
+        double dSumXX = 0;
+        double dSumXY = 0;
+        double dVariance = 0;   // of the residuals
+        std::uint64_t nSamples = 0;
+
+        void Add(double dX, double dY);
+        // a, b; through the origin while x has barely varied
+        std::pair<double, double> Solve() const;
+        double Predict(double dX) const;
+    };
+    struct Entry {
+        LineFit download;       // x: MB, y: ms
+        double dExposureOverheadMs = -1;    // -1: none yet
+        double dLiveOverheadMs = -1;
+    };
+
+    ReadoutEstimate Estimate(const ReadoutKey &key, std::size_t nBytes) const;
+
+    mutable std::mutex mtx;
+    std::map<ReadoutKey, Entry> entries;
+};
+
+#endif // READOUTMODEL_H
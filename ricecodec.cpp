@@ -0,0 +1,275 @@
+#include "ricecodec.h"
+
+#include <algorithm>
+#include <type_traits>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+namespace {
+
+// split code width, largest split and raw sample width per sample size,
+// as in cfitsio. the first sample of a tile is stored with xor nFirstXor:
+// RAW16 goes through the signed BZERO convention, RAW8 stays unsigned.
+template <typename T> struct RiceTraits;
+
+template <> struct RiceTraits<std::uint8_t> {
+    static constexpr unsigned FsBits = 3;
+    static constexpr unsigned FsMax = 6;
+    static constexpr unsigned BBits = 8;
+    static constexpr std::uint32_t nFirstXor = 0;
+};
+
+template <> struct RiceTraits<std::uint16_t> {
+    static constexpr unsigned FsBits = 4;
+    static constexpr unsigned FsMax = 14;
+    static constexpr unsigned BBits = 16;
+    static constexpr std::uint32_t nFirstXor = 0x8000;
+};
+
+int CountLeadingZeros(std::uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long nIndex;
+    _BitScanReverse64(&nIndex, v);
+    return 63 - static_cast<int>(nIndex);
+#else
+    return __builtin_clzll(v);
+#endif
+}
+
+// msb first
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<unsigned char> &out)
+        : out(out)
+        , nAcc(0)
+        , nBits(0)
+    {}
+
+    // nCount <= 32
+    void Put(std::uint32_t nValue, unsigned nCount) {
+        nAcc = (nAcc << nCount) | (nValue & ((std::uint64_t(1) << nCount) - 1));
+        nBits += nCount;
+        while ( nBits >= 8 ) {
+            nBits -= 8;
+            out.push_back(static_cast<unsigned char>(nAcc >> nBits));
+        }
+    }
+
+    // nZeros zero bits followed by a one
+    void PutUnary(std::uint32_t nZeros) {
+        while ( nZeros >= 32 ) {
+            Put(0, 32);
+            nZeros -= 32;
+        }
+        Put(1, nZeros + 1);
+    }
+
+    void Flush() {
+        if ( nBits > 0 ) {
+            out.push_back(static_cast<unsigned char>(nAcc << (8 - nBits)));
+            nBits = 0;
+        }
+    }
+
+private:
+    std::vector<unsigned char> &out;
+    std::uint64_t nAcc;
+    unsigned nBits;
+};
+
+// msb aligned 64bit window, zero filled past the valid bits
+class BitReader {
+public:
+    BitReader(const unsigned char *pData, std::size_t nSize)
+        : pData(pData)
+        , nSize(nSize)
+        , nPos(0)
+        , nWindow(0)
+        , nBits(0)
+    {}
+
+    // nCount <= 32
+    bool Get(unsigned nCount, std::uint32_t &nValue) {
+        if ( nCount == 0 ) {
+            nValue = 0;
+            return true;
+        }
+        Refill();
+        if ( nBits < static_cast<int>(nCount) ) {
+            return false;
+        }
+        nValue = static_cast<std::uint32_t>(nWindow >> (64 - nCount));
+        nWindow <<= nCount;
+        nBits -= nCount;
+        return true;
+    }
+
+    // zero bits up to and including the next one
+    bool GetUnary(std::uint32_t &nZeros) {
+        nZeros = 0;
+        for (;;) {
+            Refill();
+            if ( nBits == 0 ) {
+                return false;
+            }
+            if ( nWindow == 0 ) {
+                nZeros += nBits;
+                nBits = 0;
+                continue;
+            }
+            const auto nLeading = CountLeadingZeros(nWindow);
+            nZeros += nLeading;
+            nWindow = (nLeading + 1 < 64) ? nWindow << (nLeading + 1) : 0;
+            nBits -= nLeading + 1;
+            return true;
+        }
+    }
+
+private:
+    void Refill() {
+        while ( nBits <= 56 && nPos < nSize ) {
+            nWindow |= std::uint64_t(pData[nPos++]) << (56 - nBits);
+            nBits += 8;
+        }
+    }
+
+    const unsigned char *pData;
+    std::size_t nSize;
+    std::size_t nPos;
+    std::uint64_t nWindow;
+    int nBits;
+};
+
+template <typename T>
+void Compress(const T *pSamples, std::size_t nCount, std::vector<unsigned char> &out, int nBlockSize) {
+    using Traits = RiceTraits<T>;
+    using Signed = std::make_signed_t<T>;
+    if ( nCount == 0 ) {
+        return;
+    }
+    // worst case is the raw fallback for every block
+    out.reserve(out.size() + nCount * sizeof(T) + (nCount / nBlockSize + 1) + 4);
+    BitWriter bits(out);
+
+    // differences are the same for the signed and unsigned view
+    T nLast = pSamples[0];
+    bits.Put(nLast ^ Traits::nFirstXor, Traits::BBits);
+
+    std::vector<std::uint32_t> diffs(nBlockSize);
+    for (std::size_t i = 0; i < nCount; i += nBlockSize) {
+        const auto nBlock = static_cast<int>(std::min<std::size_t>(nBlockSize, nCount - i));
+        std::uint64_t nSum = 0;
+        for (int j = 0; j < nBlock; ++j) {
+            const T nNext = pSamples[i + j];
+            const auto nDiff = static_cast<Signed>(static_cast<T>(nNext - nLast));
+            // zigzag: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+            const auto nShifted = static_cast<std::int32_t>(nDiff) * 2;
+            diffs[j] = static_cast<std::uint32_t>(nDiff < 0 ? ~nShifted : nShifted);
+            nSum += diffs[j];
+            nLast = nNext;
+        }
+
+        // split from the mean difference, same rounding as cfitsio
+        double dMean = (static_cast<double>(nSum) - (nBlock / 2) - 1) / nBlock;
+        if ( dMean < 0 ) {
+            dMean = 0;
+        }
+        auto nPsum = static_cast<std::uint32_t>(dMean) >> 1;
+        unsigned nFs = 0;
+        for (; nPsum > 0; ++nFs) {
+            nPsum >>= 1;
+        }
+
+        if ( nFs >= Traits::FsMax ) {
+            // high entropy, store the differences as is
+            bits.Put(Traits::FsMax + 1, Traits::FsBits);
+            for (int j = 0; j < nBlock; ++j) {
+                bits.Put(diffs[j], Traits::BBits);
+            }
+        } else if ( nFs == 0 && nSum == 0 ) {
+            // flat block
+            bits.Put(0, Traits::FsBits);
+        } else {
+            bits.Put(nFs + 1, Traits::FsBits);
+            for (int j = 0; j < nBlock; ++j) {
+                bits.PutUnary(diffs[j] >> nFs);
+                if ( nFs > 0 ) {
+                    bits.Put(diffs[j], nFs);
+                }
+            }
+        }
+    }
+    bits.Flush();
+}
+
+template <typename T>
+bool Decompress(const unsigned char *pData, std::size_t nSize, T *pSamples, std::size_t nCount, int nBlockSize) {
+    using Traits = RiceTraits<T>;
+    if ( nCount == 0 ) {
+        return true;
+    }
+    BitReader bits(pData, nSize);
+
+    std::uint32_t nValue;
+    if ( ! bits.Get(Traits::BBits, nValue) ) {
+        return false;
+    }
+    T nLast = static_cast<T>(nValue ^ Traits::nFirstXor);
+
+    for (std::size_t i = 0; i < nCount; i += nBlockSize) {
+        const auto nBlock = std::min<std::size_t>(nBlockSize, nCount - i);
+        std::uint32_t nCode;
+        if ( ! bits.Get(Traits::FsBits, nCode) ) {
+            return false;
+        }
+        T *pOut = pSamples + i;
+        if ( nCode == 0 ) {
+            for (std::size_t j = 0; j < nBlock; ++j) {
+                pOut[j] = nLast;
+            }
+            continue;
+        }
+        const unsigned nFs = nCode - 1;
+        for (std::size_t j = 0; j < nBlock; ++j) {
+            std::uint32_t nDiff;
+            if ( nFs == Traits::FsMax ) {
+                if ( ! bits.Get(Traits::BBits, nDiff) ) {
+                    return false;
+                }
+            } else {
+                std::uint32_t nTop, nLow;
+                if ( ! bits.GetUnary(nTop) || ! bits.Get(nFs, nLow) ) {
+                    return false;
+                }
+                nDiff = (nTop << nFs) | nLow;
+            }
+            // undo zigzag
+            const auto nDelta = (nDiff & 1) ? ~(nDiff >> 1) : (nDiff >> 1);
+            nLast = static_cast<T>(nLast + nDelta);
+            pOut[j] = nLast;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+
+void RiceCodec::Compress8(const std::uint8_t *pSamples, std::size_t nCount, std::vector<unsigned char> &out, int nBlockSize) {
+    Compress(pSamples, nCount, out, nBlockSize);
+}
+
+void RiceCodec::Compress16(const std::uint16_t *pSamples, std::size_t nCount, std::vector<unsigned char> &out, int nBlockSize) {
+    Compress(pSamples, nCount, out, nBlockSize);
+}
+
+bool RiceCodec::Decompress8(const unsigned char *pData, std::size_t nSize, std::uint8_t *pSamples, std::size_t nCount, int nBlockSize) {
+    return Decompress(pData, nSize, pSamples, nCount, nBlockSize);
+}
+
+bool RiceCodec::Decompress16(const unsigned char *pData, std::size_t nSize, std::uint16_t *pSamples, std::size_t nCount, int nBlockSize) {
+    return Decompress(pData, nSize, pSamples, nCount, nBlockSize);
+}
@@ -0,0 +1,34 @@
+#ifndef RICECODEC_H
+#define RICECODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+//
+// Rice coding of 8/16bit samples, bit compatible with the RICE_1 algorithm of
+// FITS tile compression (cfitsio fits_rcomp_byte / fits_rcomp_short).
+// a tile starts with its first sample as is; then per block of nBlockSize
+// samples a short code selects the split, followed by the zigzag coded
+// differences. 16bit samples are unsigned with the FITS BZERO 32768
+// convention, the stream holds the signed values.
+//
+class RiceCodec {
+public:
+    static constexpr int DefaultBlockSize = 32;
+
+    // appends the compressed tile to out
+    static void Compress8(const std::uint8_t *pSamples, std::size_t nCount, std::vector<unsigned char> &out,
+                          int nBlockSize = DefaultBlockSize);
+    static void Compress16(const std::uint16_t *pSamples, std::size_t nCount, std::vector<unsigned char> &out,
+                           int nBlockSize = DefaultBlockSize);
+
+    // false if the data ends early or is malformed
+    static bool Decompress8(const unsigned char *pData, std::size_t nSize, std::uint8_t *pSamples, std::size_t nCount,
+                            int nBlockSize = DefaultBlockSize);
+    static bool Decompress16(const unsigned char *pData, std::size_t nSize, std::uint16_t *pSamples, std::size_t nCount,
+                             int nBlockSize = DefaultBlockSize);
+};
+
+#endif // RICECODEC_H
@@ -0,0 +1,1258 @@
+//
+// Simulated PlayerOneCamera SDK
+//
+// Implements every function of include/PlayerOneCamera.h without hardware so
+// that CcdPlayerOne and the capture pipeline can be exercised headless.
+// The library is built as libPlayerOneCamera (same soname as the vendor SDK),
+// so it can replace lib/ at link time (CONFIG+=playerone_sim) or at load time
+// (LD_LIBRARY_PATH / PATH).
+//
+// Configuration: key = value lines from the file named by POA_SIM_CONFIG,
+// then POA_SIM_<KEY> environment variables (upper case, '.' -> '_').
+// Camera keys may be prefixed with "cameraN." to override a single camera.
+// See sim/README.md for the list of keys.
+//
+
+#include "PlayerOneCamera.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+
+// deterministic hash -> [0, 1)
+inline std::uint64_t SplitMix64(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+inline double HashUniform(std::uint64_t a, std::uint64_t b, std::uint64_t c) {
+    const auto h = SplitMix64(SplitMix64(SplitMix64(a) ^ b) ^ c);
+    return static_cast<double>(h >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+//
+// key = value configuration
+//
+class SimConfig {
+public:
+    void Load() {
+        if ( const char *path = std::getenv("POA_SIM_CONFIG") ) {
+            std::ifstream ifs(path);
+            std::string line;
+            while ( std::getline(ifs, line) ) {
+                const auto comment = line.find('#');
+                if ( comment != std::string::npos ) {
+                    line.erase(comment);
+                }
+                const auto eq = line.find('=');
+                if ( eq == std::string::npos ) {
+                    continue;
+                }
+                const auto key = Trim(line.substr(0, eq));
+                if ( ! key.empty() ) {
+                    m_Values[key] = Trim(line.substr(eq + 1));
+                }
+            }
+        }
+    }
+
+    // "cameraN.key" -> "key" -> environment -> default
+    std::string Get(const std::string &key, const std::string &def, int nCamera = -1) const {
+        if ( nCamera >= 0 ) {
+            const auto scoped = "camera" + std::to_string(nCamera) + "." + key;
+            if ( const auto value = Lookup(scoped) ) {
+                return *value;
+            }
+        }
+        if ( const auto value = Lookup(key) ) {
+            return *value;
+        }
+        return def;
+    }
+    long GetInt(const std::string &key, long def, int nCamera = -1) const {
+        const auto value = Get(key, std::string(), nCamera);
+        return value.empty() ? def : std::strtol(value.c_str(), nullptr, 0);
+    }
+    double GetDouble(const std::string &key, double def, int nCamera = -1) const {
+        const auto value = Get(key, std::string(), nCamera);
+        return value.empty() ? def : std::strtod(value.c_str(), nullptr);
+    }
+
+private:
+    static std::string Trim(const std::string &s) {
+        const auto first = s.find_first_not_of(" \t\r\n");
+        if ( first == std::string::npos ) {
+            return std::string();
+        }
+        const auto last = s.find_last_not_of(" \t\r\n");
+        return s.substr(first, last - first + 1);
+    }
+    std::unique_ptr<std::string> Lookup(const std::string &key) const {
+        std::string env = "POA_SIM_";
+        for (const auto c : key) {
+            env += c == '.' ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+        if ( const char *value = std::getenv(env.c_str()) ) {
+            return std::make_unique<std::string>(value);
+        }
+        const auto it = m_Values.find(key);
+        if ( it == m_Values.end() ) {
+            return nullptr;
+        }
+        return std::make_unique<std::string>(it->second);
+    }
+
+    std::map<std::string, std::string> m_Values;
+};
+
+
+//
+// fault injection: fail_every.<Function> / fail_code.<Function>
+//                  stall_every.<Function> / stall_ms.<Function>
+//
+class FaultInjector {
+public:
+    void Load(const SimConfig &config) {
+        m_pConfig = &config;
+    }
+
+    // returns POA_OK if the call should proceed
+    POAErrors Check(const char *szFunction) {
+        if ( ! m_pConfig ) {
+            return POA_OK;
+        }
+        std::uint64_t nCall = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            nCall = ++m_Calls[szFunction];
+        }
+        const std::string name(szFunction);
+        const auto nStallEvery = m_pConfig->GetInt("stall_every." + name, 0);
+        if ( nStallEvery > 0 && nCall % nStallEvery == 0 ) {
+            const auto nStallMs = m_pConfig->GetInt("stall_ms." + name, 5000);
+            std::this_thread::sleep_for(std::chrono::milliseconds(nStallMs));
+        }
+        const auto nFailEvery = m_pConfig->GetInt("fail_every." + name, 0);
+        if ( nFailEvery > 0 && nCall % nFailEvery == 0 ) {
+            return static_cast<POAErrors>(m_pConfig->GetInt("fail_code." + name, POA_ERROR_OPERATION_FAILED));
+        }
+        return POA_OK;
+    }
+
+private:
+    const SimConfig *m_pConfig = nullptr;
+    std::mutex m_mtx;
+    std::map<std::string, std::uint64_t> m_Calls;
+};
+
+
+struct SimStar {
+    double x;       // unbinned sensor coordinates
+    double y;
+    double peak;    // fraction of full scale
+};
+
+struct SimCamera {
+    POACameraProperties prop;
+    std::vector<POAConfigAttributes> attributes;
+    std::map<POAConfig, POAConfigValue> values;
+    std::map<POAConfig, POABool> autos;
+
+    // model
+    double dBandwidthMBps;      // at USB_BANDWIDTH_LIMIT 100%
+    double dHostMBps;           // host controller capacity (0: unlimited)
+    double dReadoutMs;
+    double dDropRate;
+    double dTimeScale;          // exposure time scale (1: real time)
+    std::uint64_t nSeed;
+    long nDisconnectAfter;      // frames (0: never)
+    long nReconnectMs;
+    double dStarSigma;
+    double dBackground;
+    double dNoise;
+    double dSignalExposureUs;   // background and stars are at their level at this exposure, gain 0 (0: fixed)
+    double dDriftX;
+    double dDriftY;
+    std::vector<SimStar> stars;
+
+    // state
+    bool bPresent = true;
+    clock::time_point reconnectAt;
+    bool bOpened = false;
+    bool bInitialized = false;
+    int nBin = 1;
+    int nStartX = 0;
+    int nStartY = 0;
+    int nWidth = 0;
+    int nHeight = 0;
+    POAImgFormat format = POA_RAW8;
+
+    bool bExposing = false;
+    bool bSingleFrame = true;
+    bool bSingleDelivered = false;
+    std::uint64_t nSession = 0;
+    clock::time_point firstReady;
+    clock::duration period;
+    long nNextFrame = 0;
+    long nDropped = 0;
+    long nDelivered = 0;        // since open
+
+    double dTemperature = 20.0;
+    clock::time_point temperatureAt;
+
+    // rendered 16bit template (background + stars + fixed noise)
+    std::mutex mtxRender;
+    std::vector<std::uint16_t> image;
+    std::tuple<int, int, int, int, int, long, double> imageKey;
+};
+
+
+class Simulator {
+public:
+    static Simulator &Instance() {
+        static Simulator instance;
+        return instance;
+    }
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    SimConfig config;
+    FaultInjector faults;
+    std::vector<std::unique_ptr<SimCamera>> cameras;
+
+    SimCamera *Find(int nCameraID) {
+        if ( nCameraID < 0 || nCameraID >= static_cast<int>(cameras.size()) ) {
+            return nullptr;
+        }
+        return cameras[nCameraID].get();
+    }
+
+    // cameras currently plugged in (lost cameras come back after reconnect_ms)
+    std::vector<SimCamera *> Present() {
+        const auto now = clock::now();
+        std::vector<SimCamera *> result;
+        for (auto &pCamera : cameras) {
+            if ( ! pCamera->bPresent && now >= pCamera->reconnectAt ) {
+                pCamera->bPresent = true;
+            }
+            if ( pCamera->bPresent ) {
+                result.push_back(pCamera.get());
+            }
+        }
+        return result;
+    }
+
+private:
+    Simulator() {
+        config.Load();
+        faults.Load(config);
+        const auto nCount = std::max(0L, config.GetInt("cameras", 1));
+        for (long i = 0; i < nCount; ++i) {
+            cameras.push_back(CreateCamera(static_cast<int>(i)));
+        }
+    }
+
+    static std::vector<std::string> Split(const std::string &s) {
+        std::vector<std::string> result;
+        std::istringstream iss(s);
+        std::string item;
+        while ( std::getline(iss, item, ',') ) {
+            if ( ! item.empty() ) {
+                result.push_back(item);
+            }
+        }
+        return result;
+    }
+    static void CopyString(char *dst, std::size_t nSize, const std::string &src) {
+        std::strncpy(dst, src.c_str(), nSize - 1);
+        dst[nSize - 1] = '\0';
+    }
+
+    void AddInt(SimCamera &camera, POAConfig id, const char *name, long nMin, long nMax, long nDef, bool bWritable = true, bool bAuto = false) {
+        POAConfigAttributes attr = {};
+        attr.configID = id;
+        attr.valueType = VAL_INT;
+        attr.isReadable = POA_TRUE;
+        attr.isWritable = bWritable ? POA_TRUE : POA_FALSE;
+        attr.isSupportAuto = bAuto ? POA_TRUE : POA_FALSE;
+        attr.minValue.intValue = nMin;
+        attr.maxValue.intValue = nMax;
+        attr.defaultValue.intValue = nDef;
+        CopyString(attr.szConfName, sizeof(attr.szConfName), name);
+        camera.attributes.push_back(attr);
+        camera.values[id] = attr.defaultValue;
+    }
+    void AddFloat(SimCamera &camera, POAConfig id, const char *name, double dMin, double dMax, double dDef) {
+        POAConfigAttributes attr = {};
+        attr.configID = id;
+        attr.valueType = VAL_FLOAT;
+        attr.isReadable = POA_TRUE;
+        attr.isWritable = POA_FALSE;
+        attr.minValue.floatValue = dMin;
+        attr.maxValue.floatValue = dMax;
+        attr.defaultValue.floatValue = dDef;
+        CopyString(attr.szConfName, sizeof(attr.szConfName), name);
+        camera.attributes.push_back(attr);
+        camera.values[id] = attr.defaultValue;
+    }
+    void AddBool(SimCamera &camera, POAConfig id, const char *name, bool bDef) {
+        POAConfigAttributes attr = {};
+        attr.configID = id;
+        attr.valueType = VAL_BOOL;
+        attr.isReadable = POA_TRUE;
+        attr.isWritable = POA_TRUE;
+        attr.minValue.boolValue = POA_FALSE;
+        attr.maxValue.boolValue = POA_TRUE;
+        attr.defaultValue.boolValue = bDef ? POA_TRUE : POA_FALSE;
+        CopyString(attr.szConfName, sizeof(attr.szConfName), name);
+        camera.attributes.push_back(attr);
+        camera.values[id] = attr.defaultValue;
+    }
+
+    std::unique_ptr<SimCamera> CreateCamera(int n) {
+        auto pCamera = std::make_unique<SimCamera>();
+        auto &camera = *pCamera;
+        auto &prop = camera.prop;
+        prop = {};
+
+        const bool bColor = config.GetInt("color", 0, n) != 0;
+        CopyString(prop.cameraModelName, sizeof(prop.cameraModelName), config.Get("model", bColor ? "Sim-Camera-C" : "Sim-Camera-M", n));
+        CopyString(prop.sensorModelName, sizeof(prop.sensorModelName), config.Get("sensor", "SIM000", n));
+        CopyString(prop.SN, sizeof(prop.SN), config.Get("sn", "SIM" + std::to_string(1000 + n), n));
+        CopyString(prop.localPath, sizeof(prop.localPath), config.Get("path", "sim-usb-1-" + std::to_string(n + 1), n));
+        prop.cameraID = n;
+        prop.maxWidth = static_cast<int>(config.GetInt("width", 1920, n));
+        prop.maxHeight = static_cast<int>(config.GetInt("height", 1080, n));
+        prop.bitDepth = static_cast<int>(config.GetInt("bitdepth", 12, n));
+        prop.isColorCamera = bColor ? POA_TRUE : POA_FALSE;
+        prop.isHasST4Port = config.GetInt("st4", 1, n) ? POA_TRUE : POA_FALSE;
+        prop.isHasCooler = config.GetInt("cooler", 0, n) ? POA_TRUE : POA_FALSE;
+        prop.isUSB3Speed = config.GetInt("usb3", 1, n) ? POA_TRUE : POA_FALSE;
+        prop.bayerPattern = bColor ? static_cast<POABayerPattern>(config.GetInt("bayer", POA_BAYER_RG, n)) : POA_BAYER_MONO;
+        prop.pixelSize = config.GetDouble("pixel_size", 2.9, n);
+
+        const auto bins = Split(config.Get("bins", "1,2,3,4", n));
+        for (std::size_t i = 0; i < bins.size() && i < 7; ++i) {
+            prop.bins[i] = std::atoi(bins[i].c_str());
+        }
+        const auto formats = Split(config.Get("formats", bColor ? "RAW8,RAW16,RGB24,MONO8" : "RAW8,RAW16", n));
+        std::size_t nFormats = 0;
+        for (const auto &name : formats) {
+            POAImgFormat fmt = POA_END;
+            if ( name == "RAW8" ) {
+                fmt = POA_RAW8;
+            } else if ( name == "RAW16" ) {
+                fmt = POA_RAW16;
+            } else if ( name == "RGB24" ) {
+                fmt = POA_RGB24;
+            } else if ( name == "MONO8" ) {
+                fmt = POA_MONO8;
+            }
+            if ( fmt != POA_END && nFormats < 7 ) {
+                prop.imgFormats[nFormats++] = fmt;
+            }
+        }
+        for (std::size_t i = nFormats; i < 8; ++i) {
+            prop.imgFormats[i] = POA_END;
+        }
+
+        camera.dBandwidthMBps = config.GetDouble("bandwidth_mbps", prop.isUSB3Speed ? 380.0 : 40.0, n);
+        camera.dHostMBps = config.GetDouble("host_mbps", 0, n);
+        camera.dReadoutMs = config.GetDouble("readout_ms", 2.0, n);
+        camera.dDropRate = config.GetDouble("drop_rate", 0, n);
+        camera.dTimeScale = config.GetDouble("time_scale", 1.0, n);
+        camera.nSeed = static_cast<std::uint64_t>(config.GetInt("seed", 1, n)) * 1000 + n;
+        camera.nDisconnectAfter = config.GetInt("disconnect_after_frames", 0, n);
+        camera.nReconnectMs = config.GetInt("reconnect_ms", 500, n);
+        camera.dStarSigma = config.GetDouble("star_sigma", 1.5, n);
+        camera.dBackground = config.GetDouble("background", 0.05, n);
+        camera.dNoise = config.GetDouble("noise", 0.01, n);
+        camera.dSignalExposureUs = config.GetDouble("signal_exposure_us", 0, n);
+        camera.dDriftX = config.GetDouble("drift_x", 0, n);
+        camera.dDriftY = config.GetDouble("drift_y", 0, n);
+
+        const auto nStars = config.GetInt("stars", 200, n);
+        const auto dStarMax = config.GetDouble("star_max", 0.8, n);
+        for (long i = 0; i < nStars; ++i) {
+            SimStar star;
+            star.x = HashUniform(camera.nSeed, i, 1) * prop.maxWidth;
+            star.y = HashUniform(camera.nSeed, i, 2) * prop.maxHeight;
+            // many faint, few bright
+            const auto u = HashUniform(camera.nSeed, i, 3);
+            star.peak = dStarMax * u * u * u + 0.02;
+            camera.stars.push_back(star);
+        }
+
+        AddInt(camera, POA_EXPOSURE, "Exposure", 32, 2000000000, 10000, true, true);
+        AddInt(camera, POA_GAIN, "Gain", 0, 500, 100, true, true);
+        AddBool(camera, POA_HARDWARE_BIN, "HardwareBin", true);
+        AddFloat(camera, POA_TEMPERATURE, "Temperature", -50, 100, 20);
+        if ( bColor ) {
+            AddInt(camera, POA_WB_R, "WB_Red", -1200, 1200, 0);
+            AddInt(camera, POA_WB_G, "WB_Green", -1200, 1200, 0);
+            AddInt(camera, POA_WB_B, "WB_Blue", -1200, 1200, 0);
+        }
+        AddInt(camera, POA_OFFSET, "Offset", 0, 255, 10);
+        AddInt(camera, POA_AUTOEXPO_MAX_GAIN, "AutoExpMaxGain", 0, 500, 250);
+        AddInt(camera, POA_AUTOEXPO_MAX_EXPOSURE, "AutoExpMaxExpMs", 1, 2000000, 100);
+        AddInt(camera, POA_AUTOEXPO_BRIGHTNESS, "AutoExpTargetBrightness", 50, 200, 100);
+        if ( prop.isHasST4Port == POA_TRUE ) {
+            AddBool(camera, POA_GUIDE_NORTH, "GuideNorth", false);
+            AddBool(camera, POA_GUIDE_SOUTH, "GuideSouth", false);
+            AddBool(camera, POA_GUIDE_EAST, "GuideEast", false);
+            AddBool(camera, POA_GUIDE_WEST, "GuideWest", false);
+        }
+        AddFloat(camera, POA_EGAIN, "eGain", 0, 100, 1.0);
+        if ( prop.isHasCooler == POA_TRUE ) {
+            AddInt(camera, POA_COOLER_POWER, "CoolerPower", 0, 100, 0, false);
+            AddInt(camera, POA_TARGET_TEMP, "TargetTemp", -50, 50, 0);
+            AddBool(camera, POA_COOLER, "CoolerOn", false);
+            AddBool(camera, POA_HEATER, "LensHeater", false);
+        }
+        AddBool(camera, POA_FLIP_NONE, "FlipNone", true);
+        AddBool(camera, POA_FLIP_HORI, "FlipHori", false);
+        AddBool(camera, POA_FLIP_VERT, "FlipVert", false);
+        AddBool(camera, POA_FLIP_BOTH, "FlipBoth", false);
+        AddInt(camera, POA_FRAME_LIMIT, "FrameLimit", 0, 2000, 0);
+        AddBool(camera, POA_HQI, "HQI", false);
+        AddInt(camera, POA_USB_BANDWIDTH_LIMIT, "USBBandwidthLimit", 35, 100, 90);
+
+        return pCamera;
+    }
+};
+
+Simulator &Sim() {
+    return Simulator::Instance();
+}
+
+#define SIM_FAULT(name) \
+    do { \
+        const auto nFault = Sim().faults.Check(name); \
+        if ( nFault != POA_OK ) { \
+            return nFault; \
+        } \
+    } while (false)
+
+
+int BytesPerPixel(POAImgFormat fmt) {
+    switch (fmt) {
+    case POA_RAW16:
+        return 2;
+    case POA_RGB24:
+        return 3;
+    default:
+        return 1;
+    }
+}
+
+std::size_t FrameBytes(const SimCamera &camera) {
+    return static_cast<std::size_t>(camera.nWidth) * camera.nHeight * BytesPerPixel(camera.format);
+}
+
+bool IsSupportedBin(const SimCamera &camera, int nBin) {
+    for (const auto bin : camera.prop.bins) {
+        if ( bin == nBin ) {
+            return true;
+        }
+    }
+    return false;
+}
+bool IsSupportedFormat(const SimCamera &camera, POAImgFormat fmt) {
+    for (const auto format : camera.prop.imgFormats) {
+        if ( format == fmt ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ClampGeometry(SimCamera &camera) {
+    const auto nMaxW = camera.prop.maxWidth / camera.nBin;
+    const auto nMaxH = camera.prop.maxHeight / camera.nBin;
+    camera.nWidth = std::clamp(camera.nWidth, 4, nMaxW) / 4 * 4;
+    camera.nHeight = std::clamp(camera.nHeight, 2, nMaxH) / 2 * 2;
+    camera.nStartX = std::clamp(camera.nStartX, 0, nMaxW - camera.nWidth);
+    camera.nStartY = std::clamp(camera.nStartY, 0, nMaxH - camera.nHeight);
+}
+
+void UpdateTemperature(SimCamera &camera) {
+    const auto now = clock::now();
+    const auto dSec = std::chrono::duration<double>(now - camera.temperatureAt).count();
+    camera.temperatureAt = now;
+    double dTarget = 20.0;
+    if ( camera.prop.isHasCooler == POA_TRUE && camera.values[POA_COOLER].boolValue == POA_TRUE ) {
+        dTarget = std::max(-15.0, static_cast<double>(camera.values[POA_TARGET_TEMP].intValue));
+    }
+    // first order approach, tau = 60s
+    camera.dTemperature += (dTarget - camera.dTemperature) * (1.0 - std::exp(-dSec / 60.0));
+    camera.values[POA_TEMPERATURE].floatValue = camera.dTemperature;
+    if ( camera.prop.isHasCooler == POA_TRUE ) {
+        const auto dPower = camera.values[POA_COOLER].boolValue == POA_TRUE ? std::clamp((20.0 - camera.dTemperature) * 3.0 + 10.0, 0.0, 100.0) : 0.0;
+        camera.values[POA_COOLER_POWER].intValue = static_cast<long>(dPower);
+    }
+}
+
+clock::duration ExposureDuration(const SimCamera &camera) {
+    const auto dUs = camera.values.at(POA_EXPOSURE).intValue * camera.dTimeScale;
+    return std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::micro>(dUs));
+}
+
+double EffectiveBandwidth(const SimCamera &camera) {
+    return camera.dBandwidthMBps * camera.values.at(POA_USB_BANDWIDTH_LIMIT).intValue / 100.0;
+}
+
+clock::duration TransferDuration(const SimCamera &camera) {
+    const auto dSec = FrameBytes(camera) / (EffectiveBandwidth(camera) * 1e6) + camera.dReadoutMs / 1000.0;
+    return std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(dSec));
+}
+
+double DropProbability(const SimCamera &camera) {
+    auto dProb = camera.dDropRate;
+    const auto dBandwidth = EffectiveBandwidth(camera);
+    if ( camera.dHostMBps > 0 && dBandwidth > camera.dHostMBps ) {
+        // host controller cannot keep up
+        dProb += 1.0 - camera.dHostMBps / dBandwidth;
+    }
+    return std::min(dProb, 1.0);
+}
+
+// frame nNextFrame becomes ready at now + exposure + transfer, then every period
+void UpdateTimeline(SimCamera &camera, clock::time_point now) {
+    const auto exposure = ExposureDuration(camera);
+    const auto transfer = TransferDuration(camera);
+    camera.period = std::max(exposure, transfer);
+    const auto nFrameLimit = camera.values[POA_FRAME_LIMIT].intValue;
+    if ( nFrameLimit > 0 ) {
+        const auto minPeriod = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / nFrameLimit));
+        camera.period = std::max(camera.period, minPeriod);
+    }
+    camera.firstReady = now + exposure + transfer - camera.period * camera.nNextFrame;
+}
+
+bool IsFrameDropped(const SimCamera &camera, long nFrame) {
+    const auto dProb = DropProbability(camera);
+    return dProb > 0 && HashUniform(camera.nSeed, camera.nSession, static_cast<std::uint64_t>(nFrame)) < dProb;
+}
+
+// latest deliverable frame index, or -1
+long LatestFrame(const SimCamera &camera, clock::time_point now) {
+    if ( ! camera.bExposing || now < camera.firstReady ) {
+        return -1;
+    }
+    if ( camera.bSingleFrame ) {
+        return camera.bSingleDelivered ? -1 : 0;
+    }
+    auto nLatest = static_cast<long>((now - camera.firstReady) / camera.period);
+    while ( nLatest >= camera.nNextFrame && IsFrameDropped(camera, nLatest) ) {
+        --nLatest;
+    }
+    return nLatest >= camera.nNextFrame ? nLatest : -1;
+}
+
+// signal relative to the configured levels: linear in exposure, 0.1 dB per gain step
+double SignalScale(const SimCamera &camera) {
+    if ( camera.dSignalExposureUs <= 0 ) {
+        return 1.0;
+    }
+    return camera.values.at(POA_EXPOSURE).intValue / camera.dSignalExposureUs * std::pow(10.0, camera.values.at(POA_GAIN).intValue * 0.1 / 20);
+}
+
+void Render(SimCamera &camera, std::vector<std::uint16_t> &image, int nStartX, int nStartY, int nWidth, int nHeight, int nBin, long nFrame, double dScale) {
+    const auto key = std::make_tuple(nStartX, nStartY, nWidth, nHeight, nBin, (camera.dDriftX != 0 || camera.dDriftY != 0) ? nFrame : 0L, dScale);
+    if ( key == camera.imageKey && image.size() == static_cast<std::size_t>(nWidth) * nHeight ) {
+        return;
+    }
+    camera.imageKey = key;
+
+    const double dFull = 65535.0;
+    const auto nBin2 = static_cast<double>(nBin * nBin);
+    const bool bColor = camera.prop.isColorCamera == POA_TRUE;
+    image.assign(static_cast<std::size_t>(nWidth) * nHeight, 0);
+    std::vector<float> plane(image.size(), static_cast<float>(camera.dBackground * dScale * dFull * nBin2));
+
+    // stars (gaussian psf, sum binning)
+    const auto dSigma = camera.dStarSigma / nBin;
+    const auto nRadius = static_cast<int>(std::ceil(dSigma * 4));
+    const auto dDriftX = camera.dDriftX * nFrame;
+    const auto dDriftY = camera.dDriftY * nFrame;
+    for (const auto &star : camera.stars) {
+        const auto cx = (star.x + dDriftX) / nBin - nStartX;
+        const auto cy = (star.y + dDriftY) / nBin - nStartY;
+        if ( cx < -nRadius || cy < -nRadius || cx >= nWidth + nRadius || cy >= nHeight + nRadius ) {
+            continue;
+        }
+        const auto dPeak = star.peak * dScale * dFull * nBin2;
+        const auto x0 = std::max(0, static_cast<int>(cx) - nRadius);
+        const auto x1 = std::min(nWidth - 1, static_cast<int>(cx) + nRadius);
+        const auto y0 = std::max(0, static_cast<int>(cy) - nRadius);
+        const auto y1 = std::min(nHeight - 1, static_cast<int>(cy) + nRadius);
+        for (int y = y0; y <= y1; ++y) {
+            const auto dy = y + 0.5 - cy;
+            for (int x = x0; x <= x1; ++x) {
+                const auto dx = x + 0.5 - cx;
+                plane[static_cast<std::size_t>(y) * nWidth + x] += static_cast<float>(dPeak * std::exp(-(dx * dx + dy * dy) / (2 * dSigma * dSigma)));
+            }
+        }
+    }
+
+    // bayer response, fixed pattern noise, ADC depth
+    const auto nDropBits = 16 - std::clamp(camera.prop.bitDepth, 8, 16);
+    for (int y = 0; y < nHeight; ++y) {
+        for (int x = 0; x < nWidth; ++x) {
+            const auto i = static_cast<std::size_t>(y) * nWidth + x;
+            double v = plane[i];
+            if ( bColor && nBin == 1 ) {
+                // RGGB response relative to green
+                static const double aResponse[2][2] = { { 0.8, 1.0 }, { 1.0, 0.6 } };
+                v *= aResponse[(nStartY + y) & 1][(nStartX + x) & 1];
+            }
+            v += (HashUniform(camera.nSeed, nFrame, i) - 0.5) * 3.46 * camera.dNoise * dFull;
+            const auto n = static_cast<std::uint16_t>(std::clamp(v, 0.0, dFull));
+            image[i] = static_cast<std::uint16_t>((n >> nDropBits) << nDropBits);
+        }
+    }
+}
+
+void Fill(const std::vector<std::uint16_t> &image, POAImgFormat fmt, unsigned char *pBuf) {
+    switch (fmt) {
+    case POA_RAW16:
+        std::memcpy(pBuf, image.data(), image.size() * sizeof(std::uint16_t));
+        break;
+    case POA_RGB24:
+        for (std::size_t i = 0; i < image.size(); ++i) {
+            const auto v = static_cast<unsigned char>(image[i] >> 8);
+            pBuf[i * 3 + 0] = v;
+            pBuf[i * 3 + 1] = v;
+            pBuf[i * 3 + 2] = v;
+        }
+        break;
+    default:
+        for (std::size_t i = 0; i < image.size(); ++i) {
+            pBuf[i] = static_cast<unsigned char>(image[i] >> 8);
+        }
+        break;
+    }
+}
+
+POAErrors CheckOpened(SimCamera *pCamera) {
+    if ( ! pCamera ) {
+        return POA_ERROR_INVALID_ID;
+    }
+    if ( ! pCamera->bOpened ) {
+        return POA_ERROR_NOT_OPENED;
+    }
+    return POA_OK;
+}
+
+// unplug after disconnect_after_frames frames
+void CheckDisconnect(SimCamera &camera) {
+    if ( camera.nDisconnectAfter > 0 && camera.nDelivered >= camera.nDisconnectAfter ) {
+        camera.bPresent = false;
+        camera.bOpened = false;
+        camera.bExposing = false;
+        camera.reconnectAt = clock::now() + std::chrono::milliseconds(camera.nReconnectMs);
+    }
+}
+
+}  // namespace
+
+
+extern "C" {
+
+int POAGetCameraCount() {
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    return static_cast<int>(Sim().Present().size());
+}
+
+POAErrors POAGetCameraProperties(int nIndex, POACameraProperties *pProp) {
+    SIM_FAULT("POAGetCameraProperties");
+    if ( ! pProp ) {
+        return POA_ERROR_POINTER;
+    }
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    const auto present = Sim().Present();
+    if ( nIndex < 0 || nIndex >= static_cast<int>(present.size()) ) {
+        return POA_ERROR_INVALID_INDEX;
+    }
+    *pProp = present[nIndex]->prop;
+    return POA_OK;
+}
+
+POAErrors POAGetCameraPropertiesByID(int nCameraID, POACameraProperties *pProp) {
+    if ( ! pProp ) {
+        return POA_ERROR_POINTER;
+    }
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( ! pCamera ) {
+        return POA_ERROR_INVALID_ID;
+    }
+    *pProp = pCamera->prop;
+    return POA_OK;
+}
+
+POAErrors POAOpenCamera(int nCameraID) {
+    SIM_FAULT("POAOpenCamera");
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    Sim().Present();
+    auto pCamera = Sim().Find(nCameraID);
+    if ( ! pCamera ) {
+        return POA_ERROR_INVALID_ID;
+    }
+    if ( ! pCamera->bPresent ) {
+        return POA_ERROR_DEVICE_NOT_FOUND;
+    }
+    pCamera->bOpened = true;
+    pCamera->bInitialized = false;
+    return POA_OK;
+}
+
+POAErrors POAInitCamera(int nCameraID) {
+    SIM_FAULT("POAInitCamera");
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    auto &camera = *pCamera;
+    camera.bInitialized = true;
+    camera.nBin = 1;
+    camera.nStartX = 0;
+    camera.nStartY = 0;
+    camera.nWidth = camera.prop.maxWidth;
+    camera.nHeight = camera.prop.maxHeight;
+    camera.format = POA_RAW8;
+    camera.bExposing = false;
+    camera.nDelivered = 0;
+    camera.temperatureAt = clock::now();
+    ClampGeometry(camera);
+    return POA_OK;
+}
+
+POAErrors POACloseCamera(int nCameraID) {
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( ! pCamera ) {
+        return POA_ERROR_INVALID_ID;
+    }
+    pCamera->bOpened = false;
+    pCamera->bExposing = false;
+    Sim().cv.notify_all();
+    return POA_OK;
+}
+
+POAErrors POAGetConfigsCount(int nCameraID, int *pConfCount) {
+    if ( ! pConfCount ) {
+        return POA_ERROR_POINTER;
+    }
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    *pConfCount = static_cast<int>(pCamera->attributes.size());
+    return POA_OK;
+}
+
+POAErrors POAGetConfigAttributes(int nCameraID, int nConfIndex, POAConfigAttributes *pConfAttr) {
+    if ( ! pConfAttr ) {
+        return POA_ERROR_POINTER;
+    }
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    if ( nConfIndex < 0 || nConfIndex >= static_cast<int>(pCamera->attributes.size()) ) {
+        return POA_ERROR_INVALID_INDEX;
+    }
+    *pConfAttr = pCamera->attributes[nConfIndex];
+    return POA_OK;
+}
+
+POAErrors POAGetConfigAttributesByConfigID(int nCameraID, POAConfig confID, POAConfigAttributes *pConfAttr) {
+    if ( ! pConfAttr ) {
+        return POA_ERROR_POINTER;
+    }
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    for (const auto &attr : pCamera->attributes) {
+        if ( attr.configID == confID ) {
+            *pConfAttr = attr;
+            return POA_OK;
+        }
+    }
+    return POA_ERROR_INVALID_CONFIG;
+}
+
+POAErrors POASetConfig(int nCameraID, POAConfig confID, POAConfigValue confValue, POABool isAuto) {
+    SIM_FAULT("POASetConfig");
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    auto &camera = *pCamera;
+    const auto it = std::find_if(camera.attributes.begin(), camera.attributes.end(), [confID](const POAConfigAttributes &attr) {
+        return attr.configID == confID;
+    });
+    if ( it == camera.attributes.end() ) {
+        return POA_ERROR_INVALID_CONFIG;
+    }
+    if ( it->isWritable != POA_TRUE ) {
+        return POA_ERROR_CONF_CANNOT_WRITE;
+    }
+    if ( it->valueType == VAL_INT && (confValue.intValue < it->minValue.intValue || confValue.intValue > it->maxValue.intValue) ) {
+        return POA_ERROR_OUT_OF_LIMIT;
+    }
+    switch (confID) {
+    case POA_FLIP_NONE:
+    case POA_FLIP_HORI:
+    case POA_FLIP_VERT:
+    case POA_FLIP_BOTH:
+        // exclusive, value is ignored
+        camera.values[POA_FLIP_NONE].boolValue = POA_FALSE;
+        camera.values[POA_FLIP_HORI].boolValue = POA_FALSE;
+        camera.values[POA_FLIP_VERT].boolValue = POA_FALSE;
+        camera.values[POA_FLIP_BOTH].boolValue = POA_FALSE;
+        camera.values[confID].boolValue = POA_TRUE;
+        break;
+    default:
+        camera.values[confID] = confValue;
+        break;
+    }
+    camera.autos[confID] = isAuto;
+    if ( camera.bExposing && ! camera.bSingleFrame ) {
+        // exposure / frame limit / bandwidth change the stream from the next frame
+        UpdateTimeline(camera, clock::now());
+    }
+    return POA_OK;
+}
+
+POAErrors POAGetConfig(int nCameraID, POAConfig confID, POAConfigValue *pConfValue, POABool *pIsAuto) {
+    SIM_FAULT("POAGetConfig");
+    if ( ! pConfValue || ! pIsAuto ) {
+        return POA_ERROR_POINTER;
+    }
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    auto &camera = *pCamera;
+    const auto it = camera.values.find(confID);
+    if ( it == camera.values.end() ) {
+        return POA_ERROR_INVALID_CONFIG;
+    }
+    if ( confID == POA_TEMPERATURE || confID == POA_COOLER_POWER ) {
+        UpdateTemperature(camera);
+    }
+    *pConfValue = it->second;
+    const auto itAuto = camera.autos.find(confID);
+    *pIsAuto = itAuto == camera.autos.end() ? POA_FALSE : itAuto->second;
+    return POA_OK;
+}
+
+POAErrors POAGetConfigValueType(POAConfig confID, POAValueType *pConfValueType) {
+    if ( ! pConfValueType ) {
+        return POA_ERROR_POINTER;
+    }
+    switch (confID) {
+    case POA_HARDWARE_BIN:
+    case POA_GUIDE_NORTH:
+    case POA_GUIDE_SOUTH:
+    case POA_GUIDE_EAST:
+    case POA_GUIDE_WEST:
+    case POA_COOLER:
+    case POA_HEATER:
+    case POA_FLIP_NONE:
+    case POA_FLIP_HORI:
+    case POA_FLIP_VERT:
+    case POA_FLIP_BOTH:
+    case POA_HQI:
+        *pConfValueType = VAL_BOOL;
+        break;
+    case POA_TEMPERATURE:
+    case POA_EGAIN:
+        *pConfValueType = VAL_FLOAT;
+        break;
+    default:
+        *pConfValueType = VAL_INT;
+        break;
+    }
+    return POA_OK;
+}
+
+POAErrors POAGetImageStartPos(int nCameraID, int *pStartX, int *pStartY) {
+    if ( ! pStartX || ! pStartY ) {
+        return POA_ERROR_POINTER;
+    }
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    *pStartX = pCamera->nStartX;
+    *pStartY = pCamera->nStartY;
+    return POA_OK;
+}
+
+POAErrors POASetImageStartPos(int nCameraID, int startX, int startY) {
+    SIM_FAULT("POASetImageStartPos");
+    if ( startX < 0 || startY < 0 ) {
+        return POA_ERROR_INVALID_ARGU;
+    }
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    // allowed while exposing
+    pCamera->nStartX = startX;
+    pCamera->nStartY = startY;
+    ClampGeometry(*pCamera);
+    return POA_OK;
+}
+
+POAErrors POAGetImageSize(int nCameraID, int *pWidth, int *pHeight) {
+    SIM_FAULT("POAGetImageSize");
+    if ( ! pWidth || ! pHeight ) {
+        return POA_ERROR_POINTER;
+    }
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    *pWidth = pCamera->nWidth;
+    *pHeight = pCamera->nHeight;
+    return POA_OK;
+}
+
+POAErrors POASetImageSize(int nCameraID, int width, int height) {
+    SIM_FAULT("POASetImageSize");
+    if ( width < 0 || height < 0 ) {
+        return POA_ERROR_INVALID_ARGU;
+    }
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    if ( pCamera->bExposing ) {
+        return POA_ERROR_EXPOSING;
+    }
+    pCamera->nWidth = width;
+    pCamera->nHeight = height;
+    ClampGeometry(*pCamera);
+    return POA_OK;
+}
+
+POAErrors POAGetImageBin(int nCameraID, int *pBin) {
+    SIM_FAULT("POAGetImageBin");
+    if ( ! pBin ) {
+        return POA_ERROR_POINTER;
+    }
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    *pBin = pCamera->nBin;
+    return POA_OK;
+}
+
+POAErrors POASetImageBin(int nCameraID, int bin) {
+    SIM_FAULT("POASetImageBin");
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    auto &camera = *pCamera;
+    if ( camera.bExposing ) {
+        return POA_ERROR_EXPOSING;
+    }
+    if ( ! IsSupportedBin(camera, bin) ) {
+        return POA_ERROR_OPERATION_FAILED;
+    }
+    // keep the same sensor area
+    camera.nStartX = camera.nStartX * camera.nBin / bin;
+    camera.nStartY = camera.nStartY * camera.nBin / bin;
+    camera.nWidth = camera.nWidth * camera.nBin / bin;
+    camera.nHeight = camera.nHeight * camera.nBin / bin;
+    camera.nBin = bin;
+    ClampGeometry(camera);
+    return POA_OK;
+}
+
+POAErrors POAGetImageFormat(int nCameraID, POAImgFormat *pImgFormat) {
+    SIM_FAULT("POAGetImageFormat");
+    if ( ! pImgFormat ) {
+        return POA_ERROR_POINTER;
+    }
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    *pImgFormat = pCamera->format;
+    return POA_OK;
+}
+
+POAErrors POASetImageFormat(int nCameraID, POAImgFormat imgFormat) {
+    SIM_FAULT("POASetImageFormat");
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    if ( pCamera->bExposing ) {
+        return POA_ERROR_EXPOSING;
+    }
+    if ( ! IsSupportedFormat(*pCamera, imgFormat) ) {
+        return POA_ERROR_INVALID_ARGU;
+    }
+    pCamera->format = imgFormat;
+    return POA_OK;
+}
+
+POAErrors POAStartExposure(int nCameraID, POABool bSignalFrame) {
+    SIM_FAULT("POAStartExposure");
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    auto &camera = *pCamera;
+    if ( camera.bExposing ) {
+        return POA_ERROR_EXPOSING;
+    }
+    camera.bExposing = true;
+    camera.bSingleFrame = bSignalFrame == POA_TRUE;
+    camera.bSingleDelivered = false;
+    camera.nSession += 1;
+    camera.nNextFrame = 0;
+    camera.nDropped = 0;
+    UpdateTimeline(camera, clock::now());
+    return POA_OK;
+}
+
+POAErrors POAStopExposure(int nCameraID) {
+    SIM_FAULT("POAStopExposure");
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    pCamera->bExposing = false;
+    Sim().cv.notify_all();
+    return POA_OK;
+}
+
+POAErrors POAGetCameraState(int nCameraID, POACameraState *pCameraState) {
+    SIM_FAULT("POAGetCameraState");
+    if ( ! pCameraState ) {
+        return POA_ERROR_POINTER;
+    }
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( ! pCamera ) {
+        return POA_ERROR_INVALID_ID;
+    }
+    auto &camera = *pCamera;
+    if ( ! camera.bOpened ) {
+        *pCameraState = STATE_CLOSED;
+    } else if ( camera.bExposing && (! camera.bSingleFrame || clock::now() < camera.firstReady) ) {
+        *pCameraState = STATE_EXPOSING;
+    } else {
+        *pCameraState = STATE_OPENED;
+    }
+    return POA_OK;
+}
+
+POAErrors POAImageReady(int nCameraID, POABool *pIsReady) {
+    SIM_FAULT("POAImageReady");
+    if ( ! pIsReady ) {
+        return POA_ERROR_POINTER;
+    }
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    *pIsReady = LatestFrame(*pCamera, clock::now()) >= 0 ? POA_TRUE : POA_FALSE;
+    return POA_OK;
+}
+
+POAErrors POAGetImageData(int nCameraID, unsigned char *pBuf, long lBufSize, int nTimeoutms) {
+    SIM_FAULT("POAGetImageData");
+    if ( ! pBuf ) {
+        return POA_ERROR_POINTER;
+    }
+    if ( lBufSize < 0 ) {
+        return POA_ERROR_INVALID_ARGU;
+    }
+    auto &sim = Sim();
+    std::unique_lock<std::mutex> lock(sim.mtx);
+    auto pCamera = sim.Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    auto &camera = *pCamera;
+    if ( static_cast<std::size_t>(lBufSize) < FrameBytes(camera) ) {
+        return POA_ERROR_SIZE_LESS;
+    }
+
+    const auto deadline = nTimeoutms < 0 ? clock::time_point::max() : clock::now() + std::chrono::milliseconds(nTimeoutms);
+    const auto nSession = camera.nSession;
+    long nFrame = -1;
+    while ( true ) {
+        if ( ! camera.bOpened || ! camera.bExposing || camera.nSession != nSession ) {
+            return camera.bOpened ? POA_ERROR_OPERATION_FAILED : POA_ERROR_NOT_OPENED;
+        }
+        const auto now = clock::now();
+        nFrame = LatestFrame(camera, now);
+        if ( nFrame >= 0 ) {
+            break;
+        }
+        if ( now >= deadline ) {
+            return POA_ERROR_TIMEOUT;
+        }
+        // next candidate frame
+        auto wakeup = camera.firstReady;
+        if ( ! camera.bSingleFrame && now >= camera.firstReady ) {
+            wakeup = camera.firstReady + camera.period * ((now - camera.firstReady) / camera.period + 1);
+        }
+        sim.cv.wait_until(lock, std::min(wakeup, deadline));
+    }
+
+    if ( camera.bSingleFrame ) {
+        camera.bSingleDelivered = true;
+        camera.bExposing = false;
+    } else {
+        camera.nDropped += nFrame - camera.nNextFrame;
+        camera.nNextFrame = nFrame + 1;
+    }
+    camera.nDelivered += 1;
+    const auto nStartX = camera.nStartX;
+    const auto nStartY = camera.nStartY;
+    const auto nWidth = camera.nWidth;
+    const auto nHeight = camera.nHeight;
+    const auto nBin = camera.nBin;
+    const auto fmt = camera.format;
+    const auto nSequence = camera.nDelivered;
+    const auto dScale = SignalScale(camera);
+    CheckDisconnect(camera);
+    lock.unlock();
+
+    std::lock_guard<std::mutex> lockRender(camera.mtxRender);
+    Render(camera, camera.image, nStartX, nStartY, nWidth, nHeight, nBin, nSequence, dScale);
+    Fill(camera.image, fmt, pBuf);
+    return POA_OK;
+}
+
+POAErrors POAGetDroppedImagesCount(int nCameraID, int *pDroppedCount) {
+    if ( ! pDroppedCount ) {
+        return POA_ERROR_POINTER;
+    }
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    *pDroppedCount = static_cast<int>(pCamera->nDropped);
+    return POA_OK;
+}
+
+POAErrors POASetUserCustomID(int nCameraID, const char* pCustomID, int len) {
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    auto pCamera = Sim().Find(nCameraID);
+    if ( const auto nErr = CheckOpened(pCamera) ) {
+        return nErr;
+    }
+    if ( pCamera->bExposing ) {
+        return POA_ERROR_EXPOSING;
+    }
+    auto &customID = pCamera->prop.userCustomID;
+    std::memset(customID, 0, sizeof(customID));
+    if ( pCustomID && len > 0 ) {
+        std::memcpy(customID, pCustomID, std::min<std::size_t>(len, sizeof(customID) - 1));
+    }
+    return POA_OK;
+}
+
+POAErrors POAGetGainOffset(int nCameraID, int *pOffsetHighestDR, int *pOffsetUnityGain, int *pGainLowestRN, int *pOffsetLowestRN, int *pHCGain) {
+    std::lock_guard<std::mutex> lock(Sim().mtx);
+    if ( ! Sim().Find(nCameraID) ) {
+        return POA_ERROR_INVALID_ID;
+    }
+    if ( ! pOffsetHighestDR || ! pOffsetUnityGain || ! pGainLowestRN || ! pOffsetLowestRN || ! pHCGain ) {
+        return POA_ERROR_POINTER;
+    }
+    *pOffsetHighestDR = 10;
+    *pOffsetUnityGain = 12;
+    *pGainLowestRN = 300;
+    *pOffsetLowestRN = 30;
+    *pHCGain = 100;
+    return POA_OK;
+}
+
+const char* POAGetErrorString(POAErrors err) {
+    switch (err) {
+    case POA_OK: return "OK";
+    case POA_ERROR_INVALID_INDEX: return "invalid index";
+    case POA_ERROR_INVALID_ID: return "invalid camera ID";
+    case POA_ERROR_INVALID_CONFIG: return "invalid POAConfig";
+    case POA_ERROR_INVALID_ARGU: return "invalid argument";
+    case POA_ERROR_NOT_OPENED: return "camera not opened";
+    case POA_ERROR_DEVICE_NOT_FOUND: return "camera not found";
+    case POA_ERROR_OUT_OF_LIMIT: return "value out of limit";
+    case POA_ERROR_EXPOSURE_FAILED: return "exposure failed";
+    case POA_ERROR_TIMEOUT: return "timeout";
+    case POA_ERROR_SIZE_LESS: return "buffer size is not enough";
+    case POA_ERROR_EXPOSING: return "camera is exposing";
+    case POA_ERROR_POINTER: return "invalid pointer";
+    case POA_ERROR_CONF_CANNOT_WRITE: return "config is not writable";
+    case POA_ERROR_CONF_CANNOT_READ: return "config is not readable";
+    case POA_ERROR_ACCESS_DENIED: return "access denied";
+    case POA_ERROR_OPERATION_FAILED: return "operation failed";
+    case POA_ERROR_MEMORY_FAILED: return "memory allocation failed";
+    }
+    return "unknown error";
+}
+
+int POAGetAPIVersion() {
+    return 20220428;
+}
+
+const char* POAGetSDKVersion() {
+    return "2.0.6-sim";
+}
+
+}  // extern "C"
@@ -0,0 +1,23 @@
+# Simulated PlayerOneCamera SDK (drop-in replacement of lib/libPlayerOneCamera)
+
+TEMPLATE = lib
+TARGET = PlayerOneCamera
+VERSION = 2.0.6
+
+CONFIG -= qt
+CONFIG += c++17 shared skip_target_version_ext
+
+SOURCES += \
+    playeronesim.cpp
+
+HEADERS += \
+    ../include/PlayerOneCamera.h
+
+INCLUDEPATH += ../include/
+
+# same layout as ../lib so it can be used at link time or load time
+DESTDIR = $$PWD/lib
+
+unix {
+    LIBS += -lpthread
+}
@@ -0,0 +1,180 @@
+#include "softwarebin.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+
+namespace {
+
+constexpr int MaxBin = 8;
+
+// rows per ParallelFor chunk: at least ~64k source samples
+std::size_t MinRows(std::size_t nRowSamples) {
+    return std::max<std::size_t>(1, 65536 / std::max<std::size_t>(1, nRowSamples));
+}
+
+template <typename T>
+using FoldFunc = void (*)(const std::uint32_t *pAcc, T *pDst, std::size_t nOutWidth, float fScale);
+
+// one output row from the column sums; X is a constant so the inner loop
+// unrolls and the row vectorizes
+template <typename T, int X, bool Bayer, bool Average>
+void FoldRow(const std::uint32_t *pAcc, T *pDst, std::size_t nOutWidth, float fScale) {
+    constexpr std::uint32_t nMax = std::numeric_limits<T>::max();
+    for (std::size_t ox = 0; ox < nOutWidth; ++ox) {
+        // Bayer: output pairs of colors, each from X sites two apart
+        const std::size_t nFirst = Bayer ? (ox >> 1) * 2 * X + (ox & 1) : ox * X;
+        std::uint32_t nSum = 0;
+        for (int i = 0; i < X; ++i) {
+            nSum += pAcc[nFirst + (Bayer ? 2 * i : i)];
+        }
+        if ( Average ) {
+            pDst[ox] = static_cast<T>(nSum * fScale + 0.5f);
+        } else {
+            pDst[ox] = static_cast<T>(std::min(nSum, nMax));
+        }
+    }
+}
+
+template <typename T, bool Bayer, bool Average>
+FoldFunc<T> SelectFold(int nX) {
+    switch (nX) {
+    case 1:
+        return FoldRow<T, 1, Bayer, Average>;
+    case 2:
+        return FoldRow<T, 2, Bayer, Average>;
+    case 3:
+        return FoldRow<T, 3, Bayer, Average>;
+    case 4:
+        return FoldRow<T, 4, Bayer, Average>;
+    case 5:
+        return FoldRow<T, 5, Bayer, Average>;
+    case 6:
+        return FoldRow<T, 6, Bayer, Average>;
+    case 7:
+        return FoldRow<T, 7, Bayer, Average>;
+    case 8:
+        return FoldRow<T, 8, Bayer, Average>;
+    }
+    return nullptr;
+}
+
+template <typename T>
+FoldFunc<T> SelectFold(const SoftwareBin &bin) {
+    const bool bAverage = bin.mode == BinMode::Average;
+    if ( bin.bBayer ) {
+        return bAverage ? SelectFold<T, true, true>(bin.nX) : SelectFold<T, true, false>(bin.nX);
+    }
+    return bAverage ? SelectFold<T, false, true>(bin.nX) : SelectFold<T, false, false>(bin.nX);
+}
+
+template <typename T>
+void BinFrame(const T *pSrc, std::size_t nWidth, T *pDst, std::size_t nOutWidth, std::size_t nOutHeight,
+              const SoftwareBin &bin, ThreadPool &pool) {
+    const auto fold = SelectFold<T>(bin);
+    const std::size_t nX = bin.nX;
+    const std::size_t nY = bin.nY;
+    const bool bBayer = bin.bBayer;
+    // source columns that end up in a bin
+    const std::size_t nUsed = bBayer ? nOutWidth / 2 * 2 * nX : nOutWidth * nX;
+    const float fScale = 1.0f / (nX * nY);
+    pool.ParallelFor(nOutHeight, [=](std::size_t nBegin, std::size_t nEnd) {
+        std::vector<std::uint32_t> acc(nUsed);
+        std::uint32_t *a = acc.data();
+        for (auto oy = nBegin; oy < nEnd; ++oy) {
+            // Bayer: rows of the same color are two apart
+            const std::size_t nFirst = bBayer ? (oy >> 1) * 2 * nY + (oy & 1) : oy * nY;
+            const std::size_t nStep = bBayer ? 2 : 1;
+            const T *s = pSrc + nFirst * nWidth;
+            for (std::size_t x = 0; x < nUsed; ++x) {
+                a[x] = s[x];
+            }
+            for (std::size_t j = 1; j < nY; ++j) {
+                s = pSrc + (nFirst + j * nStep) * nWidth;
+                for (std::size_t x = 0; x < nUsed; ++x) {
+                    a[x] += s[x];
+                }
+            }
+            fold(a, pDst + oy * nOutWidth, nOutWidth, fScale);
+        }
+    }, MinRows(nWidth * nY));
+}
+
+}  // namespace
+
+
+SoftwareBinner::SoftwareBinner(ThreadPool &pool)
+    : pool(pool)
+{}
+
+std::pair<int, int> SoftwareBinner::GetOutputSize(int nWidth, int nHeight, const SoftwareBin &bin) {
+    if ( bin.nX < 1 || bin.nY < 1 || nWidth <= 0 || nHeight <= 0 ) {
+        return { 0, 0 };
+    }
+    if ( bin.bBayer ) {
+        // whole 2x2 CFA cells of binned sites
+        return { nWidth / (2 * bin.nX) * 2, nHeight / (2 * bin.nY) * 2 };
+    }
+    return { nWidth / bin.nX, nHeight / bin.nY };
+}
+
+bool SoftwareBinner::Bin(int nWidth, int nHeight, int nBytepp, const FrameBuffer &input, const SoftwareBin &bin, FrameBuffer &output) const {
+    if ( bin.nX < 1 || bin.nX > MaxBin || bin.nY < 1 || bin.nY > MaxBin || (nBytepp != 1 && nBytepp != 2) ) {
+        return false;
+    }
+    if ( input.size() < static_cast<std::size_t>(nWidth) * nHeight * nBytepp ) {
+        return false;
+    }
+    const auto [nOutWidth, nOutHeight] = GetOutputSize(nWidth, nHeight, bin);
+    if ( nOutWidth == 0 || nOutHeight == 0 ) {
+        return false;
+    }
+    output.resize(static_cast<std::size_t>(nOutWidth) * nOutHeight * nBytepp);
+    if ( nBytepp == 2 ) {
+        BinFrame(reinterpret_cast<const std::uint16_t *>(input.data()), nWidth,
+                 reinterpret_cast<std::uint16_t *>(output.data()), nOutWidth, nOutHeight, bin, pool);
+    } else {
+        BinFrame(input.data(), nWidth, output.data(), nOutWidth, nOutHeight, bin, pool);
+    }
+    return true;
+}
+
+std::optional<SoftwareBin> ParseSoftwareBin(const std::string &text) {
+    SoftwareBin bin;
+    auto factors = text;
+    const auto nColon = text.find(':');
+    if ( nColon != std::string::npos ) {
+        factors = text.substr(0, nColon);
+        const auto mode = text.substr(nColon + 1);
+        if ( mode == "sum" ) {
+            bin.mode = BinMode::Sum;
+        } else if ( mode != "avg" ) {
+            return std::nullopt;
+        }
+    }
+    try {
+        std::size_t nParsed = 0;
+        const auto nCross = factors.find('x');
+        bin.nX = std::stoi(factors.substr(0, nCross), &nParsed);
+        if ( nParsed != (nCross == std::string::npos ? factors.size() : nCross) ) {
+            return std::nullopt;
+        }
+        bin.nY = bin.nX;
+        if ( nCross != std::string::npos ) {
+            const auto y = factors.substr(nCross + 1);
+            bin.nY = std::stoi(y, &nParsed);
+            if ( nParsed != y.size() ) {
+                return std::nullopt;
+            }
+        }
+    } catch (const std::exception &) {
+        return std::nullopt;
+    }
+    if ( bin.nX < 1 || bin.nX > MaxBin || bin.nY < 1 || bin.nY > MaxBin ) {
+        return std::nullopt;
+    }
+    return bin;
+}
@@ -0,0 +1,54 @@
+#ifndef SOFTWAREBIN_H
+#define SOFTWAREBIN_H
+
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "framebuffer.h"
+#include "threadpool.h"
+
+
+enum class BinMode {
+    Sum,        // saturates at the largest value of the format
+    Average,    // rounded mean of the bin
+};
+
+struct SoftwareBin {
+    int nX = 1;             // 1..8, non-square allowed
+    int nY = 1;
+    BinMode mode = BinMode::Average;
+    // RAW of a color sensor: combine sites of the same color, the 2x2 CFA
+    // pattern is kept at half the resolution of a plain bin
+    bool bBayer = false;
+
+    bool IsEnabled() const {
+        return nX > 1 || nY > 1;
+    }
+};
+
+//
+// binning in software, for the factors the camera does not offer
+// every output row adds its source rows into a 32bit row accumulator, then
+// folds the bin width, both loops simple enough for the compiler to
+// vectorize; output rows are split across the thread pool. incomplete bins
+// at the right and bottom edge are dropped.
+//
+class SoftwareBinner {
+public:
+    explicit SoftwareBinner(ThreadPool &pool = ThreadPool::Global());
+
+    // size of the binned frame, 0x0 if the frame is smaller than one bin
+    static std::pair<int, int> GetOutputSize(int nWidth, int nHeight, const SoftwareBin &bin);
+
+    // nBytepp: 1 (RAW8/MONO8) or 2 (RAW16), the output has the same format
+    bool Bin(int nWidth, int nHeight, int nBytepp, const FrameBuffer &input, const SoftwareBin &bin, FrameBuffer &output) const;
+
+private:
+    ThreadPool &pool;
+};
+
+// "2x2", "3x2:sum" or "4:avg" (square); the Bayer flag is not parsed
+std::optional<SoftwareBin> ParseSoftwareBin(const std::string &text);
+
+#endif // SOFTWAREBIN_H
@@ -0,0 +1,269 @@
+#include "stardetector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace {
+
+// the background estimate looks at up to 16 x 16 samples per tile
+constexpr int TileSamplesPerAxis = 16;
+// pixels checked at once when skipping background
+constexpr int SkipBlock = 16;
+
+int FindRoot(std::vector<int> &parents, int n) {
+    while ( parents[n] != n ) {
+        parents[n] = parents[parents[n]];
+        n = parents[n];
+    }
+    return n;
+}
+
+void Union(std::vector<int> &parents, int a, int b) {
+    a = FindRoot(parents, a);
+    b = FindRoot(parents, b);
+    if ( a != b ) {
+        parents[std::max(a, b)] = std::min(a, b);
+    }
+}
+
+}  // namespace
+
+
+StarDetector::StarDetector(ThreadPool &pool)
+    : pool(pool)
+    , config()
+    , nWidth(0)
+    , nHeight(0)
+    , nTilesX(0)
+    , nTilesY(0)
+{}
+
+void StarDetector::SetConfig(const StarDetectorConfig &config) {
+    this->config = config;
+    this->config.nTileSize = std::max(8, config.nTileSize);
+}
+
+const StarDetectorConfig &StarDetector::GetConfig() const {
+    return config;
+}
+
+std::vector<Star> StarDetector::Detect(int nWidth, int nHeight, int nBytepp, const FrameBuffer &buffer) {
+    if ( nWidth <= 0 || nHeight <= 0 || (nBytepp != 1 && nBytepp != 2) ) {
+        return {};
+    }
+    if ( buffer.size() < static_cast<std::size_t>(nWidth) * nHeight * nBytepp ) {
+        return {};
+    }
+    this->nWidth = nWidth;
+    this->nHeight = nHeight;
+    nTilesX = (nWidth + config.nTileSize - 1) / config.nTileSize;
+    nTilesY = (nHeight + config.nTileSize - 1) / config.nTileSize;
+    tiles.resize(static_cast<std::size_t>(nTilesX) * nTilesY);
+    rowRuns.resize(nHeight);
+
+    if ( nBytepp == 2 ) {
+        const auto pImage = reinterpret_cast<const std::uint16_t *>(buffer.data());
+        EstimateBackground(pImage);
+        FindRuns(pImage);
+        LabelRuns();
+        return Measure(pImage, static_cast<std::uint16_t>(65535 * 0.98));
+    }
+    const auto pImage = buffer.data();
+    EstimateBackground(pImage);
+    FindRuns(pImage);
+    LabelRuns();
+    return Measure(pImage, static_cast<unsigned char>(250));
+}
+
+template <typename T>
+void StarDetector::EstimateBackground(const T *pImage) {
+    const auto nTileSize = config.nTileSize;
+    const auto dSigma = config.dThresholdSigma;
+    const int nStep = std::max(1, nTileSize / TileSamplesPerAxis);
+    pool.ParallelFor(tiles.size(), [&, pImage](std::size_t nBegin, std::size_t nEnd) {
+        std::vector<float> samples;
+        samples.reserve((nTileSize / nStep + 1) * (nTileSize / nStep + 1));
+        for (auto i = nBegin; i < nEnd; ++i) {
+            const int tx = static_cast<int>(i % nTilesX);
+            const int ty = static_cast<int>(i / nTilesX);
+            const int x0 = tx * nTileSize;
+            const int y0 = ty * nTileSize;
+            const int x1 = std::min(nWidth, x0 + nTileSize);
+            const int y1 = std::min(nHeight, y0 + nTileSize);
+            samples.clear();
+            for (int y = y0 + nStep / 2; y < y1; y += nStep) {
+                const T *p = pImage + static_cast<std::size_t>(y) * nWidth;
+                for (int x = x0 + nStep / 2; x < x1; x += nStep) {
+                    samples.push_back(static_cast<float>(p[x]));
+                }
+            }
+            // median and MAD are not pulled up by the stars in the tile
+            const auto mid = samples.begin() + samples.size() / 2;
+            std::nth_element(samples.begin(), mid, samples.end());
+            const float fMedian = *mid;
+            for (auto &v : samples) {
+                v = std::abs(v - fMedian);
+            }
+            std::nth_element(samples.begin(), mid, samples.end());
+            const float fNoise = std::max(0.5f, 1.4826f * *mid);
+            tiles[i].fBackground = fMedian;
+            tiles[i].fThreshold = fMedian + static_cast<float>(dSigma) * fNoise;
+        }
+    });
+}
+
+template <typename T>
+void StarDetector::FindRuns(const T *pImage) {
+    const auto nTileSize = config.nTileSize;
+    const float fMax = static_cast<float>(std::numeric_limits<T>::max());
+    pool.ParallelFor(nHeight, [&, pImage](std::size_t nBegin, std::size_t nEnd) {
+        for (auto y = static_cast<int>(nBegin); y < static_cast<int>(nEnd); ++y) {
+            const T *p = pImage + static_cast<std::size_t>(y) * nWidth;
+            const Tile *pTiles = tiles.data() + static_cast<std::size_t>(y / nTileSize) * nTilesX;
+            auto &runs = rowRuns[y];
+            runs.clear();
+            int nStart = -1;
+            for (int tx = 0; tx < nTilesX; ++tx) {
+                // p > limit  <=>  p > threshold
+                const T limit = static_cast<T>(std::min(fMax, std::floor(pTiles[tx].fThreshold)));
+                const int x1 = std::min(nWidth, (tx + 1) * nTileSize);
+                int x = tx * nTileSize;
+                while ( x < x1 ) {
+                    if ( nStart < 0 ) {
+                        // skip background a block at a time (vectorized max)
+                        while ( x + SkipBlock <= x1 ) {
+                            T m = 0;
+                            for (int i = 0; i < SkipBlock; ++i) {
+                                m = std::max(m, p[x + i]);
+                            }
+                            if ( m > limit ) {
+                                break;
+                            }
+                            x += SkipBlock;
+                        }
+                        if ( x >= x1 ) {
+                            break;
+                        }
+                        if ( p[x] > limit ) {
+                            nStart = x;
+                        }
+                    } else if ( p[x] <= limit ) {
+                        runs.push_back(Run{ y, nStart, x - 1, 0 });
+                        nStart = -1;
+                    }
+                    ++x;
+                }
+            }
+            if ( nStart >= 0 ) {
+                runs.push_back(Run{ y, nStart, nWidth - 1, 0 });
+            }
+        }
+    }, 16);
+}
+
+void StarDetector::LabelRuns() {
+    int nLabels = 0;
+    for (auto &runs : rowRuns) {
+        for (auto &run : runs) {
+            run.nLabel = nLabels++;
+        }
+    }
+    parents.resize(nLabels);
+    for (int i = 0; i < nLabels; ++i) {
+        parents[i] = i;
+    }
+    // 8-connected overlap with the previous row
+    for (int y = 1; y < nHeight; ++y) {
+        const auto &above = rowRuns[y - 1];
+        const auto &runs = rowRuns[y];
+        std::size_t a = 0;
+        for (const auto &run : runs) {
+            while ( a < above.size() && above[a].nX1 + 1 < run.nX0 ) {
+                ++a;
+            }
+            for (auto b = a; b < above.size() && above[b].nX0 <= run.nX1 + 1; ++b) {
+                Union(parents, above[b].nLabel, run.nLabel);
+            }
+        }
+    }
+}
+
+template <typename T>
+std::vector<Star> StarDetector::Measure(const T *pImage, T nSaturation) {
+    struct Component {
+        double dSum = 0;
+        double dSumX = 0;
+        double dSumY = 0;
+        double dPeak = 0;
+        int nPixels = 0;
+        bool bSaturated = false;
+        int nStar = -1;
+    };
+    const auto nTileSize = config.nTileSize;
+    std::vector<Component> components(parents.size());
+    for (const auto &runs : rowRuns) {
+        for (const auto &run : runs) {
+            auto &c = components[FindRoot(parents, run.nLabel)];
+            const T *p = pImage + static_cast<std::size_t>(run.nY) * nWidth;
+            const Tile *pTiles = tiles.data() + static_cast<std::size_t>(run.nY / nTileSize) * nTilesX;
+            for (int x = run.nX0; x <= run.nX1; ++x) {
+                const double w = std::max(0.0f, p[x] - pTiles[x / nTileSize].fBackground);
+                c.dSum += w;
+                c.dSumX += w * x;
+                c.dSumY += w * run.nY;
+                c.dPeak = std::max(c.dPeak, w);
+                c.bSaturated = c.bSaturated || p[x] >= nSaturation;
+            }
+            c.nPixels += run.nX1 - run.nX0 + 1;
+        }
+    }
+
+    std::vector<Star> stars;
+    for (auto &c : components) {
+        if ( c.nPixels < config.nMinPixels || c.nPixels > config.nMaxPixels || c.dSum <= 0 ) {
+            continue;
+        }
+        Star star;
+        star.dX = c.dSumX / c.dSum;
+        star.dY = c.dSumY / c.dSum;
+        star.dFlux = c.dSum;
+        star.dPeak = c.dPeak;
+        star.nPixels = c.nPixels;
+        star.bSaturated = c.bSaturated;
+        c.nStar = static_cast<int>(stars.size());
+        stars.push_back(star);
+    }
+
+    // half flux radius: flux weighted mean distance from the centroid
+    std::vector<double> radiusSum(stars.size(), 0.0);
+    for (const auto &runs : rowRuns) {
+        for (const auto &run : runs) {
+            const auto nStar = components[FindRoot(parents, run.nLabel)].nStar;
+            if ( nStar < 0 ) {
+                continue;
+            }
+            const auto &star = stars[nStar];
+            const T *p = pImage + static_cast<std::size_t>(run.nY) * nWidth;
+            const Tile *pTiles = tiles.data() + static_cast<std::size_t>(run.nY / nTileSize) * nTilesX;
+            const double dy = run.nY - star.dY;
+            for (int x = run.nX0; x <= run.nX1; ++x) {
+                const double w = std::max(0.0f, p[x] - pTiles[x / nTileSize].fBackground);
+                const double dx = x - star.dX;
+                radiusSum[nStar] += w * std::sqrt(dx * dx + dy * dy);
+            }
+        }
+    }
+    for (std::size_t i = 0; i < stars.size(); ++i) {
+        stars[i].dHFR = radiusSum[i] / stars[i].dFlux;
+    }
+
+    std::sort(stars.begin(), stars.end(), [](const Star &a, const Star &b) {
+        return a.dFlux > b.dFlux;
+    });
+    if ( config.nMaxStars > 0 && static_cast<int>(stars.size()) > config.nMaxStars ) {
+        stars.resize(config.nMaxStars);
+    }
+    return stars;
+}
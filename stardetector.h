@@ -0,0 +1,75 @@
+#ifndef STARDETECTOR_H
+#define STARDETECTOR_H
+
+#include <cstdint>
+#include <vector>
+
+#include "framebuffer.h"
+#include "threadpool.h"
+
+
+struct Star {
+    double dX = 0;          // intensity weighted centroid (pixel centers at .0)
+    double dY = 0;
+    double dFlux = 0;       // background subtracted sum (ADU)
+    double dPeak = 0;       // brightest pixel above background
+    double dHFR = 0;        // half flux radius (pixels)
+    int nPixels = 0;
+    bool bSaturated = false;
+};
+
+struct StarDetectorConfig {
+    int nTileSize = 64;             // background / noise grid
+    double dThresholdSigma = 5.0;   // detection threshold above background
+    int nMinPixels = 3;
+    int nMaxPixels = 4096;          // larger blobs (hot columns, nebula) are skipped
+    int nMaxStars = 0;              // brightest n, 0: all
+};
+
+//
+// star detection and sub pixel centroiding for guiding
+// background and noise come from the median / MAD of each tile, pixels
+// above background + k * sigma form 8-connected components. works directly
+// on the RAW8/RAW16 buffer, only per tile and per run bookkeeping is kept.
+//
+class StarDetector {
+public:
+    explicit StarDetector(ThreadPool &pool = ThreadPool::Global());
+
+    void SetConfig(const StarDetectorConfig &config);
+    const StarDetectorConfig &GetConfig() const;
+
+    // nBytepp: 1 (RAW8/MONO8) or 2 (RAW16). sorted by flux, brightest first
+    std::vector<Star> Detect(int nWidth, int nHeight, int nBytepp, const FrameBuffer &buffer);
+
+private:
+    struct Tile {
+        float fBackground;
+        float fThreshold;
+    };
+    struct Run {
+        int nY;
+        int nX0;
+        int nX1;        // inclusive
+        int nLabel;
+    };
+
+    template <typename T> void EstimateBackground(const T *pImage);
+    template <typename T> void FindRuns(const T *pImage);
+    void LabelRuns();
+    template <typename T> std::vector<Star> Measure(const T *pImage, T nSaturation);
+
+    ThreadPool &pool;
+    StarDetectorConfig config;
+
+    int nWidth;
+    int nHeight;
+    int nTilesX;
+    int nTilesY;
+    // reused between frames
+    std::vector<Tile> tiles;
+    std::vector<std::vector<Run>> rowRuns;
+    std::vector<int> parents;
+};
+
+#endif // STARDETECTOR_H
@@ -0,0 +1,120 @@
+#include "telemetry.h"
+
+#include "cameraexecutor.h"
+#include "playeronecamera.hpp"
+#include "threadconfig.h"
+
+
+TelemetryPoller::TelemetryPoller(std::shared_ptr<CameraExecutor> pExecutor, std::chrono::milliseconds interval)
+    : pExecutor(std::move(pExecutor))
+    , pSnapshot()
+    , bReadout(false)
+    , mtx()
+    , cv()
+    , interval(interval)
+    , bPollNow(true)
+    , bStop(false)
+    , bAbandoned(false)
+    , thread([this]() { ThreadProc(); })
+{}
+
+TelemetryPoller::~TelemetryPoller() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bStop = true;
+    }
+    cv.notify_all();
+    thread.join();
+}
+
+void TelemetryPoller::Abandon() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bStop = true;
+        bAbandoned = true;
+    }
+    cv.notify_all();
+}
+
+void TelemetryPoller::SetInterval(std::chrono::milliseconds interval) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        this->interval = interval;
+    }
+    cv.notify_all();
+}
+std::chrono::milliseconds TelemetryPoller::GetInterval() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return interval;
+}
+void TelemetryPoller::PollNow() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bPollNow = true;
+    }
+    cv.notify_all();
+}
+
+std::shared_ptr<const CameraTelemetry> TelemetryPoller::GetSnapshot() const {
+    return std::atomic_load(&pSnapshot);
+}
+
+void TelemetryPoller::BeginReadout() {
+    bReadout = true;
+}
+void TelemetryPoller::EndReadout() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bReadout = false;
+    }
+    cv.notify_all();
+}
+
+void TelemetryPoller::ThreadProc() {
+    SetCurrentThreadName("poa-telemetry");
+    std::unique_lock<std::mutex> lock(mtx);
+    clock::time_point last;
+    while ( ! bStop ) {
+        // re-evaluated after every wakeup, SetInterval() applies at once
+        const auto next = last + interval;
+        if ( ! bPollNow && clock::now() < next ) {
+            cv.wait_until(lock, next);
+            continue;
+        }
+        // a frame is on the wire: take the gap right after it
+        cv.wait(lock, [this]() { return bStop || ! bReadout; });
+        if ( bStop ) {
+            break;
+        }
+        bPollNow = false;
+        lock.unlock();
+        Poll();
+        lock.lock();
+        last = clock::now();
+    }
+}
+
+void TelemetryPoller::Poll() {
+    const auto pPrevious = std::atomic_load(&pSnapshot);
+    auto pTelemetry = pPrevious ? std::make_shared<CameraTelemetry>(*pPrevious) : std::make_shared<CameraTelemetry>();
+
+    // one SDK call at a time, give way as soon as a readout starts
+    const auto &pCamera = pExecutor->GetCamera();
+    if ( pCamera->HasConfig(POAConfig::POA_TEMPERATURE) && ! bReadout ) {
+        pTelemetry->temperature = pExecutor->CallOrAbandon(bAbandoned, CommandPriority::Background, &PlayerOneCamera::GetTemperature);
+    }
+    if ( pCamera->HasCooler() ) {
+        if ( pCamera->HasConfig(POAConfig::POA_COOLER_POWER) && ! bReadout ) {
+            pTelemetry->nCoolerPower = pExecutor->CallOrAbandon(bAbandoned, CommandPriority::Background, &PlayerOneCamera::GetCoolerPower);
+        }
+        if ( pCamera->HasConfig(POAConfig::POA_TARGET_TEMP) && ! bReadout ) {
+            pTelemetry->nTargetTemperature = pExecutor->CallOrAbandon(bAbandoned, CommandPriority::Background, &PlayerOneCamera::GetTargetTemperature);
+        }
+        if ( pCamera->HasConfig(POAConfig::POA_COOLER) && ! bReadout ) {
+            pTelemetry->bCooler = pExecutor->CallOrAbandon(bAbandoned, CommandPriority::Background, &PlayerOneCamera::GetCooler);
+        }
+    }
+    pTelemetry->sampled = clock::now();
+    pTelemetry->nSequence = pPrevious ? pPrevious->nSequence + 1 : 1;
+    std::atomic_store(&pSnapshot, std::shared_ptr<const CameraTelemetry>(std::move(pTelemetry)));
+}
@@ -0,0 +1,77 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+class CameraExecutor;
+
+// one poll of the temperature/cooler values, replaced as a whole
+struct CameraTelemetry {
+    std::optional<double> temperature;          // sensor (C)
+    std::optional<long> nCoolerPower;           // percent
+    std::optional<long> nTargetTemperature;     // set point (C)
+    std::optional<bool> bCooler;
+    std::chrono::steady_clock::time_point sampled;
+    std::uint64_t nSequence = 0;
+};
+
+//
+// low rate poller for POA_TEMPERATURE, POA_COOLER_POWER, POA_TARGET_TEMP and
+// POA_COOLER. the capture thread brackets every download with
+// BeginReadout()/EndReadout(); a poll that falls due during a download waits
+// for the gap after it, and a poll interrupted by a new readout keeps the
+// previous values for the rest. the reads go through the background lane of
+// the camera executor; readers get the last snapshot without an SDK call or
+// a lock.
+//
+class TelemetryPoller {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit TelemetryPoller(std::shared_ptr<CameraExecutor> pExecutor,
+                             std::chrono::milliseconds interval = std::chrono::milliseconds(2000));
+    ~TelemetryPoller();
+    // for a stuck executor: the thread stops waiting for its command; the
+    // destructor does not wait for the executor then
+    void Abandon();
+
+    TelemetryPoller(const TelemetryPoller &) = delete;
+    TelemetryPoller &operator=(const TelemetryPoller &) = delete;
+
+    void SetInterval(std::chrono::milliseconds interval);
+    std::chrono::milliseconds GetInterval() const;
+    // poll at the next gap, e.g. after changing the set point
+    void PollNow();
+
+    // null until the first poll completed
+    std::shared_ptr<const CameraTelemetry> GetSnapshot() const;
+
+    // called by the capture thread around GetImageData
+    void BeginReadout();
+    void EndReadout();
+
+private:
+    void ThreadProc();
+    void Poll();
+
+    std::shared_ptr<CameraExecutor> pExecutor;
+    // std::atomic_load / std::atomic_store only
+    std::shared_ptr<const CameraTelemetry> pSnapshot;
+    std::atomic<bool> bReadout;
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    std::chrono::milliseconds interval;
+    bool bPollNow;
+    bool bStop;
+    std::atomic<bool> bAbandoned;
+    std::thread thread;
+};
+
+#endif // TELEMETRY_H
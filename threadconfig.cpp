@@ -0,0 +1,328 @@
+#include "threadconfig.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+
+namespace {
+
+// CPUs an affinity mask can name
+#if defined(__linux__)
+constexpr int MaxCpus = CPU_SETSIZE;
+#elif defined(_WIN32)
+constexpr int MaxCpus = static_cast<int>(sizeof(DWORD_PTR) * 8);
+#else
+constexpr int MaxCpus = 1024;
+#endif
+
+void AddError(std::string &error, const std::string &message) {
+    if ( ! error.empty() ) {
+        error += "; ";
+    }
+    error += message;
+}
+
+#ifndef _WIN32
+std::string LimitText(int nResource) {
+    rlimit limit{};
+    if ( getrlimit(nResource, &limit) != 0 ) {
+        return "unknown";
+    }
+    if ( limit.rlim_cur == RLIM_INFINITY ) {
+        return "unlimited";
+    }
+    return std::to_string(static_cast<unsigned long long>(limit.rlim_cur));
+}
+#endif
+
+const char *PolicyName(ThreadPolicy policy) {
+    switch (policy) {
+    case ThreadPolicy::Default:
+        return "default";
+    case ThreadPolicy::Nice:
+        return "nice";
+    case ThreadPolicy::Fifo:
+        return "SCHED_FIFO";
+    case ThreadPolicy::RoundRobin:
+        return "SCHED_RR";
+    }
+    return "?";
+}
+
+bool ApplyAffinity(const std::vector<int> &cpus, std::string &error) {
+    if ( cpus.empty() ) {
+        return true;
+    }
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const auto nCpu : cpus) {
+        if ( nCpu < 0 || nCpu >= MaxCpus ) {
+            AddError(error, "affinity: CPU " + std::to_string(nCpu) + " out of range");
+            return false;
+        }
+        CPU_SET(nCpu, &set);
+    }
+    const int nResult = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if ( nResult == EINVAL ) {
+        AddError(error, "affinity: none of the CPUs is online or allowed for this process (cpuset), "
+                        + std::to_string(std::thread::hardware_concurrency()) + " CPUs online");
+        return false;
+    }
+    if ( nResult != 0 ) {
+        AddError(error, std::string("affinity: ") + std::strerror(nResult));
+        return false;
+    }
+    return true;
+#elif defined(_WIN32)
+    DWORD_PTR nMask = 0;
+    for (const auto nCpu : cpus) {
+        if ( nCpu < 0 || nCpu >= MaxCpus ) {
+            AddError(error, "affinity: CPU " + std::to_string(nCpu) + " out of range");
+            return false;
+        }
+        nMask |= DWORD_PTR(1) << nCpu;
+    }
+    if ( SetThreadAffinityMask(GetCurrentThread(), nMask) == 0 ) {
+        AddError(error, "affinity: SetThreadAffinityMask failed (error " + std::to_string(GetLastError()) + ")");
+        return false;
+    }
+    return true;
+#else
+    AddError(error, "affinity: not supported on this platform");
+    return false;
+#endif
+}
+
+bool ApplyPolicy(ThreadPolicy policy, int nPriority, std::string &error) {
+#ifdef _WIN32
+    // no real time classes for a thread alone: the closest priorities
+    int nWinPriority = THREAD_PRIORITY_NORMAL;
+    switch (policy) {
+    case ThreadPolicy::Default:
+        return true;
+    case ThreadPolicy::Nice:
+        nWinPriority = nPriority <= -10 ? THREAD_PRIORITY_HIGHEST : nPriority < 0 ? THREAD_PRIORITY_ABOVE_NORMAL
+                     : nPriority >= 10 ? THREAD_PRIORITY_LOWEST : nPriority > 0 ? THREAD_PRIORITY_BELOW_NORMAL
+                     : THREAD_PRIORITY_NORMAL;
+        break;
+    case ThreadPolicy::Fifo:
+    case ThreadPolicy::RoundRobin:
+        nWinPriority = nPriority >= 50 ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_HIGHEST;
+        break;
+    }
+    if ( ! SetThreadPriority(GetCurrentThread(), nWinPriority) ) {
+        AddError(error, std::string(PolicyName(policy)) + ": SetThreadPriority failed (error " + std::to_string(GetLastError()) + ")");
+        return false;
+    }
+    return true;
+#else
+    switch (policy) {
+    case ThreadPolicy::Default:
+        return true;
+    case ThreadPolicy::Nice: {
+        if ( nPriority < -20 || nPriority > 19 ) {
+            AddError(error, "nice " + std::to_string(nPriority) + ": out of range (-20..19)");
+            return false;
+        }
+#ifdef __linux__
+        // per thread on Linux
+        const auto tid = static_cast<id_t>(syscall(SYS_gettid));
+        if ( setpriority(PRIO_PROCESS, tid, nPriority) != 0 ) {
+            const int nError = errno;
+            if ( nError == EACCES || nError == EPERM ) {
+                AddError(error, "nice " + std::to_string(nPriority) + ": not permitted, needs CAP_SYS_NICE or RLIMIT_NICE of at least "
+                                + std::to_string(20 - nPriority) + " (current " + LimitText(RLIMIT_NICE) + ", 'nice' in limits.conf)");
+            } else {
+                AddError(error, "nice " + std::to_string(nPriority) + ": " + std::strerror(nError));
+            }
+            return false;
+        }
+        return true;
+#else
+        AddError(error, "nice: per thread nice levels not supported on this platform");
+        return false;
+#endif
+    }
+    case ThreadPolicy::Fifo:
+    case ThreadPolicy::RoundRobin: {
+        const int nPolicy = policy == ThreadPolicy::Fifo ? SCHED_FIFO : SCHED_RR;
+        const int nMin = sched_get_priority_min(nPolicy);
+        const int nMax = sched_get_priority_max(nPolicy);
+        if ( nPriority < nMin || nPriority > nMax ) {
+            AddError(error, std::string(PolicyName(policy)) + " priority " + std::to_string(nPriority)
+                            + ": out of range (" + std::to_string(nMin) + ".." + std::to_string(nMax) + ")");
+            return false;
+        }
+        sched_param param{};
+        param.sched_priority = nPriority;
+        const int nResult = pthread_setschedparam(pthread_self(), nPolicy, &param);
+        if ( nResult == EPERM ) {
+#ifdef __linux__
+            AddError(error, std::string(PolicyName(policy)) + " priority " + std::to_string(nPriority)
+                            + ": not permitted, needs CAP_SYS_NICE or RLIMIT_RTPRIO of at least " + std::to_string(nPriority)
+                            + " (current " + LimitText(RLIMIT_RTPRIO) + ", 'rtprio' in limits.conf or ulimit -r)");
+#else
+            AddError(error, std::string(PolicyName(policy)) + " priority " + std::to_string(nPriority) + ": not permitted");
+#endif
+            return false;
+        }
+        if ( nResult != 0 ) {
+            AddError(error, std::string(PolicyName(policy)) + ": " + std::strerror(nResult));
+            return false;
+        }
+        return true;
+    }
+    }
+    return true;
+#endif
+}
+
+}  // namespace
+
+
+void SetCurrentThreadName(const std::string &name) {
+#if defined(__linux__)
+    // the kernel limit is 16 bytes with the terminator
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#elif defined(__APPLE__)
+    pthread_setname_np(name.c_str());
+#elif defined(_WIN32)
+    // SetThreadDescription exists from Windows 10 1607 on
+    using SetThreadDescriptionProc = HRESULT (WINAPI *)(HANDLE, PCWSTR);
+    const auto proc = reinterpret_cast<SetThreadDescriptionProc>(
+        reinterpret_cast<void *>(GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "SetThreadDescription")));
+    if ( proc ) {
+        const std::wstring wide(name.begin(), name.end());
+        proc(GetCurrentThread(), wide.c_str());
+    }
+#else
+    (void)name;
+#endif
+}
+
+bool ApplyThreadConfig(const ThreadConfig &config, std::string &error) {
+    error.clear();
+    const bool bAffinity = ApplyAffinity(config.cpus, error);
+    const bool bPolicy = ApplyPolicy(config.policy, config.nPriority, error);
+    return bAffinity && bPolicy;
+}
+
+bool TestThreadConfig(const ThreadConfig &config, std::string &error) {
+    bool bOk = false;
+    std::thread scratch([&]() {
+        bOk = ApplyThreadConfig(config, error);
+    });
+    scratch.join();
+    return bOk;
+}
+
+bool LockMemory(const void *pData, std::size_t nSize, std::string &error) {
+    if ( nSize == 0 ) {
+        return true;
+    }
+#ifdef _WIN32
+    if ( ! VirtualLock(const_cast<void *>(pData), nSize) ) {
+        error = "VirtualLock of " + std::to_string(nSize) + " bytes failed (error " + std::to_string(GetLastError())
+                + "), the working set may be too small (SetProcessWorkingSetSize)";
+        return false;
+    }
+    return true;
+#else
+    if ( mlock(pData, nSize) != 0 ) {
+        const int nError = errno;
+        if ( nError == ENOMEM || nError == EPERM ) {
+            error = "mlock of " + std::to_string(nSize) + " bytes: exceeds RLIMIT_MEMLOCK (current " + LimitText(RLIMIT_MEMLOCK)
+                    + " bytes, 'memlock' in limits.conf or ulimit -l) and no CAP_IPC_LOCK";
+        } else {
+            error = "mlock of " + std::to_string(nSize) + " bytes: " + std::strerror(nError);
+        }
+        return false;
+    }
+    return true;
+#endif
+}
+
+void UnlockMemory(const void *pData, std::size_t nSize) {
+    if ( nSize == 0 ) {
+        return;
+    }
+#ifdef _WIN32
+    VirtualUnlock(const_cast<void *>(pData), nSize);
+#else
+    munlock(pData, nSize);
+#endif
+}
+
+std::optional<std::vector<int>> ParseCpuList(const std::string &text) {
+    std::vector<int> cpus;
+    std::size_t nPos = 0;
+    while ( nPos < text.size() ) {
+        auto nEnd = text.find(',', nPos);
+        if ( nEnd == std::string::npos ) {
+            nEnd = text.size();
+        }
+        const auto item = text.substr(nPos, nEnd - nPos);
+        nPos = nEnd + 1;
+        try {
+            std::size_t nParsed = 0;
+            const auto nDash = item.find('-');
+            const int nFirst = std::stoi(item.substr(0, nDash), &nParsed);
+            if ( nParsed != (nDash == std::string::npos ? item.size() : nDash) || nFirst < 0 || nFirst >= MaxCpus ) {
+                return std::nullopt;
+            }
+            int nLast = nFirst;
+            if ( nDash != std::string::npos ) {
+                const auto last = item.substr(nDash + 1);
+                nLast = std::stoi(last, &nParsed);
+                // bounded here, a huge range would fill the list first
+                if ( nParsed != last.size() || nLast < nFirst || nLast >= MaxCpus ) {
+                    return std::nullopt;
+                }
+            }
+            for (int nCpu = nFirst; nCpu <= nLast; ++nCpu) {
+                cpus.push_back(nCpu);
+            }
+        } catch (const std::exception &) {
+            return std::nullopt;
+        }
+    }
+    if ( cpus.empty() ) {
+        return std::nullopt;
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+std::optional<ThreadPolicy> ParseThreadPolicy(const std::string &name) {
+    if ( name == "default" ) {
+        return ThreadPolicy::Default;
+    }
+    if ( name == "nice" ) {
+        return ThreadPolicy::Nice;
+    }
+    if ( name == "fifo" ) {
+        return ThreadPolicy::Fifo;
+    }
+    if ( name == "rr" ) {
+        return ThreadPolicy::RoundRobin;
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,41 @@
+#ifndef THREADCONFIG_H
+#define THREADCONFIG_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+enum class ThreadPolicy {
+    Default,        // left as created
+    Nice,           // time sharing with a nice level
+    Fifo,           // SCHED_FIFO real time
+    RoundRobin,     // SCHED_RR real time
+};
+
+struct ThreadConfig {
+    std::vector<int> cpus;      // affinity, empty: any CPU
+    ThreadPolicy policy = ThreadPolicy::Default;
+    int nPriority = 0;          // Fifo/RoundRobin: 1..99, Nice: -20..19
+};
+
+// names the calling thread for top -H, perf and debuggers (15 characters
+// on Linux, longer names are cut)
+void SetCurrentThreadName(const std::string &name);
+
+// applies to the calling thread. every part is tried; error lists what
+// failed and which privilege or limit is missing.
+bool ApplyThreadConfig(const ThreadConfig &config, std::string &error);
+// applies on a scratch thread, to report missing privileges up front
+bool TestThreadConfig(const ThreadConfig &config, std::string &error);
+
+// keeps the pages resident (mlock / VirtualLock)
+bool LockMemory(const void *pData, std::size_t nSize, std::string &error);
+void UnlockMemory(const void *pData, std::size_t nSize);
+
+// "2,3" or "0-3,6"; nullopt for a CPU the affinity mask cannot name
+std::optional<std::vector<int>> ParseCpuList(const std::string &text);
+std::optional<ThreadPolicy> ParseThreadPolicy(const std::string &name);
+
+#endif // THREADCONFIG_H
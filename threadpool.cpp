@@ -0,0 +1,147 @@
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+
+ThreadPool::ThreadPool(unsigned nThreads)
+    : workers()
+    , mtx()
+    , cv()
+    , tasks()
+    , bStop(false)
+    , threadConfig()
+    , nConfigGeneration(0)
+{
+    if ( nThreads == 0 ) {
+        nThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < nThreads; ++i) {
+        workers.emplace_back([this, i]() {
+            WorkerProc(i);
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bStop = true;
+    }
+    cv.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+unsigned ThreadPool::GetThreadCount() const {
+    return static_cast<unsigned>(workers.size());
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        tasks.push_back(std::move(task));
+    }
+    cv.notify_one();
+}
+
+void ThreadPool::ParallelFor(std::size_t nCount, const std::function<void(std::size_t, std::size_t)> &func, std::size_t nMinChunk) {
+    if ( nCount == 0 ) {
+        return;
+    }
+    nMinChunk = std::max<std::size_t>(1, nMinChunk);
+    // a few chunks per thread evens out uneven rows
+    const auto nMaxChunks = static_cast<std::size_t>(workers.size() + 1) * 4;
+    const auto nWanted = std::clamp<std::size_t>(nCount / nMinChunk, 1, nMaxChunks);
+    const auto nChunkSize = (nCount + nWanted - 1) / nWanted;
+    // the rounded up chunks may cover the range in fewer; none starts past its end
+    const auto nChunks = (nCount + nChunkSize - 1) / nChunkSize;
+    if ( nChunks == 1 ) {
+        func(0, nCount);
+        return;
+    }
+
+    // shared with the helpers: one may start after all chunks are done
+    struct Job {
+        std::atomic<std::size_t> nNext{0};
+        std::atomic<std::size_t> nDone{0};
+        std::mutex mtx;
+        std::condition_variable cv;
+    };
+    const auto pJob = std::make_shared<Job>();
+    auto worker = [pJob, &func, nCount, nChunks, nChunkSize]() {
+        std::size_t nFinished = 0;
+        for (;;) {
+            const auto nChunk = pJob->nNext++;
+            if ( nChunk >= nChunks ) {
+                break;
+            }
+            const auto nBegin = nChunk * nChunkSize;
+            func(nBegin, std::min(nCount, nBegin + nChunkSize));
+            ++nFinished;
+        }
+        if ( nFinished > 0 && (pJob->nDone += nFinished) == nChunks ) {
+            std::lock_guard<std::mutex> lock(pJob->mtx);
+            pJob->cv.notify_all();
+        }
+    };
+
+    const auto nHelpers = std::min<std::size_t>(workers.size(), nChunks - 1);
+    for (std::size_t i = 0; i < nHelpers; ++i) {
+        Submit(worker);
+    }
+    worker();
+
+    // every chunk is taken now and runs on a thread that got to it, a nested
+    // ParallelFor included; other queued tasks (frame consumers) are not ours
+    // to run, the caller may be a capture thread
+    std::unique_lock<std::mutex> lock(pJob->mtx);
+    pJob->cv.wait(lock, [&]() { return pJob->nDone == nChunks; });
+}
+
+bool ThreadPool::SetThreadConfig(const ThreadConfig &config, std::string &error) {
+    if ( ! TestThreadConfig(config, error) ) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        threadConfig = config;
+        ++nConfigGeneration;
+    }
+    cv.notify_all();
+    return true;
+}
+
+ThreadPool &ThreadPool::Global() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::WorkerProc(unsigned nIndex) {
+    SetCurrentThreadName("poa-pool-" + std::to_string(nIndex));
+    unsigned nGeneration = 0;
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [&]() { return bStop || ! tasks.empty() || nGeneration != nConfigGeneration; });
+            if ( nGeneration != nConfigGeneration ) {
+                const auto config = threadConfig;
+                nGeneration = nConfigGeneration;
+                lock.unlock();
+                // checked by SetThreadConfig()
+                std::string error;
+                ApplyThreadConfig(config, error);
+                continue;
+            }
+            if ( bStop && tasks.empty() ) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <vector>
+
+#include "threadconfig.h"
+
+
+//
+// fixed set of worker threads for the image processing stages
+// ParallelFor() splits a range into chunks and blocks until all chunks ran;
+// the calling thread works on chunks too, so nested calls cannot starve. it
+// only ever runs chunks of its own call, never other queued tasks.
+//
+class ThreadPool {
+public:
+    // nThreads 0: one per hardware thread
+    explicit ThreadPool(unsigned nThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned GetThreadCount() const;
+
+    // queue a task, runs on a worker
+    void Submit(std::function<void()> task);
+
+    // func(begin, end) over [0, nCount), at least nMinChunk items per call
+    void ParallelFor(std::size_t nCount, const std::function<void(std::size_t, std::size_t)> &func, std::size_t nMinChunk = 1);
+
+    // affinity and scheduling of the workers, checked on a scratch thread
+    // first. idle workers apply it at once, busy ones after their task.
+    bool SetThreadConfig(const ThreadConfig &config, std::string &error);
+
+    // process wide pool
+    static ThreadPool &Global();
+
+private:
+    void WorkerProc(unsigned nIndex);
+
+    std::vector<std::thread> workers;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<std::function<void()>> tasks;
+    bool bStop;
+    ThreadConfig threadConfig;
+    unsigned nConfigGeneration;
+};
+
+#endif // THREADPOOL_H